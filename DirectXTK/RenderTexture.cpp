@@ -34,7 +34,8 @@ RenderTexture::RenderTexture(DXGI_FORMAT format) noexcept :
     m_clearColor{},
     m_format(format),
     m_width(0),
-    m_height(0)
+    m_height(0),
+    m_provider(nullptr)
 {
 }
 
@@ -95,17 +96,39 @@ void RenderTexture::SizeResources(size_t width, size_t height)
     if (!m_device)
         return;
 
+    // Hand the old target back to the provider; it is reused once the GPU has finished with it
+    if (m_provider && m_resource)
+    {
+        m_provider->ReleaseRenderTarget(GetResourceDesc(m_width, m_height), GetClearValue(), std::move(m_resource), m_state);
+    }
+
     m_width = m_height = 0;
 
-    auto const heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    if (m_provider)
+    {
+        m_resource = m_provider->AcquireRenderTarget(GetResourceDesc(width, height), GetClearValue(), m_state);
+    }
+    else
+    {
+        CreateResource(width, height);
+    }
 
-    const D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(m_format,
-        static_cast<UINT64>(width),
-        static_cast<UINT>(height),
-        1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+    // Create RTV.
+    m_device->CreateRenderTargetView(m_resource.Get(), nullptr, m_rtvDescriptor);
 
-    D3D12_CLEAR_VALUE clearValue = { m_format, {} };
-    memcpy(clearValue.Color, m_clearColor, sizeof(clearValue.Color));
+    // Create SRV.
+    m_device->CreateShaderResourceView(m_resource.Get(), nullptr, m_srvDescriptor);
+
+    m_width = width;
+    m_height = height;
+}
+
+void RenderTexture::CreateResource(size_t width, size_t height)
+{
+    auto const heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+
+    const D3D12_RESOURCE_DESC desc = GetResourceDesc(width, height);
+    const D3D12_CLEAR_VALUE clearValue = GetClearValue();
 
     m_state = D3D12_RESOURCE_STATE_RENDER_TARGET;
 
@@ -118,21 +141,28 @@ void RenderTexture::SizeResources(size_t width, size_t height)
     );
 
     SetDebugObjectName(m_resource.Get(), L"RenderTexture RT");
+}
 
-    // Create RTV.
-    m_device->CreateRenderTargetView(m_resource.Get(), nullptr, m_rtvDescriptor);
-
-    // Create SRV.
-    m_device->CreateShaderResourceView(m_resource.Get(), nullptr, m_srvDescriptor);
+D3D12_RESOURCE_DESC RenderTexture::GetResourceDesc(size_t width, size_t height) const noexcept
+{
+    return CD3DX12_RESOURCE_DESC::Tex2D(m_format,
+        static_cast<UINT64>(width),
+        static_cast<UINT>(height),
+        1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+}
 
-    m_width = width;
-    m_height = height;
+D3D12_CLEAR_VALUE RenderTexture::GetClearValue() const noexcept
+{
+    D3D12_CLEAR_VALUE clearValue = { m_format, {} };
+    memcpy(clearValue.Color, m_clearColor, sizeof(clearValue.Color));
+    return clearValue;
 }
 
 void RenderTexture::ReleaseDevice() noexcept
 {
     m_resource.Reset();
     m_device.Reset();
+    m_provider = nullptr;
 
     m_state = D3D12_RESOURCE_STATE_COMMON;
     m_width = m_height = 0;
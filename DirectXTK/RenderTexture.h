@@ -17,6 +17,21 @@
 
 namespace DX
 {
+    // Supplies render targets to a RenderTexture in place of creating a committed resource on each resize.
+    class IRenderTargetProvider
+    {
+    public:
+        virtual ~IRenderTargetProvider() = default;
+
+        // Get a target matching desc, returning the state it is in.
+        virtual Microsoft::WRL::ComPtr<ID3D12Resource> AcquireRenderTarget(const D3D12_RESOURCE_DESC& desc,
+            const D3D12_CLEAR_VALUE& clearValue, D3D12_RESOURCE_STATES& state) = 0;
+
+        // Take back a target that may still be in use by the frame being recorded.
+        virtual void ReleaseRenderTarget(const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE& clearValue,
+            Microsoft::WRL::ComPtr<ID3D12Resource> resource, D3D12_RESOURCE_STATES state) = 0;
+    };
+
     class RenderTexture
     {
     public:
@@ -33,6 +48,9 @@ namespace DX
 
         void SizeResources(size_t width, size_t height);
 
+        // Take render targets from provider rather than creating a committed resource on each resize.
+        void SetProvider(_In_opt_ IRenderTargetProvider* provider) noexcept { m_provider = provider; }
+
         void ReleaseDevice() noexcept;
 
         void TransitionTo(_In_ ID3D12GraphicsCommandList* commandList, D3D12_RESOURCE_STATES afterState);
@@ -68,6 +86,10 @@ namespace DX
         DXGI_FORMAT GetFormat() const noexcept { return m_format; }
 
     private:
+        void CreateResource(size_t width, size_t height);
+        D3D12_RESOURCE_DESC GetResourceDesc(size_t width, size_t height) const noexcept;
+        D3D12_CLEAR_VALUE GetClearValue() const noexcept;
+
         Microsoft::WRL::ComPtr<ID3D12Device>                m_device;
         Microsoft::WRL::ComPtr<ID3D12Resource>              m_resource;
         D3D12_RESOURCE_STATES                               m_state;
@@ -79,5 +101,7 @@ namespace DX
 
         size_t                                              m_width;
         size_t                                              m_height;
+
+        IRenderTargetProvider*                              m_provider;
     };
 }
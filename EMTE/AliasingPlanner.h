@@ -0,0 +1,110 @@
+//
+// AliasingPlanner.h - Packs transient resources with disjoint lifetimes into one heap
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+
+namespace DX
+{
+    // Assigns heap offsets to transient resources so that any two whose lifetimes overlap never overlap in memory,
+    // while resources that are never alive at the same time may share it. Lifetimes are inclusive ranges of pass
+    // indices. This is purely CPU-side bookkeeping; it knows nothing about the graphics API.
+    class AliasingPlanner
+    {
+    public:
+        struct Request
+        {
+            uint64_t    size;
+            uint64_t    alignment;      // a power of two
+            uint32_t    firstUse;
+            uint32_t    lastUse;
+        };
+
+        struct Plan
+        {
+            std::vector<uint64_t>   offsets;        // one per request, in request order
+            uint64_t                heapSize = 0;   // bytes needed to hold every request at its offset
+            uint64_t                unaliasedSize = 0;  // bytes needed with a separate allocation per request
+
+            // Alignment padding between packed resources can make the heap the larger of the two.
+            uint64_t GetSavedBytes() const noexcept { return (heapSize < unaliasedSize) ? unaliasedSize - heapSize : 0; }
+        };
+
+        // Largest resources are placed first, each at the lowest offset that does not collide with a resource already
+        // placed whose lifetime overlaps its own.
+        static Plan Build(std::span<const Request> requests)
+        {
+            Plan plan;
+            plan.offsets.assign(requests.size(), 0);
+
+            std::vector<size_t> order(requests.size());
+            std::iota(order.begin(), order.end(), size_t(0));
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                {
+                    return requests[a].size > requests[b].size;
+                });
+
+            struct Range
+            {
+                uint64_t begin;
+                uint64_t end;
+            };
+
+            std::vector<size_t> placed;
+            std::vector<Range> occupied;
+            for (auto const index : order)
+            {
+                auto const& request = requests[index];
+                if (request.firstUse > request.lastUse || request.alignment == 0
+                    || (request.alignment & (request.alignment - 1)) != 0)
+                {
+                    throw std::invalid_argument("AliasingPlanner request");
+                }
+
+                plan.unaliasedSize += AlignUp(request.size, request.alignment);
+
+                // Memory in use by anything alive at the same time as this request
+                occupied.clear();
+                for (auto const other : placed)
+                {
+                    auto const& live = requests[other];
+                    if (live.firstUse <= request.lastUse && request.firstUse <= live.lastUse)
+                    {
+                        occupied.push_back(Range{ plan.offsets[other], plan.offsets[other] + live.size });
+                    }
+                }
+                std::sort(occupied.begin(), occupied.end(), [](Range const& a, Range const& b) { return a.begin < b.begin; });
+
+                // Walk the occupied ranges in address order until the request fits in a gap
+                uint64_t offset = 0;
+                for (auto const& range : occupied)
+                {
+                    if (offset + request.size <= range.begin)
+                        break;
+
+                    offset = std::max(offset, AlignUp(range.end, request.alignment));
+                }
+
+                plan.offsets[index] = offset;
+                plan.heapSize = std::max(plan.heapSize, offset + request.size);
+                placed.push_back(index);
+            }
+
+            return plan;
+        }
+
+        static constexpr uint64_t AlignUp(uint64_t value, uint64_t alignment) noexcept
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+    };
+}
@@ -0,0 +1,203 @@
+//
+// AsyncPipelineCompiler.h - Compiles pipelines on worker threads, with fallbacks drawn in their place until ready
+//
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // Compiles pipelines without blocking the caller. Each request moves through these states:
+    //
+    //     Compiling - queued for, or being compiled on, a JobSystem worker
+    //     Compiled  - waiting for the next Update to make it available
+    //     Ready     - Resolve returns it
+    //     Failed    - compiling threw; Resolve returns its fallback instead, forever
+    //
+    // A pipeline only becomes Ready in Update, so every draw recorded between two Updates resolves a request the
+    // same way, however the workers progress. Until then, Resolve walks the request's fallback chain to the first
+    // Ready pipeline, or returns null, in which case the draw should be skipped.
+    //
+    // Request and Update must be called from one thread. Resolve may be called from several at once, but not
+    // concurrently with Request or Update.
+    //
+    // TBackend must provide:
+    //     using Description = ...;
+    //     using Pipeline = ...;
+    //     Pipeline Compile(Description const& description);     // called on worker threads concurrently
+    template<typename TBackend>
+    class AsyncPipelineCompiler
+    {
+    public:
+        using Description = typename TBackend::Description;
+        using Pipeline = typename TBackend::Pipeline;
+        using Handle = uint32_t;
+
+        static constexpr Handle NoFallback = UINT32_MAX;
+
+        enum class State : uint32_t
+        {
+            Compiling,
+            Compiled,
+            Ready,
+            Failed,
+        };
+
+        AsyncPipelineCompiler(TBackend backend, JobSystem& jobs) :
+            m_backend(std::move(backend)),
+            m_jobs(jobs),
+            m_compileTicks(0)
+        {
+        }
+
+        ~AsyncPipelineCompiler()
+        {
+            // Compile jobs reference their entries, so they must finish before the entries go away.
+            m_jobs.Wait(m_compiles);
+        }
+
+        AsyncPipelineCompiler(AsyncPipelineCompiler const&) = delete;
+        AsyncPipelineCompiler& operator= (AsyncPipelineCompiler const&) = delete;
+
+        // Request a pipeline, drawn with fallback until it is Ready. A fallback must have been requested earlier,
+        // so chains always end. Handles are assigned sequentially from zero.
+        Handle Request(Description description, Handle fallback = NoFallback)
+        {
+            if (fallback != NoFallback && fallback >= m_entries.size())
+            {
+                throw std::invalid_argument("Fallback pipeline must be requested first");
+            }
+
+            const Handle handle = static_cast<Handle>(m_entries.size());
+
+            auto entry = std::make_unique<Entry>();
+            entry->description = std::move(description);
+            entry->fallback = fallback;
+            auto request = entry.get();
+            m_entries.emplace_back(std::move(entry));
+            m_pending.push_back(handle);
+
+            m_jobs.Run([this, request]()
+                {
+                    auto const start = std::chrono::steady_clock::now();
+                    try
+                    {
+                        request->pipeline = m_backend.Compile(request->description);
+                        request->state.store(State::Compiled, std::memory_order_release);
+                    }
+                    catch (...)
+                    {
+                        request->state.store(State::Failed, std::memory_order_release);
+                    }
+                    m_compileTicks.fetch_add(static_cast<uint64_t>((std::chrono::steady_clock::now() - start).count()), std::memory_order_relaxed);
+                }, &m_compiles);
+
+            return handle;
+        }
+
+        // Make newly compiled pipelines Ready. Returns the requests that became Ready or Failed during this call,
+        // in the order they were made.
+        std::span<const Handle> Update()
+        {
+            m_finished.clear();
+
+            size_t kept = 0;
+            for (auto const handle : m_pending)
+            {
+                auto& entry = *m_entries[handle];
+                auto state = entry.state.load(std::memory_order_acquire);
+                if (state == State::Compiled)
+                {
+                    state = State::Ready;
+                    entry.state.store(state, std::memory_order_release);
+                }
+
+                if (state == State::Ready || state == State::Failed)
+                {
+                    m_finished.push_back(handle);
+                }
+                else
+                {
+                    m_pending[kept++] = handle;
+                }
+            }
+            m_pending.resize(kept);
+
+            return m_finished;
+        }
+
+        // Block until every request is Ready or Failed, helping with compiles in the meantime.
+        void Flush()
+        {
+            while (!m_pending.empty())
+            {
+                Update();
+                if (!m_pending.empty() && !m_jobs.TryRunPending())
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        // The pipeline to draw handle's draws with: its own once Ready, else its nearest Ready fallback, else null.
+        Pipeline* Resolve(Handle handle)
+        {
+            while (handle != NoFallback)
+            {
+                auto& entry = *m_entries.at(handle);
+                if (entry.state.load(std::memory_order_acquire) == State::Ready)
+                    return &entry.pipeline;
+
+                handle = entry.fallback;
+            }
+            return nullptr;
+        }
+
+        State GetState(Handle handle) const { return m_entries.at(handle)->state.load(std::memory_order_acquire); }
+        bool IsReady(Handle handle) const { return GetState(handle) == State::Ready; }
+
+        size_t GetRequestCount() const noexcept { return m_entries.size(); }
+        size_t GetPendingCount() const noexcept { return m_pending.size(); }
+
+        // Total CPU time spent compiling across all workers.
+        double GetCompileSeconds() const noexcept
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::duration(
+                static_cast<std::chrono::steady_clock::rep>(m_compileTicks.load(std::memory_order_relaxed)))).count();
+        }
+
+        TBackend& GetBackend() noexcept { return m_backend; }
+
+    private:
+        struct Entry
+        {
+            Description         description{};
+            Pipeline            pipeline{};
+            Handle              fallback = NoFallback;
+            std::atomic<State>  state{ State::Compiling };
+        };
+
+        TBackend                            m_backend;
+        JobSystem&                          m_jobs;
+        JobSystem::Counter                  m_compiles;
+        std::atomic<uint64_t>               m_compileTicks;
+
+        std::deque<std::unique_ptr<Entry>>  m_entries;
+        std::vector<Handle>                 m_pending;
+        std::vector<Handle>                 m_finished;
+    };
+}
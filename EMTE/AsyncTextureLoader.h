@@ -0,0 +1,228 @@
+//
+// AsyncTextureLoader.h - Decodes textures on worker threads and uploads them in batches
+//
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // Loads textures without blocking the caller. Each request moves through these states:
+    //
+    //     Decoding  - the file is being read and decoded on a JobSystem worker
+    //     Decoded   - waiting for the next Update to submit it for upload
+    //     Uploading - its copy has been submitted; waiting for the copy to complete
+    //     Ready     - the image can be used by the GPU
+    //     Failed    - decoding or uploading threw
+    //
+    // Decodes finish in any order, but every request that is decoded by the time Update runs goes into the same upload
+    // batch, and Update reports requests in the order they were made.
+    //
+    // TBackend must provide:
+    //     using Image = ...;
+    //     Image Decode(std::wstring const& path);         // called on worker threads concurrently
+    //     uint64_t Upload(std::span<Image* const> images); // submits one batch; returns a ticket for it
+    //     bool IsUploadComplete(uint64_t ticket);
+    template<typename TBackend>
+    class AsyncTextureLoader
+    {
+    public:
+        using Image = typename TBackend::Image;
+        using Handle = uint32_t;
+
+        enum class State : uint32_t
+        {
+            Decoding,
+            Decoded,
+            Uploading,
+            Ready,
+            Failed,
+        };
+
+        AsyncTextureLoader(TBackend backend, JobSystem& jobs) :
+            m_backend(std::move(backend)),
+            m_jobs(jobs),
+            m_decodeTicks(0)
+        {
+        }
+
+        ~AsyncTextureLoader()
+        {
+            // Decode jobs reference their entries, so they must finish before the entries go away.
+            m_jobs.Wait(m_decodes);
+        }
+
+        AsyncTextureLoader(AsyncTextureLoader const&) = delete;
+        AsyncTextureLoader& operator= (AsyncTextureLoader const&) = delete;
+
+        // Request a texture. Handles are assigned sequentially from zero.
+        Handle Load(std::wstring path)
+        {
+            const Handle handle = static_cast<Handle>(m_entries.size());
+
+            auto entry = std::make_unique<Entry>();
+            entry->path = std::move(path);
+            auto request = entry.get();
+            m_entries.emplace_back(std::move(entry));
+            m_pending.push_back(handle);
+
+            m_jobs.Run([this, request]()
+                {
+                    auto const start = std::chrono::steady_clock::now();
+                    try
+                    {
+                        request->image = m_backend.Decode(request->path);
+                        request->state.store(State::Decoded, std::memory_order_release);
+                    }
+                    catch (...)
+                    {
+                        request->state.store(State::Failed, std::memory_order_release);
+                    }
+                    m_decodeTicks.fetch_add(static_cast<uint64_t>((std::chrono::steady_clock::now() - start).count()), std::memory_order_relaxed);
+                }, &m_decodes);
+
+            return handle;
+        }
+
+        // Submit newly decoded images for upload and collect finished uploads. Returns the requests that became
+        // Ready or Failed during this call, in the order they were made. Call from one thread only.
+        std::span<const Handle> Update()
+        {
+            m_finished.clear();
+
+            // Workers keep decoding while this runs, so the batch is fixed here and only its members are advanced.
+            m_batch.clear();
+            m_batchHandles.clear();
+            for (auto const handle : m_pending)
+            {
+                auto& entry = *m_entries[handle];
+                if (entry.state.load(std::memory_order_acquire) == State::Decoded)
+                {
+                    m_batch.push_back(&entry.image);
+                    m_batchHandles.push_back(handle);
+                }
+            }
+
+            if (!m_batch.empty())
+            {
+                uint64_t ticket = 0;
+                bool submitted = true;
+                try
+                {
+                    ticket = m_backend.Upload(m_batch);
+                }
+                catch (...)
+                {
+                    submitted = false;
+                }
+
+                for (auto const handle : m_batchHandles)
+                {
+                    auto& entry = *m_entries[handle];
+                    entry.ticket = ticket;
+                    entry.state.store(submitted ? State::Uploading : State::Failed, std::memory_order_release);
+                }
+            }
+
+            // Retire everything that has reached a final state, keeping the rest pending in request order.
+            size_t kept = 0;
+            for (auto const handle : m_pending)
+            {
+                auto& entry = *m_entries[handle];
+                auto state = entry.state.load(std::memory_order_acquire);
+                if (state == State::Uploading && m_backend.IsUploadComplete(entry.ticket))
+                {
+                    state = State::Ready;
+                    entry.state.store(state, std::memory_order_release);
+                }
+
+                if (state == State::Ready || state == State::Failed)
+                {
+                    m_finished.push_back(handle);
+                }
+                else
+                {
+                    m_pending[kept++] = handle;
+                }
+            }
+            m_pending.resize(kept);
+
+            return m_finished;
+        }
+
+        // Block until every request is Ready or Failed, helping with decodes in the meantime.
+        void Flush()
+        {
+            while (!m_pending.empty())
+            {
+                Update();
+                if (!m_pending.empty() && !m_jobs.TryRunPending())
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        State GetState(Handle handle) const { return m_entries.at(handle)->state.load(std::memory_order_acquire); }
+        bool IsReady(Handle handle) const { return GetState(handle) == State::Ready; }
+
+        std::wstring const& GetPath(Handle handle) const { return m_entries.at(handle)->path; }
+
+        // The decoded image. Only valid once the request is Ready.
+        Image& GetImage(Handle handle)
+        {
+            if (!IsReady(handle))
+            {
+                throw std::logic_error("Texture is not ready");
+            }
+            return m_entries[handle]->image;
+        }
+
+        size_t GetRequestCount() const noexcept { return m_entries.size(); }
+        size_t GetPendingCount() const noexcept { return m_pending.size(); }
+
+        // Total CPU time spent decoding across all workers.
+        double GetDecodeSeconds() const noexcept
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::duration(
+                static_cast<std::chrono::steady_clock::rep>(m_decodeTicks.load(std::memory_order_relaxed)))).count();
+        }
+
+        TBackend& GetBackend() noexcept { return m_backend; }
+
+    private:
+        struct Entry
+        {
+            std::wstring        path;
+            Image               image{};
+            std::atomic<State>  state{ State::Decoding };
+            uint64_t            ticket = 0;
+        };
+
+        TBackend                            m_backend;
+        JobSystem&                          m_jobs;
+        JobSystem::Counter                  m_decodes;
+        std::atomic<uint64_t>               m_decodeTicks;
+
+        std::deque<std::unique_ptr<Entry>>  m_entries;
+        std::vector<Handle>                 m_pending;
+        std::vector<Handle>                 m_finished;
+        std::vector<Image*>                 m_batch;
+        std::vector<Handle>                 m_batchHandles;
+    };
+}
@@ -0,0 +1,576 @@
+//
+// BoundingVolumeHierarchy.h - A tree of axis-aligned boxes for frustum, ray and nearest-object queries
+//
+
+#pragma once
+
+#include "FrustumCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+
+namespace DX
+{
+    // A point or direction, convertible from any type with x, y and z members.
+    struct BvhPoint
+    {
+        float x, y, z;
+
+        constexpr BvhPoint() noexcept : x(0.f), y(0.f), z(0.f) {}
+        constexpr BvhPoint(float px, float py, float pz) noexcept : x(px), y(py), z(pz) {}
+
+        template<typename T>
+            requires requires(T const& v) { v.x; v.y; v.z; }
+        constexpr BvhPoint(T const& v) noexcept : x(v.x), y(v.y), z(v.z) {}
+
+        float operator[](int axis) const noexcept { return axis == 0 ? x : axis == 1 ? y : z; }
+    };
+
+    // An axis-aligned box by its corners. The default box is empty, and grows to fit whatever is added to it.
+    struct Aabb
+    {
+        BvhPoint min{ +std::numeric_limits<float>::infinity(), +std::numeric_limits<float>::infinity(), +std::numeric_limits<float>::infinity() };
+        BvhPoint max{ -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity() };
+
+        static Aabb FromSphere(BvhPoint center, float radius) noexcept
+        {
+            return Aabb{ { center.x - radius, center.y - radius, center.z - radius }, { center.x + radius, center.y + radius, center.z + radius } };
+        }
+
+        void Grow(BvhPoint point) noexcept
+        {
+            min = { std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z) };
+            max = { std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z) };
+        }
+
+        void Grow(Aabb const& box) noexcept
+        {
+            min = { std::min(min.x, box.min.x), std::min(min.y, box.min.y), std::min(min.z, box.min.z) };
+            max = { std::max(max.x, box.max.x), std::max(max.y, box.max.y), std::max(max.z, box.max.z) };
+        }
+
+        bool IsEmpty() const noexcept { return min.x > max.x; }
+
+        float GetCenter(int axis) const noexcept { return (min[axis] + max[axis]) * 0.5f; }
+
+        float GetSurfaceArea() const noexcept
+        {
+            if (IsEmpty())
+                return 0.f;
+            const float dx = max.x - min.x, dy = max.y - min.y, dz = max.z - min.z;
+            return 2.f * (dx * dy + dy * dz + dz * dx);
+        }
+
+        // Distance from a point outside the box; zero inside it.
+        float GetDistance(BvhPoint point) const noexcept
+        {
+            const float dx = std::max({ min.x - point.x, 0.f, point.x - max.x });
+            const float dy = std::max({ min.y - point.y, 0.f, point.y - max.y });
+            const float dz = std::max({ min.z - point.z, 0.f, point.z - max.z });
+            return std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+    };
+
+    // Indexes a set of objects by their bounding boxes. Objects are identified by their index in the span given
+    // to Build.
+    //
+    // The tree is built top down, splitting each node where the surface area heuristic estimates queries are
+    // cheapest. When objects move, Refit updates the boxes without changing the tree; that is much faster than a
+    // rebuild, but the tree gets worse as objects drift from where they were built, which GetCost measures.
+    // Queries are const and may run concurrently.
+    class BoundingVolumeHierarchy
+    {
+    public:
+        // A node is a leaf when count is non-zero; then its objects are GetObjects()[first, first + count).
+        // Otherwise its children are nodes first and first + 1, which always come after it.
+        struct Node
+        {
+            Aabb        bounds;
+            uint32_t    first;
+            uint32_t    count;
+        };
+
+        struct Hit
+        {
+            uint32_t    object;
+            float       distance;
+        };
+
+        static constexpr uint32_t MaxLeafSize = 8;
+
+        BoundingVolumeHierarchy() noexcept : m_builtCost(0.f) {}
+
+        void Clear() noexcept
+        {
+            m_nodes.clear();
+            m_objects.clear();
+            m_bounds.clear();
+            m_builtCost = 0.f;
+        }
+
+        void Build(std::span<const Aabb> bounds)
+        {
+            if (bounds.size() >= std::numeric_limits<uint32_t>::max() / 2)
+            {
+                throw std::length_error("BoundingVolumeHierarchy object count");
+            }
+
+            m_bounds.assign(bounds.begin(), bounds.end());
+            m_items.resize(bounds.size());
+            for (size_t i = 0; i < bounds.size(); ++i)
+            {
+                m_items[i] = BuildItem{ bounds[i], { bounds[i].GetCenter(0), bounds[i].GetCenter(1), bounds[i].GetCenter(2) }, static_cast<uint32_t>(i) };
+            }
+
+            m_nodes.clear();
+            m_nodes.reserve(bounds.empty() ? 0 : 2 * bounds.size() - 1);
+            if (!bounds.empty())
+            {
+                m_nodes.push_back(Node{ {}, 0, static_cast<uint32_t>(bounds.size()) });
+                Split(0, 0);
+            }
+
+            m_objects.resize(m_items.size());
+            for (size_t i = 0; i < m_items.size(); ++i)
+            {
+                m_objects[i] = m_items[i].object;
+            }
+
+            m_builtCost = GetCost();
+        }
+
+        // Update the boxes of the objects the tree was built with, keeping its structure.
+        void Refit(std::span<const Aabb> bounds)
+        {
+            if (bounds.size() != m_bounds.size())
+            {
+                throw std::invalid_argument("BoundingVolumeHierarchy refit with a different object count");
+            }
+
+            m_bounds.assign(bounds.begin(), bounds.end());
+            for (size_t i = m_nodes.size(); i-- > 0;)
+            {
+                auto& node = m_nodes[i];
+                node.bounds = node.count ? GetLeafBounds(node) : Union(m_nodes[node.first].bounds, m_nodes[node.first + 1].bounds);
+            }
+        }
+
+        // The expected cost of a query, relative to testing the root alone: each node costs its area, and each
+        // object in a leaf the leaf's area, over the root's area.
+        float GetCost() const noexcept
+        {
+            if (m_nodes.empty())
+                return 0.f;
+
+            const float rootArea = m_nodes[0].bounds.GetSurfaceArea();
+            if (rootArea <= 0.f)
+                return 1.f;
+
+            double cost = 0.0;
+            for (auto const& node : m_nodes)
+            {
+                cost += double(node.bounds.GetSurfaceArea()) * (node.count ? node.count : 1);
+            }
+            return static_cast<float>(cost / rootArea);
+        }
+
+        // GetCost when the tree was last built. Refit trees are usually rebuilt once they cost some margin more.
+        float GetBuiltCost() const noexcept { return m_builtCost; }
+
+        size_t GetObjectCount() const noexcept { return m_objects.size(); }
+        std::span<const Node> GetNodes() const noexcept { return m_nodes; }
+        std::span<const uint32_t> GetObjects() const noexcept { return m_objects; }
+
+        // Replace visible with the objects whose boxes are at least partly inside the frustum, in no particular order.
+        // Subtrees wholly inside are taken without testing, and planes a node is wholly inside are not tested again
+        // below it.
+        void QueryFrustum(Frustum const& frustum, std::vector<uint32_t>& visible) const
+        {
+            visible.clear();
+            if (m_nodes.empty())
+                return;
+
+            constexpr uint32_t allPlanes = (1u << Frustum::SideCount) - 1;
+
+            StackEntry stack[c_maxDepth];
+            uint32_t depth = 0;
+            stack[depth++] = { 0, allPlanes };
+            while (depth)
+            {
+                auto const [index, planes] = stack[--depth];
+                auto const& node = m_nodes[index];
+
+                uint32_t straddled = 0;
+                bool outside = false;
+                for (uint32_t side = 0; side < Frustum::SideCount && !outside; ++side)
+                {
+                    if (!(planes & (1u << side)))
+                        continue;
+
+                    auto const& p = frustum.planes[side];
+                    auto const& box = node.bounds;
+                    const float distance = p.a * (box.min.x + box.max.x) * 0.5f + p.b * (box.min.y + box.max.y) * 0.5f
+                        + p.c * (box.min.z + box.max.z) * 0.5f + p.d;
+                    const float reach = (std::fabs(p.a) * (box.max.x - box.min.x) + std::fabs(p.b) * (box.max.y - box.min.y)
+                        + std::fabs(p.c) * (box.max.z - box.min.z)) * 0.5f;
+
+                    outside = distance < -reach;
+                    straddled |= distance < reach ? 1u << side : 0u;
+                }
+                if (outside)
+                    continue;
+
+                if (node.count)
+                {
+                    // Objects of a straddling leaf are tested on their own boxes
+                    for (uint32_t i = node.first; i < node.first + node.count; ++i)
+                    {
+                        if (!straddled || Intersects(frustum, straddled, m_bounds[m_objects[i]]))
+                        {
+                            visible.push_back(m_objects[i]);
+                        }
+                    }
+                    continue;
+                }
+
+                stack[depth++] = { node.first + 1, straddled };
+                stack[depth++] = { node.first, straddled };
+            }
+        }
+
+        // The nearest object along a ray that intersect accepts, if any is closer than maxDistance.
+        // intersect(object, maxDistance) returns the distance to the object along the ray, or infinity for a miss.
+        template<typename TIntersect>
+        std::optional<Hit> Raycast(BvhPoint origin, BvhPoint direction, float maxDistance, TIntersect&& intersect) const
+        {
+            if (m_nodes.empty())
+                return std::nullopt;
+
+            const BvhPoint inverse(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+
+            std::optional<Hit> nearest;
+            float limit = maxDistance;
+
+            // Nodes are pushed with their entry distance, and skipped if a nearer hit is found by the time they pop
+            RayEntry stack[c_maxDepth];
+            uint32_t depth = 0;
+            stack[depth++] = { 0, RayDistance(m_nodes[0].bounds, origin, inverse, limit) };
+            while (depth)
+            {
+                auto const entry = stack[--depth];
+                if (entry.distance >= limit)
+                    continue;
+
+                auto const& node = m_nodes[entry.node];
+                if (node.count)
+                {
+                    for (uint32_t i = node.first; i < node.first + node.count; ++i)
+                    {
+                        const float distance = intersect(m_objects[i], limit);
+                        if (distance >= 0.f && distance < limit)
+                        {
+                            limit = distance;
+                            nearest = Hit{ m_objects[i], distance };
+                        }
+                    }
+                    continue;
+                }
+
+                // Visit the nearer child first, so that the farther is more likely to be pruned
+                uint32_t nearChild = node.first, farChild = node.first + 1;
+                float nearDistance = RayDistance(m_nodes[nearChild].bounds, origin, inverse, limit);
+                float farDistance = RayDistance(m_nodes[farChild].bounds, origin, inverse, limit);
+                if (farDistance < nearDistance)
+                {
+                    std::swap(nearChild, farChild);
+                    std::swap(nearDistance, farDistance);
+                }
+                stack[depth++] = { farChild, farDistance };
+                stack[depth++] = { nearChild, nearDistance };
+            }
+            return nearest;
+        }
+
+        // The nearest object along a ray, by its box.
+        std::optional<Hit> Raycast(BvhPoint origin, BvhPoint direction,
+            float maxDistance = std::numeric_limits<float>::infinity()) const
+        {
+            const BvhPoint inverse(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+            return Raycast(origin, direction, maxDistance, [&](uint32_t object, float limit)
+                {
+                    return RayDistance(m_bounds[object], origin, inverse, limit);
+                });
+        }
+
+        // The object nearest a point, if any is closer than maxDistance. distance(object) is the distance from the
+        // point to the object, which must be no less than the distance to its box.
+        template<typename TDistance>
+        std::optional<Hit> FindNearest(BvhPoint point, float maxDistance, TDistance&& distance) const
+        {
+            if (m_nodes.empty())
+                return std::nullopt;
+
+            std::optional<Hit> nearest;
+            float limit = maxDistance;
+
+            StackEntry stack[c_maxDepth];
+            uint32_t depth = 0;
+            stack[depth++] = { 0, 0 };
+            while (depth)
+            {
+                auto const& node = m_nodes[stack[--depth].node];
+                if (node.bounds.GetDistance(point) >= limit)
+                    continue;
+
+                if (node.count)
+                {
+                    for (uint32_t i = node.first; i < node.first + node.count; ++i)
+                    {
+                        const float objectDistance = distance(m_objects[i]);
+                        if (objectDistance < limit)
+                        {
+                            limit = objectDistance;
+                            nearest = Hit{ m_objects[i], objectDistance };
+                        }
+                    }
+                    continue;
+                }
+
+                uint32_t nearChild = node.first, farChild = node.first + 1;
+                if (m_nodes[farChild].bounds.GetDistance(point) < m_nodes[nearChild].bounds.GetDistance(point))
+                {
+                    std::swap(nearChild, farChild);
+                }
+                stack[depth++] = { farChild, 0 };
+                stack[depth++] = { nearChild, 0 };
+            }
+            return nearest;
+        }
+
+        // The object whose box is nearest a point.
+        std::optional<Hit> FindNearest(BvhPoint point, float maxDistance = std::numeric_limits<float>::infinity()) const
+        {
+            return FindNearest(point, maxDistance, [&](uint32_t object) { return m_bounds[object].GetDistance(point); });
+        }
+
+        // Distance along a ray to where it enters a box, or infinity if it misses it within limit.
+        static float RayDistance(Aabb const& box, BvhPoint origin, BvhPoint inverseDirection, float limit) noexcept
+        {
+            float entry = 0.f, exit = limit;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const float t0 = (box.min[axis] - origin[axis]) * inverseDirection[axis];
+                const float t1 = (box.max[axis] - origin[axis]) * inverseDirection[axis];
+                entry = std::max(entry, std::min(t0, t1));
+                exit = std::min(exit, std::max(t0, t1));
+            }
+            return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+        }
+
+    private:
+        // Enough for any tree Split makes: past c_medianDepth it only halves nodes
+        static constexpr uint32_t c_maxDepth = 72;
+        static constexpr uint32_t c_medianDepth = 32;
+        static constexpr uint32_t c_binCount = 16;
+        // The cost of visiting a node, relative to testing an object
+        static constexpr float c_traversalCost = 1.f;
+
+        struct StackEntry
+        {
+            uint32_t    node;
+            uint32_t    planes;
+        };
+
+        struct BuildItem
+        {
+            Aabb        bounds;
+            BvhPoint    centroid;
+            uint32_t    object;
+        };
+
+        struct RayEntry
+        {
+            uint32_t    node;
+            float       distance;
+        };
+
+        static Aabb Union(Aabb a, Aabb const& b) noexcept
+        {
+            a.Grow(b);
+            return a;
+        }
+
+        static bool Intersects(Frustum const& frustum, uint32_t planes, Aabb const& box) noexcept
+        {
+            for (uint32_t side = 0; side < Frustum::SideCount; ++side)
+            {
+                if (!(planes & (1u << side)))
+                    continue;
+
+                auto const& p = frustum.planes[side];
+                const float distance = p.a * (box.min.x + box.max.x) * 0.5f + p.b * (box.min.y + box.max.y) * 0.5f
+                    + p.c * (box.min.z + box.max.z) * 0.5f + p.d;
+                const float reach = (std::fabs(p.a) * (box.max.x - box.min.x) + std::fabs(p.b) * (box.max.y - box.min.y)
+                    + std::fabs(p.c) * (box.max.z - box.min.z)) * 0.5f;
+                if (distance < -reach)
+                    return false;
+            }
+            return true;
+        }
+
+        Aabb GetLeafBounds(Node const& node) const noexcept
+        {
+            Aabb bounds;
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                bounds.Grow(m_bounds[m_objects[i]]);
+            }
+            return bounds;
+        }
+
+        // Turn the leaf at index into an inner node if splitting it is estimated to be cheaper, and recurse. Works on
+        // m_items, which holds each object's box and centroid so that they are partitioned together with it.
+        void Split(uint32_t index, uint32_t depth)
+        {
+            const uint32_t first = m_nodes[index].first;
+            const uint32_t count = m_nodes[index].count;
+            auto const items = std::span(m_items).subspan(first, count);
+
+            Aabb bounds, centroidBounds;
+            for (auto const& item : items)
+            {
+                bounds.Grow(item.bounds);
+                centroidBounds.Grow(item.centroid);
+            }
+            m_nodes[index].bounds = bounds;
+
+            if (count <= 2)
+                return;
+
+            int axis = 0;
+            for (int a = 1; a < 3; ++a)
+            {
+                if (centroidBounds.max[a] - centroidBounds.min[a] > centroidBounds.max[axis] - centroidBounds.min[axis])
+                    axis = a;
+            }
+
+            uint32_t leftCount = 0;
+            if (depth < c_medianDepth && centroidBounds.max[axis] > centroidBounds.min[axis])
+            {
+                // Binned surface area heuristic on every axis, binning all three in one pass over the objects. Small
+                // nodes, which are most of them, get fewer bins.
+                const uint32_t binCount = std::min(c_binCount, count);
+                float low[3], scale[3];
+                for (int a = 0; a < 3; ++a)
+                {
+                    const float extent = centroidBounds.max[a] - centroidBounds.min[a];
+                    low[a] = centroidBounds.min[a];
+                    scale[a] = extent > 0.f ? binCount / extent : 0.f;
+                }
+
+                Aabb bins[3][c_binCount];
+                uint32_t binCounts[3][c_binCount] = {};
+                for (auto const& item : items)
+                {
+                    for (int a = 0; a < 3; ++a)
+                    {
+                        const uint32_t bin = BinOf(item.centroid[a], low[a], scale[a], binCount);
+                        binCounts[a][bin]++;
+                        bins[a][bin].Grow(item.bounds);
+                    }
+                }
+
+                const float leafCost = float(count);
+                const float parentArea = bounds.GetSurfaceArea();
+
+                float bestCost = std::numeric_limits<float>::infinity();
+                int bestAxis = -1;
+                uint32_t bestBin = 0;
+                for (int a = 0; a < 3; ++a)
+                {
+                    if (scale[a] == 0.f)
+                        continue;
+
+                    // Areas to the right of each boundary, then sweep from the left
+                    float rightAreas[c_binCount] = {};
+                    Aabb right;
+                    for (uint32_t b = binCount - 1; b > 0; --b)
+                    {
+                        right.Grow(bins[a][b]);
+                        rightAreas[b] = right.GetSurfaceArea();
+                    }
+
+                    Aabb left;
+                    uint32_t leftObjects = 0;
+                    for (uint32_t b = 0; b + 1 < binCount; ++b)
+                    {
+                        left.Grow(bins[a][b]);
+                        leftObjects += binCounts[a][b];
+                        const uint32_t rightObjects = count - leftObjects;
+                        if (!leftObjects || !rightObjects)
+                            continue;
+
+                        const float cost = c_traversalCost + (left.GetSurfaceArea() * leftObjects + rightAreas[b + 1] * rightObjects) / parentArea;
+                        if (cost < bestCost)
+                        {
+                            bestCost = cost;
+                            bestAxis = a;
+                            bestBin = b;
+                        }
+                    }
+                }
+
+                if (bestCost >= leafCost && count <= MaxLeafSize)
+                    return;
+
+                // No split has a cost when the node has no area, as for boxes along a line; those are halved below
+                if (bestAxis >= 0)
+                {
+                    auto const middle = std::partition(items.begin(), items.end(),
+                        [&](BuildItem const& item) { return BinOf(item.centroid[bestAxis], low[bestAxis], scale[bestAxis], binCount) <= bestBin; });
+                    leftCount = static_cast<uint32_t>(middle - items.begin());
+                }
+            }
+
+            if (!leftCount)
+            {
+                // Deep, or the centroids coincide: halve the node, which bounds the depth
+                if (count <= MaxLeafSize && !(centroidBounds.max[axis] > centroidBounds.min[axis]))
+                    return;
+
+                leftCount = count / 2;
+                std::nth_element(items.begin(), items.begin() + leftCount, items.end(),
+                    [axis](BuildItem const& a, BuildItem const& b) { return a.centroid[axis] < b.centroid[axis]; });
+            }
+
+            const auto child = static_cast<uint32_t>(m_nodes.size());
+            m_nodes.push_back(Node{ {}, first, leftCount });
+            m_nodes.push_back(Node{ {}, first + leftCount, count - leftCount });
+            m_nodes[index].first = child;
+            m_nodes[index].count = 0;
+
+            Split(child, depth + 1);
+            Split(child + 1, depth + 1);
+        }
+
+        static uint32_t BinOf(float centroid, float low, float scale, uint32_t binCount) noexcept
+        {
+            const auto bin = static_cast<int>((centroid - low) * scale);
+            return static_cast<uint32_t>(std::clamp(bin, 0, int(binCount) - 1));
+        }
+
+        std::vector<Node>       m_nodes;
+        std::vector<uint32_t>   m_objects;
+        std::vector<Aabb>       m_bounds;
+        std::vector<BuildItem>  m_items;
+        float                   m_builtCost;
+    };
+}
@@ -0,0 +1,142 @@
+//
+// Clock.h - Monotonic high-resolution clocks: the platform's, and a manual one for driving timers in tests
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+
+namespace DX
+{
+    // A monotonic clock counting ticks at a fixed frequency.
+    class IClock
+    {
+    public:
+        virtual ~IClock() = default;
+
+        virtual uint64_t GetTicks() noexcept = 0;
+
+        // Ticks per second.
+        virtual uint64_t GetFrequency() noexcept = 0;
+    };
+
+    // QueryPerformanceCounter on Windows; CLOCK_MONOTONIC_RAW elsewhere, which NTP does not slew.
+    class SystemClock final : public IClock
+    {
+    public:
+        SystemClock() :
+            m_frequency(0)
+        {
+#ifdef _WIN32
+            LARGE_INTEGER frequency;
+            if (!QueryPerformanceFrequency(&frequency))
+            {
+                throw std::runtime_error("QueryPerformanceFrequency");
+            }
+            m_frequency = static_cast<uint64_t>(frequency.QuadPart);
+#else
+            timespec resolution;
+            if (clock_getres(CLOCK_MONOTONIC_RAW, &resolution) != 0)
+            {
+                throw std::runtime_error("CLOCK_MONOTONIC_RAW is not available");
+            }
+            m_frequency = 1000000000;
+#endif
+        }
+
+        uint64_t GetTicks() noexcept override
+        {
+#ifdef _WIN32
+            LARGE_INTEGER counter;
+            QueryPerformanceCounter(&counter);
+            return static_cast<uint64_t>(counter.QuadPart);
+#else
+            timespec now;
+            clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+            return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+#endif
+        }
+
+        uint64_t GetFrequency() noexcept override { return m_frequency; }
+
+    private:
+        uint64_t m_frequency;
+    };
+
+    // The process's system clock, shared by every timer that is not given one.
+    inline IClock& GetSystemClock()
+    {
+        static SystemClock clock;
+        return clock;
+    }
+
+    // Block until clock reads at least ticks. The OS wakes sleepers late by up to its timer resolution, so the
+    // last spinTicks are spun out instead. On Windows the sleep uses a high-resolution waitable timer where there
+    // is one, as Sleep is only as fine as the system timer period.
+    inline void SleepUntil(IClock& clock, uint64_t ticks, uint64_t spinTicks)
+    {
+        const uint64_t frequency = clock.GetFrequency();
+        uint64_t now = clock.GetTicks();
+        if (now + spinTicks < ticks)
+        {
+            const uint64_t sleepTicks = ticks - spinTicks - now;
+#ifdef _WIN32
+            struct Timer
+            {
+                HANDLE handle = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+                ~Timer() { if (handle) CloseHandle(handle); }
+            };
+            static thread_local Timer timer;
+
+            // Negative due times are relative, in 100 ns units
+            LARGE_INTEGER dueTime;
+            dueTime.QuadPart = -static_cast<LONGLONG>(sleepTicks * 10000000 / frequency);
+            if (timer.handle && SetWaitableTimerEx(timer.handle, &dueTime, 0, nullptr, nullptr, nullptr, 0))
+            {
+                WaitForSingleObject(timer.handle, INFINITE);
+            }
+            else
+#endif
+            {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(sleepTicks * 1000000000 / frequency));
+            }
+            now = clock.GetTicks();
+        }
+
+        while (now < ticks)
+        {
+            std::this_thread::yield();
+            now = clock.GetTicks();
+        }
+    }
+
+    // Only moves when told to, so timing logic can be stepped through exactly.
+    class ManualClock final : public IClock
+    {
+    public:
+        explicit ManualClock(uint64_t frequency = 10000000, uint64_t ticks = 0) noexcept :
+            m_frequency(frequency),
+            m_ticks(ticks)
+        {
+        }
+
+        uint64_t GetTicks() noexcept override { return m_ticks.load(std::memory_order_acquire); }
+        uint64_t GetFrequency() noexcept override { return m_frequency; }
+
+        void Advance(uint64_t ticks) noexcept { m_ticks.fetch_add(ticks, std::memory_order_acq_rel); }
+        void AdvanceSeconds(double seconds) noexcept { Advance(static_cast<uint64_t>(seconds * static_cast<double>(m_frequency))); }
+
+    private:
+        uint64_t                m_frequency;
+        std::atomic<uint64_t>   m_ticks;
+    };
+}
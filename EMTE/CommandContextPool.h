@@ -0,0 +1,200 @@
+//
+// CommandContextPool.h - Per-frame command allocator/list pairs recycled on fence completion
+//
+
+#pragma once
+
+#include "FenceTimeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+
+namespace DX
+{
+    // Hands out command allocator/list pairs ("contexts") to recording threads. Every context acquired during a frame
+    // is retired with that frame's fence value and only reset once the GPU has reached it.
+    //
+    // TBackend must provide:
+    //     using Allocator = ...;
+    //     using List = ...;
+    //     Allocator CreateAllocator();
+    //     List CreateList(Allocator const& allocator);
+    //     void Reset(Allocator& allocator, List& list);    // leaves list open for recording
+    //     void Close(List& list);
+    template<typename TBackend>
+    class CommandContextPool
+    {
+    public:
+        using Allocator = typename TBackend::Allocator;
+        using List = typename TBackend::List;
+
+        struct Context
+        {
+            Allocator   allocator;
+            List        list;
+            uint32_t    order;
+            uint64_t    retireValue;
+        };
+
+        // A unit of recording work. Passes are recorded concurrently but submitted in the order they are given.
+        struct Pass
+        {
+            const char*                 name;
+            std::function<void(List&)>  record;
+        };
+
+        // Runs body(i) for every i in [0, count), potentially in parallel, and returns once all have finished.
+        using Executor = std::function<void(size_t count, std::function<void(size_t)> const& body)>;
+
+        CommandContextPool(TBackend backend, FenceTimeline& timeline) :
+            m_backend(std::move(backend)),
+            m_timeline(timeline),
+            m_created(0)
+        {
+        }
+
+        CommandContextPool(CommandContextPool const&) = delete;
+        CommandContextPool& operator= (CommandContextPool const&) = delete;
+
+        // Get an open context for recording. order determines where its list is placed in the submitted batch.
+        // Safe to call from any thread: the pool's lock guards its lists, and the timeline may be queried while the
+        // main thread signals it.
+        Context& Acquire(uint32_t order)
+        {
+            std::unique_ptr<Context> context;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                // Retired contexts are in fence order, so only the front needs checking.
+                if (!m_retired.empty() && m_timeline.IsComplete(m_retired.front()->retireValue))
+                {
+                    context = std::move(m_retired.front());
+                    m_retired.pop_front();
+                }
+            }
+
+            const bool recycled = static_cast<bool>(context);
+            if (recycled)
+            {
+                m_backend.Reset(context->allocator, context->list);
+            }
+            else
+            {
+                auto allocator = m_backend.CreateAllocator();
+                auto list = m_backend.CreateList(allocator);
+                context.reset(new Context{ std::move(allocator), std::move(list), 0, 0 });
+            }
+
+            context->order = order;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!recycled)
+            {
+                m_created++;
+            }
+            m_frame.emplace_back(std::move(context));
+            return *m_frame.back();
+        }
+
+        // Route Record through a job scheduler instead of launching a thread per pass.
+        void SetExecutor(Executor executor) { m_executor = std::move(executor); }
+
+        // Record each pass into its own context, running them concurrently. Returns once every list is closed.
+        void Record(std::span<const Pass> passes, uint32_t firstOrder = 0)
+        {
+            m_passTimes.resize(passes.size());
+
+            std::function<void(size_t)> recordPass = [&](size_t index)
+            {
+                auto const start = std::chrono::steady_clock::now();
+
+                auto& context = Acquire(firstOrder + static_cast<uint32_t>(index));
+                passes[index].record(context.list);
+                m_backend.Close(context.list);
+
+                m_passTimes[index] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            };
+
+            auto const start = std::chrono::steady_clock::now();
+
+            if (m_executor)
+            {
+                m_executor(passes.size(), recordPass);
+                m_recordSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                return;
+            }
+
+            std::vector<std::future<void>> workers;
+            workers.reserve(passes.size());
+            for (size_t i = 1; i < passes.size(); ++i)
+            {
+                workers.emplace_back(std::async(std::launch::async, recordPass, i));
+            }
+
+            if (!passes.empty())
+            {
+                recordPass(0);
+            }
+
+            for (auto& worker : workers)
+            {
+                worker.get();
+            }
+
+            m_recordSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // Contexts acquired this frame, sorted into submission order.
+        std::span<const std::unique_ptr<Context>> GetFrameContexts()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::stable_sort(m_frame.begin(), m_frame.end(),
+                [](auto const& a, auto const& b) { return a->order < b->order; });
+            return m_frame;
+        }
+
+        // Retire every context acquired this frame, to be recycled once fenceValue completes.
+        void EndFrame(uint64_t fenceValue)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto& context : m_frame)
+            {
+                context->retireValue = fenceValue;
+                m_retired.emplace_back(std::move(context));
+            }
+            m_frame.clear();
+        }
+
+        TBackend& GetBackend() noexcept { return m_backend; }
+
+        // Number of contexts ever created; stays flat once the pool has warmed up.
+        size_t GetCreatedCount() const noexcept { return m_created; }
+
+        // Wall time of the last Record call, and CPU time spent recording each of its passes.
+        double GetRecordSeconds() const noexcept { return m_recordSeconds; }
+        std::span<const double> GetPassSeconds() const noexcept { return m_passTimes; }
+
+    private:
+        TBackend                                m_backend;
+        FenceTimeline&                          m_timeline;
+        Executor                                m_executor;
+
+        std::mutex                              m_mutex;
+        std::vector<std::unique_ptr<Context>>   m_frame;
+        std::deque<std::unique_ptr<Context>>    m_retired;
+        size_t                                  m_created;
+
+        double                                  m_recordSeconds = 0.0;
+        std::vector<double>                     m_passTimes;
+    };
+}
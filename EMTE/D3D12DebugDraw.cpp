@@ -0,0 +1,83 @@
+//
+// D3D12DebugDraw.cpp - Draws a merged DebugDrawList with one draw call per topology
+//
+
+#include "pch.h"
+#include "D3D12DebugDraw.h"
+
+using namespace DirectX;
+using namespace DX;
+
+namespace
+{
+    constexpr D3D_PRIMITIVE_TOPOLOGY c_primitiveTopologies[] =
+    {
+        D3D_PRIMITIVE_TOPOLOGY_LINELIST,
+        D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST,
+    };
+
+    static_assert(std::size(c_primitiveTopologies) == static_cast<size_t>(DebugTopology::Count));
+}
+
+D3D12DebugDrawRenderer::D3D12DebugDrawRenderer(_In_ ID3D12Device* device, RenderTargetState const& renderTargetState) :
+    m_vertices{},
+    m_vertexCounts{}
+{
+    const EffectPipelineStateDescription lines(
+        &VertexPositionColor::InputLayout,
+        CommonStates::Opaque,
+        CommonStates::DepthDefault,
+        CommonStates::CullNone,
+        renderTargetState,
+        D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE);
+
+    const EffectPipelineStateDescription triangles(
+        &VertexPositionColor::InputLayout,
+        CommonStates::NonPremultiplied,
+        CommonStates::DepthRead,
+        CommonStates::CullNone,
+        renderTargetState,
+        D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE);
+
+    m_effects[static_cast<size_t>(DebugTopology::Lines)] = std::make_unique<BasicEffect>(device, EffectFlags::VertexColor, lines);
+    m_effects[static_cast<size_t>(DebugTopology::Triangles)] = std::make_unique<BasicEffect>(device, EffectFlags::VertexColor, triangles);
+}
+
+void D3D12DebugDrawRenderer::Prepare(_In_opt_ DebugDrawList const* list, D3D12UploadAllocator& allocator)
+{
+    for (size_t topology = 0; topology < c_topologyCount; ++topology)
+    {
+        auto const vertices = list ? list->GetVertices(static_cast<DebugTopology>(topology)) : std::span<const DebugVertex>();
+
+        m_vertexCounts[topology] = static_cast<UINT>(vertices.size());
+        if (vertices.empty())
+        {
+            m_vertices[topology] = {};
+            continue;
+        }
+
+        auto const buffer = allocator.Allocate(vertices.size_bytes(), alignof(DebugVertex));
+        memcpy(buffer.memory, vertices.data(), vertices.size_bytes());
+
+        m_vertices[topology].BufferLocation = buffer.gpuAddress;
+        m_vertices[topology].SizeInBytes = static_cast<UINT>(vertices.size_bytes());
+        m_vertices[topology].StrideInBytes = sizeof(DebugVertex);
+    }
+}
+
+void D3D12DebugDrawRenderer::Draw(_In_ ID3D12GraphicsCommandList* commandList, FXMMATRIX view, CXMMATRIX projection)
+{
+    for (size_t topology = 0; topology < c_topologyCount; ++topology)
+    {
+        if (!m_vertexCounts[topology])
+            continue;
+
+        auto& effect = *m_effects[topology];
+        effect.SetMatrices(XMMatrixIdentity(), view, projection);
+        effect.Apply(commandList);
+
+        commandList->IASetPrimitiveTopology(c_primitiveTopologies[topology]);
+        commandList->IASetVertexBuffers(0, 1, &m_vertices[topology]);
+        commandList->DrawInstanced(m_vertexCounts[topology], 1, 0, 0);
+    }
+}
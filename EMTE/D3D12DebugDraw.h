@@ -0,0 +1,37 @@
+//
+// D3D12DebugDraw.h - Draws a merged DebugDrawList with one draw call per topology
+//
+
+#pragma once
+
+#include "D3D12UploadAllocator.h"
+#include "DebugDraw.h"
+
+
+namespace DX
+{
+    // Lines are drawn opaque and triangles alpha blended, both depth tested against the scene. Labels are not drawn
+    // here: they are text, which the caller draws in screen space.
+    class D3D12DebugDrawRenderer
+    {
+    public:
+        D3D12DebugDrawRenderer(_In_ ID3D12Device* device, DirectX::RenderTargetState const& renderTargetState);
+
+        D3D12DebugDrawRenderer(D3D12DebugDrawRenderer const&) = delete;
+        D3D12DebugDrawRenderer& operator= (D3D12DebugDrawRenderer const&) = delete;
+
+        // Copy the list's vertices into this frame's upload memory. Call once per frame, before Draw is recorded;
+        // a null list draws nothing.
+        void Prepare(_In_opt_ DebugDrawList const* list, D3D12UploadAllocator& allocator);
+
+        // Record at most one draw per topology.
+        void Draw(_In_ ID3D12GraphicsCommandList* commandList, DirectX::FXMMATRIX view, DirectX::CXMMATRIX projection);
+
+    private:
+        static constexpr size_t c_topologyCount = static_cast<size_t>(DebugTopology::Count);
+
+        std::unique_ptr<DirectX::BasicEffect>   m_effects[c_topologyCount];
+        D3D12_VERTEX_BUFFER_VIEW                m_vertices[c_topologyCount];
+        UINT                                    m_vertexCounts[c_topologyCount];
+    };
+}
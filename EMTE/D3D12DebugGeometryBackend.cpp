@@ -0,0 +1,94 @@
+//
+// D3D12DebugGeometryBackend.cpp - Uploads procedural geometry into static buffers on a copy queue
+//
+
+#include "pch.h"
+#include "D3D12DebugGeometryBackend.h"
+
+using namespace DirectX;
+using namespace DX;
+
+using Microsoft::WRL::ComPtr;
+
+static_assert(sizeof(DebugVertex) == sizeof(VertexPositionColor), "DebugVertex must match VertexPositionColor");
+
+void D3D12DebugGeometryBackend::Geometry::Draw(_In_ ID3D12GraphicsCommandList* commandList) const
+{
+    commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINELIST);
+    commandList->IASetVertexBuffers(0, 1, &vertexBufferView);
+    commandList->IASetIndexBuffer(&indexBufferView);
+    commandList->DrawIndexedInstanced(indexCount, 1, 0, 0, 0);
+}
+
+D3D12DebugGeometryBackend::D3D12DebugGeometryBackend(_In_ ID3D12Device* device, _In_ ID3D12CommandQueue* copyQueue, FenceTimeline& copyTimeline) noexcept :
+    m_device(device),
+    m_copyQueue(copyQueue),
+    m_copyTimeline(&copyTimeline)
+{
+}
+
+D3D12DebugGeometryBackend::~D3D12DebugGeometryBackend()
+{
+    for (auto& batch : m_batches)
+    {
+        if (batch.valid())
+        {
+            batch.wait();
+        }
+    }
+}
+
+D3D12DebugGeometryBackend::Geometry D3D12DebugGeometryBackend::Create(std::span<const DebugVertex> vertices, std::span<const uint32_t> indices)
+{
+    if (vertices.empty() || indices.empty())
+    {
+        throw std::invalid_argument("Debug geometry is empty");
+    }
+
+    // Drop batches that have finished
+    m_batches.erase(
+        std::remove_if(m_batches.begin(), m_batches.end(), [](auto const& batch)
+            {
+                return batch.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            }),
+        m_batches.end());
+
+    Geometry geometry;
+
+    ResourceUploadBatch resourceUpload(m_device);
+
+    resourceUpload.Begin(D3D12_COMMAND_LIST_TYPE_COPY);
+
+    ThrowIfFailed(CreateStaticBuffer(m_device, resourceUpload, vertices.data(), vertices.size(), sizeof(DebugVertex),
+        D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, geometry.vertexBuffer.GetAddressOf()));
+    ThrowIfFailed(CreateStaticBuffer(m_device, resourceUpload, indices.data(), indices.size(), sizeof(uint32_t),
+        D3D12_RESOURCE_STATE_INDEX_BUFFER, geometry.indexBuffer.GetAddressOf()));
+
+    m_batches.emplace_back(resourceUpload.End(m_copyQueue));
+
+    geometry.ticket = m_copyTimeline->Signal();
+    if (!geometry.ticket)
+    {
+        throw std::runtime_error("Failed to signal the copy queue");
+    }
+
+    geometry.vertexBuffer->SetName(L"Debug geometry vertices");
+    geometry.indexBuffer->SetName(L"Debug geometry indices");
+
+    geometry.vertexBufferView.BufferLocation = geometry.vertexBuffer->GetGPUVirtualAddress();
+    geometry.vertexBufferView.SizeInBytes = static_cast<UINT>(vertices.size_bytes());
+    geometry.vertexBufferView.StrideInBytes = sizeof(DebugVertex);
+
+    geometry.indexBufferView.BufferLocation = geometry.indexBuffer->GetGPUVirtualAddress();
+    geometry.indexBufferView.SizeInBytes = static_cast<UINT>(indices.size_bytes());
+    geometry.indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+
+    geometry.indexCount = static_cast<UINT>(indices.size());
+
+    return geometry;
+}
+
+bool D3D12DebugGeometryBackend::IsReady(Geometry const& geometry) noexcept
+{
+    return m_copyTimeline->IsComplete(geometry.ticket);
+}
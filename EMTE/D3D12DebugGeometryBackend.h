@@ -0,0 +1,59 @@
+//
+// D3D12DebugGeometryBackend.h - Uploads procedural geometry into static buffers on a copy queue
+//
+
+#pragma once
+
+#include "FenceTimeline.h"
+#include "StaticGeometryCache.h"
+
+#include <future>
+#include <span>
+#include <vector>
+
+
+namespace DX
+{
+    // Backend for StaticGeometryCache. Each shape gets its own default heap vertex and index buffer, copied on the copy
+    // queue. Buffers decay to common once the copy queue is done with them, and are promoted to vertex and index
+    // buffer reads by the direct queue without a barrier.
+    class D3D12DebugGeometryBackend
+    {
+    public:
+        struct Geometry
+        {
+            Microsoft::WRL::ComPtr<ID3D12Resource>      vertexBuffer;
+            Microsoft::WRL::ComPtr<ID3D12Resource>      indexBuffer;
+            D3D12_VERTEX_BUFFER_VIEW                    vertexBufferView = {};
+            D3D12_INDEX_BUFFER_VIEW                     indexBufferView = {};
+            UINT                                        indexCount = 0;
+            uint64_t                                    ticket = 0;     // copy timeline value that marks the upload done
+
+            // Draw as a line list. The caller applies the effect first.
+            void Draw(_In_ ID3D12GraphicsCommandList* commandList) const;
+        };
+
+        D3D12DebugGeometryBackend(_In_ ID3D12Device* device, _In_ ID3D12CommandQueue* copyQueue, FenceTimeline& copyTimeline) noexcept;
+
+        D3D12DebugGeometryBackend(D3D12DebugGeometryBackend&&) = default;
+        D3D12DebugGeometryBackend& operator= (D3D12DebugGeometryBackend&&) = default;
+
+        D3D12DebugGeometryBackend(D3D12DebugGeometryBackend const&) = delete;
+        D3D12DebugGeometryBackend& operator= (D3D12DebugGeometryBackend const&) = delete;
+
+        ~D3D12DebugGeometryBackend();
+
+        Geometry Create(std::span<const DebugVertex> vertices, std::span<const uint32_t> indices);
+        bool IsReady(Geometry const& geometry) noexcept;
+
+    private:
+        ID3D12Device*                                   m_device;
+        ID3D12CommandQueue*                             m_copyQueue;
+        FenceTimeline*                                  m_copyTimeline;
+
+        // Held until each upload has finished, as with D3D12TextureBackend.
+        std::vector<std::future<void>>                  m_batches;
+    };
+
+    using D3D12DebugGeometryCache = StaticGeometryCache<D3D12DebugGeometryBackend>;
+}
@@ -0,0 +1,32 @@
+//
+// D3D12FrameGraph.cpp - Issues a FrameGraph's barriers on a Direct3D 12 command list
+//
+
+#include "pch.h"
+#include "D3D12FrameGraph.h"
+
+using namespace DX;
+
+void DX::RecordBarriers(D3D12CommandList& list,
+    std::span<const FrameGraph::Barrier> barriers,
+    std::span<ID3D12Resource* const> resources)
+{
+    for (auto const& barrier : barriers)
+    {
+        auto resource = resources[barrier.resource];
+
+        // The transient's memory may have held another resource; make it this one's
+        if (barrier.aliasing)
+        {
+            list.states.Alias(resource);
+        }
+
+        if (barrier.before != ResourceState::Undefined)
+        {
+            list.states.Assume(resource, barrier.before);
+        }
+        list.states.Transition(resource, barrier.after);
+    }
+
+    FlushBarriers(list);
+}
@@ -0,0 +1,21 @@
+//
+// D3D12FrameGraph.h - Issues a FrameGraph's barriers on a Direct3D 12 command list
+//
+
+#pragma once
+
+#include "D3D12ResourceStates.h"
+#include "FrameGraph.h"
+
+#include <span>
+
+
+namespace DX
+{
+    // Queue a batch of graph barriers on the list's tracked states and record them with a single ResourceBarrier call.
+    // resources maps each ResourceId to its resource. The state the graph expects each resource to start in is
+    // assumed, so the tracker can check it when the list is submitted.
+    void RecordBarriers(D3D12CommandList& list,
+        std::span<const FrameGraph::Barrier> barriers,
+        std::span<ID3D12Resource* const> resources);
+}
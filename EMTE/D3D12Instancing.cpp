@@ -0,0 +1,53 @@
+//
+// D3D12Instancing.cpp - Per-frame instance buffers for the effects' instanced shaders
+//
+
+#include "pch.h"
+#include "D3D12Instancing.h"
+
+using namespace DirectX;
+using namespace DX;
+
+namespace
+{
+    const D3D12_INPUT_ELEMENT_DESC c_instancedElements[] =
+    {
+        { "SV_Position", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL",      0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD",    0, DXGI_FORMAT_R32G32_FLOAT,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "InstMatrix",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "InstMatrix",  1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "InstMatrix",  2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+    };
+
+    static_assert(sizeof(GeometricPrimitive::VertexType) == sizeof(VertexPositionNormalTexture));
+    static_assert(sizeof(InstanceTransform) == sizeof(XMFLOAT3X4));
+}
+
+const D3D12_INPUT_LAYOUT_DESC DX::c_instancedInputLayout =
+{
+    c_instancedElements,
+    static_cast<UINT>(std::size(c_instancedElements))
+};
+
+void D3D12InstanceBuffer::Upload(InstanceBatcher const& batcher, D3D12UploadAllocator& allocator)
+{
+    const size_t size = batcher.GetUploadSize();
+    if (!size)
+    {
+        m_view = {};
+        return;
+    }
+
+    auto const buffer = allocator.Allocate(size, alignof(InstanceTransform));
+    batcher.Pack(buffer.memory);
+
+    m_view.BufferLocation = buffer.gpuAddress;
+    m_view.SizeInBytes = static_cast<UINT>(size);
+    m_view.StrideInBytes = sizeof(InstanceTransform);
+}
+
+void D3D12InstanceBuffer::Bind(_In_ ID3D12GraphicsCommandList* commandList) const
+{
+    commandList->IASetVertexBuffers(1, 1, &m_view);
+}
@@ -0,0 +1,34 @@
+//
+// D3D12Instancing.h - Per-frame instance buffers for the effects' instanced shaders
+//
+
+#pragma once
+
+#include "D3D12UploadAllocator.h"
+#include "InstanceBatcher.h"
+
+
+namespace DX
+{
+    // The input layout of an instanced GeometricPrimitive: its vertices in slot 0, and an InstanceTransform per
+    // instance in slot 1. Pipelines built with it need an effect created with EffectFlags::Instancing.
+    extern const D3D12_INPUT_LAYOUT_DESC c_instancedInputLayout;
+
+    // Holds one frame's instance transforms in upload memory.
+    class D3D12InstanceBuffer
+    {
+    public:
+        D3D12InstanceBuffer() noexcept : m_view{} {}
+
+        // Copy the batcher's transforms, in batch order, into this frame's upload memory. The batcher must be sorted.
+        void Upload(InstanceBatcher const& batcher, D3D12UploadAllocator& allocator);
+
+        // Bind the transforms to slot 1. Each batch then draws with its first instance as the start instance location.
+        void Bind(_In_ ID3D12GraphicsCommandList* commandList) const;
+
+        bool IsEmpty() const noexcept { return m_view.SizeInBytes == 0; }
+
+    private:
+        D3D12_VERTEX_BUFFER_VIEW    m_view;
+    };
+}
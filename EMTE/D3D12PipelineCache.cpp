@@ -0,0 +1,191 @@
+//
+// D3D12PipelineCache.cpp - Creates pipeline state objects through a PipelineCache saved between runs
+//
+
+#include "pch.h"
+#include "D3D12PipelineCache.h"
+
+using namespace DirectX;
+using namespace DX;
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    void AddRenderTargetBlend(PipelineHasher& hasher, D3D12_RENDER_TARGET_BLEND_DESC const& blend) noexcept
+    {
+        hasher.Add(blend.BlendEnable).Add(blend.LogicOpEnable)
+            .Add(blend.SrcBlend).Add(blend.DestBlend).Add(blend.BlendOp)
+            .Add(blend.SrcBlendAlpha).Add(blend.DestBlendAlpha).Add(blend.BlendOpAlpha)
+            .Add(blend.LogicOp).Add(blend.RenderTargetWriteMask);
+    }
+
+    void AddStencilOp(PipelineHasher& hasher, D3D12_DEPTH_STENCILOP_DESC const& op) noexcept
+    {
+        hasher.Add(op.StencilFailOp).Add(op.StencilDepthFailOp).Add(op.StencilPassOp).Add(op.StencilFunc);
+    }
+}
+
+PipelineCacheIdentity DX::GetPipelineCacheIdentity(_In_ ID3D12Device* device, _In_ IDXGIFactory4* factory)
+{
+    ComPtr<IDXGIAdapter1> adapter;
+    ThrowIfFailed(factory->EnumAdapterByLuid(device->GetAdapterLuid(), IID_PPV_ARGS(adapter.GetAddressOf())));
+
+    DXGI_ADAPTER_DESC1 desc;
+    ThrowIfFailed(adapter->GetDesc1(&desc));
+
+    // The driver version is only reported through the D3D10-era interface check
+    LARGE_INTEGER driverVersion = {};
+    if (FAILED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion)))
+    {
+        driverVersion.QuadPart = 0;
+    }
+
+    return PipelineCacheIdentity{ desc.VendorId, desc.DeviceId, desc.SubSysId, desc.Revision,
+        static_cast<uint64_t>(driverVersion.QuadPart) };
+}
+
+uint64_t DX::HashPipelineState(EffectPipelineStateDescription const& description,
+    D3D12_SHADER_BYTECODE const& vertexShader, D3D12_SHADER_BYTECODE const& pixelShader) noexcept
+{
+    PipelineHasher hasher;
+
+    auto const& inputLayout = description.inputLayout;
+    hasher.Add(inputLayout.NumElements);
+    for (UINT i = 0; i < inputLayout.NumElements; ++i)
+    {
+        auto const& element = inputLayout.pInputElementDescs[i];
+        hasher.AddString(element.SemanticName).Add(element.SemanticIndex).Add(element.Format)
+            .Add(element.InputSlot).Add(element.AlignedByteOffset).Add(element.InputSlotClass)
+            .Add(element.InstanceDataStepRate);
+    }
+
+    auto const& blend = description.blendDesc;
+    hasher.Add(blend.AlphaToCoverageEnable).Add(blend.IndependentBlendEnable);
+    for (auto const& target : blend.RenderTarget)
+    {
+        AddRenderTargetBlend(hasher, target);
+    }
+
+    auto const& depthStencil = description.depthStencilDesc;
+    hasher.Add(depthStencil.DepthEnable).Add(depthStencil.DepthWriteMask).Add(depthStencil.DepthFunc)
+        .Add(depthStencil.StencilEnable).Add(depthStencil.StencilReadMask).Add(depthStencil.StencilWriteMask);
+    AddStencilOp(hasher, depthStencil.FrontFace);
+    AddStencilOp(hasher, depthStencil.BackFace);
+
+    auto const& rasterizer = description.rasterizerDesc;
+    hasher.Add(rasterizer.FillMode).Add(rasterizer.CullMode).Add(rasterizer.FrontCounterClockwise)
+        .Add(rasterizer.DepthBias).Add(rasterizer.DepthBiasClamp).Add(rasterizer.SlopeScaledDepthBias)
+        .Add(rasterizer.DepthClipEnable).Add(rasterizer.MultisampleEnable).Add(rasterizer.AntialiasedLineEnable)
+        .Add(rasterizer.ForcedSampleCount).Add(rasterizer.ConservativeRaster);
+
+    auto const& targets = description.renderTargetState;
+    hasher.Add(targets.sampleMask).Add(targets.numRenderTargets);
+    for (auto const format : targets.rtvFormats)
+    {
+        hasher.Add(format);
+    }
+    hasher.Add(targets.dsvFormat).Add(targets.sampleDesc.Count).Add(targets.sampleDesc.Quality).Add(targets.nodeMask);
+
+    hasher.Add(description.primitiveTopology).Add(description.stripCutValue);
+
+    hasher.Add(static_cast<uint64_t>(vertexShader.BytecodeLength)).AddBytes(vertexShader.pShaderBytecode, vertexShader.BytecodeLength);
+    hasher.Add(static_cast<uint64_t>(pixelShader.BytecodeLength)).AddBytes(pixelShader.pShaderBytecode, pixelShader.BytecodeLength);
+    return hasher.GetHash();
+}
+
+D3D12PipelineCache::D3D12PipelineCache(_In_ ID3D12Device* device, _In_ IDXGIFactory4* factory, std::filesystem::path path) :
+    m_device(device),
+    m_path(std::move(path)),
+    m_cache(GetPipelineCacheIdentity(device, factory)),
+    m_rejectedCount(0)
+{
+    m_loadResult = m_cache.Load(m_path);
+}
+
+ComPtr<ID3D12PipelineState> D3D12PipelineCache::CreatePipelineState(
+    EffectPipelineStateDescription const& description,
+    _In_ ID3D12RootSignature* rootSignature,
+    D3D12_SHADER_BYTECODE const& vertexShader,
+    D3D12_SHADER_BYTECODE const& pixelShader)
+{
+    auto desc = description.GetDesc();
+    desc.pRootSignature = rootSignature;
+    desc.VS = vertexShader;
+    desc.PS = pixelShader;
+
+    const uint64_t key = HashPipelineState(description, vertexShader, pixelShader);
+
+    // Copy the blob out, as another thread may replace it while this one compiles
+    std::vector<uint8_t> blob;
+    {
+        std::lock_guard lock(m_mutex);
+        if (auto const cached = m_cache.Find(key))
+        {
+            blob = *cached;
+        }
+    }
+
+    ComPtr<ID3D12PipelineState> pipelineState;
+    if (!blob.empty())
+    {
+        desc.CachedPSO = { blob.data(), blob.size() };
+        const HRESULT hr = m_device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pipelineState.ReleaseAndGetAddressOf()));
+        if (SUCCEEDED(hr))
+            return pipelineState;
+
+        // The driver changed without the version we check changing, or the blob does not match the description
+        if (hr != D3D12_ERROR_ADAPTER_NOT_FOUND && hr != D3D12_ERROR_DRIVER_VERSION_MISMATCH && hr != E_INVALIDARG)
+        {
+            ThrowIfFailed(hr);
+        }
+
+        std::lock_guard lock(m_mutex);
+        m_cache.Remove(key);
+        m_rejectedCount++;
+        desc.CachedPSO = {};
+    }
+
+    ThrowIfFailed(m_device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pipelineState.ReleaseAndGetAddressOf())));
+
+    ComPtr<ID3DBlob> compiled;
+    if (SUCCEEDED(pipelineState->GetCachedBlob(compiled.GetAddressOf())))
+    {
+        std::lock_guard lock(m_mutex);
+        m_cache.Store(key, compiled->GetBufferPointer(), compiled->GetBufferSize());
+    }
+    return pipelineState;
+}
+
+void D3D12PipelineCache::Save()
+{
+    std::lock_guard lock(m_mutex);
+    if (m_cache.IsDirty())
+    {
+        m_cache.Save(m_path);
+    }
+}
+
+size_t D3D12PipelineCache::GetEntryCount() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_cache.GetEntryCount();
+}
+
+size_t D3D12PipelineCache::GetHitCount() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_cache.GetHitCount();
+}
+
+size_t D3D12PipelineCache::GetMissCount() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_cache.GetMissCount();
+}
+
+size_t D3D12PipelineCache::GetRejectedCount() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_rejectedCount;
+}
@@ -0,0 +1,61 @@
+//
+// D3D12PipelineCache.h - Creates pipeline state objects through a PipelineCache saved between runs
+//
+
+#pragma once
+
+#include "PipelineCache.h"
+
+#include <filesystem>
+#include <mutex>
+
+
+namespace DX
+{
+    // The adapter a device was created on, and its user-mode driver version.
+    PipelineCacheIdentity GetPipelineCacheIdentity(_In_ ID3D12Device* device, _In_ IDXGIFactory4* factory);
+
+    // A stable key for a pipeline built from an effect description and shaders. Formats, states and the input
+    // layout's semantic names are hashed field by field, and the shaders by their bytecode.
+    uint64_t HashPipelineState(DirectX::EffectPipelineStateDescription const& description,
+        D3D12_SHADER_BYTECODE const& vertexShader, D3D12_SHADER_BYTECODE const& pixelShader) noexcept;
+
+    // Creates pipelines from their cached blobs when the driver accepts them, and compiles and caches them when
+    // not. The root signature is not part of the key; a blob built against another one is rejected by the runtime
+    // and recompiled. Pipelines may be created from several threads at once.
+    //
+    // Only pipelines built from shaders the caller owns can go through it: the DirectXTK effects and batches the game
+    // draws with create their pipelines internally, without a way to pass a cached blob.
+    class D3D12PipelineCache
+    {
+    public:
+        // Load the cache saved at path. A missing, stale or damaged file leaves it empty, or with what could be kept.
+        D3D12PipelineCache(_In_ ID3D12Device* device, _In_ IDXGIFactory4* factory, std::filesystem::path path);
+
+        D3D12PipelineCache(D3D12PipelineCache const&) = delete;
+        D3D12PipelineCache& operator= (D3D12PipelineCache const&) = delete;
+
+        Microsoft::WRL::ComPtr<ID3D12PipelineState> CreatePipelineState(
+            DirectX::EffectPipelineStateDescription const& description,
+            _In_ ID3D12RootSignature* rootSignature,
+            D3D12_SHADER_BYTECODE const& vertexShader,
+            D3D12_SHADER_BYTECODE const& pixelShader);
+
+        // Write the cache back if a pipeline was compiled or a blob dropped since it was loaded or last saved.
+        void Save();
+
+        PipelineCache::LoadResult GetLoadResult() const noexcept { return m_loadResult; }
+        size_t GetEntryCount() const;
+        size_t GetHitCount() const;
+        size_t GetMissCount() const;
+        size_t GetRejectedCount() const;
+
+    private:
+        ID3D12Device*               m_device;
+        std::filesystem::path       m_path;
+        mutable std::mutex          m_mutex;
+        PipelineCache               m_cache;
+        PipelineCache::LoadResult   m_loadResult;
+        size_t                      m_rejectedCount;
+    };
+}
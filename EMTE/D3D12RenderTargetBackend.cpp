@@ -0,0 +1,88 @@
+//
+// D3D12RenderTargetBackend.cpp - Creates committed render targets for a RenderTargetPool
+//
+
+#include "pch.h"
+#include "D3D12RenderTargetBackend.h"
+
+using namespace DirectX;
+using namespace DX;
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    D3D12_RESOURCE_DESC GetResourceDesc(RenderTargetKey const& key) noexcept
+    {
+        return CD3DX12_RESOURCE_DESC::Tex2D(static_cast<DXGI_FORMAT>(key.format),
+            static_cast<UINT64>(key.width),
+            static_cast<UINT>(key.height),
+            1, 1, 1, 0, static_cast<D3D12_RESOURCE_FLAGS>(key.flags));
+    }
+
+    // Targets are created ready to be drawn to, with the key's clear value as their optimized clear value.
+    D3D12_RESOURCE_STATES GetInitialState(RenderTargetKey const& key, D3D12_CLEAR_VALUE& clearValue) noexcept
+    {
+        clearValue = {};
+        clearValue.Format = static_cast<DXGI_FORMAT>(key.format);
+
+        if (key.flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)
+        {
+            clearValue.DepthStencil.Depth = key.clearColor[0];
+            return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+        }
+
+        memcpy(clearValue.Color, key.clearColor, sizeof(clearValue.Color));
+        return D3D12_RESOURCE_STATE_RENDER_TARGET;
+    }
+}
+
+D3D12RenderTargetBackend::Target D3D12RenderTargetBackend::Create(RenderTargetKey const& key)
+{
+    auto const heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    auto const desc = GetResourceDesc(key);
+
+    D3D12_CLEAR_VALUE clearValue;
+    Target target;
+    target.state = GetInitialState(key, clearValue);
+
+    ThrowIfFailed(
+        device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE,
+            &desc,
+            target.state, &clearValue,
+            IID_GRAPHICS_PPV_ARGS(target.resource.ReleaseAndGetAddressOf()))
+    );
+
+    SetDebugObjectName(target.resource.Get(), L"RenderTargetPool RT");
+
+    return target;
+}
+
+RenderTargetKey D3D12RenderTargetBackend::MakeKey(DXGI_FORMAT format, size_t width, size_t height,
+    D3D12_RESOURCE_FLAGS flags, const float clearColor[4]) noexcept
+{
+    RenderTargetKey key;
+    key.format = static_cast<uint32_t>(format);
+    key.width = static_cast<uint32_t>(width);
+    key.height = static_cast<uint32_t>(height);
+    key.flags = static_cast<uint32_t>(flags);
+    memcpy(key.clearColor, clearColor, sizeof(key.clearColor));
+    return key;
+}
+
+ComPtr<ID3D12Resource> D3D12RenderTargetProvider::AcquireRenderTarget(const D3D12_RESOURCE_DESC& desc,
+    const D3D12_CLEAR_VALUE& clearValue, D3D12_RESOURCE_STATES& state)
+{
+    auto target = m_pool.Acquire(D3D12RenderTargetBackend::MakeKey(desc.Format, static_cast<size_t>(desc.Width), desc.Height,
+        desc.Flags, clearValue.Color));
+    state = target.state;
+    return std::move(target.resource);
+}
+
+void D3D12RenderTargetProvider::ReleaseRenderTarget(const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE& clearValue,
+    ComPtr<ID3D12Resource> resource, D3D12_RESOURCE_STATES state)
+{
+    m_pool.Release(D3D12RenderTargetBackend::MakeKey(desc.Format, static_cast<size_t>(desc.Width), desc.Height,
+        desc.Flags, clearValue.Color),
+        D3D12RenderTargetBackend::Target{ std::move(resource), state });
+}
@@ -0,0 +1,48 @@
+//
+// D3D12RenderTargetBackend.h - Creates committed render targets for a RenderTargetPool
+//
+
+#pragma once
+
+#include "RenderTargetPool.h"
+
+
+namespace DX
+{
+    // Creates 2D render (or depth) targets. Targets carry the state they are in, as a pooled target is handed back in
+    // whatever state it was released in rather than the state it was created in.
+    struct D3D12RenderTargetBackend
+    {
+        struct Target
+        {
+            Microsoft::WRL::ComPtr<ID3D12Resource>  resource;
+            D3D12_RESOURCE_STATES                   state = D3D12_RESOURCE_STATE_COMMON;
+        };
+
+        ID3D12Device* device;
+
+        Target Create(RenderTargetKey const& key);
+
+        // Describe a render target for the pool.
+        static RenderTargetKey MakeKey(DXGI_FORMAT format, size_t width, size_t height,
+            D3D12_RESOURCE_FLAGS flags, const float clearColor[4]) noexcept;
+    };
+
+    using D3D12RenderTargetPool = RenderTargetPool<D3D12RenderTargetBackend>;
+
+    // Lets a RenderTexture take its targets from a pool without the toolkit depending on the pool.
+    class D3D12RenderTargetProvider final : public IRenderTargetProvider
+    {
+    public:
+        explicit D3D12RenderTargetProvider(D3D12RenderTargetPool& pool) noexcept : m_pool(pool) {}
+
+        Microsoft::WRL::ComPtr<ID3D12Resource> AcquireRenderTarget(const D3D12_RESOURCE_DESC& desc,
+            const D3D12_CLEAR_VALUE& clearValue, D3D12_RESOURCE_STATES& state) override;
+
+        void ReleaseRenderTarget(const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE& clearValue,
+            Microsoft::WRL::ComPtr<ID3D12Resource> resource, D3D12_RESOURCE_STATES state) override;
+
+    private:
+        D3D12RenderTargetPool& m_pool;
+    };
+}
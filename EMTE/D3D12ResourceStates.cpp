@@ -0,0 +1,104 @@
+//
+// D3D12ResourceStates.cpp - Maps tracked resource states to Direct3D 12 and records their barriers
+//
+
+#include "pch.h"
+#include "D3D12ResourceStates.h"
+
+using namespace DX;
+
+namespace
+{
+    struct StateMapping
+    {
+        ResourceState           state;
+        D3D12_RESOURCE_STATES   d3d12;
+    };
+
+    constexpr StateMapping c_stateMappings[] =
+    {
+        { ResourceState::RenderTarget,              D3D12_RESOURCE_STATE_RENDER_TARGET },
+        { ResourceState::DepthWrite,                D3D12_RESOURCE_STATE_DEPTH_WRITE },
+        { ResourceState::UnorderedAccess,           D3D12_RESOURCE_STATE_UNORDERED_ACCESS },
+        { ResourceState::CopyDest,                  D3D12_RESOURCE_STATE_COPY_DEST },
+        { ResourceState::DepthRead,                 D3D12_RESOURCE_STATE_DEPTH_READ },
+        { ResourceState::PixelShaderResource,       D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE },
+        { ResourceState::NonPixelShaderResource,    D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE },
+        { ResourceState::CopySource,                D3D12_RESOURCE_STATE_COPY_SOURCE },
+    };
+
+    // Barriers are gathered on the stack; longer batches are split across calls
+    constexpr size_t c_maxBatch = 32;
+
+    static_assert(ResourceStateTracker::AllSubresources == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+}
+
+// Undefined and Present both map to D3D12_RESOURCE_STATE_COMMON, which is the same value as PRESENT.
+D3D12_RESOURCE_STATES DX::ToD3D12(ResourceState state) noexcept
+{
+    auto result = D3D12_RESOURCE_STATE_COMMON;
+    for (auto const& mapping : c_stateMappings)
+    {
+        if ((state & mapping.state) == mapping.state)
+        {
+            result |= mapping.d3d12;
+        }
+    }
+    return result;
+}
+
+// COMMON comes back as Present, so that it round trips.
+ResourceState DX::FromD3D12(D3D12_RESOURCE_STATES state) noexcept
+{
+    if (state == D3D12_RESOURCE_STATE_COMMON)
+        return ResourceState::Present;
+
+    auto result = ResourceState::Undefined;
+    for (auto const& mapping : c_stateMappings)
+    {
+        if ((state & mapping.d3d12) == mapping.d3d12)
+        {
+            result = result | mapping.state;
+        }
+    }
+    return result;
+}
+
+void DX::RecordBarriers(_In_ ID3D12GraphicsCommandList* commandList, std::span<const ResourceStateTracker::Barrier> barriers)
+{
+    D3D12_RESOURCE_BARRIER batch[c_maxBatch];
+    UINT count = 0;
+
+    for (auto const& barrier : barriers)
+    {
+        if (count == c_maxBatch)
+        {
+            commandList->ResourceBarrier(count, batch);
+            count = 0;
+        }
+
+        auto resource = const_cast<ID3D12Resource*>(static_cast<const ID3D12Resource*>(barrier.resource));
+        if (barrier.aliasing)
+        {
+            batch[count++] = CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, resource);
+        }
+        else
+        {
+            batch[count++] = CD3DX12_RESOURCE_BARRIER::Transition(resource,
+                ToD3D12(barrier.before), ToD3D12(barrier.after), barrier.subresource);
+        }
+    }
+
+    if (count > 0)
+    {
+        commandList->ResourceBarrier(count, batch);
+    }
+}
+
+void DX::FlushBarriers(D3D12CommandList& list)
+{
+    list.states.Flush([&list](std::span<const ResourceStateTracker::Barrier> barriers)
+        {
+            RecordBarriers(list.Get(), barriers);
+        });
+}
@@ -0,0 +1,32 @@
+//
+// D3D12ResourceStates.h - Maps tracked resource states to Direct3D 12 and records their barriers
+//
+
+#pragma once
+
+#include "ResourceStateTracker.h"
+
+#include <span>
+
+
+namespace DX
+{
+    D3D12_RESOURCE_STATES ToD3D12(ResourceState state) noexcept;
+    ResourceState FromD3D12(D3D12_RESOURCE_STATES state) noexcept;
+
+    // A command list together with the resource states it has recorded transitions for.
+    struct D3D12CommandList
+    {
+        Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>   list;
+        ResourceStateTracker::LocalState                    states;
+
+        ID3D12GraphicsCommandList* Get() const noexcept { return list.Get(); }
+        ID3D12GraphicsCommandList* operator->() const noexcept { return list.Get(); }
+    };
+
+    // Record a batch of tracked barriers. The tracker's resource keys are the ID3D12Resource pointers.
+    void RecordBarriers(_In_ ID3D12GraphicsCommandList* commandList, std::span<const ResourceStateTracker::Barrier> barriers);
+
+    // Record the transitions queued on list since the last flush.
+    void FlushBarriers(D3D12CommandList& list);
+}
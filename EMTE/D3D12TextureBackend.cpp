@@ -0,0 +1,112 @@
+//
+// D3D12TextureBackend.cpp - Decodes texture files and uploads them on a copy queue
+//
+
+#include "pch.h"
+#include "D3D12TextureBackend.h"
+
+using namespace DirectX;
+using namespace DX;
+
+using Microsoft::WRL::ComPtr;
+
+D3D12TextureBackend::D3D12TextureBackend(_In_ ID3D12Device* device, _In_ ID3D12CommandQueue* copyQueue, FenceTimeline& copyTimeline) noexcept :
+    m_device(device),
+    m_copyQueue(copyQueue),
+    m_copyTimeline(&copyTimeline)
+{
+}
+
+D3D12TextureBackend::~D3D12TextureBackend()
+{
+    for (auto& batch : m_batches)
+    {
+        if (batch.valid())
+        {
+            batch.wait();
+        }
+    }
+}
+
+// Read and decode a texture file. Called on worker threads, so only touches the (free threaded) device.
+D3D12TextureBackend::Image D3D12TextureBackend::Decode(std::wstring const& path)
+{
+    Image image;
+
+    auto const extension = path.substr(std::min(path.size(), path.find_last_of(L'.')));
+    if (_wcsicmp(extension.c_str(), L".dds") == 0)
+    {
+        ThrowIfFailed(LoadDDSTextureFromFile(
+            m_device,
+            path.c_str(),
+            image.resource.ReleaseAndGetAddressOf(),
+            image.data,
+            image.subresources,
+            0,
+            nullptr,
+            &image.isCubeMap));
+    }
+    else
+    {
+        // The copy queue cannot generate mips, so WIC images are uploaded with just their top level.
+        D3D12_SUBRESOURCE_DATA subresource = {};
+        ThrowIfFailed(LoadWICTextureFromFile(
+            m_device,
+            path.c_str(),
+            image.resource.ReleaseAndGetAddressOf(),
+            image.data,
+            subresource));
+        image.subresources.push_back(subresource);
+    }
+
+    image.resource->SetName(path.c_str());
+
+    return image;
+}
+
+// Copy a batch of decoded images on the copy queue. The returned ticket is the copy timeline value that marks them done.
+uint64_t D3D12TextureBackend::Upload(std::span<Image* const> images)
+{
+    // Drop batches that have finished
+    m_batches.erase(
+        std::remove_if(m_batches.begin(), m_batches.end(), [](auto const& batch)
+            {
+                return batch.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            }),
+        m_batches.end());
+
+    ResourceUploadBatch resourceUpload(m_device);
+
+    resourceUpload.Begin(D3D12_COMMAND_LIST_TYPE_COPY);
+
+    for (auto image : images)
+    {
+        resourceUpload.Upload(
+            image->resource.Get(),
+            0,
+            image->subresources.data(),
+            static_cast<UINT>(image->subresources.size()));
+    }
+
+    m_batches.emplace_back(resourceUpload.End(m_copyQueue));
+
+    const uint64_t ticket = m_copyTimeline->Signal();
+    if (!ticket)
+    {
+        throw std::runtime_error("Failed to signal the copy queue");
+    }
+
+    // The CPU copies of the texels are no longer needed once they are in the upload heap
+    for (auto image : images)
+    {
+        image->data.reset();
+        image->subresources.clear();
+    }
+
+    return ticket;
+}
+
+bool D3D12TextureBackend::IsUploadComplete(uint64_t ticket) noexcept
+{
+    return m_copyTimeline->IsComplete(ticket);
+}
@@ -0,0 +1,57 @@
+//
+// D3D12TextureBackend.h - Decodes texture files and uploads them on a copy queue
+//
+
+#pragma once
+
+#include "FenceTimeline.h"
+
+#include <future>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+
+namespace DX
+{
+    // Backend for AsyncTextureLoader. Decode reads a DDS, or any format WIC understands, into a committed resource
+    // and its subresource data; Upload copies a batch of those on the copy queue and signals the copy timeline.
+    //
+    // Resources are created in the copy destination state and decay to common once the copy queue is done with them,
+    // so the direct queue can read them as shader resources without a barrier.
+    class D3D12TextureBackend
+    {
+    public:
+        struct Image
+        {
+            Microsoft::WRL::ComPtr<ID3D12Resource>      resource;
+            std::unique_ptr<uint8_t[]>                  data;
+            std::vector<D3D12_SUBRESOURCE_DATA>         subresources;
+            bool                                        isCubeMap = false;
+        };
+
+        D3D12TextureBackend(_In_ ID3D12Device* device, _In_ ID3D12CommandQueue* copyQueue, FenceTimeline& copyTimeline) noexcept;
+
+        D3D12TextureBackend(D3D12TextureBackend&&) = default;
+        D3D12TextureBackend& operator= (D3D12TextureBackend&&) = default;
+
+        D3D12TextureBackend(D3D12TextureBackend const&) = delete;
+        D3D12TextureBackend& operator= (D3D12TextureBackend const&) = delete;
+
+        ~D3D12TextureBackend();
+
+        Image Decode(std::wstring const& path);
+        uint64_t Upload(std::span<Image* const> images);
+        bool IsUploadComplete(uint64_t ticket) noexcept;
+
+    private:
+        ID3D12Device*                                   m_device;
+        ID3D12CommandQueue*                             m_copyQueue;
+        FenceTimeline*                                  m_copyTimeline;
+
+        // ResourceUploadBatch keeps its staging memory alive until the future it returns is ready, and that
+        // future blocks in its destructor, so each one is held here until it has finished.
+        std::vector<std::future<void>>                  m_batches;
+    };
+}
@@ -0,0 +1,33 @@
+//
+// D3D12UploadAllocator.cpp - A persistently mapped upload buffer sub-allocated per frame by an UploadAllocator
+//
+
+#include "pch.h"
+#include "D3D12UploadAllocator.h"
+
+using namespace DirectX;
+using namespace DX;
+
+D3D12UploadAllocator::D3D12UploadAllocator(_In_ ID3D12Device* device, uint64_t capacity) :
+    m_allocator(Backend{}, capacity)
+{
+    // Buffers are placed on 64KB boundaries, which covers every alignment dynamic data needs
+    const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+    const auto desc = CD3DX12_RESOURCE_DESC::Buffer(capacity);
+    ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(m_buffer.ReleaseAndGetAddressOf())));
+    m_buffer->SetName(L"D3D12UploadAllocator");
+
+    // Upload heaps may stay mapped for their whole lifetime
+    auto& backend = m_allocator.GetBackend();
+    const CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(m_buffer->Map(0, &readRange, reinterpret_cast<void**>(&backend.memory)));
+    backend.gpuAddress = m_buffer->GetGPUVirtualAddress();
+}
+
+D3D12UploadAllocator::Allocation D3D12UploadAllocator::Backend::Fallback(size_t size, size_t alignment)
+{
+    fallbacks.push_back(GraphicsMemory::Get().Allocate(size, alignment));
+    auto& fallback = fallbacks.back();
+    return Allocation{ fallback.Memory(), fallback.GpuAddress(), size };
+}
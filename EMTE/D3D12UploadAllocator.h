@@ -0,0 +1,66 @@
+//
+// D3D12UploadAllocator.h - A persistently mapped upload buffer sub-allocated per frame by an UploadAllocator
+//
+
+#pragma once
+
+#include "UploadAllocator.h"
+
+#include <vector>
+
+
+namespace DX
+{
+    // Dynamic data for the frame being recorded. When the ring is full, allocations come from GraphicsMemory
+    // instead, so a spike costs a page allocation rather than a stall; these are counted as fallbacks.
+    //
+    // Only the game's own dynamic data goes through the ring. SpriteBatch, PrimitiveBatch and the effects' constant
+    // buffers are allocated inside DirectXTK straight from GraphicsMemory, which offers no hook to redirect them.
+    class D3D12UploadAllocator
+    {
+    public:
+        struct Allocation
+        {
+            void*                       memory;
+            D3D12_GPU_VIRTUAL_ADDRESS   gpuAddress;
+            size_t                      size;
+        };
+
+        D3D12UploadAllocator(_In_ ID3D12Device* device, uint64_t capacity);
+
+        D3D12UploadAllocator(D3D12UploadAllocator const&) = delete;
+        D3D12UploadAllocator& operator= (D3D12UploadAllocator const&) = delete;
+
+        Allocation Allocate(size_t size, size_t alignment) { return m_allocator.Allocate(size, alignment); }
+        Allocation AllocateConstants(size_t size) { return Allocate(size, UploadAllocator::ConstantBufferAlignment); }
+
+        // Close the frame; its memory is reused once the GPU reaches fenceValue.
+        void EndFrame(uint64_t fenceValue) { m_allocator.EndFrame(fenceValue); }
+        void Retire(uint64_t completedValue) noexcept { m_allocator.Retire(completedValue); }
+
+        UploadAllocator const& GetRing() const noexcept { return m_allocator.GetRing(); }
+
+        // Allocations of the last frame that did not fit in the ring.
+        size_t GetLastFrameFallbackCount() const noexcept { return m_allocator.GetLastFrameFallbackCount(); }
+
+    private:
+        struct Backend
+        {
+            using Allocation = D3D12UploadAllocator::Allocation;
+
+            uint8_t*                                memory = nullptr;
+            D3D12_GPU_VIRTUAL_ADDRESS               gpuAddress = 0;
+
+            // Held until the frame ends, then released to GraphicsMemory, which keeps their pages until the GPU
+            // has finished with the frame
+            std::vector<DirectX::GraphicsResource>  fallbacks;
+
+            Allocation Ring(uint64_t offset, size_t size) noexcept { return Allocation{ memory + offset, gpuAddress + offset, size }; }
+            Allocation Fallback(size_t size, size_t alignment);
+            void ReleaseFallbacks() noexcept { fallbacks.clear(); }
+        };
+
+        Microsoft::WRL::ComPtr<ID3D12Resource>      m_buffer;
+        FallbackUploadAllocator<Backend>            m_allocator;
+    };
+}
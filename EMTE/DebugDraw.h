@@ -0,0 +1,372 @@
+//
+// DebugDraw.h - Immediate-mode debug primitives gathered from any thread and merged once per frame
+//
+
+#pragma once
+
+#include "DebugGeometry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // Each topology is drawn with its own effect, so the merged list holds one vertex stream per topology.
+    enum class DebugTopology : uint32_t
+    {
+        Lines,
+        Triangles,
+        Count
+    };
+
+    // A point, convertible from any vector type with x, y and z members.
+    struct DebugPoint
+    {
+        float x, y, z;
+
+        constexpr DebugPoint() noexcept : x(0.f), y(0.f), z(0.f) {}
+        constexpr DebugPoint(float px, float py, float pz) noexcept : x(px), y(py), z(pz) {}
+
+        template<typename T>
+            requires requires(T const& v) { v.x; v.y; v.z; }
+        constexpr DebugPoint(T const& v) noexcept : x(v.x), y(v.y), z(v.z) {}
+    };
+
+    // An RGBA color, convertible from any type with x, y, z and w members, or an array f of four floats.
+    struct DebugColor
+    {
+        float r, g, b, a;
+
+        constexpr DebugColor() noexcept : r(1.f), g(1.f), b(1.f), a(1.f) {}
+        constexpr DebugColor(float cr, float cg, float cb, float ca = 1.f) noexcept : r(cr), g(cg), b(cb), a(ca) {}
+
+        template<typename T>
+            requires requires(T const& c) { c.x; c.y; c.z; c.w; }
+        constexpr DebugColor(T const& c) noexcept : r(c.x), g(c.y), b(c.z), a(c.w) {}
+
+        template<typename T>
+            requires requires(T const& c) { c.f[3]; }
+        constexpr DebugColor(T const& c) noexcept : r(c.f[0]), g(c.f[1]), b(c.f[2]), a(c.f[3]) {}
+    };
+
+    struct DebugLabel
+    {
+        DebugPoint      position;
+        DebugColor      color;
+        std::string     text;
+    };
+
+    // One frame's primitives, merged from every thread.
+    struct DebugDrawList
+    {
+        std::vector<DebugVertex>    streams[static_cast<size_t>(DebugTopology::Count)];
+        std::vector<DebugLabel>     labels;
+
+        std::span<const DebugVertex> GetVertices(DebugTopology topology) const noexcept
+        {
+            return streams[static_cast<size_t>(topology)];
+        }
+
+        size_t GetLineCount() const noexcept { return GetVertices(DebugTopology::Lines).size() / 2; }
+        size_t GetTriangleCount() const noexcept { return GetVertices(DebugTopology::Triangles).size() / 3; }
+
+        void clear() noexcept
+        {
+            for (auto& stream : streams)
+            {
+                stream.clear();
+            }
+            labels.clear();
+        }
+    };
+
+    // One thread's primitives. Aligned so that threads filling neighbouring buffers do not share cache lines.
+    struct alignas(64) DebugDrawBuffer
+    {
+        std::vector<DebugVertex>    streams[static_cast<size_t>(DebugTopology::Count)];
+        std::vector<DebugLabel>     labels;
+    };
+
+    // Collects debug lines, shapes and labels from any number of threads without locking.
+    //
+    // Each thread that draws gets a buffer of its own the first time it asks for a Writer, and keeps it from frame to
+    // frame. Threads beyond maxThreads share one more buffer, and lock it for each primitive they draw. Merge concatenates every thread's buffers into one DebugDrawList, so a frame's primitives of each topology
+    // are drawn with a single draw call however many threads produced them. Merge must not run while any thread is
+    // still drawing; call it once the frame's producers have been joined.
+    //
+    // Merged lists are shared, so a renderer can hold on to one while the next frame is being drawn. A list is
+    // reused, keeping its allocations, once nothing else holds it.
+    class DebugDraw
+    {
+    public:
+        // Draws into one thread's buffer. Only use it on the thread that obtained it.
+        class Writer
+        {
+        public:
+            void Line(DebugPoint const& a, DebugPoint const& b, DebugColor const& color = {})
+            {
+                auto const lock = Lock();
+                AddLine(a, b, color);
+            }
+
+            void Triangle(DebugPoint const& a, DebugPoint const& b, DebugPoint const& c, DebugColor const& color = {})
+            {
+                auto const lock = Lock();
+                auto& stream = Stream(DebugTopology::Triangles);
+                stream.push_back(Vertex(a, color));
+                stream.push_back(Vertex(b, color));
+                stream.push_back(Vertex(c, color));
+            }
+
+            // The edges of an axis-aligned box.
+            void Box(DebugPoint const& min, DebugPoint const& max, DebugColor const& color = {})
+            {
+                DebugPoint corners[8];
+                for (uint32_t corner = 0; corner < 8; ++corner)
+                {
+                    corners[corner] = DebugPoint((corner & 1) ? max.x : min.x, (corner & 2) ? max.y : min.y,
+                        (corner & 4) ? max.z : min.z);
+                }
+
+                auto const lock = Lock();
+                Edges(corners, color);
+            }
+
+            // A sphere drawn as three circles, one around each axis.
+            void Sphere(DebugPoint const& center, float radius, DebugColor const& color = {}, uint32_t segments = 32)
+            {
+                segments = std::max(segments, 3u);
+                auto const lock = Lock();
+                auto& stream = Stream(DebugTopology::Lines);
+                stream.reserve(stream.size() + size_t(segments) * 6);
+
+                constexpr float c_twoPi = 6.28318530718f;
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    DebugPoint previous = CirclePoint(center, radius, axis, 0.f);
+                    for (uint32_t i = 1; i <= segments; ++i)
+                    {
+                        const DebugPoint next = CirclePoint(center, radius, axis, c_twoPi * float(i) / float(segments));
+                        AddLine(previous, next, color);
+                        previous = next;
+                    }
+                }
+            }
+
+            // The edges of the volume a camera sees, given the inverse of its view-projection matrix. TMatrix is any
+            // 4x4 matrix with m[row][column], used with row vectors as DirectXMath does.
+            template<typename TMatrix>
+            void Frustum(TMatrix const& inverseViewProjection, DebugColor const& color = {})
+            {
+                DebugPoint corners[8];
+                for (uint32_t corner = 0; corner < 8; ++corner)
+                {
+                    const float in[4] = { (corner & 1) ? 1.f : -1.f, (corner & 2) ? 1.f : -1.f, (corner & 4) ? 1.f : 0.f, 1.f };
+                    float out[4] = {};
+                    for (int column = 0; column < 4; ++column)
+                    {
+                        for (int row = 0; row < 4; ++row)
+                        {
+                            out[column] += in[row] * inverseViewProjection.m[row][column];
+                        }
+                    }
+                    corners[corner] = DebugPoint(out[0] / out[3], out[1] / out[3], out[2] / out[3]);
+                }
+
+                auto const lock = Lock();
+                Edges(corners, color);
+            }
+
+            void Label(DebugPoint const& position, std::string text, DebugColor const& color = {})
+            {
+                auto const lock = Lock();
+                m_buffer->labels.push_back(DebugLabel{ position, color, std::move(text) });
+            }
+
+        private:
+            friend class DebugDraw;
+
+            Writer(DebugDrawBuffer& buffer, std::mutex* mutex) noexcept : m_buffer(&buffer), m_mutex(mutex) {}
+
+            // Only the shared buffer is locked; a thread's own needs no lock.
+            std::unique_lock<std::mutex> Lock()
+            {
+                return m_mutex ? std::unique_lock<std::mutex>(*m_mutex) : std::unique_lock<std::mutex>();
+            }
+
+            void AddLine(DebugPoint const& a, DebugPoint const& b, DebugColor const& color)
+            {
+                auto& stream = Stream(DebugTopology::Lines);
+                stream.push_back(Vertex(a, color));
+                stream.push_back(Vertex(b, color));
+            }
+
+            std::vector<DebugVertex>& Stream(DebugTopology topology) noexcept
+            {
+                return m_buffer->streams[static_cast<size_t>(topology)];
+            }
+
+            static DebugVertex Vertex(DebugPoint const& p, DebugColor const& c) noexcept
+            {
+                return DebugVertex{ { p.x, p.y, p.z }, { c.r, c.g, c.b, c.a } };
+            }
+
+            static DebugPoint CirclePoint(DebugPoint const& center, float radius, int axis, float angle) noexcept
+            {
+                const float u = std::cos(angle) * radius;
+                const float v = std::sin(angle) * radius;
+                switch (axis)
+                {
+                case 0:     return DebugPoint(center.x, center.y + u, center.z + v);
+                case 1:     return DebugPoint(center.x + u, center.y, center.z + v);
+                default:    return DebugPoint(center.x + u, center.y + v, center.z);
+                }
+            }
+
+            // The 12 edges of a box whose corners are indexed by their x, y and z bits.
+            void Edges(DebugPoint const (&corners)[8], DebugColor const& color)
+            {
+                for (uint32_t corner = 0; corner < 8; ++corner)
+                {
+                    for (uint32_t bit = 1; bit < 8; bit <<= 1)
+                    {
+                        if (!(corner & bit))
+                        {
+                            AddLine(corners[corner], corners[corner | bit], color);
+                        }
+                    }
+                }
+            }
+
+            DebugDrawBuffer*    m_buffer;
+            std::mutex*         m_mutex;
+        };
+
+        explicit DebugDraw(uint32_t maxThreads = 64) :
+            m_id(NextId()),
+            m_claimed(0),
+            m_mergedLines(0),
+            m_mergedTriangles(0)
+        {
+            // One buffer per thread, and the shared one after them
+            m_buffers.reserve(size_t(maxThreads) + 1);
+            for (uint32_t i = 0; i <= maxThreads; ++i)
+            {
+                m_buffers.emplace_back(std::make_unique<DebugDrawBuffer>());
+            }
+        }
+
+        DebugDraw(DebugDraw const&) = delete;
+        DebugDraw& operator= (DebugDraw const&) = delete;
+
+        // The calling thread's writer. Cheap, but a thread drawing many primitives should keep the one it gets.
+        Writer GetWriter()
+        {
+            // Each thread remembers the buffer it claimed from every DebugDraw it has used
+            thread_local std::vector<std::pair<uint64_t, DebugDrawBuffer*>> t_buffers;
+            for (auto const& [id, buffer] : t_buffers)
+            {
+                if (id == m_id)
+                    return MakeWriter(buffer);
+            }
+
+            const uint32_t slot = m_claimed.fetch_add(1, std::memory_order_acq_rel);
+            auto buffer = m_buffers[std::min<size_t>(slot, m_buffers.size() - 1)].get();
+            t_buffers.emplace_back(m_id, buffer);
+            return MakeWriter(buffer);
+        }
+
+        // Gather everything drawn since the last Merge into one list, and empty the threads' buffers.
+        std::shared_ptr<const DebugDrawList> Merge()
+        {
+            auto list = AcquireList();
+
+            const size_t count = std::min<size_t>(m_claimed.load(std::memory_order_acquire), m_buffers.size());
+            for (size_t topology = 0; topology < static_cast<size_t>(DebugTopology::Count); ++topology)
+            {
+                size_t total = 0;
+                size_t largest = 0;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    auto const size = m_buffers[i]->streams[topology].size();
+                    total += size;
+                    largest = (size > m_buffers[largest]->streams[topology].size()) ? i : largest;
+                }
+
+                if (total == 0)
+                    continue;
+
+                // The biggest contribution is swapped in rather than copied, and that thread gets the list's old,
+                // empty vector to fill next time
+                auto& stream = list->streams[topology];
+                stream.swap(m_buffers[largest]->streams[topology]);
+                stream.reserve(total);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    auto& source = m_buffers[i]->streams[topology];
+                    stream.insert(stream.end(), source.begin(), source.end());
+                    source.clear();
+                }
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto& labels = m_buffers[i]->labels;
+                std::move(labels.begin(), labels.end(), std::back_inserter(list->labels));
+                labels.clear();
+            }
+
+            m_mergedLines.store(list->GetLineCount(), std::memory_order_relaxed);
+            m_mergedTriangles.store(list->GetTriangleCount(), std::memory_order_relaxed);
+            return list;
+        }
+
+        // Threads that have drawn so far, and the size of the last merged list. Safe to read while a merge is running.
+        uint32_t GetThreadCount() const noexcept { return m_claimed.load(std::memory_order_relaxed); }
+        size_t GetMergedLineCount() const noexcept { return m_mergedLines.load(std::memory_order_relaxed); }
+        size_t GetMergedTriangleCount() const noexcept { return m_mergedTriangles.load(std::memory_order_relaxed); }
+
+    private:
+        static uint64_t NextId() noexcept
+        {
+            static std::atomic<uint64_t> s_next(1);
+            return s_next.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Writer MakeWriter(DebugDrawBuffer* buffer) noexcept
+        {
+            return Writer(*buffer, (buffer == m_buffers.back().get()) ? &m_sharedMutex : nullptr);
+        }
+
+        std::shared_ptr<DebugDrawList> AcquireList()
+        {
+            for (auto const& list : m_lists)
+            {
+                if (list.use_count() == 1)
+                {
+                    list->clear();
+                    return list;
+                }
+            }
+            return m_lists.emplace_back(std::make_shared<DebugDrawList>());
+        }
+
+        const uint64_t                                  m_id;
+        std::vector<std::unique_ptr<DebugDrawBuffer>>   m_buffers;
+        std::atomic<uint32_t>                           m_claimed;
+        std::mutex                                      m_sharedMutex;
+        std::vector<std::shared_ptr<DebugDrawList>>     m_lists;
+        std::atomic<size_t>                             m_mergedLines;
+        std::atomic<size_t>                             m_mergedTriangles;
+    };
+}
@@ -0,0 +1,207 @@
+//
+// DebugGeometry.h - Procedural debug shapes, generated once per set of parameters
+//
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+
+
+namespace DX
+{
+    // Position and color, laid out like DirectX::VertexPositionColor.
+    struct DebugVertex
+    {
+        float   position[3];
+        float   color[4];
+    };
+
+    // A shape as an indexed line list.
+    struct DebugGeometryData
+    {
+        std::vector<DebugVertex>    vertices;
+        std::vector<uint32_t>       indices;
+
+        void clear() noexcept
+        {
+            vertices.clear();
+            indices.clear();
+        }
+
+        size_t GetByteSize() const noexcept
+        {
+            return vertices.size() * sizeof(DebugVertex) + indices.size() * sizeof(uint32_t);
+        }
+
+        void AddLine(DebugVertex const& a, DebugVertex const& b)
+        {
+            const auto first = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(a);
+            vertices.push_back(b);
+            indices.push_back(first);
+            indices.push_back(first + 1);
+        }
+    };
+
+    // A shape's kind and parameters. Parameters are compared bit for bit, so that equal parameters always give equal
+    // keys and different parameters never do, whatever their hashes.
+    struct DebugGeometryKey
+    {
+        static constexpr size_t MaxValues = 12;
+
+        uint32_t    kind = 0;
+        uint32_t    count = 0;
+        uint32_t    values[MaxValues] = {};
+
+        bool operator== (DebugGeometryKey const&) const noexcept = default;
+    };
+
+    inline DebugGeometryKey MakeDebugGeometryKey(uint32_t kind, std::initializer_list<float> values)
+    {
+        if (values.size() > DebugGeometryKey::MaxValues)
+        {
+            throw std::length_error("Too many debug geometry parameters");
+        }
+
+        DebugGeometryKey key;
+        key.kind = kind;
+        key.count = static_cast<uint32_t>(values.size());
+        std::transform(values.begin(), values.end(), key.values, [](float value) { return std::bit_cast<uint32_t>(value); });
+        return key;
+    }
+
+    // 64-bit FNV-1a over a key's kind and parameters.
+    struct DebugGeometryKeyHash
+    {
+        size_t operator()(DebugGeometryKey const& key) const noexcept
+        {
+            uint64_t hash = 14695981039346656037ull;
+            auto const mix = [&hash](uint32_t value)
+                {
+                    hash ^= value;
+                    hash *= 1099511628211ull;
+                };
+
+            mix(key.kind);
+            for (uint32_t i = 0; i < key.count; ++i)
+            {
+                mix(key.values[i]);
+            }
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    // Square grid of lines on the XZ plane: divisions + 1 lines in each direction, spanning halfExtent either side of
+    // origin.
+    struct DebugGrid
+    {
+        uint32_t    divisions = 20;
+        float       halfExtent = 2.f;
+        float       origin[3] = {};
+        float       color[4] = { 1.f, 1.f, 1.f, 1.f };
+
+        bool operator== (DebugGrid const&) const noexcept = default;
+
+        DebugGeometryKey GetKey() const
+        {
+            return MakeDebugGeometryKey(1, { static_cast<float>(divisions), halfExtent, origin[0], origin[1], origin[2],
+                color[0], color[1], color[2], color[3] });
+        }
+
+        void Generate(DebugGeometryData& data) const
+        {
+            data.vertices.reserve(data.vertices.size() + (size_t(divisions) + 1) * 4);
+            data.indices.reserve(data.indices.size() + (size_t(divisions) + 1) * 4);
+
+            for (uint32_t i = 0; i <= divisions; ++i)
+            {
+                const float offset = (divisions > 0 ? (float(i) / float(divisions)) * 2.f - 1.f : 0.f) * halfExtent;
+
+                // Line along Z, then along X
+                data.AddLine(Vertex(offset, -halfExtent), Vertex(offset, halfExtent));
+                data.AddLine(Vertex(-halfExtent, offset), Vertex(halfExtent, offset));
+            }
+        }
+
+    private:
+        DebugVertex Vertex(float x, float z) const noexcept
+        {
+            return DebugVertex{ { origin[0] + x, origin[1], origin[2] + z }, { color[0], color[1], color[2], color[3] } };
+        }
+    };
+
+    // X, Y and Z axes from origin, colored red, green and blue.
+    struct DebugAxes
+    {
+        float       length = 1.f;
+        float       origin[3] = {};
+
+        bool operator== (DebugAxes const&) const noexcept = default;
+
+        DebugGeometryKey GetKey() const
+        {
+            return MakeDebugGeometryKey(2, { length, origin[0], origin[1], origin[2] });
+        }
+
+        void Generate(DebugGeometryData& data) const
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                DebugVertex start{ { origin[0], origin[1], origin[2] }, { 0.f, 0.f, 0.f, 1.f } };
+                start.color[axis] = 1.f;
+
+                DebugVertex end = start;
+                end.position[axis] += length;
+
+                data.AddLine(start, end);
+            }
+        }
+    };
+
+    // The edges of an axis-aligned box, such as a bounding box.
+    struct DebugBox
+    {
+        float       min[3] = { -1.f, -1.f, -1.f };
+        float       max[3] = { 1.f, 1.f, 1.f };
+        float       color[4] = { 1.f, 1.f, 1.f, 1.f };
+
+        bool operator== (DebugBox const&) const noexcept = default;
+
+        DebugGeometryKey GetKey() const
+        {
+            return MakeDebugGeometryKey(3, { min[0], min[1], min[2], max[0], max[1], max[2],
+                color[0], color[1], color[2], color[3] });
+        }
+
+        void Generate(DebugGeometryData& data) const
+        {
+            // Corners share vertices, indexed by their x, y and z bits
+            const auto first = static_cast<uint32_t>(data.vertices.size());
+            for (uint32_t corner = 0; corner < 8; ++corner)
+            {
+                data.vertices.push_back(DebugVertex{
+                    { (corner & 1) ? max[0] : min[0], (corner & 2) ? max[1] : min[1], (corner & 4) ? max[2] : min[2] },
+                    { color[0], color[1], color[2], color[3] } });
+            }
+
+            // An edge joins two corners that differ in one bit
+            for (uint32_t corner = 0; corner < 8; ++corner)
+            {
+                for (uint32_t bit = 1; bit < 8; bit <<= 1)
+                {
+                    if (!(corner & bit))
+                    {
+                        data.indices.push_back(first + corner);
+                        data.indices.push_back(first + (corner | bit));
+                    }
+                }
+            }
+        }
+    };
+}
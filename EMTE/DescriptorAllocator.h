@@ -0,0 +1,174 @@
+//
+// DescriptorAllocator.h - Slot bookkeeping for a bindless descriptor heap
+//
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // Hands out slots in a descriptor heap. The front of the heap holds persistent descriptors, allocated and freed
+    // individually and recycled through a free list; each slot carries a generation that is bumped when it is freed,
+    // so handles that outlive their descriptor are caught rather than silently aliasing a new one. The back of the
+    // heap is a ring of transient descriptors that are allocated each frame and reclaimed once the GPU has finished
+    // with the frame's fence value.
+    //
+    // This only tracks indices; it never touches the heap itself, so it is safe to use without a device.
+    class DescriptorAllocator
+    {
+    public:
+        static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+        struct Handle
+        {
+            uint32_t index = InvalidIndex;
+            uint32_t generation = 0;
+
+            bool IsValid() const noexcept { return index != InvalidIndex; }
+        };
+
+        DescriptorAllocator(uint32_t capacity, uint32_t transientCapacity) :
+            m_persistentCapacity(0),
+            m_transientCapacity(transientCapacity),
+            m_allocatedCount(0),
+            m_transientHead(0),
+            m_transientTail(0),
+            m_transientFrameStart(0)
+        {
+            if (transientCapacity > capacity)
+            {
+                throw std::out_of_range("transientCapacity");
+            }
+
+            m_persistentCapacity = capacity - transientCapacity;
+        }
+
+        DescriptorAllocator(DescriptorAllocator const&) = delete;
+        DescriptorAllocator& operator= (DescriptorAllocator const&) = delete;
+
+        // Allocate a persistent slot. Freed slots are reused before the heap's high water mark is raised.
+        Handle Allocate()
+        {
+            uint32_t index;
+            if (!m_freeList.empty())
+            {
+                index = m_freeList.back();
+                m_freeList.pop_back();
+            }
+            else
+            {
+                if (m_generations.size() >= m_persistentCapacity)
+                {
+                    throw std::runtime_error("DescriptorAllocator is full");
+                }
+
+                index = static_cast<uint32_t>(m_generations.size());
+                m_generations.push_back(0);
+            }
+
+            m_allocatedCount++;
+            return Handle{ index, m_generations[index] };
+        }
+
+        // Return a slot to the free list. The caller must ensure the GPU no longer references it.
+        void Free(Handle handle)
+        {
+            Resolve(handle);
+
+            m_generations[handle.index]++;
+            m_freeList.push_back(handle.index);
+            m_allocatedCount--;
+        }
+
+        bool IsAlive(Handle handle) const noexcept
+        {
+            return handle.index < m_generations.size() && m_generations[handle.index] == handle.generation;
+        }
+
+        // Get the heap index for a handle, throwing if it has been freed.
+        uint32_t Resolve(Handle handle) const
+        {
+            if (!IsAlive(handle))
+            {
+                throw std::invalid_argument("Stale or invalid descriptor handle");
+            }
+            return handle.index;
+        }
+
+        // Allocate count contiguous transient slots for the current frame, returning the first heap index.
+        uint32_t AllocateTransient(uint32_t count)
+        {
+            if (count == 0 || count > m_transientCapacity)
+            {
+                throw std::out_of_range("AllocateTransient");
+            }
+
+            // Allocations never straddle the end of the ring; skip the remainder if it is too small.
+            uint64_t start = m_transientHead;
+            const uint64_t offset = start % m_transientCapacity;
+            if (offset + count > m_transientCapacity)
+            {
+                start += m_transientCapacity - offset;
+            }
+
+            if (start + count - m_transientTail > m_transientCapacity)
+            {
+                throw std::runtime_error("DescriptorAllocator transient ring is full");
+            }
+
+            m_transientHead = start + count;
+            return m_persistentCapacity + static_cast<uint32_t>(start % m_transientCapacity);
+        }
+
+        // Close the current frame's transient allocations; they are reclaimed once fenceValue completes.
+        void EndFrame(uint64_t fenceValue)
+        {
+            if (m_transientHead != m_transientFrameStart)
+            {
+                m_transientFrames.emplace_back(fenceValue, m_transientHead);
+                m_transientFrameStart = m_transientHead;
+            }
+        }
+
+        // Reclaim transient slots from every frame whose fence value has been reached.
+        void RetireTransient(uint64_t completedValue) noexcept
+        {
+            while (!m_transientFrames.empty() && m_transientFrames.front().first <= completedValue)
+            {
+                m_transientTail = m_transientFrames.front().second;
+                m_transientFrames.pop_front();
+            }
+        }
+
+        uint32_t GetCapacity() const noexcept { return m_persistentCapacity + m_transientCapacity; }
+        uint32_t GetPersistentCapacity() const noexcept { return m_persistentCapacity; }
+        uint32_t GetTransientCapacity() const noexcept { return m_transientCapacity; }
+
+        // Persistent slots currently allocated, and the highest number ever in use at once.
+        uint32_t GetAllocatedCount() const noexcept { return m_allocatedCount; }
+        uint32_t GetHighWaterMark() const noexcept { return static_cast<uint32_t>(m_generations.size()); }
+
+        uint32_t GetTransientInUse() const noexcept { return static_cast<uint32_t>(m_transientHead - m_transientTail); }
+
+    private:
+        uint32_t                                    m_persistentCapacity;
+        uint32_t                                    m_transientCapacity;
+
+        // Persistent region: one generation per slot ever handed out, and the slots available for reuse.
+        std::vector<uint32_t>                       m_generations;
+        std::vector<uint32_t>                       m_freeList;
+        uint32_t                                    m_allocatedCount;
+
+        // Transient ring, tracked with monotonic offsets so that full and empty are distinguishable.
+        uint64_t                                    m_transientHead;
+        uint64_t                                    m_transientTail;
+        uint64_t                                    m_transientFrameStart;
+        std::deque<std::pair<uint64_t, uint64_t>>   m_transientFrames;
+    };
+}
@@ -38,21 +38,108 @@ namespace
     }
 }
 
+// Constructor for D3D12FenceBackend.
+D3D12FenceBackend::D3D12FenceBackend(_In_ ID3D12Device* device, _In_ ID3D12CommandQueue* commandQueue, uint64_t initialValue) :
+    m_commandQueue(commandQueue)
+{
+    ThrowIfFailed(device->CreateFence(initialValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
+
+    m_fence->SetName(L"DeviceResources");
+}
+
+bool D3D12FenceBackend::Signal(uint64_t value) noexcept
+{
+    return SUCCEEDED(m_commandQueue->Signal(m_fence.Get(), value));
+}
+
+uint64_t D3D12FenceBackend::GetCompletedValue() noexcept
+{
+    return m_fence->GetCompletedValue();
+}
+
+bool D3D12FenceBackend::Wait(uint64_t value, uint32_t timeoutMs) noexcept
+{
+    if (m_fence->GetCompletedValue() >= value)
+        return true;
+
+    // One event per thread, so that concurrent waits never consume each other's wake-ups. A wait that timed out
+    // leaves its registration behind, and that may still set the event for a lower value, so a wake-up only ends the
+    // wait once the fence has actually reached value.
+    static thread_local Microsoft::WRL::Wrappers::Event s_event(CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE));
+    if (!s_event.IsValid())
+        return false;
+
+    const ULONGLONG start = GetTickCount64();
+    for (;;)
+    {
+        if (FAILED(m_fence->SetEventOnCompletion(value, s_event.Get())))
+            return false;
+
+        DWORD remaining = INFINITE;
+        if (timeoutMs != INFINITE)
+        {
+            const ULONGLONG elapsed = GetTickCount64() - start;
+            remaining = (elapsed >= timeoutMs) ? 0 : static_cast<DWORD>(timeoutMs - elapsed);
+        }
+
+        const DWORD result = WaitForSingleObjectEx(s_event.Get(), remaining, FALSE);
+        if (m_fence->GetCompletedValue() >= value)
+            return true;
+
+        if (result != WAIT_OBJECT_0 || remaining == 0)
+            return false;
+    }
+}
+
+D3D12CommandBackend::Allocator D3D12CommandBackend::CreateAllocator()
+{
+    Allocator allocator;
+    ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(allocator.GetAddressOf())));
+    allocator->SetName(L"CommandContextPool");
+    return allocator;
+}
+
+D3D12CommandBackend::List D3D12CommandBackend::CreateList(Allocator const& allocator)
+{
+    List list{ nullptr, ResourceStateTracker::LocalState(*stateTracker) };
+    ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), nullptr, IID_PPV_ARGS(list.list.GetAddressOf())));
+    list->SetName(L"CommandContextPool");
+    return list;
+}
+
+void D3D12CommandBackend::Reset(Allocator& allocator, List& list)
+{
+    ThrowIfFailed(allocator->Reset());
+    ThrowIfFailed(list->Reset(allocator.Get(), nullptr));
+    list.states.Reset();
+    list.states.SetInheritGlobal(false);
+}
+
+void D3D12CommandBackend::Close(List& list)
+{
+    ThrowIfFailed(list->Close());
+}
+
 // Constructor for DeviceResources.
 DeviceResources::DeviceResources(
     DXGI_FORMAT backBufferFormat,
     DXGI_FORMAT depthBufferFormat,
     UINT backBufferCount,
     D3D_FEATURE_LEVEL minFeatureLevel,
-    unsigned int flags) noexcept(false) :
+    unsigned int flags,
+    UINT framesInFlight) noexcept(false) :
         m_backBufferIndex(0),
-        m_fenceValues{},
+        m_frameIndex(0),
+        m_frameFenceValues{},
+        m_lastFrameWaitSeconds(0.0),
+        m_mainStates(m_stateTracker),
         m_rtvDescriptorSize(0),
         m_screenViewport{},
         m_scissorRect{},
         m_backBufferFormat(backBufferFormat),
         m_depthBufferFormat(depthBufferFormat),
         m_backBufferCount(backBufferCount),
+        m_framesInFlight(framesInFlight),
         m_d3dMinFeatureLevel(minFeatureLevel),
         m_window(nullptr),
         m_d3dFeatureLevel(D3D_FEATURE_LEVEL_11_0),
@@ -60,6 +147,8 @@ DeviceResources::DeviceResources(
         m_outputSize{0, 0, 1, 1},
         m_colorSpace(DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709),
         m_options(flags),
+        m_maxFrameLatency(1),
+        m_frameLatencyAcquired(false),
         m_deviceNotify(nullptr)
 {
     if (backBufferCount < 2 || backBufferCount > MAX_BACK_BUFFER_COUNT)
@@ -67,10 +156,20 @@ DeviceResources::DeviceResources(
         throw std::out_of_range("invalid backBufferCount");
     }
 
+    if (framesInFlight < 1 || framesInFlight > MAX_FRAMES_IN_FLIGHT)
+    {
+        throw std::out_of_range("invalid framesInFlight");
+    }
+
     if (minFeatureLevel < D3D_FEATURE_LEVEL_11_0)
     {
         throw std::out_of_range("minFeatureLevel too low");
     }
+
+#ifdef _DEBUG
+    m_stateTracker.SetValidation(true);
+#endif
+    m_mainStates.SetInheritGlobal(true);
 }
 
 // Destructor for DeviceResources.
@@ -216,6 +315,15 @@ void DeviceResources::CreateDeviceResources()
 
     m_commandQueue->SetName(L"DeviceResources");
 
+    // Create the copy queue, which uploads resources without stalling the direct queue.
+    D3D12_COMMAND_QUEUE_DESC copyQueueDesc = {};
+    copyQueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    copyQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+
+    ThrowIfFailed(m_d3dDevice->CreateCommandQueue(&copyQueueDesc, IID_PPV_ARGS(m_copyQueue.ReleaseAndGetAddressOf())));
+
+    m_copyQueue->SetName(L"DeviceResources Copy");
+
     // Create descriptor heaps for render target views and depth stencil views.
     D3D12_DESCRIPTOR_HEAP_DESC rtvDescriptorHeapDesc = {};
     rtvDescriptorHeapDesc.NumDescriptors = m_backBufferCount;
@@ -238,13 +346,13 @@ void DeviceResources::CreateDeviceResources()
         m_dsvDescriptorHeap->SetName(L"DeviceResources");
     }
 
-    // Create a command allocator for each back buffer that will be rendered to.
-    for (UINT n = 0; n < m_backBufferCount; n++)
+    // Create a command allocator for each frame that may be in flight on the GPU.
+    for (UINT n = 0; n < m_framesInFlight; n++)
     {
         ThrowIfFailed(m_d3dDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(m_commandAllocators[n].ReleaseAndGetAddressOf())));
 
         wchar_t name[25] = {};
-        swprintf_s(name, L"Render target %u", n);
+        swprintf_s(name, L"Frame %u", n);
         m_commandAllocators[n]->SetName(name);
     }
 
@@ -255,16 +363,17 @@ void DeviceResources::CreateDeviceResources()
     m_commandList->SetName(L"DeviceResources");
 
     // Create a fence for tracking GPU execution progress.
-    ThrowIfFailed(m_d3dDevice->CreateFence(m_fenceValues[m_backBufferIndex], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
-    m_fenceValues[m_backBufferIndex]++;
+    m_fence = std::make_unique<D3D12FenceBackend>(m_d3dDevice.Get(), m_commandQueue.Get());
+    m_frameTimeline.SetBackend(m_fence.get());
 
-    m_fence->SetName(L"DeviceResources");
+    m_copyFence = std::make_unique<D3D12FenceBackend>(m_d3dDevice.Get(), m_copyQueue.Get());
+    m_copyTimeline.SetBackend(m_copyFence.get());
 
-    m_fenceEvent.Attach(CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE));
-    if (!m_fenceEvent.IsValid())
-    {
-        throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
-    }
+    m_frameIndex = 0;
+    std::fill(std::begin(m_frameFenceValues), std::end(m_frameFenceValues), UINT64(0));
+
+    // Create the pool that hands out command lists for recording on other threads.
+    m_contextPool = std::make_unique<ContextPool>(D3D12CommandBackend{ m_d3dDevice.Get(), &m_stateTracker }, m_frameTimeline);
 }
 
 // These resources need to be recreated every time the window size is changed.
@@ -275,14 +384,16 @@ void DeviceResources::CreateWindowSizeDependentResources()
         throw std::logic_error("Call SetWindow with a valid Win32 window handle");
     }
 
-    // Wait until all previous GPU work is complete.
-    WaitForGpu();
+    // Wait until the GPU has finished with the back buffers. Every frame already signals the timeline,
+    // so this only blocks if the last submitted frame is still executing.
+    m_frameTimeline.WaitForIdle();
+    m_frameTimeline.ProcessCompletions();
 
-    // Release resources that are tied to the swap chain and update fence values.
+    // Release resources that are tied to the swap chain.
     for (UINT n = 0; n < m_backBufferCount; n++)
     {
+        m_stateTracker.Unregister(m_renderTargets[n].Get());
         m_renderTargets[n].Reset();
-        m_fenceValues[n] = m_fenceValues[m_backBufferIndex];
     }
 
     // Determine the render target size in pixels.
@@ -299,7 +410,7 @@ void DeviceResources::CreateWindowSizeDependentResources()
             backBufferWidth,
             backBufferHeight,
             backBufferFormat,
-            (m_options & c_AllowTearing) ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0u
+            GetSwapChainFlags()
             );
 
         if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET)
@@ -336,7 +447,7 @@ void DeviceResources::CreateWindowSizeDependentResources()
         swapChainDesc.Scaling = DXGI_SCALING_STRETCH;
         swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
         swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_IGNORE;
-        swapChainDesc.Flags = (m_options & c_AllowTearing) ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0u;
+        swapChainDesc.Flags = GetSwapChainFlags();
 
         DXGI_SWAP_CHAIN_FULLSCREEN_DESC fsSwapChainDesc = {};
         fsSwapChainDesc.Windowed = TRUE;
@@ -356,6 +467,16 @@ void DeviceResources::CreateWindowSizeDependentResources()
 
         // This class does not support exclusive full-screen mode and prevents DXGI from responding to the ALT+ENTER shortcut
         ThrowIfFailed(m_dxgiFactory->MakeWindowAssociation(m_window, DXGI_MWA_NO_ALT_ENTER));
+
+        if (m_options & c_FrameLatencyWaitable)
+        {
+            ThrowIfFailed(m_swapChain->SetMaximumFrameLatency(m_maxFrameLatency));
+            m_frameLatencyWaitable.Attach(m_swapChain->GetFrameLatencyWaitableObject());
+            if (!m_frameLatencyWaitable.IsValid())
+            {
+                throw std::runtime_error("GetFrameLatencyWaitableObject");
+            }
+        }
     }
 
     // Handle color space settings for HDR
@@ -371,6 +492,8 @@ void DeviceResources::CreateWindowSizeDependentResources()
         swprintf_s(name, L"Render target %u", n);
         m_renderTargets[n]->SetName(name);
 
+        m_stateTracker.Register(m_renderTargets[n].Get(), 1, ResourceState::Present);
+
         D3D12_RENDER_TARGET_VIEW_DESC rtvDesc = {};
         rtvDesc.Format = m_backBufferFormat;
         rtvDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2D;
@@ -408,6 +531,8 @@ void DeviceResources::CreateWindowSizeDependentResources()
 
         const CD3DX12_CLEAR_VALUE depthOptimizedClearValue(m_depthBufferFormat, (m_options & c_ReverseDepth) ? 0.0f : 1.0f, 0u);
 
+        m_stateTracker.Unregister(m_depthStencil.Get());
+
         ThrowIfFailed(m_d3dDevice->CreateCommittedResource(
             &depthHeapProperties,
             D3D12_HEAP_FLAG_NONE,
@@ -419,6 +544,8 @@ void DeviceResources::CreateWindowSizeDependentResources()
 
         m_depthStencil->SetName(L"Depth stencil");
 
+        m_stateTracker.Register(m_depthStencil.Get(), 1, ResourceState::DepthWrite);
+
         D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
         dsvDesc.Format = m_depthBufferFormat;
         dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
@@ -486,18 +613,32 @@ void DeviceResources::HandleDeviceLost()
         m_deviceNotify->OnDeviceLost();
     }
 
-    for (UINT n = 0; n < m_backBufferCount; n++)
+    // Every tracked resource belonged to the lost device
+    m_stateTracker.Clear();
+
+    for (UINT n = 0; n < m_framesInFlight; n++)
     {
         m_commandAllocators[n].Reset();
+    }
+
+    for (UINT n = 0; n < m_backBufferCount; n++)
+    {
         m_renderTargets[n].Reset();
     }
 
     m_depthStencil.Reset();
     m_commandQueue.Reset();
     m_commandList.Reset();
-    m_fence.Reset();
+    m_contextPool.reset();
+    m_frameTimeline.SetBackend(nullptr);
+    m_fence.reset();
+    m_copyTimeline.SetBackend(nullptr);
+    m_copyFence.reset();
+    m_copyQueue.Reset();
     m_rtvDescriptorHeap.Reset();
     m_dsvDescriptorHeap.Reset();
+    m_frameLatencyWaitable.Close();
+    m_frameLatencyAcquired = false;
     m_swapChain.Reset();
     m_d3dDevice.Reset();
     m_dxgiFactory.Reset();
@@ -525,34 +666,78 @@ void DeviceResources::HandleDeviceLost()
 void DeviceResources::Prepare(D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_STATES afterState)
 {
     // Reset command list and allocator.
-    ThrowIfFailed(m_commandAllocators[m_backBufferIndex]->Reset());
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_backBufferIndex].Get(), nullptr));
-
-    if (beforeState != afterState)
+    ThrowIfFailed(m_commandAllocators[m_frameIndex]->Reset());
+    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), nullptr));
+    m_mainStates.Reset();
+    m_stateTracker.ResetStatistics();
+
+    // The tracker knows what state the render target is in; beforeState is only checked.
+    auto const renderTarget = m_renderTargets[m_backBufferIndex].Get();
+    if (m_stateTracker.IsValidationEnabled() && m_stateTracker.GetState(renderTarget) != FromD3D12(beforeState))
     {
-        // Transition the render target into the correct state to allow for drawing into it.
-        const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            m_renderTargets[m_backBufferIndex].Get(),
-            beforeState, afterState);
-        m_commandList->ResourceBarrier(1, &barrier);
+        throw std::logic_error("Render target is not in the state Prepare was given");
     }
+
+    // Transition the render target into the correct state to allow for drawing into it.
+    m_mainStates.Transition(renderTarget, FromD3D12(afterState));
+    m_mainStates.Flush([this](std::span<const ResourceStateTracker::Barrier> barriers)
+        {
+            RecordBarriers(m_commandList.Get(), barriers);
+        });
 }
 
 // Present the contents of the swap chain to the screen.
 void DeviceResources::Present(D3D12_RESOURCE_STATES beforeState)
 {
-    if (beforeState != D3D12_RESOURCE_STATE_PRESENT)
+    ThrowIfFailed(m_commandList->Close());
+
+    // Resolve each list's resource states in submission order. A list that needs a resource in a different state
+    // from the one the lists ahead of it left it in gets the transitions on a list of their own, just in front of it.
+    m_submitLists.clear();
+    std::ignore = m_stateTracker.Resolve(m_mainStates);
+    m_submitLists.push_back(m_commandList.Get());
+
+    m_frameContexts.clear();
+    for (auto const& context : m_contextPool->GetFrameContexts())
+    {
+        m_frameContexts.push_back(context.get());
+    }
+
+    for (auto context : m_frameContexts)
+    {
+        auto const fixups = m_stateTracker.Resolve(context->list.states);
+        if (!fixups.empty())
+        {
+            auto& fixup = m_contextPool->Acquire(context->order);
+            RecordBarriers(fixup.list.Get(), fixups);
+            m_contextPool->GetBackend().Close(fixup.list);
+            m_submitLists.push_back(fixup.list.Get());
+        }
+        m_submitLists.push_back(context->list.Get());
+    }
+
+    auto const renderTarget = m_renderTargets[m_backBufferIndex].Get();
+    if (m_stateTracker.IsValidationEnabled() && m_stateTracker.GetState(renderTarget) != FromD3D12(beforeState))
+    {
+        throw std::logic_error("Render target is not in the state Present was given");
+    }
+
+    if (m_stateTracker.GetState(renderTarget) != ResourceState::Present)
     {
         // Transition the render target to the state that allows it to be presented to the display.
-        const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            m_renderTargets[m_backBufferIndex].Get(),
-            beforeState, D3D12_RESOURCE_STATE_PRESENT);
-        m_commandList->ResourceBarrier(1, &barrier);
+        // This goes on a list of its own as it must follow every list recorded from the context pool.
+        auto& context = m_contextPool->Acquire(UINT32_MAX);
+        context.list.states.SetInheritGlobal(true);
+        context.list.states.Transition(renderTarget, ResourceState::Present);
+        FlushBarriers(context.list);
+        m_contextPool->GetBackend().Close(context.list);
+        std::ignore = m_stateTracker.Resolve(context.list.states);
+        m_submitLists.push_back(context.list.Get());
     }
 
-    // Send the command list off to the GPU for processing.
-    ThrowIfFailed(m_commandList->Close());
-    m_commandQueue->ExecuteCommandLists(1, CommandListCast(m_commandList.GetAddressOf()));
+    // Send the command lists off to the GPU for processing, in one ordered batch.
+    m_commandQueue->ExecuteCommandLists(static_cast<UINT>(m_submitLists.size()), m_submitLists.data());
+    m_frameLatencyAcquired = false;
 
     HRESULT hr;
     if (m_options & c_AllowTearing)
@@ -596,43 +781,97 @@ void DeviceResources::Present(D3D12_RESOURCE_STATES beforeState)
 // Wait for pending GPU work to complete.
 void DeviceResources::WaitForGpu() noexcept
 {
-    if (m_commandQueue && m_fence && m_fenceEvent.IsValid())
+    if (m_commandQueue && m_fence)
     {
-        // Schedule a Signal command in the GPU queue.
-        const UINT64 fenceValue = m_fenceValues[m_backBufferIndex];
-        if (SUCCEEDED(m_commandQueue->Signal(m_fence.Get(), fenceValue)))
+        // Schedule a Signal command in the GPU queue and wait until it has been processed.
+        const UINT64 fenceValue = m_frameTimeline.Signal();
+        if (fenceValue)
         {
-            // Wait until the Signal has been processed.
-            if (SUCCEEDED(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent.Get())))
-            {
-                std::ignore = WaitForSingleObjectEx(m_fenceEvent.Get(), INFINITE, FALSE);
-
-                // Increment the fence value for the current frame.
-                m_fenceValues[m_backBufferIndex]++;
-            }
+            std::ignore = m_frameTimeline.Wait(fenceValue);
         }
     }
+
+    // Uploads still in flight on the copy queue may reference resources about to be released.
+    if (m_copyQueue && m_copyFence)
+    {
+        std::ignore = m_copyTimeline.WaitForIdle();
+    }
+}
+
+// Wait until the swap chain can queue another frame.
+bool DeviceResources::WaitForFrameLatency() noexcept
+{
+    if (!m_frameLatencyWaitable.IsValid() || m_frameLatencyAcquired)
+        return false;
+
+    // The object is a semaphore, so a wait that succeeds at once has still taken the frame's slot
+    if (WaitForSingleObjectEx(m_frameLatencyWaitable.Get(), 0, FALSE) == WAIT_OBJECT_0)
+    {
+        m_frameLatencyAcquired = true;
+        return false;
+    }
+
+    // Bounded, so that a lost device or a hidden window cannot hang the message loop. A wait that times out took no
+    // slot and saw no refresh, so it is neither counted as acquired nor reported as having waited for the display.
+    if (WaitForSingleObjectEx(m_frameLatencyWaitable.Get(), 1000, FALSE) != WAIT_OBJECT_0)
+        return false;
+
+    m_frameLatencyAcquired = true;
+    return true;
+}
+
+void DeviceResources::SetMaximumFrameLatency(UINT maxLatency)
+{
+    if (maxLatency < 1 || maxLatency > DXGI_MAX_SWAP_CHAIN_BUFFERS)
+    {
+        throw std::out_of_range("invalid maxLatency");
+    }
+
+    m_maxFrameLatency = maxLatency;
+    if (m_swapChain && (m_options & c_FrameLatencyWaitable))
+    {
+        ThrowIfFailed(m_swapChain->SetMaximumFrameLatency(maxLatency));
+    }
 }
 
 // Prepare to render the next frame.
 void DeviceResources::MoveToNextFrame()
 {
-    // Schedule a Signal command in the queue.
-    const UINT64 currentFenceValue = m_fenceValues[m_backBufferIndex];
-    ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), currentFenceValue));
+    // Schedule a Signal command in the queue. Once it is reached this frame's allocator can be reused.
+    const UINT64 currentFenceValue = m_frameTimeline.Signal();
+    if (!currentFenceValue)
+    {
+        throw std::runtime_error("Signal");
+    }
+    m_frameFenceValues[m_frameIndex] = currentFenceValue;
+    m_contextPool->EndFrame(currentFenceValue);
 
-    // Update the back buffer index.
+    // Update the back buffer index and move to the next frame slot.
     m_backBufferIndex = m_swapChain->GetCurrentBackBufferIndex();
+    m_frameIndex = (m_frameIndex + 1) % m_framesInFlight;
+
+    // Only stall if the GPU is still using the slot from m_framesInFlight frames ago.
+    const double waitStart = m_frameTimeline.GetWaitSeconds();
+    std::ignore = m_frameTimeline.Wait(m_frameFenceValues[m_frameIndex]);
+    m_lastFrameWaitSeconds = m_frameTimeline.GetWaitSeconds() - waitStart;
 
-    // If the next frame is not ready to be rendered yet, wait until it is ready.
-    if (m_fence->GetCompletedValue() < m_fenceValues[m_backBufferIndex])
+    // Run anything that was deferred until the GPU finished with it.
+    m_frameTimeline.ProcessCompletions();
+}
+
+// Flags the swap chain is created with, which ResizeBuffers must repeat.
+UINT DeviceResources::GetSwapChainFlags() const noexcept
+{
+    UINT flags = 0;
+    if (m_options & c_AllowTearing)
     {
-        ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_backBufferIndex], m_fenceEvent.Get()));
-        std::ignore = WaitForSingleObjectEx(m_fenceEvent.Get(), INFINITE, FALSE);
+        flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
     }
-
-    // Set the fence value for the next frame.
-    m_fenceValues[m_backBufferIndex] = currentFenceValue + 1;
+    if (m_options & c_FrameLatencyWaitable)
+    {
+        flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+    }
+    return flags;
 }
 
 // This method acquires the first available hardware adapter that supports Direct3D 12.
@@ -4,6 +4,11 @@
 
 #pragma once
 
+#include "CommandContextPool.h"
+#include "D3D12ResourceStates.h"
+#include "FenceTimeline.h"
+#include "ResourceStateTracker.h"
+
 namespace DX
 {
     // Provides an interface for an application that owns DeviceResources to be notified of the device being lost or created.
@@ -16,19 +21,59 @@ namespace DX
         ~IDeviceNotify() = default;
     };
 
+    // Drives an ID3D12Fence signaled from a command queue.
+    class D3D12FenceBackend final : public IFenceBackend
+    {
+    public:
+        D3D12FenceBackend(_In_ ID3D12Device* device, _In_ ID3D12CommandQueue* commandQueue, uint64_t initialValue = 0);
+
+        D3D12FenceBackend(D3D12FenceBackend const&) = delete;
+        D3D12FenceBackend& operator= (D3D12FenceBackend const&) = delete;
+
+        bool Signal(uint64_t value) noexcept override;
+        uint64_t GetCompletedValue() noexcept override;
+        bool Wait(uint64_t value, uint32_t timeoutMs) noexcept override;
+
+        ID3D12Fence* GetFence() const noexcept { return m_fence.Get(); }
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12Fence>                 m_fence;
+        ID3D12CommandQueue*                                 m_commandQueue;
+    };
+
+    // Creates direct command allocators and lists for a CommandContextPool. Each list tracks resource states against
+    // stateTracker.
+    struct D3D12CommandBackend
+    {
+        using Allocator = Microsoft::WRL::ComPtr<ID3D12CommandAllocator>;
+        using List = D3D12CommandList;
+
+        ID3D12Device*           device;
+        ResourceStateTracker*   stateTracker;
+
+        Allocator CreateAllocator();
+        List CreateList(Allocator const& allocator);
+        void Reset(Allocator& allocator, List& list);
+        void Close(List& list);
+    };
+
     // Controls all the DirectX device resources.
     class DeviceResources
     {
     public:
+        using ContextPool = CommandContextPool<D3D12CommandBackend>;
+
         static constexpr unsigned int c_AllowTearing = 0x1;
         static constexpr unsigned int c_EnableHDR    = 0x2;
         static constexpr unsigned int c_ReverseDepth = 0x4;
+        static constexpr unsigned int c_FrameLatencyWaitable = 0x8;
 
         DeviceResources(DXGI_FORMAT backBufferFormat = DXGI_FORMAT_B8G8R8A8_UNORM,
                         DXGI_FORMAT depthBufferFormat = DXGI_FORMAT_D32_FLOAT,
                         UINT backBufferCount = 2,
                         D3D_FEATURE_LEVEL minFeatureLevel = D3D_FEATURE_LEVEL_11_0,
-                        unsigned int flags = 0) noexcept(false);
+                        unsigned int flags = 0,
+                        UINT framesInFlight = 2) noexcept(false);
         ~DeviceResources();
 
         DeviceResources(DeviceResources&&) = default;
@@ -49,6 +94,16 @@ namespace DX
         void WaitForGpu() noexcept;
         void UpdateColorSpace();
 
+        // With c_FrameLatencyWaitable, block until the swap chain's queue has room for another frame, and return
+        // whether that meant waiting for the display. Call once per frame, before sampling input for it; a frame
+        // that is not presented keeps its place for the next. A wait that times out returns false, and the next
+        // call waits again.
+        bool WaitForFrameLatency() noexcept;
+
+        // How many presented frames may queue for the display; 1 or 2 keep input latency low.
+        void SetMaximumFrameLatency(UINT maxLatency);
+        UINT GetMaximumFrameLatency() const noexcept { return m_maxFrameLatency; }
+
         // Device Accessors.
         RECT GetOutputSize() const noexcept { return m_outputSize; }
 
@@ -61,17 +116,34 @@ namespace DX
         ID3D12Resource*             GetRenderTarget() const noexcept       { return m_renderTargets[m_backBufferIndex].Get(); }
         ID3D12Resource*             GetDepthStencil() const noexcept       { return m_depthStencil.Get(); }
         ID3D12CommandQueue*         GetCommandQueue() const noexcept       { return m_commandQueue.Get(); }
-        ID3D12CommandAllocator*     GetCommandAllocator() const noexcept   { return m_commandAllocators[m_backBufferIndex].Get(); }
+        ID3D12CommandQueue*         GetCopyQueue() const noexcept          { return m_copyQueue.Get(); }
+        ID3D12CommandAllocator*     GetCommandAllocator() const noexcept   { return m_commandAllocators[m_frameIndex].Get(); }
         auto                        GetCommandList() const noexcept        { return m_commandList.Get(); }
+        ContextPool*                GetCommandContextPool() const noexcept { return m_contextPool.get(); }
         DXGI_FORMAT                 GetBackBufferFormat() const noexcept   { return m_backBufferFormat; }
         DXGI_FORMAT                 GetDepthBufferFormat() const noexcept  { return m_depthBufferFormat; }
         D3D12_VIEWPORT              GetScreenViewport() const noexcept     { return m_screenViewport; }
         D3D12_RECT                  GetScissorRect() const noexcept        { return m_scissorRect; }
         UINT                        GetCurrentFrameIndex() const noexcept  { return m_backBufferIndex; }
         UINT                        GetBackBufferCount() const noexcept    { return m_backBufferCount; }
+        UINT                        GetFrameSlot() const noexcept          { return m_frameIndex; }
+        UINT                        GetFramesInFlight() const noexcept     { return m_framesInFlight; }
         DXGI_COLOR_SPACE_TYPE       GetColorSpace() const noexcept         { return m_colorSpace; }
         unsigned int                GetDeviceOptions() const noexcept      { return m_options; }
 
+        // Frame pacing accessors.
+        FenceTimeline&              GetFrameTimeline() noexcept            { return m_frameTimeline; }
+        UINT64                      GetCurrentFrameFenceValue() const noexcept { return m_frameTimeline.GetNextValue(); }
+        double                      GetLastFrameWaitSeconds() const noexcept { return m_lastFrameWaitSeconds; }
+
+        // Signaled on the copy queue after each batch of uploads submitted to it.
+        FenceTimeline&              GetCopyTimeline() noexcept             { return m_copyTimeline; }
+
+        // States of the resources command lists transition, as of the last list submitted. The back buffers and depth
+        // buffer are registered here; anything else the context pool's lists transition must be registered too. Its
+        // statistics cover the frame submitted most recently.
+        ResourceStateTracker&       GetStateTracker() noexcept             { return m_stateTracker; }
+
         CD3DX12_CPU_DESCRIPTOR_HANDLE GetRenderTargetView() const noexcept
         {
         #ifdef __MINGW32__
@@ -98,27 +170,48 @@ namespace DX
     private:
         void MoveToNextFrame();
         void GetAdapter(IDXGIAdapter1** ppAdapter);
+        UINT GetSwapChainFlags() const noexcept;
 
         static constexpr size_t MAX_BACK_BUFFER_COUNT = 3;
+        static constexpr size_t MAX_FRAMES_IN_FLIGHT = 8;
 
         UINT                                                m_backBufferIndex;
+        UINT                                                m_frameIndex;
 
         // Direct3D objects.
         Microsoft::WRL::ComPtr<ID3D12Device>                m_d3dDevice;
         Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>   m_commandList;
         Microsoft::WRL::ComPtr<ID3D12CommandQueue>          m_commandQueue;
-        Microsoft::WRL::ComPtr<ID3D12CommandAllocator>      m_commandAllocators[MAX_BACK_BUFFER_COUNT];
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator>      m_commandAllocators[MAX_FRAMES_IN_FLIGHT];
 
         // Swap chain objects.
         Microsoft::WRL::ComPtr<IDXGIFactory4>               m_dxgiFactory;
         Microsoft::WRL::ComPtr<IDXGISwapChain3>             m_swapChain;
         Microsoft::WRL::ComPtr<ID3D12Resource>              m_renderTargets[MAX_BACK_BUFFER_COUNT];
         Microsoft::WRL::ComPtr<ID3D12Resource>              m_depthStencil;
+        Microsoft::WRL::Wrappers::Event                     m_frameLatencyWaitable;
+        UINT                                                m_maxFrameLatency;
+        bool                                                m_frameLatencyAcquired;
 
         // Presentation fence objects.
-        Microsoft::WRL::ComPtr<ID3D12Fence>                 m_fence;
-        UINT64                                              m_fenceValues[MAX_BACK_BUFFER_COUNT];
-        Microsoft::WRL::Wrappers::Event                     m_fenceEvent;
+        std::unique_ptr<D3D12FenceBackend>                  m_fence;
+        FenceTimeline                                       m_frameTimeline;
+        UINT64                                              m_frameFenceValues[MAX_FRAMES_IN_FLIGHT];
+        double                                              m_lastFrameWaitSeconds;
+
+        // Copy queue for uploads that run alongside rendering, and its fence.
+        Microsoft::WRL::ComPtr<ID3D12CommandQueue>          m_copyQueue;
+        std::unique_ptr<D3D12FenceBackend>                  m_copyFence;
+        FenceTimeline                                       m_copyTimeline;
+
+        // Resource states, and those seen by m_commandList, which is always resolved first and so inherits them.
+        ResourceStateTracker                                m_stateTracker;
+        ResourceStateTracker::LocalState                    m_mainStates;
+
+        // Additional command lists recorded alongside m_commandList, submitted after it in one batch.
+        std::unique_ptr<ContextPool>                        m_contextPool;
+        std::vector<ContextPool::Context*>                  m_frameContexts;
+        std::vector<ID3D12CommandList*>                     m_submitLists;
 
         // Direct3D rendering objects.
         Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>        m_rtvDescriptorHeap;
@@ -131,6 +224,7 @@ namespace DX
         DXGI_FORMAT                                         m_backBufferFormat;
         DXGI_FORMAT                                         m_depthBufferFormat;
         UINT                                                m_backBufferCount;
+        UINT                                                m_framesInFlight;
         D3D_FEATURE_LEVEL                                   m_d3dMinFeatureLevel;
 
         // Cached device properties.
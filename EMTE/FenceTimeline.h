@@ -0,0 +1,295 @@
+//
+// FenceTimeline.h - Monotonic fence values over an abstract GPU queue
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // Abstracts the fence/queue pair a FenceTimeline drives, so that frame pacing can run against a simulated queue.
+    class IFenceBackend
+    {
+    public:
+        virtual ~IFenceBackend() = default;
+
+        // Schedule the fence to reach value once all work previously submitted to the queue has completed.
+        virtual bool Signal(uint64_t value) noexcept = 0;
+
+        // Get the last value the fence has reached.
+        virtual uint64_t GetCompletedValue() noexcept = 0;
+
+        // Block the calling thread until the fence reaches value, or the timeout (in milliseconds) expires.
+        virtual bool Wait(uint64_t value, uint32_t timeoutMs) noexcept = 0;
+    };
+
+    class FenceTimeline;
+
+    // Told about a timeline's signals and blocking waits, for tracing. Called on the thread signaling or waiting.
+    class IFenceObserver
+    {
+    public:
+        virtual ~IFenceObserver() = default;
+
+        virtual void OnSignal(FenceTimeline const& timeline, uint64_t value) noexcept = 0;
+        virtual void OnWaitBegin(FenceTimeline const& timeline, uint64_t value) noexcept = 0;
+        virtual void OnWaitEnd(FenceTimeline const& timeline, uint64_t value) noexcept = 0;
+    };
+
+    // Tracks a single queue's progress as a monotonically increasing 64-bit value.
+    //
+    // Any thread may signal, query, wait and add callbacks. Signals are serialized so that values reach the queue in
+    // order. Only SetBackend must not race with the rest, as the old backend may be in use until it returns.
+    class FenceTimeline
+    {
+    public:
+        static constexpr uint32_t Infinite = 0xFFFFFFFF;
+
+        // A value on a particular timeline, used for waiting across several queues at once.
+        struct Point
+        {
+            FenceTimeline*  timeline;
+            uint64_t        value;
+        };
+
+        explicit FenceTimeline(IFenceBackend* backend = nullptr, uint64_t initialValue = 0) noexcept :
+            m_backend(backend),
+            m_observer(nullptr),
+            m_lastSignaled(initialValue),
+            m_lastCompleted(initialValue),
+            m_waitTicks(0),
+            m_waitCount(0)
+        {
+        }
+
+        FenceTimeline(FenceTimeline const&) = delete;
+        FenceTimeline& operator= (FenceTimeline const&) = delete;
+
+        // Rebind the timeline to a new backend (e.g. after the device is recreated). Pending callbacks are dropped.
+        void SetBackend(IFenceBackend* backend, uint64_t initialValue = 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_backend = backend;
+            m_lastSignaled.store(initialValue, std::memory_order_relaxed);
+            m_lastCompleted.store(initialValue, std::memory_order_relaxed);
+            m_callbacks.clear();
+        }
+
+        // The observer must outlive the timeline, or be replaced first.
+        void SetObserver(IFenceObserver* observer) noexcept { m_observer.store(observer, std::memory_order_release); }
+
+        // Signal the next value on the queue. Returns the signaled value, or 0 if the backend rejected it.
+        uint64_t Signal() noexcept
+        {
+            uint64_t value;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                value = m_lastSignaled.load(std::memory_order_relaxed) + 1;
+                if (!m_backend || !m_backend->Signal(value))
+                    return 0;
+
+                m_lastSignaled.store(value, std::memory_order_release);
+            }
+
+            if (auto const observer = m_observer.load(std::memory_order_acquire))
+            {
+                observer->OnSignal(*this, value);
+            }
+            return value;
+        }
+
+        // Value that the next call to Signal will use. Work recorded now retires once this value completes.
+        uint64_t GetNextValue() const noexcept { return GetLastSignaledValue() + 1; }
+        uint64_t GetLastSignaledValue() const noexcept { return m_lastSignaled.load(std::memory_order_acquire); }
+
+        uint64_t GetCompletedValue() noexcept
+        {
+            if (m_backend)
+            {
+                return AdvanceCompleted(m_backend->GetCompletedValue());
+            }
+            return m_lastCompleted.load(std::memory_order_acquire);
+        }
+
+        // Query whether value has been reached without blocking; only touches the backend if the cached value is behind.
+        bool IsComplete(uint64_t value) noexcept
+        {
+            return value <= m_lastCompleted.load(std::memory_order_acquire) || value <= GetCompletedValue();
+        }
+
+        // Block until value is reached. Time spent blocked is accumulated as CPU idle time.
+        bool Wait(uint64_t value, uint32_t timeoutMs = Infinite) noexcept
+        {
+            if (IsComplete(value))
+                return true;
+
+            if (!m_backend || value > GetLastSignaledValue())
+                return false;
+
+            auto const observer = m_observer.load(std::memory_order_acquire);
+            if (observer)
+            {
+                observer->OnWaitBegin(*this, value);
+            }
+            auto const start = std::chrono::steady_clock::now();
+            const bool complete = m_backend->Wait(value, timeoutMs);
+            m_waitTicks.fetch_add(static_cast<uint64_t>((std::chrono::steady_clock::now() - start).count()),
+                std::memory_order_relaxed);
+            m_waitCount.fetch_add(1, std::memory_order_relaxed);
+            if (observer)
+            {
+                observer->OnWaitEnd(*this, value);
+            }
+
+            // Trust only what the backend reports: a backend that wakes early must not complete value before the GPU
+            return complete && AdvanceCompleted(m_backend->GetCompletedValue()) >= value;
+        }
+
+        // Block until everything signaled so far has completed.
+        bool WaitForIdle() noexcept { return Wait(GetLastSignaledValue()); }
+
+        // Run callback once value has been reached. Callbacks are invoked from ProcessCompletions.
+        void OnCompletion(uint64_t value, std::function<void()> callback)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_callbacks.emplace_back(value, std::move(callback));
+        }
+
+        // Invoke every deferred callback whose value has been reached. Returns the number invoked.
+        size_t ProcessCompletions()
+        {
+            std::vector<std::function<void()>> ready;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_callbacks.empty())
+                    return 0;
+
+                const uint64_t completed = GetCompletedValue();
+                auto const split = std::stable_partition(m_callbacks.begin(), m_callbacks.end(),
+                    [completed](auto const& entry) { return entry.first > completed; });
+
+                for (auto it = split; it != m_callbacks.end(); ++it)
+                {
+                    ready.emplace_back(std::move(it->second));
+                }
+                m_callbacks.erase(split, m_callbacks.end());
+            }
+
+            for (auto& callback : ready)
+            {
+                callback();
+            }
+            return ready.size();
+        }
+
+        size_t GetPendingCallbackCount() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_callbacks.size();
+        }
+
+        // CPU idle time spent inside Wait, in seconds, and the number of waits that actually blocked.
+        double GetWaitSeconds() const noexcept
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::duration(
+                static_cast<std::chrono::steady_clock::rep>(m_waitTicks.load(std::memory_order_relaxed)))).count();
+        }
+        uint64_t GetWaitCount() const noexcept { return m_waitCount.load(std::memory_order_relaxed); }
+
+        void ResetWaitStatistics() noexcept
+        {
+            m_waitTicks.store(0, std::memory_order_relaxed);
+            m_waitCount.store(0, std::memory_order_relaxed);
+        }
+
+        // Block until any of the points is reached. Returns its index, or points.size() on timeout. As with Wait, a
+        // point whose value has not been signaled yet fails at once, since blocking on it could never end.
+        static size_t WaitAny(std::span<const Point> points, uint32_t timeoutMs = Infinite) noexcept
+        {
+            if (points.empty())
+                return 0;
+
+            auto const start = std::chrono::steady_clock::now();
+            for (;;)
+            {
+                for (size_t i = 0; i < points.size(); ++i)
+                {
+                    if (points[i].timeline->IsComplete(points[i].value))
+                        return i;
+                }
+
+                for (auto const& point : points)
+                {
+                    if (point.value > point.timeline->GetLastSignaledValue())
+                        return points.size();
+                }
+
+                if (timeoutMs != Infinite
+                    && std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(timeoutMs))
+                    return points.size();
+
+                // Sleep on each timeline in turn so that no single queue starves the others.
+                for (auto const& point : points)
+                {
+                    if (point.timeline->Wait(point.value, 1))
+                        break;
+                }
+            }
+        }
+
+        // Block until every point is reached.
+        static bool WaitAll(std::span<const Point> points, uint32_t timeoutMs = Infinite) noexcept
+        {
+            auto const start = std::chrono::steady_clock::now();
+            for (auto const& point : points)
+            {
+                uint32_t remaining = timeoutMs;
+                if (timeoutMs != Infinite)
+                {
+                    auto const elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+                    remaining = (elapsed >= timeoutMs) ? 0u : static_cast<uint32_t>(timeoutMs - elapsed);
+                }
+
+                if (!point.timeline->Wait(point.value, remaining))
+                    return false;
+            }
+            return true;
+        }
+
+    private:
+        // Raise the cached completed value to at least value, never lowering it. Returns the result.
+        uint64_t AdvanceCompleted(uint64_t value) noexcept
+        {
+            uint64_t completed = m_lastCompleted.load(std::memory_order_acquire);
+            while (completed < value
+                && !m_lastCompleted.compare_exchange_weak(completed, value, std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+            }
+            return std::max(completed, value);
+        }
+
+        IFenceBackend*                                          m_backend;
+        std::atomic<IFenceObserver*>                            m_observer;
+        std::atomic<uint64_t>                                   m_lastSignaled;
+        std::atomic<uint64_t>                                   m_lastCompleted;
+
+        // Members for tracking CPU idle time.
+        std::atomic<uint64_t>                                   m_waitTicks;
+        std::atomic<uint64_t>                                   m_waitCount;
+
+        // Serializes Signal, and guards the callbacks.
+        mutable std::mutex                                      m_mutex;
+        std::vector<std::pair<uint64_t, std::function<void()>>> m_callbacks;
+    };
+}
@@ -0,0 +1,395 @@
+//
+// FrameGraph.h - Declarative pass ordering with culling, barrier planning and resource lifetimes
+//
+
+#pragma once
+
+#include "ResourceState.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+
+namespace DX
+{
+    // Describes one frame's passes and the resources they touch, then works out which passes are needed, the
+    // transitions each must make before it runs, and the span of passes over which each resource is alive.
+    //
+    // Passes are declared in submission order. A write keeps the resource's previous contents unless it discards them,
+    // so an earlier writer is only culled when a later pass discards its output, or nothing downstream uses it. Passes
+    // writing an output resource, or marked as having side effects, are never culled.
+    //
+    // The graph only records what passes do; running them is left to the caller, who looks the passes up by id in
+    // GetCompiledPasses. It is intended to be rebuilt every frame: Reset keeps its allocations.
+    class FrameGraph
+    {
+    public:
+        using ResourceId = uint32_t;
+        using PassId = uint32_t;
+
+        static constexpr uint32_t Unused = 0xFFFFFFFF;
+
+        struct Barrier
+        {
+            ResourceId      resource;
+            ResourceState   before;
+            ResourceState   after;
+            bool            aliasing;   // first use of a transient: its memory may have held another resource
+        };
+
+        struct Resource
+        {
+            const char*     name;
+            bool            imported;
+            bool            output;
+            ResourceState   initialState;
+            ResourceState   finalState;     // state to leave an imported resource in; Undefined leaves it as is
+
+            // Filled in by Compile, as indices into GetCompiledPasses.
+            uint32_t        firstPass;
+            uint32_t        lastPass;
+            ResourceState   endState;       // state after the frame, including any final transition
+        };
+
+        struct CompiledPass
+        {
+            PassId                  pass;
+            const char*             name;
+            uint32_t                firstBarrier;   // barriers to issue before the pass, in GetBarriers
+            uint32_t                barrierCount;
+
+            // Barriers to issue before the pass, as one batch.
+            std::span<const Barrier> GetBarriers(FrameGraph const& graph) const noexcept
+            {
+                return std::span<const Barrier>(graph.m_barriers).subspan(firstBarrier, barrierCount);
+            }
+        };
+
+        // Declares what a pass reads and writes.
+        class PassBuilder
+        {
+        public:
+            PassBuilder& Read(ResourceId resource, ResourceState state)
+            {
+                if (!IsReadState(state))
+                {
+                    throw std::invalid_argument("FrameGraph::Read requires a read state");
+                }
+                m_graph.AddAccess(m_pass, resource, state, false, false);
+                return *this;
+            }
+
+            PassBuilder& Write(ResourceId resource, ResourceState state, bool discard = false)
+            {
+                if (state == ResourceState::Undefined || IsReadState(state))
+                {
+                    throw std::invalid_argument("FrameGraph::Write requires a write state");
+                }
+                m_graph.AddAccess(m_pass, resource, state, true, discard);
+                return *this;
+            }
+
+            // Keep the pass even if nothing uses what it writes.
+            PassBuilder& SideEffect() noexcept
+            {
+                m_graph.m_passes[m_pass].sideEffect = true;
+                return *this;
+            }
+
+            PassId GetId() const noexcept { return m_pass; }
+
+        private:
+            friend class FrameGraph;
+
+            PassBuilder(FrameGraph& graph, PassId pass) noexcept : m_graph(graph), m_pass(pass) {}
+
+            FrameGraph& m_graph;
+            PassId      m_pass;
+        };
+
+        FrameGraph() noexcept : m_compiled(false) {}
+
+        FrameGraph(FrameGraph const&) = delete;
+        FrameGraph& operator= (FrameGraph const&) = delete;
+
+        void Reset() noexcept
+        {
+            m_resources.clear();
+            m_passes.clear();
+            m_accesses.clear();
+            m_compiledPasses.clear();
+            m_barriers.clear();
+            m_finalBarriers.clear();
+            m_compiled = false;
+        }
+
+        // A resource that lives outside the graph, such as the back buffer. It starts the frame in initialState.
+        ResourceId Import(const char* name, ResourceState initialState,
+            ResourceState finalState = ResourceState::Undefined, bool output = false)
+        {
+            m_resources.push_back(Resource{ name, true, output, initialState, finalState, Unused, Unused, initialState });
+            m_compiled = false;
+            return static_cast<ResourceId>(m_resources.size() - 1);
+        }
+
+        // A resource that only lives between its first and last use this frame. Its memory may be shared with other
+        // transients, so its contents are undefined at first use; initialState is the state the API object backing it
+        // was last left in, if it has one.
+        ResourceId CreateTransient(const char* name, ResourceState initialState = ResourceState::Undefined)
+        {
+            m_resources.push_back(Resource{ name, false, false, initialState, ResourceState::Undefined,
+                Unused, Unused, initialState });
+            m_compiled = false;
+            return static_cast<ResourceId>(m_resources.size() - 1);
+        }
+
+        PassBuilder AddPass(const char* name)
+        {
+            m_passes.push_back(Pass{ name, false, static_cast<uint32_t>(m_accesses.size()), 0 });
+            m_compiled = false;
+            return PassBuilder(*this, static_cast<PassId>(m_passes.size() - 1));
+        }
+
+        void Compile()
+        {
+            Cull();
+            PlanBarriers();
+            m_compiled = true;
+        }
+
+        // Passes that survived culling, in submission order, each with the barriers to issue before it.
+        std::span<const CompiledPass> GetCompiledPasses() const { CheckCompiled(); return m_compiledPasses; }
+
+        // Transitions that return imported resources to their final states, to issue after the last pass.
+        std::span<const Barrier> GetFinalBarriers() const { CheckCompiled(); return m_finalBarriers; }
+
+        Resource const& GetResource(ResourceId resource) const { return m_resources.at(resource); }
+        size_t GetResourceCount() const noexcept { return m_resources.size(); }
+
+        size_t GetPassCount() const noexcept { return m_passes.size(); }
+        size_t GetCulledCount() const noexcept { return m_passes.size() - m_compiledPasses.size(); }
+        size_t GetBarrierCount() const noexcept { return m_barriers.size() + m_finalBarriers.size(); }
+
+    private:
+        struct Pass
+        {
+            const char* name;
+            bool        sideEffect;
+            uint32_t    firstAccess;
+            uint32_t    accessCount;
+        };
+
+        struct Access
+        {
+            ResourceId      resource;
+            ResourceState   state;
+            bool            write;
+            bool            discard;
+        };
+
+        void AddAccess(PassId pass, ResourceId resource, ResourceState state, bool write, bool discard)
+        {
+            if (resource >= m_resources.size())
+            {
+                throw std::out_of_range("FrameGraph resource");
+            }
+
+            // Accesses are stored contiguously per pass, so only the most recently added pass may be declared
+            auto& entry = m_passes[pass];
+            if (pass != m_passes.size() - 1)
+            {
+                throw std::logic_error("FrameGraph passes must be declared one at a time");
+            }
+
+            m_accesses.push_back(Access{ resource, state, write, discard });
+            entry.accessCount++;
+            m_compiled = false;
+        }
+
+        std::span<const Access> GetAccesses(Pass const& pass) const noexcept
+        {
+            return std::span<const Access>(m_accesses).subspan(pass.firstAccess, pass.accessCount);
+        }
+
+        void CheckCompiled() const
+        {
+            if (!m_compiled)
+            {
+                throw std::logic_error("FrameGraph has not been compiled");
+            }
+        }
+
+        // Walk the passes backwards, keeping each one whose writes something later depends on.
+        void Cull()
+        {
+            m_needed.assign(m_resources.size(), false);
+            for (size_t i = 0; i < m_resources.size(); ++i)
+            {
+                m_needed[i] = m_resources[i].output;
+            }
+
+            m_live.assign(m_passes.size(), false);
+            for (size_t p = m_passes.size(); p-- > 0;)
+            {
+                auto const& pass = m_passes[p];
+                auto const accesses = GetAccesses(pass);
+
+                bool live = pass.sideEffect;
+                for (auto const& access : accesses)
+                {
+                    live = live || (access.write && m_needed[access.resource]);
+                }
+
+                if (!live)
+                    continue;
+
+                m_live[p] = true;
+
+                // Writes that discard make earlier contents irrelevant; anything read or preserved is needed
+                for (auto const& access : accesses)
+                {
+                    if (access.write && access.discard)
+                    {
+                        m_needed[access.resource] = false;
+                    }
+                }
+                for (auto const& access : accesses)
+                {
+                    if (!access.write || !access.discard)
+                    {
+                        m_needed[access.resource] = true;
+                    }
+                }
+            }
+        }
+
+        // Walk the live passes forwards, transitioning each resource only when its state must change. Consecutive
+        // reads are merged into one combined read state, so a resource read by several passes transitions once.
+        void PlanBarriers()
+        {
+            m_compiledPasses.clear();
+            m_barriers.clear();
+            m_finalBarriers.clear();
+
+            m_order.clear();
+            for (PassId p = 0; p < m_passes.size(); ++p)
+            {
+                if (m_live[p])
+                {
+                    m_order.push_back(p);
+                }
+            }
+
+            m_current.resize(m_resources.size());
+            for (size_t i = 0; i < m_resources.size(); ++i)
+            {
+                auto& resource = m_resources[i];
+                resource.firstPass = resource.lastPass = Unused;
+                m_current[i] = resource.initialState;
+            }
+
+            for (uint32_t index = 0; index < m_order.size(); ++index)
+            {
+                auto const& pass = m_passes[m_order[index]];
+                const uint32_t firstBarrier = static_cast<uint32_t>(m_barriers.size());
+
+                for (auto const& access : GetAccesses(pass))
+                {
+                    auto& resource = m_resources[access.resource];
+                    const bool firstUse = resource.firstPass == Unused;
+                    if (firstUse)
+                    {
+                        resource.firstPass = index;
+                    }
+                    resource.lastPass = index;
+
+                    const ResourceState required = GetRequiredState(index, access.resource);
+                    auto& current = m_current[access.resource];
+                    const bool aliasing = firstUse && !resource.imported;
+
+                    // A read state that already covers this read needs no transition
+                    const bool covered = IsReadState(required) && IsReadState(current) && (current & required) == required;
+                    if ((required != current && !covered) || aliasing)
+                    {
+                        // Skip duplicates from a pass declaring the same resource twice
+                        bool duplicate = false;
+                        for (size_t b = firstBarrier; b < m_barriers.size(); ++b)
+                        {
+                            duplicate = duplicate || m_barriers[b].resource == access.resource;
+                        }
+
+                        if (!duplicate)
+                        {
+                            m_barriers.push_back(Barrier{ access.resource, current, required, aliasing });
+                            current = required;
+                        }
+                    }
+                }
+
+                m_compiledPasses.push_back(CompiledPass{ m_order[index], pass.name, firstBarrier,
+                    static_cast<uint32_t>(m_barriers.size()) - firstBarrier });
+            }
+
+            for (ResourceId i = 0; i < m_resources.size(); ++i)
+            {
+                auto& resource = m_resources[i];
+                if (resource.imported && resource.finalState != ResourceState::Undefined && resource.finalState != m_current[i])
+                {
+                    m_finalBarriers.push_back(Barrier{ i, m_current[i], resource.finalState, false });
+                    m_current[i] = resource.finalState;
+                }
+                resource.endState = m_current[i];
+            }
+        }
+
+        // The state resource must be in for the live pass at index. A pass that writes it needs the write state; a run
+        // of passes that only read it share the union of their read states.
+        ResourceState GetRequiredState(uint32_t index, ResourceId resource) const noexcept
+        {
+            ResourceState state = ResourceState::Undefined;
+            for (auto const& access : GetAccesses(m_passes[m_order[index]]))
+            {
+                if (access.resource == resource && access.write)
+                    return access.state;
+                if (access.resource == resource)
+                    state = state | access.state;
+            }
+
+            for (size_t next = index + 1; next < m_order.size(); ++next)
+            {
+                ResourceState reads = ResourceState::Undefined;
+                for (auto const& access : GetAccesses(m_passes[m_order[next]]))
+                {
+                    if (access.resource != resource)
+                        continue;
+                    if (access.write)
+                        return state;
+                    reads = reads | access.state;
+                }
+
+                if (reads == ResourceState::Undefined)
+                    continue;
+
+                state = state | reads;
+            }
+            return state;
+        }
+
+        std::vector<Resource>       m_resources;
+        std::vector<Pass>           m_passes;
+        std::vector<Access>         m_accesses;
+        bool                        m_compiled;
+
+        // Compile results and scratch space.
+        std::vector<CompiledPass>   m_compiledPasses;
+        std::vector<Barrier>        m_barriers;
+        std::vector<Barrier>        m_finalBarriers;
+        std::vector<bool>           m_needed;
+        std::vector<bool>           m_live;
+        std::vector<PassId>         m_order;
+        std::vector<ResourceState>  m_current;
+    };
+}
@@ -0,0 +1,226 @@
+//
+// FramePacer.h - Schedules each frame's start just in time for the display, from timestamps alone
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+
+namespace DX
+{
+    // Decides how long to hold a frame back after the swap chain can take it, so that input is sampled as late as
+    // possible while the frame is still presented before the display wants it.
+    //
+    // A frame that had to wait for the swap chain was released as the display took the frame before it, so its
+    // ready time marks a refresh. Those times anchor a grid of refreshes, whose spacing is estimated from them too,
+    // but only where the frame before was not held back: one held back may skip refreshes on purpose, and if the
+    // estimate were a multiple of the true refresh it would go on pacing to that multiple. Frames are not held back
+    // until MinIntervals are measured.
+    // A frame's deadline is the first refresh after it is ready, plus one for the frame presented before it if that
+    // one is still queued, which queuedFrames above one allows. The time left before the deadline, less the
+    // predicted input to present time of the frame and a safety margin, is slept. The prediction is a high
+    // percentile of recent frames; the margin doubles on each frame presented past its deadline and decays while
+    // frames make theirs. With one queued frame input is sampled latest; two trade a refresh of it for headroom.
+    //
+    // Only timestamps go in and out, all in one clock's ticks, so recorded traces can be replayed against it.
+    class FramePacer
+    {
+    public:
+        static constexpr size_t HistorySize = 64;
+        static constexpr uint64_t MinIntervals = 8;
+
+        struct Statistics
+        {
+            uint64_t    frameCount;
+            uint64_t    missedCount;                // frames presented after their deadline
+            double      refreshSeconds;             // estimated time between refreshes
+            double      predictedWorkSeconds;       // input to present, as budgeted for the next frame
+            double      marginSeconds;
+            double      sleepSeconds;               // the last frame's
+            double      inputLatencySeconds;        // the last frame's input to present
+            double      meanInputLatencySeconds;    // over the last HistorySize frames
+        };
+
+        explicit FramePacer(uint64_t frequency, uint32_t queuedFrames = 1) :
+            m_frequency(frequency),
+            m_queuedFrames(0),
+            m_enabled(true),
+            m_vblankTicks(0),
+            m_lastPresentTicks(0),
+            m_deadlineTicks(0),
+            m_sleepTicks(0),
+            m_minMarginTicks(frequency / 2000),
+            m_marginTicks(frequency / 1000),
+            m_intervalCount(0),
+            m_workCount(0),
+            m_frameCount(0),
+            m_missedCount(0),
+            m_intervals{},
+            m_work{}
+        {
+            if (frequency == 0)
+            {
+                throw std::invalid_argument("FramePacer needs a tick frequency");
+            }
+
+            SetQueuedFrames(queuedFrames);
+        }
+
+        // How many frames the swap chain may queue for the display.
+        void SetQueuedFrames(uint32_t queuedFrames)
+        {
+            if (queuedFrames < 1 || queuedFrames > 16)
+            {
+                throw std::out_of_range("FramePacer queued frames");
+            }
+            m_queuedFrames = queuedFrames;
+        }
+
+        // While disabled, frames start as soon as they are ready, but are still measured.
+        void SetEnabled(bool enabled) noexcept { m_enabled = enabled; }
+        bool IsEnabled() const noexcept { return m_enabled; }
+
+        // The swap chain could take another frame at readyTicks, having blocked until then if waitedForDisplay.
+        // Returns when to sample input for it, which is never before readyTicks.
+        uint64_t Schedule(uint64_t readyTicks, bool waitedForDisplay) noexcept
+        {
+            if (waitedForDisplay)
+            {
+                // Refreshes missed in between count as intervals of their own
+                if (m_vblankTicks && readyTicks > m_vblankTicks && !m_sleepTicks)
+                {
+                    const uint64_t elapsedTicks = readyTicks - m_vblankTicks;
+                    const uint64_t refreshTicks = GetRefreshTicks();
+                    const uint64_t refreshes = std::max<uint64_t>((elapsedTicks + refreshTicks / 2) / refreshTicks, 1);
+                    m_intervals[m_intervalCount++ % HistorySize] = elapsedTicks / refreshes;
+                }
+                m_vblankTicks = readyTicks;
+            }
+
+            const uint64_t refreshTicks = GetRefreshTicks();
+            uint64_t nextVblankTicks = readyTicks + refreshTicks;
+            if (m_vblankTicks && readyTicks >= m_vblankTicks)
+            {
+                nextVblankTicks = m_vblankTicks + ((readyTicks - m_vblankTicks) / refreshTicks + 1) * refreshTicks;
+            }
+
+            m_deadlineTicks = nextVblankTicks;
+            if (m_queuedFrames > 1 && m_lastPresentTicks > nextVblankTicks - refreshTicks)
+            {
+                m_deadlineTicks += refreshTicks;
+            }
+
+            uint64_t wakeTicks = readyTicks;
+            const uint64_t budgetTicks = GetPredictedWorkTicks() + m_marginTicks;
+            if (m_enabled && m_intervalCount >= MinIntervals && m_deadlineTicks > readyTicks + budgetTicks)
+            {
+                wakeTicks = m_deadlineTicks - budgetTicks;
+            }
+            m_sleepTicks = wakeTicks - readyTicks;
+            return wakeTicks;
+        }
+
+        // The last frame scheduled was presented at presentTicks, showing state simulated from input sampled at
+        // inputTicks. That is an earlier frame's input sample when simulation runs a frame ahead of rendering.
+        void Complete(uint64_t inputTicks, uint64_t presentTicks) noexcept
+        {
+            m_work[m_workCount++ % HistorySize] = presentTicks > inputTicks ? presentTicks - inputTicks : 0;
+            m_lastPresentTicks = presentTicks;
+            m_frameCount++;
+
+            if (presentTicks > m_deadlineTicks)
+            {
+                m_missedCount++;
+                m_marginTicks = std::min(m_marginTicks * 2, GetRefreshTicks() / 2);
+            }
+            else
+            {
+                m_marginTicks = std::max(m_marginTicks - m_marginTicks / 64, m_minMarginTicks);
+            }
+        }
+
+        // The median of recent refresh intervals. Until there are any, assumes 60 Hz, or a tick if the clock is slower.
+        uint64_t GetRefreshTicks() const noexcept
+        {
+            if (!m_intervalCount)
+                return std::max<uint64_t>(m_frequency / 60, 1);
+
+            return Percentile(m_intervals, m_intervalCount, 0.50);
+        }
+
+        // A high percentile of recent frames' input to present times, so that most frames fit in the budget.
+        uint64_t GetPredictedWorkTicks() const noexcept
+        {
+            if (!m_workCount)
+                return 0;
+
+            return Percentile(m_work, m_workCount, 0.99);
+        }
+
+        Statistics GetStatistics() const noexcept
+        {
+            Statistics statistics = {};
+            statistics.frameCount = m_frameCount;
+            statistics.missedCount = m_missedCount;
+            statistics.refreshSeconds = ToSeconds(GetRefreshTicks());
+            statistics.predictedWorkSeconds = ToSeconds(GetPredictedWorkTicks());
+            statistics.marginSeconds = ToSeconds(m_marginTicks);
+            statistics.sleepSeconds = ToSeconds(m_sleepTicks);
+            if (m_workCount)
+            {
+                const size_t count = static_cast<size_t>(std::min<uint64_t>(m_workCount, HistorySize));
+                uint64_t totalTicks = 0;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    totalTicks += m_work[i];
+                }
+                statistics.inputLatencySeconds = ToSeconds(m_work[(m_workCount - 1) % HistorySize]);
+                statistics.meanInputLatencySeconds = ToSeconds(totalTicks) / static_cast<double>(count);
+            }
+            return statistics;
+        }
+
+        uint64_t GetFrequency() const noexcept { return m_frequency; }
+
+    private:
+        using History = std::array<uint64_t, HistorySize>;
+
+        // Nearest rank over the filled part of history.
+        static uint64_t Percentile(History const& history, uint64_t recorded, double fraction) noexcept
+        {
+            const size_t count = static_cast<size_t>(std::min<uint64_t>(recorded, HistorySize));
+            History sorted = history;
+            const size_t rank = std::clamp<size_t>(static_cast<size_t>(fraction * static_cast<double>(count) + 0.999999), 1, count);
+            std::nth_element(sorted.begin(), sorted.begin() + (rank - 1), sorted.begin() + count);
+            return sorted[rank - 1];
+        }
+
+        double ToSeconds(uint64_t ticks) const noexcept
+        {
+            return static_cast<double>(ticks) / static_cast<double>(m_frequency);
+        }
+
+        uint64_t    m_frequency;
+        uint32_t    m_queuedFrames;
+        bool        m_enabled;
+
+        uint64_t    m_vblankTicks;
+        uint64_t    m_lastPresentTicks;
+        uint64_t    m_deadlineTicks;
+        uint64_t    m_sleepTicks;
+        uint64_t    m_minMarginTicks;
+        uint64_t    m_marginTicks;
+
+        uint64_t    m_intervalCount;
+        uint64_t    m_workCount;
+        uint64_t    m_frameCount;
+        uint64_t    m_missedCount;
+        History     m_intervals;
+        History     m_work;
+    };
+}
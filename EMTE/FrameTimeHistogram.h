@@ -0,0 +1,143 @@
+//
+// FrameTimeHistogram.h - Lock-free rolling window of frame times, summarized as percentiles
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+
+namespace DX
+{
+    // Keeps the last WindowSize frames' durations, and how much of each the CPU spent waiting (for the GPU, or for
+    // the display). One thread records; any thread may summarize at the same time without blocking it. Each slot
+    // is guarded by a sequence number, so a summary never sees a frame half written.
+    class FrameTimeHistogram
+    {
+    public:
+        static constexpr size_t WindowSize = 512;
+
+        struct Summary
+        {
+            size_t      frameCount;         // frames in the window
+            double      p50Seconds;
+            double      p95Seconds;
+            double      p99Seconds;
+            double      maxSeconds;
+            size_t      stutterCount;       // frames longer than the stutter factor times the median
+            double      cpuSeconds;         // mean time per frame not spent waiting
+            double      waitSeconds;        // mean time per frame spent waiting
+        };
+
+        // frequency is the number of ticks per second that frames are recorded in.
+        explicit FrameTimeHistogram(uint64_t frequency) :
+            m_frequency(frequency),
+            m_recordedCount(0)
+        {
+            if (frequency == 0)
+            {
+                throw std::invalid_argument("FrameTimeHistogram needs a tick frequency");
+            }
+        }
+
+        FrameTimeHistogram(FrameTimeHistogram const&) = delete;
+        FrameTimeHistogram& operator= (FrameTimeHistogram const&) = delete;
+
+        // Record a frame that took frameTicks, waitTicks of which were spent waiting. Call from one thread only.
+        void Record(uint64_t frameTicks, uint64_t waitTicks) noexcept
+        {
+            const uint64_t index = m_recordedCount.load(std::memory_order_relaxed);
+            auto& slot = m_slots[index % WindowSize];
+
+            // A reader that sees either new value also sees the odd sequence number stored before it, and retries
+            const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+            slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+            slot.frameTicks.store(frameTicks, std::memory_order_release);
+            slot.waitTicks.store(std::min(waitTicks, frameTicks), std::memory_order_release);
+
+            slot.sequence.store(sequence + 2, std::memory_order_release);
+            m_recordedCount.store(index + 1, std::memory_order_release);
+        }
+
+        // Percentiles use the nearest rank, so they are always one of the recorded frame times.
+        Summary Summarize(double stutterFactor = 2.0) const noexcept
+        {
+            const size_t count = static_cast<size_t>(std::min<uint64_t>(m_recordedCount.load(std::memory_order_acquire), WindowSize));
+
+            std::array<uint64_t, WindowSize> frames;
+            uint64_t totalTicks = 0;
+            uint64_t waitTicks = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto const& slot = m_slots[i];
+                uint64_t frame;
+                uint64_t wait;
+                uint32_t before;
+                uint32_t after;
+                do
+                {
+                    before = slot.sequence.load(std::memory_order_acquire);
+                    frame = slot.frameTicks.load(std::memory_order_acquire);
+                    wait = slot.waitTicks.load(std::memory_order_acquire);
+                    after = slot.sequence.load(std::memory_order_relaxed);
+                } while ((before & 1) != 0 || before != after);
+
+                frames[i] = frame;
+                totalTicks += frame;
+                waitTicks += wait;
+            }
+
+            Summary summary = {};
+            summary.frameCount = count;
+            if (!count)
+                return summary;
+
+            std::sort(frames.begin(), frames.begin() + count);
+            auto const percentile = [&](double fraction)
+                {
+                    const size_t rank = static_cast<size_t>(fraction * static_cast<double>(count) + 0.999999);
+                    return ToSeconds(frames[std::clamp<size_t>(rank, 1, count) - 1]);
+                };
+
+            summary.p50Seconds = percentile(0.50);
+            summary.p95Seconds = percentile(0.95);
+            summary.p99Seconds = percentile(0.99);
+            summary.maxSeconds = ToSeconds(frames[count - 1]);
+
+            const double stutterSeconds = summary.p50Seconds * stutterFactor;
+            summary.stutterCount = static_cast<size_t>(frames.begin() + count
+                - std::upper_bound(frames.begin(), frames.begin() + count, stutterSeconds,
+                    [this](double seconds, uint64_t ticks) { return seconds < ToSeconds(ticks); }));
+
+            summary.cpuSeconds = ToSeconds(totalTicks - waitTicks) / static_cast<double>(count);
+            summary.waitSeconds = ToSeconds(waitTicks) / static_cast<double>(count);
+            return summary;
+        }
+
+        // Frames recorded since construction, including those that have left the window.
+        uint64_t GetRecordedCount() const noexcept { return m_recordedCount.load(std::memory_order_acquire); }
+        uint64_t GetFrequency() const noexcept { return m_frequency; }
+
+    private:
+        struct Slot
+        {
+            std::atomic<uint32_t>   sequence{ 0 };
+            std::atomic<uint64_t>   frameTicks{ 0 };
+            std::atomic<uint64_t>   waitTicks{ 0 };
+        };
+
+        double ToSeconds(uint64_t ticks) const noexcept
+        {
+            return static_cast<double>(ticks) / static_cast<double>(m_frequency);
+        }
+
+        uint64_t                            m_frequency;
+        std::atomic<uint64_t>               m_recordedCount;
+        std::array<Slot, WindowSize>        m_slots;
+    };
+}
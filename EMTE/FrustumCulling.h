@@ -0,0 +1,413 @@
+//
+// FrustumCulling.h - Tests structure-of-arrays bounding volumes against a view frustum, four or eight at a time
+//
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DX_CULLING_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles AVX2 intrinsics anywhere; GCC and Clang only in functions targeting it
+#if defined(DX_CULLING_X86) && (defined(__GNUC__) || defined(__clang__))
+#define DX_CULLING_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DX_CULLING_TARGET_AVX2
+#endif
+
+
+namespace DX
+{
+    // A plane as in DirectXMath: the points p with a*p.x + b*p.y + c*p.z + d == 0, in front of it when positive.
+    // Laid out as an XMFLOAT4.
+    struct FrustumPlane
+    {
+        float a, b, c, d;
+    };
+
+    // The six planes bounding what a view-projection matrix can see, normalized and facing inwards.
+    struct Frustum
+    {
+        enum Side { Left, Right, Bottom, Top, Near, Far, SideCount };
+
+        FrustumPlane planes[SideCount];
+
+        // Extract the planes of viewProjection, any 4x4 matrix with m[row][column] used with row vectors as
+        // DirectXMath does, e.g. view * projection. The clip volume is Direct3D's: depth runs from 0 to 1.
+        template<typename TMatrix>
+        static Frustum FromMatrix(TMatrix const& viewProjection)
+        {
+            auto const& m = viewProjection.m;
+            auto const wPlus = [&m](float sign, int column)
+                {
+                    // Column 3 of the matrix, plus or minus another column
+                    return FrustumPlane{
+                        m[0][3] + sign * m[0][column], m[1][3] + sign * m[1][column],
+                        m[2][3] + sign * m[2][column], m[3][3] + sign * m[3][column] };
+                };
+
+            Frustum frustum;
+            frustum.planes[Left] = wPlus(+1.f, 0);
+            frustum.planes[Right] = wPlus(-1.f, 0);
+            frustum.planes[Bottom] = wPlus(+1.f, 1);
+            frustum.planes[Top] = wPlus(-1.f, 1);
+            frustum.planes[Near] = FrustumPlane{ m[0][2], m[1][2], m[2][2], m[3][2] };
+            frustum.planes[Far] = wPlus(-1.f, 2);
+
+            for (auto& plane : frustum.planes)
+            {
+                const float length = std::sqrt(plane.a * plane.a + plane.b * plane.b + plane.c * plane.c);
+                if (length > 0.f)
+                {
+                    plane = FrustumPlane{ plane.a / length, plane.b / length, plane.c / length, plane.d / length };
+                }
+            }
+            return frustum;
+        }
+    };
+
+    // Bounding spheres, one array per component.
+    struct BoundingSphereSoA
+    {
+        std::vector<float> x, y, z, radius;
+
+        size_t size() const noexcept { return x.size(); }
+
+        void clear() noexcept
+        {
+            x.clear(); y.clear(); z.clear(); radius.clear();
+        }
+
+        void reserve(size_t count)
+        {
+            x.reserve(count); y.reserve(count); z.reserve(count); radius.reserve(count);
+        }
+
+        void push_back(float centerX, float centerY, float centerZ, float r)
+        {
+            x.push_back(centerX); y.push_back(centerY); z.push_back(centerZ); radius.push_back(r);
+        }
+    };
+
+    // Axis-aligned boxes as a center and half extents, one array per component.
+    struct BoundingBoxSoA
+    {
+        std::vector<float> x, y, z, extentX, extentY, extentZ;
+
+        size_t size() const noexcept { return x.size(); }
+
+        void clear() noexcept
+        {
+            x.clear(); y.clear(); z.clear(); extentX.clear(); extentY.clear(); extentZ.clear();
+        }
+
+        void reserve(size_t count)
+        {
+            x.reserve(count); y.reserve(count); z.reserve(count);
+            extentX.reserve(count); extentY.reserve(count); extentZ.reserve(count);
+        }
+
+        void push_back(float centerX, float centerY, float centerZ, float halfX, float halfY, float halfZ)
+        {
+            x.push_back(centerX); y.push_back(centerY); z.push_back(centerZ);
+            extentX.push_back(halfX); extentY.push_back(halfY); extentZ.push_back(halfZ);
+        }
+    };
+
+    enum class CullPath
+    {
+        Scalar,
+        Sse,
+        Avx2,
+        Best,       // the widest this CPU supports
+    };
+
+    // Writes the indices of the volumes that are at least partly inside a frustum, in ascending order.
+    //
+    // A volume is culled when it lies wholly behind one of the planes; volumes that straddle a corner outside the
+    // frustum are kept, as is usual for plane tests. Every path evaluates the same expressions in the same order
+    // without fused multiply-adds, so all of them give exactly the scalar result.
+    class FrustumCuller
+    {
+    public:
+        // The widest path this CPU can run.
+        static CullPath GetBestPath() noexcept
+        {
+#if defined(DX_CULLING_X86)
+            static const CullPath best = HasAvx2() ? CullPath::Avx2 : CullPath::Sse;
+            return best;
+#else
+            return CullPath::Scalar;
+#endif
+        }
+
+        static bool IsSupported(CullPath path) noexcept
+        {
+            return path == CullPath::Best || static_cast<int>(path) <= static_cast<int>(GetBestPath());
+        }
+
+        // Replace visible with the indices of the spheres that may be visible. Returns their number.
+        static size_t Cull(Frustum const& frustum, BoundingSphereSoA const& spheres, std::vector<uint32_t>& visible,
+            CullPath path = CullPath::Best)
+        {
+            const size_t count = spheres.size();
+            visible.resize(count + c_maxWidth);
+
+            const CullPath resolved = Resolve(path);
+            size_t written = 0;
+            switch (resolved)
+            {
+#if defined(DX_CULLING_X86)
+            case CullPath::Avx2:
+                written = CullSpheresAvx2(frustum, spheres, visible.data());
+                break;
+            case CullPath::Sse:
+                written = CullSpheresSse(frustum, spheres, visible.data());
+                break;
+#endif
+            default:
+                break;
+            }
+            written = CullSpheresScalar(frustum, spheres, GetVectorEnd(resolved, count), count, visible.data(), written);
+
+            visible.resize(written);
+            return written;
+        }
+
+        // Replace visible with the indices of the boxes that may be visible. Returns their number.
+        static size_t Cull(Frustum const& frustum, BoundingBoxSoA const& boxes, std::vector<uint32_t>& visible,
+            CullPath path = CullPath::Best)
+        {
+            const size_t count = boxes.size();
+            visible.resize(count + c_maxWidth);
+
+            const CullPath resolved = Resolve(path);
+            size_t written = 0;
+            switch (resolved)
+            {
+#if defined(DX_CULLING_X86)
+            case CullPath::Avx2:
+                written = CullBoxesAvx2(frustum, boxes, visible.data());
+                break;
+            case CullPath::Sse:
+                written = CullBoxesSse(frustum, boxes, visible.data());
+                break;
+#endif
+            default:
+                break;
+            }
+            written = CullBoxesScalar(frustum, boxes, GetVectorEnd(resolved, count), count, visible.data(), written);
+
+            visible.resize(written);
+            return written;
+        }
+
+    private:
+        static constexpr size_t c_maxWidth = 8;
+
+        static CullPath Resolve(CullPath path)
+        {
+            if (path == CullPath::Best)
+                return GetBestPath();
+            if (!IsSupported(path))
+                throw std::invalid_argument("FrustumCuller path is not supported by this CPU");
+            return path;
+        }
+
+        // Where a path's vector loop stops, and the scalar tail starts.
+        static size_t GetVectorEnd(CullPath path, size_t count) noexcept
+        {
+            return path == CullPath::Avx2 ? count & ~size_t(7) : path == CullPath::Sse ? count & ~size_t(3) : 0;
+        }
+
+        // The reference implementation, and the tail of the wider paths.
+        static size_t CullSpheresScalar(Frustum const& frustum, BoundingSphereSoA const& spheres, size_t begin, size_t end,
+            uint32_t* out, size_t written)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                const float negRadius = -spheres.radius[i];
+                bool outside = false;
+                for (auto const& p : frustum.planes)
+                {
+                    const float distance = ((p.a * spheres.x[i] + p.b * spheres.y[i]) + p.c * spheres.z[i]) + p.d;
+                    outside |= distance < negRadius;
+                }
+
+                out[written] = static_cast<uint32_t>(i);
+                written += outside ? 0 : 1;
+            }
+            return written;
+        }
+
+        static size_t CullBoxesScalar(Frustum const& frustum, BoundingBoxSoA const& boxes, size_t begin, size_t end,
+            uint32_t* out, size_t written)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                bool outside = false;
+                for (auto const& p : frustum.planes)
+                {
+                    const float distance = ((p.a * boxes.x[i] + p.b * boxes.y[i]) + p.c * boxes.z[i]) + p.d;
+                    const float reach = (std::fabs(p.a) * boxes.extentX[i] + std::fabs(p.b) * boxes.extentY[i])
+                        + std::fabs(p.c) * boxes.extentZ[i];
+                    outside |= distance < -reach;
+                }
+
+                out[written] = static_cast<uint32_t>(i);
+                written += outside ? 0 : 1;
+            }
+            return written;
+        }
+
+#if defined(DX_CULLING_X86)
+        static bool HasAvx2() noexcept
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4] = {};
+            __cpuid(info, 0);
+            if (info[0] < 7)
+                return false;
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+                return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+
+        // Store the indices of the visible lanes. Every lane is written, and only visible lanes advance the output.
+        static size_t Compact(uint32_t* out, size_t written, size_t base, unsigned visibleMask, size_t width) noexcept
+        {
+            for (size_t lane = 0; lane < width; ++lane)
+            {
+                out[written] = static_cast<uint32_t>(base + lane);
+                written += (visibleMask >> lane) & 1;
+            }
+            return written;
+        }
+
+        static size_t CullSpheresSse(Frustum const& frustum, BoundingSphereSoA const& spheres, uint32_t* out)
+        {
+            const size_t end = spheres.size() & ~size_t(3);
+            size_t written = 0;
+            for (size_t i = 0; i < end; i += 4)
+            {
+                const __m128 x = _mm_loadu_ps(&spheres.x[i]);
+                const __m128 y = _mm_loadu_ps(&spheres.y[i]);
+                const __m128 z = _mm_loadu_ps(&spheres.z[i]);
+                const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+                __m128 outside = _mm_setzero_ps();
+                for (auto const& p : frustum.planes)
+                {
+                    __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.a), x), _mm_mul_ps(_mm_set1_ps(p.b), y));
+                    distance = _mm_add_ps(_mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(p.c), z)), _mm_set1_ps(p.d));
+                    outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negRadius));
+                }
+
+                written = Compact(out, written, i, ~static_cast<unsigned>(_mm_movemask_ps(outside)) & 0xF, 4);
+            }
+            return written;
+        }
+
+        static size_t CullBoxesSse(Frustum const& frustum, BoundingBoxSoA const& boxes, uint32_t* out)
+        {
+            const size_t end = boxes.size() & ~size_t(3);
+            size_t written = 0;
+            for (size_t i = 0; i < end; i += 4)
+            {
+                const __m128 x = _mm_loadu_ps(&boxes.x[i]);
+                const __m128 y = _mm_loadu_ps(&boxes.y[i]);
+                const __m128 z = _mm_loadu_ps(&boxes.z[i]);
+                const __m128 extentX = _mm_loadu_ps(&boxes.extentX[i]);
+                const __m128 extentY = _mm_loadu_ps(&boxes.extentY[i]);
+                const __m128 extentZ = _mm_loadu_ps(&boxes.extentZ[i]);
+
+                __m128 outside = _mm_setzero_ps();
+                for (auto const& p : frustum.planes)
+                {
+                    __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.a), x), _mm_mul_ps(_mm_set1_ps(p.b), y));
+                    distance = _mm_add_ps(_mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(p.c), z)), _mm_set1_ps(p.d));
+                    __m128 reach = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(p.a)), extentX),
+                        _mm_mul_ps(_mm_set1_ps(std::fabs(p.b)), extentY));
+                    reach = _mm_add_ps(reach, _mm_mul_ps(_mm_set1_ps(std::fabs(p.c)), extentZ));
+                    outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_sub_ps(_mm_setzero_ps(), reach)));
+                }
+
+                written = Compact(out, written, i, ~static_cast<unsigned>(_mm_movemask_ps(outside)) & 0xF, 4);
+            }
+            return written;
+        }
+
+        DX_CULLING_TARGET_AVX2
+        static size_t CullSpheresAvx2(Frustum const& frustum, BoundingSphereSoA const& spheres, uint32_t* out)
+        {
+            const size_t end = spheres.size() & ~size_t(7);
+            size_t written = 0;
+            for (size_t i = 0; i < end; i += 8)
+            {
+                const __m256 x = _mm256_loadu_ps(&spheres.x[i]);
+                const __m256 y = _mm256_loadu_ps(&spheres.y[i]);
+                const __m256 z = _mm256_loadu_ps(&spheres.z[i]);
+                const __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]));
+
+                __m256 outside = _mm256_setzero_ps();
+                for (auto const& p : frustum.planes)
+                {
+                    __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.a), x), _mm256_mul_ps(_mm256_set1_ps(p.b), y));
+                    distance = _mm256_add_ps(_mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(p.c), z)), _mm256_set1_ps(p.d));
+                    outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negRadius, _CMP_LT_OQ));
+                }
+
+                written = Compact(out, written, i, ~static_cast<unsigned>(_mm256_movemask_ps(outside)) & 0xFF, 8);
+            }
+            return written;
+        }
+
+        DX_CULLING_TARGET_AVX2
+        static size_t CullBoxesAvx2(Frustum const& frustum, BoundingBoxSoA const& boxes, uint32_t* out)
+        {
+            const size_t end = boxes.size() & ~size_t(7);
+            size_t written = 0;
+            for (size_t i = 0; i < end; i += 8)
+            {
+                const __m256 x = _mm256_loadu_ps(&boxes.x[i]);
+                const __m256 y = _mm256_loadu_ps(&boxes.y[i]);
+                const __m256 z = _mm256_loadu_ps(&boxes.z[i]);
+                const __m256 extentX = _mm256_loadu_ps(&boxes.extentX[i]);
+                const __m256 extentY = _mm256_loadu_ps(&boxes.extentY[i]);
+                const __m256 extentZ = _mm256_loadu_ps(&boxes.extentZ[i]);
+
+                __m256 outside = _mm256_setzero_ps();
+                for (auto const& p : frustum.planes)
+                {
+                    __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.a), x), _mm256_mul_ps(_mm256_set1_ps(p.b), y));
+                    distance = _mm256_add_ps(_mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(p.c), z)), _mm256_set1_ps(p.d));
+                    __m256 reach = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::fabs(p.a)), extentX),
+                        _mm256_mul_ps(_mm256_set1_ps(std::fabs(p.b)), extentY));
+                    reach = _mm256_add_ps(reach, _mm256_mul_ps(_mm256_set1_ps(std::fabs(p.c)), extentZ));
+                    outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_sub_ps(_mm256_setzero_ps(), reach), _CMP_LT_OQ));
+                }
+
+                written = Compact(out, written, i, ~static_cast<unsigned>(_mm256_movemask_ps(outside)) & 0xFF, 8);
+            }
+            return written;
+        }
+#endif
+    };
+}
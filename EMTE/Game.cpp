@@ -12,29 +12,77 @@ using namespace DirectX::SimpleMath;
 
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+    // Textures used by name each frame. Their IDs are hashed at compile time.
+    constexpr DX::TextureId c_catTexture(L"textures/cat.dds");
+    constexpr DX::TextureId c_sunsetTexture(L"textures/sunset.jpg");
+    constexpr DX::TextureId c_rocksDiffuseTexture(L"textures/rocks_diff.dds");
+    constexpr DX::TextureId c_rocksNormalTexture(L"textures/rocks_norm.dds");
+
+    // Diffuse colors of the instanced materials. Material 0 is the lit sphere's own.
+    const XMVECTORF32 c_instanceMaterialColors[] =
+    {
+        Colors::White,
+        Colors::IndianRed,
+        Colors::SeaGreen,
+        Colors::SteelBlue,
+    };
+
+    // Depth range of the projection, also used to quantize draw depths into sort keys
+    constexpr float c_nearPlane = 0.1f;
+    constexpr float c_farPlane = 100.f;
+
+    // Room for a few frames of instance transforms and debug vertices; anything more spills into GraphicsMemory
+    constexpr uint64_t c_uploadRingSize = 16 * 1024 * 1024;
+}
+
 Game::Game() noexcept(false)
 {
     //Create device resource instance
-    m_deviceResources = std::make_unique<DX::DeviceResources>();
+    m_deviceResources = std::make_unique<DX::DeviceResources>(DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_D32_FLOAT, 2,
+        D3D_FEATURE_LEVEL_11_0, DX::DeviceResources::c_FrameLatencyWaitable);
 
     // TODO: Provide parameters for swapchain format, depth/stencil format, and backbuffer count.
     //   Add DX::DeviceResources::c_AllowTearing to opt-in to variable rate displays.
     //   Add DX::DeviceResources::c_EnableHDR for HDR10 display.
     //   Add DX::DeviceResources::c_ReverseDepth to optimize depth buffer clears for 0 instead of 1.
     m_deviceResources->RegisterDeviceNotify(this);
+
+    // Trace the CPU zones and both queues' fences whenever a capture runs. The timelines outlive device loss.
+    DX::GetProfiler().SetEventSink(&m_trace);
+    m_trace.AddFenceTrack(m_deviceResources->GetFrameTimeline(), "Frame fence");
+    m_trace.AddFenceTrack(m_deviceResources->GetCopyTimeline(), "Copy fence");
+
+    // Create the job system that runs the frame's tasks
+    m_jobs = std::make_unique<DX::JobSystem>();
+    CreateUpdateGraph();
+
+    // The lit sphere sits at the origin; the ring turns about a pivot of its own, so turning the pivot moves every
+    // ring instance without touching their transforms
+    m_litEntity = m_transforms.Create();
+    m_ringPivot = m_transforms.Create();
 }
 
 Game::~Game()
 {
+    m_jobs->Wait(m_traceExport);
+
     if (m_deviceResources)
     {
         m_deviceResources->WaitForGpu();
     }
+
+    // Nothing may report to the capture once it is gone
+    DX::GetProfiler().SetEventSink(nullptr);
+    m_trace.DetachFenceTracks();
 }
 
 // Initialize the Direct3D resources required to run.
 void Game::Initialize(HWND window, int width, int height)
 {
+    DX::GetProfiler().SetThreadName("Main");
+
     m_deviceResources->SetWindow(window, width, height);
 
     m_deviceResources->CreateDeviceResources();
@@ -51,39 +99,369 @@ void Game::Initialize(HWND window, int width, int height)
     m_timer.SetFixedTimeStep(true);
     m_timer.SetTargetElapsedSeconds(1.0 / 60);
     */
+
+    // In fixed timestep mode, don't let a slow frame queue up more Updates than the next frame can absorb, and
+    // drop to as little as 15 Hz while frames stay that slow
+    m_timer.SetMaxUpdatesPerTick(4);
+    m_timer.SetAdaptiveTimeStep(true, DX::StepTimer::TicksPerSecond / 15);
 }
 
 #pragma region Frame Update
 // Executes the basic game loop.
 void Game::Tick()
 {
+    // Zones recorded since the last Tick, on every thread, make up the frame shown by the profiler window
+    DX::GetProfiler().EndFrame();
+    m_trace.RecordFrame(m_timer.GetFrameCount());
+    DX_PROFILE_ZONE("Frame");
+
+    WaitForFrame();
+
+    // Time the whole of the previous frame, from one Tick to the next, including its waits on the GPU and display
+    const uint64_t frameStart = m_frameInputTicks;
+    if (m_lastFrameStart)
+    {
+        const double waitSeconds = m_deviceResources->GetLastFrameWaitSeconds();
+        m_frameTimes.Record(frameStart - m_lastFrameStart,
+            static_cast<uint64_t>(waitSeconds * static_cast<double>(m_frameTimes.GetFrequency())) + m_frameWaitTicks);
+    }
+    m_lastFrameStart = frameStart;
+
     // Start ImGui frame
     ImGui_ImplDX12_NewFrame();
     ImGui_ImplWin32_NewFrame();
     ImGui::NewFrame();
     ImGui::ShowDemoWindow();
+    ShowFrameStats();
+    ShowProfiler();
+
+    // Input is sampled on the main thread, which owns the window's message queue
+    SampleInput();
+
+    // Swap in any textures that finished loading, and effects that finished compiling, before passes that draw
+    // with them are recorded
+    UpdateTextures();
+    UpdateEffects();
+
+    if (m_pipelined)
+    {
+        // Simulate the next frame on a worker while this frame's commands are built from the last snapshot
+        DX::JobSystem::Counter simulation;
+        bool simulated = false;
+        m_jobs->Run([this, &simulated]() { simulated = Simulate(); }, &simulation);
+
+        try
+        {
+            Render(m_renderStates.GetRead());
+        }
+        catch (...)
+        {
+            m_jobs->Wait(simulation);
+            throw;
+        }
+
+        m_jobs->Wait(simulation);
+        if (simulated)
+        {
+            m_renderStates.Publish();
+        }
+    }
+    else
+    {
+        if (Simulate())
+        {
+            m_renderStates.Publish();
+        }
+        Render(m_renderStates.GetRead());
+    }
+}
+
+// Wait for the swap chain to take another frame, then sleep until the pacer's time to sample input for it.
+void Game::WaitForFrame()
+{
+    DX_PROFILE_ZONE("WaitForFrame");
+
+    auto& clock = DX::GetSystemClock();
+    const uint64_t waitStart = clock.GetTicks();
+    const bool waitedForDisplay = m_deviceResources->WaitForFrameLatency();
+
+    const uint64_t inputTicks = m_framePacer.Schedule(clock.GetTicks(), waitedForDisplay);
+    DX::SleepUntil(clock, inputTicks, clock.GetFrequency() / 1000);
+
+    m_frameInputTicks = clock.GetTicks();
+    m_frameWaitTicks = m_frameInputTicks - waitStart;
+}
+
+// Advance the timer, running as many Updates as it asks for. Returns whether any ran, and so rewrote the render
+// state being built.
+bool Game::Simulate()
+{
+    DX_PROFILE_ZONE("Simulate");
 
     m_timer.Tick([&]()
         {
             Update(m_timer);
         });
+    return m_timer.GetLastUpdateCount() > 0;
+}
+
+// Show frame pacing statistics
+void Game::ShowFrameStats()
+{
+    DX_PROFILE_ZONE("ShowFrameStats");
 
-    Render();
+    ImGui::Begin("Frame");
+    ImGui::Checkbox("Pipelined update", &m_pipelined);
+    ImGui::Text("FPS: %u", m_timer.GetFramesPerSecond());
+    bool fixedTimeStep = m_timer.IsFixedTimeStep();
+    if (ImGui::Checkbox("Fixed timestep", &fixedTimeStep))
+    {
+        m_timer.SetFixedTimeStep(fixedTimeStep);
+        m_timer.ResetElapsedTime();
+    }
+    ImGui::Text("Updates: %u last frame, step %.2f ms, alpha %.2f, %.1f ms dropped", m_timer.GetLastUpdateCount(),
+        DX::StepTimer::TicksToSeconds(m_timer.GetStepTicks()) * 1000.0, m_timer.GetInterpolationAlpha(),
+        DX::StepTimer::TicksToSeconds(m_timer.GetDroppedTicks()) * 1000.0);
+    auto const frameTimes = m_frameTimes.Summarize();
+    ImGui::Text("Frame time: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms, %zu stutters in %zu frames",
+        frameTimes.p50Seconds * 1000.0, frameTimes.p95Seconds * 1000.0, frameTimes.p99Seconds * 1000.0,
+        frameTimes.maxSeconds * 1000.0, frameTimes.stutterCount, frameTimes.frameCount);
+    ImGui::Text("Frame CPU: %.3f ms working, %.3f ms waiting", frameTimes.cpuSeconds * 1000.0, frameTimes.waitSeconds * 1000.0);
+    ImGui::Text("Frames in flight: %u", m_deviceResources->GetFramesInFlight());
+    bool framePacing = m_framePacer.IsEnabled();
+    if (ImGui::Checkbox("Frame pacing", &framePacing))
+    {
+        m_framePacer.SetEnabled(framePacing);
+    }
+    int queuedFrames = static_cast<int>(m_deviceResources->GetMaximumFrameLatency());
+    if (ImGui::SliderInt("Queued frames", &queuedFrames, 1, 2))
+    {
+        m_deviceResources->SetMaximumFrameLatency(static_cast<UINT>(queuedFrames));
+        m_framePacer.SetQueuedFrames(static_cast<uint32_t>(queuedFrames));
+    }
+    auto const pacing = m_framePacer.GetStatistics();
+    ImGui::Text("Pacing: refresh %.2f ms, slept %.2f ms, budget %.2f ms + %.2f ms margin, %llu of %llu frames late",
+        pacing.refreshSeconds * 1000.0, pacing.sleepSeconds * 1000.0, pacing.predictedWorkSeconds * 1000.0,
+        pacing.marginSeconds * 1000.0, pacing.missedCount, pacing.frameCount);
+    ImGui::Text("Input to present: %.2f ms (mean %.2f ms)", pacing.inputLatencySeconds * 1000.0,
+        pacing.meanInputLatencySeconds * 1000.0);
+    ImGui::Text("CPU wait on GPU: %.3f ms", m_deviceResources->GetLastFrameWaitSeconds() * 1000.0);
+    if (m_uploadAllocator)
+    {
+        auto const& upload = m_uploadAllocator->GetRing().GetLastFrameStatistics();
+        ImGui::Text("Upload ring: %.1f KB in %llu allocations (%.1f KB padding), high water %.2f of %.2f MB, %zu spilled",
+            upload.allocatedBytes / 1024.0, upload.allocationCount, upload.paddingBytes / 1024.0,
+            upload.highWaterMark / 1048576.0, m_uploadAllocator->GetRing().GetCapacity() / 1048576.0,
+            m_uploadAllocator->GetLastFrameFallbackCount());
+        auto const graphicsMemory = m_graphicsMemory->GetStatistics();
+        ImGui::Text("GraphicsMemory: %.2f MB committed, %.2f MB total", graphicsMemory.committedMemory / 1048576.0,
+            graphicsMemory.totalMemory / 1048576.0);
+    }
+    if (auto pool = m_deviceResources->GetCommandContextPool())
+    {
+        ImGui::Text("Command recording: %.3f ms (%zu contexts)", pool->GetRecordSeconds() * 1000.0, pool->GetCreatedCount());
+        for (auto const seconds : pool->GetPassSeconds())
+        {
+            ImGui::BulletText("%.3f ms", seconds * 1000.0);
+        }
+    }
+    if (m_textureLoader)
+    {
+        ImGui::Text("Textures loading: %zu of %zu (decode %.3f ms)", m_textureLoader->GetPendingCount(),
+            m_textureLoader->GetRequestCount(), m_textureLoader->GetDecodeSeconds() * 1000.0);
+    }
+    ImGui::Text("Frame graph: %zu passes (%zu culled), %zu barriers", m_frameGraph.GetPassCount(),
+        m_frameGraph.GetCulledCount(), m_frameGraph.GetBarrierCount());
+    auto const barriers = m_deviceResources->GetStateTracker().GetStatistics();
+    ImGui::Text("Barriers: %llu in %llu batches, %llu redundant skipped, %llu fixups at submit",
+        barriers.barriers, barriers.batches, barriers.redundant, barriers.fixups);
+    if (m_renderTargetPool)
+    {
+        ImGui::Text("Render targets: %zu created, %zu reused, %zu pooled", m_renderTargetPool->GetCreatedCount(),
+            m_renderTargetPool->GetReusedCount(), m_renderTargetPool->GetPooledCount());
+    }
+    bool showDebugDraw = m_showDebugDraw.load(std::memory_order_relaxed);
+    if (ImGui::Checkbox("Debug draw", &showDebugDraw))
+    {
+        m_showDebugDraw.store(showDebugDraw, std::memory_order_relaxed);
+    }
+    ImGui::Text("Debug draw: %zu lines, %zu triangles from %u threads", m_debugDraw.GetMergedLineCount(),
+        m_debugDraw.GetMergedTriangleCount(), m_debugDraw.GetThreadCount());
+    int ringInstances = static_cast<int>(m_ringInstanceCount.load(std::memory_order_relaxed));
+    if (ImGui::SliderInt("Ring instances", &ringInstances, 0, 100000, "%d", ImGuiSliderFlags_Logarithmic))
+    {
+        m_ringInstanceCount.store(static_cast<uint32_t>(ringInstances), std::memory_order_relaxed);
+    }
+    auto const& instances = m_renderStates.GetRead().instances;
+    ImGui::Text("Instances: %zu in %zu draws, %zu culled", instances.GetInstanceCount(), instances.GetBatches().size(),
+        m_renderStates.GetRead().culledInstances);
+    ImGui::Text("Transforms: %zu entities, %zu levels, %zu updated", m_transforms.GetEntityCount(), m_transforms.GetDepth(),
+        m_transforms.GetUpdatedCount());
+    ImGui::Text("Instance tree: %zu nodes, cost %.1f (%.1f when built), %zu builds", m_instanceTree.GetNodes().size(),
+        m_instanceTree.GetCost(), m_instanceTree.GetBuiltCost(), m_instanceTreeBuilds);
+    auto const litStatistics = m_litQueue.GetStatistics();
+    ImGui::Text("Lit draws: %zu, %zu pipeline and %zu material binds", litStatistics.draws,
+        litStatistics.pipelineBinds, litStatistics.materialBinds);
+    if (m_effectCompiler)
+    {
+        ImGui::Text("Effects compiling: %zu of %zu (%.3f ms), %zu draws on fallbacks, %zu skipped",
+            m_effectCompiler->GetPendingCount(), m_effectCompiler->GetRequestCount(),
+            m_effectCompiler->GetCompileSeconds() * 1000.0, m_fallbackLitDraws, m_skippedLitDraws);
+    }
+    if (m_debugGeometry)
+    {
+        int divisions = static_cast<int>(m_grid.divisions);
+        if (ImGui::SliderInt("Grid divisions", &divisions, 1, 1000))
+        {
+            m_grid.divisions = static_cast<uint32_t>(divisions);
+        }
+        ImGui::Text("Debug geometry: %zu cached, %zu generated (%.1f KB)", m_debugGeometry->GetCachedCount(),
+            m_debugGeometry->GetGeneratedCount(), m_debugGeometry->GetGeneratedBytes() / 1024.0);
+    }
+    ImGui::Text("Update tasks (%u workers):", m_jobs->GetWorkerCount());
+    for (auto const& timing : m_updateGraph.GetTimings())
+    {
+        ImGui::BulletText("%s: %.3f ms on thread %zu", timing.name, timing.durationSeconds * 1000.0, timing.thread);
+    }
+    ImGui::End();
+}
+
+// Show the last frame's CPU zones as a call tree per thread
+void Game::ShowProfiler()
+{
+    DX_PROFILE_ZONE("ShowProfiler");
+
+    auto& profiler = DX::GetProfiler();
+    ImGui::Begin("Profiler");
+    bool enabled = profiler.IsEnabled();
+    if (ImGui::Checkbox("Record zones", &enabled))
+    {
+        profiler.SetEnabled(enabled);
+    }
+    ImGui::Text("%zu threads, %llu events dropped, %llu unmatched", profiler.GetThreadCount(), profiler.GetDroppedCount(),
+        profiler.GetUnmatchedCount());
+
+    bool capturing = m_trace.IsCapturing();
+    if (ImGui::Checkbox("Capture trace", &capturing))
+    {
+        capturing ? m_trace.Start() : m_trace.Stop();
+    }
+    ImGui::Text("Trace: %zu records, %llu overwritten (%zu MB kept)", m_trace.GetRecordCount(), m_trace.GetDroppedCount(),
+        m_trace.GetCapacityBytes() >> 20);
+    if (m_traceJob && m_traceExport.IsDone())
+    {
+        m_traceStatus = std::move(m_traceJob->status);
+        m_traceJob.reset();
+    }
+    if (ImGui::Button("Export trace") && !m_traceJob)
+    {
+        ExportTrace();
+    }
+    ImGui::TextUnformatted(m_traceJob ? "Writing trace.json..." : m_traceStatus.c_str());
+
+    uint32_t thread = UINT32_MAX;
+    for (auto const& node : profiler.GetLastFrame())
+    {
+        if (node.thread != thread)
+        {
+            thread = node.thread;
+            ImGui::Separator();
+            ImGui::TextUnformatted(profiler.GetThreadName(thread).c_str());
+        }
+        ImGui::Text("%*s%s: %u calls, %.3f ms (%.3f ms self)", static_cast<int>(node.depth * 2), "", node.zone->name,
+            node.calls, node.inclusiveNanoseconds * 1e-6, node.exclusiveNanoseconds * 1e-6);
+    }
+    ImGui::End();
+}
+
+// Hand everything captured so far to a worker, which writes it to trace.json for chrome://tracing or Perfetto
+void Game::ExportTrace()
+{
+    // std::function needs a copyable job. The job only touches its own TraceExport, which ShowProfiler reads back
+    // once m_traceExport is done
+    auto job = std::make_shared<TraceExport>();
+    job->snapshot = m_trace.TakeSnapshot(DX::GetProfiler());
+    m_traceJob = job;
+    m_jobs->Run([job]()
+        {
+            DX_PROFILE_ZONE("ExportTrace");
+
+            try
+            {
+                auto const result = DX::WriteChromeTrace(job->snapshot, "trace.json");
+                char status[128];
+                std::snprintf(status, sizeof(status), "Wrote %zu events to trace.json (%zu unmatched, %llu overwritten)",
+                    result.events, result.unmatched, job->snapshot.droppedRecords);
+                job->status = status;
+            }
+            catch (std::exception const& e)
+            {
+                job->status = std::string("Trace export failed: ") + e.what();
+            }
+        }, &m_traceExport);
 }
 
 // Updates the world.
 void Game::Update(DX::StepTimer const& timer)
 {
-    PIXBeginEvent(PIX_COLOR_DEFAULT, L"Update");
+    DX_PROFILE_ZONE("Update");
+
+    m_elapsedTime = float(timer.GetElapsedSeconds());
+    m_totalTime = float(timer.GetTotalSeconds());
+
+    // Input, camera, light and sprite updates run as a task graph on the job system
+    m_updateGraph.Execute(*m_jobs);
+
+    // Every task has finished drawing, so gather what they drew
+    m_renderStates.GetWrite().debugDraw = m_debugDraw.Merge();
+    m_renderStates.GetWrite().frameCount = timer.GetFrameCount();
+    m_renderStates.GetWrite().inputTicks = m_frameInputTicks;
+}
+
+// Build the graph of tasks that make up an Update. Tasks write their results into the render state being built.
+void Game::CreateUpdateGraph()
+{
+    auto input = m_updateGraph.AddNode("Input", [this]() { UpdateInput(); });
+    auto camera = m_updateGraph.AddNode("Camera", [this]() { UpdateCamera(); });
+    auto light = m_updateGraph.AddNode("Light", [this]() { UpdateLight(); });
+    m_updateGraph.AddNode("Sprites", [this]() { UpdateSprites(); });
+    auto debug = m_updateGraph.AddNode("Debug", [this]() { UpdateDebugDraw(); });
+    auto transforms = m_updateGraph.AddNode("Transforms", [this]() { UpdateTransforms(); });
+    auto instances = m_updateGraph.AddNode("Instances", [this]() { UpdateInstances(); });
+
+    m_updateGraph.AddDependency(input, camera);
+    m_updateGraph.AddDependency(camera, debug);
+    m_updateGraph.AddDependency(light, debug);
+    m_updateGraph.AddDependency(camera, instances);
+    m_updateGraph.AddDependency(transforms, instances);
+    m_updateGraph.AddDependency(transforms, debug);
+}
 
-    float elapsedTime = float(timer.GetElapsedSeconds());
+// Read the mouse and keyboard for this frame, and handle anything that has to happen on the main thread.
+void Game::SampleInput()
+{
+    m_mouseState = m_mouse->GetState();
+    m_keyboardState = m_keyboard->GetState();
 
-    float time = float(m_timer.GetTotalSeconds());
-    // TODO: Add your game logic here.
+    m_mouse->SetMode(m_mouseState.leftButton
+        ? Mouse::MODE_RELATIVE : Mouse::MODE_ABSOLUTE);
+
+    // handle user input
+    if (m_keyboardState.Escape)
+    {
+        ExitGame();
+    }
+}
+
+// Move the camera in response to the sampled input.
+void Game::UpdateInput()
+{
+    DX_PROFILE_ZONE("UpdateInput");
 
+    float elapsedTime = m_elapsedTime;
 
     // handle mouse input
-    auto mouse = m_mouse->GetState();
+    auto const& mouse = m_mouseState;
 
     if (mouse.positionMode == Mouse::MODE_RELATIVE)
     {
@@ -94,17 +472,7 @@ void Game::Update(DX::StepTimer const& timer)
         m_yaw -= delta.x;
     }
 
-    m_mouse->SetMode(mouse.leftButton
-        ? Mouse::MODE_RELATIVE : Mouse::MODE_ABSOLUTE);
-
-
-
-    auto kb = m_keyboard->GetState();
-    // handle user input
-    if (kb.Escape)
-    {
-        ExitGame();
-    }
+    auto const& kb = m_keyboardState;
     if (kb.Home)
     {
         // reset camera position and rotation
@@ -138,13 +506,14 @@ void Game::Update(DX::StepTimer const& timer)
     move = Vector3::Transform(move, q);
     move *= m_movementGain * elapsedTime;
     m_cameraPos += move;
+}
 
+// update the camera positon
+void Game::UpdateCamera()
+{
+    DX_PROFILE_ZONE("UpdateCamera");
 
-
-
-    // update the camera positon
-
-        // limit pitch to straight up or straight down
+    // limit pitch to straight up or straight down
     constexpr float limit = XM_PIDIV2 - 0.01f;
     m_pitch = std::max(-limit, m_pitch);
     m_pitch = std::min(+limit, m_pitch);
@@ -167,240 +536,669 @@ void Game::Update(DX::StepTimer const& timer)
     XMVECTOR lookAt = m_cameraPos + Vector3(x, y, z);
     m_view = XMMatrixLookAtRH(m_cameraPos, lookAt, Vector3::Up);
 
-    /*
-    char buffer[500];
-    sprintf_s(buffer, "\nm_cameraPos = (%f, %f, %f)\nm_cameraLookAt = (%f, %f, %f)", m_cameraPos.x, m_cameraPos.y, m_cameraPos.z, x, y, z);
-    OutputDebugStringA(buffer);*/
+    auto& state = m_renderStates.GetWrite();
+    state.view = m_view;
+    state.proj = m_proj;
+}
 
+//Rotate the light based on elapsed time
+void Game::UpdateLight()
+{
+    DX_PROFILE_ZONE("UpdateLight");
 
-    //Rotate the light based on elapsed time
-    auto quat = Quaternion::CreateFromAxisAngle(Vector3::UnitY, time);
+    auto quat = Quaternion::CreateFromAxisAngle(Vector3::UnitY, m_totalTime);
 
     auto light = XMVector3Rotate(g_XMOne, quat);
 
-    m_effect->SetLightDirection(0, light);
+    m_renderStates.GetWrite().lightDirection = light;
+}
+
+// Build the list of sprites to draw
+void Game::UpdateSprites()
+{
+    DX_PROFILE_ZONE("UpdateSprites");
+
+    auto& sprites = m_renderStates.GetWrite().sprites;
+    sprites.clear();
+
+    // Background texture, stretched over the whole screen
+    sprites.push_back({ c_sunsetTexture, Vector2::Zero, true });
+    sprites.push_back({ c_catTexture, Vector2(50.f, 50.f), false });
+}
+
+// Outline the light and the lit objects. Any task may draw like this; each gets a buffer of its own.
+void Game::UpdateDebugDraw()
+{
+    DX_PROFILE_ZONE("UpdateDebugDraw");
+
+    if (!m_showDebugDraw.load(std::memory_order_relaxed))
+        return;
+
+    auto const& state = m_renderStates.GetWrite();
+    auto debug = m_debugDraw.GetWriter();
+
+    Vector3 const light = state.lightDirection;
+    debug.Line(Vector3::Zero, light, Colors::Yellow);
+    debug.Label(light, "Light", Colors::Yellow);
+
+    // The sphere and the triangle drawn by RenderLit
+    debug.Sphere(Vector3::Transform(Vector3::Zero, state.world), 0.5f, Colors::LimeGreen);
+    debug.Box(Vector3::Transform(Vector3(-1.f, -1.f, 0.f), state.world),
+        Vector3::Transform(Vector3(1.f, 1.f, 0.f), state.world), Colors::Orange);
+}
+
+// Keep as many ring entities as the GUI asks for, turn the ring, and update every world matrix that has changed.
+void Game::UpdateTransforms()
+{
+    DX_PROFILE_ZONE("UpdateTransforms");
+
+    const uint32_t ringCount = m_ringInstanceCount.load(std::memory_order_relaxed);
+    if (ringCount != m_ringEntities.size())
+    {
+        while (m_ringEntities.size() > ringCount)
+        {
+            m_transforms.Destroy(m_ringEntities.back());
+            m_ringEntities.pop_back();
+        }
+        while (m_ringEntities.size() < ringCount)
+        {
+            m_ringEntities.push_back(m_transforms.Create(m_ringPivot));
+        }
+
+        // Rings of 64, stacked upwards, with smaller meshes the more there are
+        const float scale = std::min(0.25f, 8.f / std::sqrt(float(ringCount) + 1.f));
+        for (uint32_t i = 0; i < ringCount; ++i)
+        {
+            const float angle = XM_2PI * float(i % 64) / 64.f;
+            m_transforms.SetPosition(m_ringEntities[i], Vector3(3.f * std::cos(angle), float(i / 64) * scale * 2.f, 3.f * std::sin(angle)));
+            m_transforms.SetScale(m_ringEntities[i], scale);
+        }
+    }
+
+    m_transforms.SetRotation(m_ringPivot, Quaternion::CreateFromAxisAngle(Vector3::UnitY, -m_totalTime * 0.25f));
+
+    m_transforms.Update([this](size_t count, auto const& body)
+        {
+            m_jobs->ParallelForRange(count, 4096, body);
+        });
+
+    m_renderStates.GetWrite().world = Matrix(&m_transforms.GetWorld(m_litEntity).m[0][0]);
+}
+
+// Bound the lit sphere and the ring, and sort those the camera can see into instanced draws.
+void Game::UpdateInstances()
+{
+    DX_PROFILE_ZONE("UpdateInstances");
+
+    auto& state = m_renderStates.GetWrite();
+    constexpr uint32_t materialCount = static_cast<uint32_t>(std::size(c_instanceMaterialColors));
+    auto const ringMesh = [](size_t i) { return i % 2 ? CubeMesh : SphereMesh; };
+
+    // Bound everything first, so that only visible instances get a transform. Instance 0 is the lit sphere, and
+    // instance i + 1 is ring entity i. The primitives are a unit across, and scaled uniformly.
+    auto const bound = [this](DX::Entity entity, float radius)
+        {
+            auto const& world = m_transforms.GetWorld(entity).m;
+            const float scale = Vector3(world[0][0], world[0][1], world[0][2]).Length();
+            m_instanceBounds.push_back(world[3][0], world[3][1], world[3][2], radius * scale);
+        };
+
+    m_instanceBounds.clear();
+    m_instanceBounds.reserve(m_ringEntities.size() + 1);
+    bound(m_litEntity, 0.5f);
+    for (size_t i = 0; i < m_ringEntities.size(); ++i)
+    {
+        bound(m_ringEntities[i], ringMesh(i) == CubeMesh ? 0.866f : 0.5f);
+    }
+
+    const auto frustum = DX::Frustum::FromMatrix(state.view * state.proj);
+    DX::FrustumCuller::Cull(frustum, m_instanceBounds, m_visibleInstances);
+    state.culledInstances = m_instanceBounds.size() - m_visibleInstances.size();
+
+    auto& instances = state.instances;
+    instances.Clear();
+    instances.Reserve(m_visibleInstances.size());
+    for (auto const index : m_visibleInstances)
+    {
+        if (index == 0)
+        {
+            instances.Add(SphereMesh, 0, m_transforms.GetWorld(m_litEntity));
+            continue;
+        }
+
+        const uint32_t i = index - 1;
+        instances.Add(ringMesh(i), 1 + i % (materialCount - 1), m_transforms.GetWorld(m_ringEntities[i]));
+    }
+
+    instances.Sort();
+
+    PickInstance(state);
+}
+
+// Find the instance under the mouse, and the one nearest the camera, through a tree over the instances' bounds.
+void Game::PickInstance(RenderState const& state)
+{
+    // The ring moves every frame, so the tree is refit, and rebuilt only when that has made it much worse
+    m_instanceBoxes.resize(m_instanceBounds.size());
+    for (size_t i = 0; i < m_instanceBounds.size(); ++i)
+    {
+        m_instanceBoxes[i] = DX::Aabb::FromSphere({ m_instanceBounds.x[i], m_instanceBounds.y[i], m_instanceBounds.z[i] },
+            m_instanceBounds.radius[i]);
+    }
 
+    if (m_instanceTree.GetObjectCount() != m_instanceBoxes.size())
+    {
+        m_instanceTree.Build(m_instanceBoxes);
+        m_instanceTreeBuilds++;
+    }
+    else
+    {
+        m_instanceTree.Refit(m_instanceBoxes);
+        if (m_instanceTree.GetCost() > m_instanceTree.GetBuiltCost() * 1.5f)
+        {
+            m_instanceTree.Build(m_instanceBoxes);
+            m_instanceTreeBuilds++;
+        }
+    }
 
+    // The results are only shown as debug primitives
+    if (!m_showDebugDraw.load(std::memory_order_relaxed))
+        return;
 
+    auto const sphereDistance = [this](uint32_t object, Vector3 const& point)
+        {
+            const Vector3 center(m_instanceBounds.x[object], m_instanceBounds.y[object], m_instanceBounds.z[object]);
+            return std::max(Vector3::Distance(point, center) - m_instanceBounds.radius[object], 0.f);
+        };
 
-    elapsedTime;
+    auto debug = m_debugDraw.GetWriter();
+    auto const highlight = [&](uint32_t object, char const* label, DX::DebugColor color)
+        {
+            const Vector3 center(m_instanceBounds.x[object], m_instanceBounds.y[object], m_instanceBounds.z[object]);
+            debug.Sphere(center, m_instanceBounds.radius[object] * 1.2f, color);
+            debug.Label(center, label, color);
+        };
+
+    // The mouse picks only while it is not steering the camera
+    auto const size = m_deviceResources->GetOutputSize();
+    if (m_mouseState.positionMode == Mouse::MODE_ABSOLUTE && size.right > size.left && size.bottom > size.top)
+    {
+        const float x = 2.f * float(m_mouseState.x) / float(size.right - size.left) - 1.f;
+        const float y = 1.f - 2.f * float(m_mouseState.y) / float(size.bottom - size.top);
+
+        const Matrix inverseViewProj = (state.view * state.proj).Invert();
+        const Vector3 nearPoint = Vector3::Transform(Vector3(x, y, 0.f), inverseViewProj);
+        const Vector3 farPoint = Vector3::Transform(Vector3(x, y, 1.f), inverseViewProj);
+        Vector3 direction = farPoint - nearPoint;
+        direction.Normalize();
+
+        // Boxes narrow the search; the spheres inside them decide the hit
+        auto const hit = m_instanceTree.Raycast(nearPoint, direction, std::numeric_limits<float>::infinity(),
+            [&](uint32_t object, float)
+            {
+                const Vector3 center(m_instanceBounds.x[object], m_instanceBounds.y[object], m_instanceBounds.z[object]);
+                const float radius = m_instanceBounds.radius[object];
+                const Vector3 offset = nearPoint - center;
+                const float b = offset.Dot(direction);
+                const float discriminant = b * b - (offset.Dot(offset) - radius * radius);
+                if (discriminant < 0.f)
+                    return std::numeric_limits<float>::infinity();
+
+                const float root = std::sqrt(discriminant);
+                return -b - root >= 0.f ? -b - root : -b + root >= 0.f ? 0.f : std::numeric_limits<float>::infinity();
+            });
+        if (hit)
+        {
+            highlight(hit->object, "Picked", Colors::Yellow);
+        }
+    }
 
-    PIXEndEvent();
+    auto const nearest = m_instanceTree.FindNearest(m_cameraPos, std::numeric_limits<float>::infinity(),
+        [&](uint32_t object) { return sphereDistance(object, m_cameraPos); });
+    if (nearest)
+    {
+        highlight(nearest->object, "Nearest", Colors::Cyan);
+    }
 }
 
 #pragma endregion
 
 #pragma region Frame Render
-// Draws the scene.
-void Game::Render()
+// Draws the scene from a snapshot of the simulation, which may be running the next frame concurrently.
+void Game::Render(RenderState const& state)
 {
+    DX_PROFILE_ZONE("Render");
+
     // Don't try to render anything before the first Update.
-    if (m_timer.GetFrameCount() == 0)
+    if (state.frameCount == 0)
     {
         return;
     }
 
+    // Reclaim upload memory from frames the GPU has finished with
+    m_uploadAllocator->Retire(m_deviceResources->GetFrameTimeline().GetCompletedValue());
+    m_renderTargetPool->BeginFrame();
+    m_debugGeometry->BeginFrame();
+    m_gridGeometry = m_debugGeometry->Get(m_grid);
+
     // Prepare the command list to render a new frame.
     m_deviceResources->Prepare();
     auto commandList = m_deviceResources->GetCommandList();
 
-    m_renderTexture->BeginScene(commandList);
+    // Upload this frame's debug primitives, and add their labels to the GUI
+    m_debugDrawRenderer->Prepare(state.debugDraw.get(), *m_uploadAllocator);
+    DrawDebugLabels(state);
 
-    Clear();
+    // Upload this frame's instance transforms, in the order RenderLit draws them
+    m_instanceBuffer.Upload(state.instances, *m_uploadAllocator);
 
-    PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Render");
+    // Build the GUI draw data before recording it
+    ImGui::Render();
 
-    // TODO: Add your rendering code here.
+    // Work out which passes run and the transitions between them
+    BuildFrameGraph(state);
+    m_frameGraph.Compile();
 
-    // Set descriptor heaps in the command list
-    ID3D12DescriptorHeap* heaps[] = { m_srvPile->Heap()
-        //};
-        , m_states->Heap() };  //Use specific sampler state
-    commandList->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
+    // Record each pass into its own command list on its own thread, starting with its batch of barriers.
+    // They are submitted in this order.
+    using Pass = DX::DeviceResources::ContextPool::Pass;
+    auto const compiled = m_frameGraph.GetCompiledPasses();
+    m_graphPasses.clear();
+    for (size_t i = 0; i < compiled.size(); ++i)
+    {
+        m_graphPasses.push_back(Pass{ compiled[i].name, [this, i, compiled](auto& list)
+            {
+                DX::RecordBarriers(list, compiled[i].GetBarriers(m_frameGraph), m_graphResources);
+                m_passRecorders[compiled[i].pass](list.Get());
+
+                if (i + 1 == compiled.size())
+                {
+                    DX::RecordBarriers(list, m_frameGraph.GetFinalBarriers(), m_graphResources);
+                }
+            } });
+    }
+    m_deviceResources->GetCommandContextPool()->Record(m_graphPasses);
 
+    m_renderTexture->UpdateState(DX::ToD3D12(m_frameGraph.GetResource(m_offscreenResource).endState));
 
+    // Update and Render additional Platform Windows
+    ImGuiIO& io = ImGui::GetIO();
+    if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+    {
+        ImGui::UpdatePlatformWindows();
+        ImGui::RenderPlatformWindowsDefault(nullptr, (void*)commandList);
+    }
 
+    // Upload memory used this frame stays reserved until the GPU reaches this frame's fence value
+    m_uploadAllocator->EndFrame(m_deviceResources->GetCurrentFrameFenceValue());
 
+    // Show the new frame.
+    PIXBeginEvent(m_deviceResources->GetCommandQueue(), PIX_COLOR_DEFAULT, L"Present");
+    const uint64_t presentTicks = DX::GetSystemClock().GetTicks();
+    {
+        DX_PROFILE_ZONE("Present");
+        m_deviceResources->Present();
+    }
+    // Pipelined, the state presented was simulated from the previous Tick's input
+    m_framePacer.Complete(state.inputTicks ? state.inputTicks : m_frameInputTicks, presentTicks);
+    // Let manager know a frame's worth of video memory has been sent to the GPU
+    // This checks to release old frame data.
+    m_graphicsMemory->Commit(m_deviceResources->GetCommandQueue());
+    PIXEndEvent(m_deviceResources->GetCommandQueue());
+}
 
-    // Render sprites
+// Declare this frame's passes and the resources each reads and writes. Passes are recorded in the order declared.
+void Game::BuildFrameGraph(RenderState const& state)
+{
+    DX_PROFILE_ZONE("BuildFrameGraph");
 
-        // Begin the batch of sprite drawing operations
-    m_spriteBatch->Begin(commandList);
+    using DX::ResourceState;
 
-    {
-        Microsoft::WRL::ComPtr<ID3D12Resource> texture;
-        auto texHand = m_texHands->at(L"textures/sunset.jpg");
-        m_textureResources->GetResource(texHand.slot, texture.ReleaseAndGetAddressOf());
+    m_frameGraph.Reset();
+    m_passRecorders.clear();
 
-        // Draw background texture
-        m_spriteBatch->Draw(
-            m_textureResources->GetGpuDescriptorHandle(texHand.desc),
-            GetTextureSize(texture.Get()),
-            m_fullscreenRect
-        );
+    // The offscreen target is tracked from its first frame, in whatever state RenderTexture created or pooled it in
+    auto& stateTracker = m_deviceResources->GetStateTracker();
+    if (!stateTracker.IsRegistered(m_renderTexture->GetResource()))
+    {
+        stateTracker.Register(m_renderTexture->GetResource(), 1, DX::FromD3D12(m_renderTexture->GetCurrentState()));
     }
 
-    {
-        Microsoft::WRL::ComPtr<ID3D12Resource> texture;
-        auto texHand = m_texHands->at(L"textures/cat.dds");
-        m_textureResources->GetResource(texHand.slot, texture.ReleaseAndGetAddressOf());
+    // Prepare has already made the back buffer a render target, and Present takes it from there
+    m_offscreenResource = m_frameGraph.Import("Offscreen", stateTracker.GetState(m_renderTexture->GetResource()));
+    auto const depth = m_frameGraph.Import("Depth", ResourceState::DepthWrite, ResourceState::DepthWrite);
+    auto const backBuffer = m_frameGraph.Import("BackBuffer", ResourceState::RenderTarget, ResourceState::RenderTarget, true);
 
-        // Submit the work of drawing a texture to the command list
-        m_spriteBatch->Draw(
-            m_srvPile->GetGpuHandle(texHand.desc),
-            GetTextureSize(texture.Get()),
-            Vector2(50.f, 50.f), nullptr, Colors::White, 0.f  //Screen position, source rect, tint, rotation, origin
-        );
-    }
+    m_graphResources.clear();
+    m_graphResources.push_back(m_renderTexture->GetResource());
+    m_graphResources.push_back(m_deviceResources->GetDepthStencil());
+    m_graphResources.push_back(m_deviceResources->GetRenderTarget());
 
+    auto const addPass = [this](DX::FrameGraph::PassBuilder const& pass, std::function<void(ID3D12GraphicsCommandList*)> record)
+        {
+            m_passRecorders.resize(pass.GetId() + 1);
+            m_passRecorders[pass.GetId()] = std::move(record);
+        };
+
+    addPass(m_frameGraph.AddPass("Clear")
+        .Write(m_offscreenResource, ResourceState::RenderTarget, true)
+        .Write(depth, ResourceState::DepthWrite, true),
+        [this](auto list) { Clear(list); });
+
+    addPass(m_frameGraph.AddPass("Sprites")
+        .Write(m_offscreenResource, ResourceState::RenderTarget),
+        [this, &state](auto list) { RenderSprites(list, state); });
+
+    addPass(m_frameGraph.AddPass("Wireframe")
+        .Write(m_offscreenResource, ResourceState::RenderTarget)
+        .Write(depth, ResourceState::DepthWrite),
+        [this, &state](auto list) { RenderWireframe(list, state); });
+
+    addPass(m_frameGraph.AddPass("Lit")
+        .Write(m_offscreenResource, ResourceState::RenderTarget)
+        .Write(depth, ResourceState::DepthWrite),
+        [this, &state](auto list) { RenderLit(list, state); });
+
+    addPass(m_frameGraph.AddPass("Composite")
+        .Read(m_offscreenResource, ResourceState::PixelShaderResource)
+        .Write(backBuffer, ResourceState::RenderTarget),
+        [this](auto list) { RenderComposite(list); });
+
+    addPass(m_frameGraph.AddPass("GUI")
+        .Write(backBuffer, ResourceState::RenderTarget),
+        [this](auto list) { RenderGui(list); });
+}
 
+// Helper method to clear the back buffers.
+void Game::Clear(ID3D12GraphicsCommandList* commandList)
+{
+    PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Clear");
 
-    // End the batch of sprite drawing operations
-    m_spriteBatch->End();
+    // Clear the views.
+    {
+        // render to the render target and depth/stencil buffer
+        SetOffscreenTarget(commandList);
 
+        // Clear the offscreen RT
+        m_renderTexture->Clear(commandList);
+        commandList->ClearDepthStencilView(m_deviceResources->GetDepthStencilView(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+    }
 
-    // Render primitives
-    m_effect->SetView(m_view);
-    m_effect->SetProjection(m_proj);
+    PIXEndEvent(commandList);
+}
 
-    m_wireframeEffect->SetView(m_view);
-    m_wireframeEffect->SetProjection(m_proj);
+// Bind the offscreen render target, depth buffer, viewport and descriptor heaps. Every pass list starts with no state set.
+void Game::SetOffscreenTarget(ID3D12GraphicsCommandList* commandList)
+{
+    auto const rtvDescriptor = m_renderDescriptors->GetCpuHandle(RTDescriptors::OffscreenRT);
+    auto const dsvDescriptor = m_deviceResources->GetDepthStencilView();
+    commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, &dsvDescriptor);
 
+    // Set the viewport and scissor rect.
+    auto const viewport = m_deviceResources->GetScreenViewport();
+    auto const scissorRect = m_deviceResources->GetScissorRect();
+    commandList->RSSetViewports(1, &viewport);
+    commandList->RSSetScissorRects(1, &scissorRect);
 
-    // Apply wireframe effect
-    m_wireframeEffect->SetWorld(m_world);
-    
+    // Set descriptor heaps in the command list
+    ID3D12DescriptorHeap* heaps[] = { m_srvHeap->Heap(), m_states->Heap() };  //Use specific sampler state
+    commandList->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
+}
 
-    m_wireframeEffect->Apply(commandList);
+// As above, but for the swapchain's current back buffer.
+void Game::SetBackBufferTarget(ID3D12GraphicsCommandList* commandList)
+{
+    auto const rtvDescriptor = m_deviceResources->GetRenderTargetView();
+    commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, nullptr);
+
+    auto const viewport = m_deviceResources->GetScreenViewport();
+    auto const scissorRect = m_deviceResources->GetScissorRect();
+    commandList->RSSetViewports(1, &viewport);
+    commandList->RSSetScissorRects(1, &scissorRect);
 
-    m_wireframeBatch->Begin(commandList);
+    ID3D12DescriptorHeap* heaps[] = { m_srvHeap->Heap(), m_states->Heap() };
+    commandList->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
+}
 
-    Vector3 xaxis(2.f, 0.f, 0.f);
-    Vector3 yaxis(0.f, 0.f, 2.f);
-    Vector3 origin = Vector3::Zero;
+void Game::RenderSprites(ID3D12GraphicsCommandList* commandList, RenderState const& state)
+{
+    DX_PROFILE_ZONE("RenderSprites");
 
-    constexpr size_t divisions = 20;
+    PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Sprites");
+    SetOffscreenTarget(commandList);
 
-    for (size_t i = 0; i <= divisions; ++i)
-    {
-        float fPercent = float(i) / float(divisions);
-        fPercent = (fPercent * 2.0f) - 1.0f;
+    // Begin the batch of sprite drawing operations
+    m_spriteBatch->Begin(commandList);
 
-        Vector3 scale = xaxis * fPercent + origin;
+    for (auto const& sprite : state.sprites)
+    {
+        auto const& texHand = m_texHands->at(sprite.texture);
 
-        WireframeVertexType v1(scale - yaxis, Colors::White);
-        WireframeVertexType v2(scale + yaxis, Colors::White);
-        m_wireframeBatch->DrawLine(v1, v2);
+        if (sprite.fullscreen)
+        {
+            m_spriteBatch->Draw(
+                GetSrvGpuHandle(texHand.desc),
+                GetTextureSize(texHand.resource.Get()),
+                m_fullscreenRect
+            );
+        }
+        else
+        {
+            // Submit the work of drawing a texture to the command list
+            m_spriteBatch->Draw(
+                GetSrvGpuHandle(texHand.desc),
+                GetTextureSize(texHand.resource.Get()),
+                sprite.position, nullptr, Colors::White, 0.f  //Screen position, source rect, tint, rotation, origin
+            );
+        }
     }
 
-    for (size_t i = 0; i <= divisions; i++)
-    {
-        float fPercent = float(i) / float(divisions);
-        fPercent = (fPercent * 2.0f) - 1.0f;
+    // End the batch of sprite drawing operations
+    m_spriteBatch->End();
 
-        Vector3 scale = yaxis * fPercent + origin;
+    PIXEndEvent(commandList);
+}
 
-        WireframeVertexType v1(scale - xaxis, Colors::White);
-        WireframeVertexType v2(scale + xaxis, Colors::White);
-        m_wireframeBatch->DrawLine(v1, v2);
-    }
+void Game::RenderWireframe(ID3D12GraphicsCommandList* commandList, RenderState const& state)
+{
+    DX_PROFILE_ZONE("RenderWireframe");
 
-    m_wireframeBatch->End();
+    PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Wireframe");
+    SetOffscreenTarget(commandList);
 
-    // apply the basic effect
-    // Set matrices
-    m_effect->SetWorld(m_world);
-    
+    m_wireframeEffect->SetView(state.view);
+    m_wireframeEffect->SetProjection(state.proj);
 
-    m_effect->Apply(commandList);
+    // Apply wireframe effect
+    m_wireframeEffect->SetWorld(state.world);
 
-    m_shape->Draw(commandList);
+    m_wireframeEffect->Apply(commandList);
 
-    // Start batch of primitive drawing operations
-    m_batch->Begin(commandList);
+    // The grid is static, so drawing it streams no vertices
+    if (m_gridGeometry)
+    {
+        m_gridGeometry->Draw(commandList);
+    }
 
-    VertexType v1(Vector3(0.0f, 1.f, 0.f), -Vector3::UnitZ, Vector2(0.5f, 0.f));
-    VertexType v3(Vector3(-1.f, -1.f, 0.f), -Vector3::UnitZ, Vector2(0.f, 1.f));
-    VertexType v2(Vector3(1.f, -1.f, 0.f), -Vector3::UnitZ, Vector2(1.f, 1.f));
+    m_debugDrawRenderer->Draw(commandList, state.view, state.proj);
 
-    m_batch->DrawTriangle(v1, v2, v3);
+    PIXEndEvent(commandList);
+}
 
-    // Cease this batch of primitive drawing operations
-    m_batch->End();
+void Game::RenderLit(ID3D12GraphicsCommandList* commandList, RenderState const& state)
+{
+    DX_PROFILE_ZONE("RenderLit");
 
-    m_renderTexture->EndScene(commandList);
+    PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Lit");
+    SetOffscreenTarget(commandList);
 
-    //Render GUI
-    ImGuiIO& io = ImGui::GetIO();
+    // Draw every instance of a mesh with the same material at once. Their transforms come from the instance
+    // buffer, so the effects' world matrix stays the identity.
+    for (auto const handle : m_instancedEffects)
+    {
+        if (m_effectCompiler->IsReady(handle))
+        {
+            auto const& effect = *m_effectCompiler->Resolve(handle);
+            effect->SetView(state.view);
+            effect->SetProjection(state.proj);
+            effect->SetLightDirection(0, state.lightDirection);
+        }
+    }
 
-    ImGui::Render();
-    ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), commandList);
+    m_effect->SetView(state.view);
+    m_effect->SetProjection(state.proj);
+    m_effect->SetWorld(state.world);
+    m_effect->SetLightDirection(0, state.lightDirection);
 
-    // Update and Render additional Platform Windows
-    if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+    // Queue the draws by pipeline and material, so each effect is applied once however many meshes use it
+    m_litQueue.Clear();
+    if (!m_instanceBuffer.IsEmpty())
     {
-        ImGui::UpdatePlatformWindows();
-        ImGui::RenderPlatformWindowsDefault(nullptr, (void*)commandList);
+        for (auto const& batch : state.instances.GetBatches())
+        {
+            m_litQueue.Submit(DX::DrawKey::Make(0, 0, InstancedPipeline, batch.material),
+                LitDraw{ batch.mesh, batch.firstInstance, batch.instanceCount });
+        }
     }
 
+    const float triangleDepth = -Vector3::Transform(state.world.Translation(), state.view).z;
+    m_litQueue.Submit(DX::DrawKey::Make(0, 0, TrianglePipeline, 0,
+        DX::DrawKey::QuantizeDepth(triangleDepth, c_nearPlane, c_farPlane)), LitDraw{});
+    m_litQueue.Sort();
+
+    // Effect::Apply sets the pipeline state, root signature and descriptors together, so the queue skipping a
+    // redundant material skips all of them
+    struct Backend
+    {
+        Game& game;
+        ID3D12GraphicsCommandList* commandList;
+        uint32_t pipeline;
+        bool skipping;
+        bool fallback;
 
+        void BindPipeline(uint32_t newPipeline)
+        {
+            pipeline = newPipeline;
+            if (pipeline == InstancedPipeline)
+            {
+                game.m_instanceBuffer.Bind(commandList);
+            }
+        }
+
+        void BindMaterial(uint32_t, uint32_t material)
+        {
+            if (pipeline != InstancedPipeline)
+            {
+                game.m_effect->Apply(commandList);
+                return;
+            }
+
+            // A material whose effect is still compiling borrows its fallback's, or is skipped if that isn't ready
+            auto const handle = game.m_instancedEffects[material];
+            auto const effect = game.m_effectCompiler->Resolve(handle);
+            skipping = (effect == nullptr);
+            if (effect)
+            {
+                (*effect)->Apply(commandList);
+            }
+            fallback = !skipping && !game.m_effectCompiler->IsReady(handle);
+        }
+
+        void Draw(LitDraw const& draw)
+        {
+            if (pipeline == InstancedPipeline)
+            {
+                if (skipping)
+                {
+                    game.m_skippedLitDraws++;
+                    return;
+                }
+
+                game.m_fallbackLitDraws += fallback ? 1 : 0;
+                game.m_meshes[draw.mesh]->DrawInstanced(commandList, draw.instanceCount, draw.firstInstance);
+                return;
+            }
+
+            // Start batch of primitive drawing operations
+            game.m_batch->Begin(commandList);
+
+            VertexType v1(Vector3(0.0f, 1.f, 0.f), -Vector3::UnitZ, Vector2(0.5f, 0.f));
+            VertexType v3(Vector3(-1.f, -1.f, 0.f), -Vector3::UnitZ, Vector2(0.f, 1.f));
+            VertexType v2(Vector3(1.f, -1.f, 0.f), -Vector3::UnitZ, Vector2(1.f, 1.f));
+
+            game.m_batch->DrawTriangle(v1, v2, v3);
+
+            // Cease this batch of primitive drawing operations
+            game.m_batch->End();
+        }
+    };
+
+    m_fallbackLitDraws = 0;
+    m_skippedLitDraws = 0;
+    Backend backend{ *this, commandList, UINT32_MAX, false, false };
+    m_litQueue.Execute(backend);
 
+    PIXEndEvent(commandList);
+}
 
-    // render scene to offscreen texture
-    auto rtvDescriptor = m_deviceResources->GetRenderTargetView();
-    commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, nullptr);
+// Copy the offscreen texture onto the back buffer.
+void Game::RenderComposite(ID3D12GraphicsCommandList* commandList)
+{
+    DX_PROFILE_ZONE("RenderComposite");
 
-    // Begin the batch of sprite drawing operations
-    m_spriteBatch->Begin(commandList);
+    PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Composite");
 
-    m_spriteBatch->Draw(
-        m_srvPile->GetGpuHandle(Descriptors::RenderTexture),
+    SetBackBufferTarget(commandList);
+
+    // Uses its own sprite batch, as m_spriteBatch is being recorded on another thread
+    m_compositeBatch->Begin(commandList);
+
+    m_compositeBatch->Draw(
+        GetSrvGpuHandle(m_renderTextureDescriptor),
         GetTextureSize(m_renderTexture->GetResource()),
         m_deviceResources->GetOutputSize()
     );
 
-    // Begin the batch of sprite drawing operations
-    m_spriteBatch->End();
+    m_compositeBatch->End();
 
     PIXEndEvent(commandList);
-
-    // Show the new frame.
-    PIXBeginEvent(m_deviceResources->GetCommandQueue(), PIX_COLOR_DEFAULT, L"Present");
-    m_deviceResources->Present();
-    // Let manager know a frame's worth of video memory has been sent to the GPU
-    // This checks to release old frame data.
-    m_graphicsMemory->Commit(m_deviceResources->GetCommandQueue());
-    PIXEndEvent(m_deviceResources->GetCommandQueue());
 }
 
-// Helper method to clear the back buffers.
-void Game::Clear()
+void Game::RenderGui(ID3D12GraphicsCommandList* commandList)
 {
-    auto commandList = m_deviceResources->GetCommandList();
-    PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Clear");
+    DX_PROFILE_ZONE("RenderGui");
 
-    // Clear the views.
-    {
-        // render to the render target and depth/stencil buffer
-        // clear the offscreen render target
-        auto const rtvDescriptor = m_renderDescriptors->GetCpuHandle(RTDescriptors::OffscreenRT);
-        //auto const rtvDescriptor = m_deviceResources->GetRenderTargetView();
-        auto const dsvDescriptor = m_deviceResources->GetDepthStencilView();
+    PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"GUI");
 
-        commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, &dsvDescriptor);
-        //commandList->ClearRenderTargetView(rtvDescriptor, Colors::CornflowerBlue, 0, nullptr);
-        // Clear the offscreen RT
-        m_renderTexture->Clear(commandList);
-        commandList->ClearDepthStencilView(dsvDescriptor, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-    }
-    // Set the viewport and scissor rect.
-    auto const viewport = m_deviceResources->GetScreenViewport();
-    auto const scissorRect = m_deviceResources->GetScissorRect();
-    commandList->RSSetViewports(1, &viewport);
-    commandList->RSSetScissorRects(1, &scissorRect);
+    SetBackBufferTarget(commandList);
+    ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), commandList);
 
     PIXEndEvent(commandList);
 }
+
+// Debug labels are text, so they are projected to the screen and drawn over everything by the GUI.
+void Game::DrawDebugLabels(RenderState const& state)
+{
+    if (!state.debugDraw || state.debugDraw->labels.empty())
+        return;
+
+    auto const viewProjection = state.view * state.proj;
+    auto const viewport = m_deviceResources->GetScreenViewport();
+    auto const mainViewport = ImGui::GetMainViewport();
+    auto drawList = ImGui::GetForegroundDrawList(mainViewport);
+
+    for (auto const& label : state.debugDraw->labels)
+    {
+        auto const clip = Vector4::Transform(Vector4(label.position.x, label.position.y, label.position.z, 1.f), viewProjection);
+        if (clip.w <= 0.f)
+            continue;
+
+        const float x = (clip.x / clip.w * 0.5f + 0.5f) * viewport.Width + viewport.TopLeftX;
+        const float y = (0.5f - clip.y / clip.w * 0.5f) * viewport.Height + viewport.TopLeftY;
+        auto const color = ImGui::ColorConvertFloat4ToU32(ImVec4(label.color.r, label.color.g, label.color.b, label.color.a));
+        drawList->AddText(ImVec2(mainViewport->Pos.x + x, mainViewport->Pos.y + y), color, label.text.c_str());
+    }
+}
 #pragma endregion
 
 #pragma region Message Handlers
@@ -423,6 +1221,8 @@ void Game::OnSuspending()
 void Game::OnResuming()
 {
     m_timer.ResetElapsedTime();
+    // The suspended time is not a frame
+    m_lastFrameStart = 0;
 
     // TODO: Game is being power-resumed (or returning from minimize).
 }
@@ -477,6 +1277,12 @@ void Game::CreateDeviceDependentResources()
     m_cameraPos = m_startPos;
 
 
+    // Record render passes on the job system's workers
+    m_deviceResources->GetCommandContextPool()->SetExecutor([this](size_t count, auto const& body)
+        {
+            m_jobs->ParallelFor(count, body);
+        });
+
     // Check Shader Model 6 support
     D3D12_FEATURE_DATA_SHADER_MODEL shaderModel = { D3D_SHADER_MODEL_6_0 };
     if (FAILED(device->CheckFeatureSupport(D3D12_FEATURE_SHADER_MODEL, &shaderModel, sizeof(shaderModel)))
@@ -492,7 +1298,7 @@ void Game::CreateDeviceDependentResources()
 
     // TODO: Initialize device dependent objects here (independent of window size).
     m_graphicsMemory = std::make_unique<GraphicsMemory>(device);
-
+    m_uploadAllocator = std::make_unique<DX::D3D12UploadAllocator>(device, c_uploadRingSize);
 
     ///<summary>wraps information concerning render target used by DX12 when creating Pipeline State Objects</summary>
     RenderTargetState rtState(
@@ -503,41 +1309,33 @@ void Game::CreateDeviceDependentResources()
     // Create a common states object which provides a descriptor heap with pre-defined sampler descriptors
     m_states = std::make_unique<CommonStates>(device);
 
-    m_srvPile = std::make_unique<DescriptorPile>(device, Descriptors::Count, Descriptors::Reserve);
+    // Create the shader visible heap used for every texture, and the allocator that hands out its slots
+    m_srvHeap = std::make_unique<DescriptorHeap>(device, SrvHeapCapacity);
+    m_srvAllocator = std::make_unique<DX::DescriptorAllocator>(SrvHeapCapacity, 0);
+    m_guiDescriptor = m_srvAllocator->Allocate();
+    m_renderTextureDescriptor = m_srvAllocator->Allocate();
     
     // Create render descriptor heap to store render target views
     m_renderDescriptors = std::make_unique<DescriptorHeap>(device, D3D12_DESCRIPTOR_HEAP_TYPE::D3D12_DESCRIPTOR_HEAP_TYPE_RTV, D3D12_DESCRIPTOR_HEAP_FLAGS::D3D12_DESCRIPTOR_HEAP_FLAG_NONE, RTDescriptors::RTCount);
 
 
 
-    //Initialize world matrix
-    m_world = Matrix::Identity;
-
     LoadTextures();
 
     // create render texture, used for the portal
     // Create a render texture of the same size and foramt as the swapchain
+    m_renderTargetPool = std::make_unique<DX::D3D12RenderTargetPool>(
+        DX::D3D12RenderTargetBackend{ device }, m_deviceResources->GetFrameTimeline());
+    m_renderTargetProvider = std::make_unique<DX::D3D12RenderTargetProvider>(*m_renderTargetPool);
     m_renderTexture = std::make_unique<DX::RenderTexture>(m_deviceResources->GetBackBufferFormat());
     // Set optimized clear colour
     m_renderTexture->SetClearColor(Colors::CornflowerBlue);
     m_renderTexture->SetDevice(
         device,
-        m_srvPile->GetCpuHandle(Descriptors::RenderTexture),
+        GetSrvCpuHandle(m_renderTextureDescriptor),
         m_renderDescriptors->GetCpuHandle(RTDescriptors::OffscreenRT)
     );
-
-    // Instanciate sprites
-    {
-        // set position of sprite
-        Microsoft::WRL::ComPtr<ID3D12Resource> cat;
-        auto texHand = m_texHands->find(L"textures/cat.dds")->second;
-        //TODO sanitize if the map does not contain this value
-
-        m_textureResources->GetResource(texHand.slot, cat.ReleaseAndGetAddressOf());
-        XMUINT2 catSize = GetTextureSize(cat.Get());
-        m_origin.x = float(catSize.x / 2);
-        m_origin.y = float(catSize.y / 2);
-    }
+    m_renderTexture->SetProvider(m_renderTargetProvider.get());
 
     // Initialize the primitive batch used for rendering lit objects 
     {
@@ -556,24 +1354,47 @@ void Game::CreateDeviceDependentResources()
         // create the basiceffect to use the pipeline description and colored vertices
         // utilize built in normal effect, per pixel lighting and use of textures
         m_effect = std::make_unique<NormalMapEffect>(device, EffectFlags::PerPixelLighting | EffectFlags::Texture, ppd);
-        // Set the texture descriptors for this effect
-        m_effect->SetTexture(m_textureResources->GetGpuDescriptorHandle(m_texHands->at(L"textures/rocks_diff.dds").desc), m_states->LinearClamp());
-        m_effect->SetNormalTexture(m_textureResources->GetGpuDescriptorHandle(m_texHands->at(L"textures/rocks_norm.dds").desc));
+
+        // The same effect for the instanced meshes, which read a transform per instance from a second vertex buffer
+        EffectPipelineStateDescription instancedPpd(
+            &DX::c_instancedInputLayout,
+            CommonStates::Opaque,
+            CommonStates::DepthDefault,
+            CommonStates::CullCounterClockwise,
+            rtState
+        );
+
+        // Their pipelines compile on workers. Until a material's is ready its instances are drawn with material
+        // 0's, and until that is ready they are not drawn.
+        m_effectCompiler = std::make_unique<EffectCompiler>(InstancedEffectBackend{ device, instancedPpd }, *m_jobs);
+        m_instancedEffects.clear();
+        for (auto const& color : c_instanceMaterialColors)
+        {
+            m_instancedEffects.push_back(m_effectCompiler->Request(color,
+                m_instancedEffects.empty() ? EffectCompiler::NoFallback : m_instancedEffects.front()));
+        }
+
+        // Set the texture descriptors for these effects. These are rebound as the textures finish loading.
+        BindEffectTextures();
 
         // enable the first light in the scene
         m_effect->SetLightEnabled(0, true);
         m_effect->SetLightDiffuseColor(0, Colors::White);
         m_effect->SetLightDirection(0, -Vector3::UnitZ);
     
-        // instanciate geometric primitive
-        m_shape = GeometricPrimitive::CreateSphere();
+        // instanciate geometric primitives
+        m_meshes[SphereMesh] = GeometricPrimitive::CreateSphere();
+        m_meshes[CubeMesh] = GeometricPrimitive::CreateCube();
 
         ResourceUploadBatch resourceUpload(device);
 
         resourceUpload.Begin();
 
         // Load geometric primitive data into the dedicated video memory for faster performance
-        m_shape->LoadStaticBuffers(device, resourceUpload);
+        for (auto const& mesh : m_meshes)
+        {
+            mesh->LoadStaticBuffers(device, resourceUpload);
+        }
 
         //Create a future allowing the upload process to potentially happen on another thread, and wait for the upload to comlete before continuing
         auto uploadResourcesFinished = resourceUpload.End(
@@ -582,11 +1403,12 @@ void Game::CreateDeviceDependentResources()
         uploadResourcesFinished.wait();
     }
 
-    // Create the primitive batch used to render wireframe vertices, which are unlit, and use a different vertex type and effect so need their own batch
-    // TODO: make this code more applicable to switching effects by giving it more in common with the other primitive batch
+    // Create the cache of debug shapes drawn with the wireframe effect, which are unlit, and use a different vertex type
     {
-        // Set up wireframe batch
-        m_wireframeBatch = std::make_unique<PrimitiveBatch<WireframeVertexType>>(device);
+        // Shapes are uploaded on the copy queue, and only drawn once their upload has finished
+        m_debugGeometry = std::make_unique<DX::D3D12DebugGeometryCache>(
+            DX::D3D12DebugGeometryBackend(device, m_deviceResources->GetCopyQueue(), m_deviceResources->GetCopyTimeline()),
+            m_deviceResources->GetFrameTimeline());
 
         // create the pipeline description for the wireframe effect object
         EffectPipelineStateDescription wpd(
@@ -600,6 +1422,9 @@ void Game::CreateDeviceDependentResources()
 
         // create the wireframe effect from the above description
         m_wireframeEffect = std::make_unique<BasicEffect>(device, EffectFlags::VertexColor, wpd);
+
+        // Debug primitives have effects of their own, one per topology
+        m_debugDrawRenderer = std::make_unique<DX::D3D12DebugDrawRenderer>(device, rtState);
     }
 
     // Initialize the sprite batch
@@ -617,6 +1442,7 @@ void Game::CreateDeviceDependentResources()
             , nullptr, nullptr, nullptr, &sampler); // use specific sampler
         //,&CommonStates::NonPremultiplied);   // Prevent use of premultiplied alpha, for textures without that
         m_spriteBatch = std::make_unique<SpriteBatch>(device, resourceUpload, spd);
+        m_compositeBatch = std::make_unique<SpriteBatch>(device, resourceUpload, spd);
 
         //Create a future allowing the upload process to potentially happen on another thread, and wait for the upload to comlete before continuing
         auto uploadResourcesFinished = resourceUpload.End(
@@ -642,11 +1468,11 @@ void Game::CreateDeviceDependentResources()
         // TODO: Initialize DX12 rendering backends
         ImGui_ImplDX12_Init(
             device,
-            m_deviceResources->GetBackBufferCount(),
+            m_deviceResources->GetFramesInFlight(),
             m_deviceResources->GetBackBufferFormat(),
-            m_srvPile->Heap(),
-            m_srvPile->GetCpuHandle(Descriptors::Gui),
-            m_srvPile->GetGpuHandle(Descriptors::Gui)
+            m_srvHeap->Heap(),
+            GetSrvCpuHandle(m_guiDescriptor),
+            GetSrvGpuHandle(m_guiDescriptor)
         );
 
     }
@@ -659,9 +1485,12 @@ void Game::CreateWindowSizeDependentResources()
     // Get screen coordinates
     auto viewport = m_deviceResources->GetScreenViewport();
     m_spriteBatch->SetViewport(viewport);
+    m_compositeBatch->SetViewport(viewport);
 
     auto size = m_deviceResources->GetOutputSize();
-    // size the render texture to be the same size as the swapchain
+    // size the render texture to be the same size as the swapchain. If that replaces its resource, the new one is
+    // registered with the state tracker when the next frame graph is built.
+    m_deviceResources->GetStateTracker().Unregister(m_renderTexture->GetResource());
     m_renderTexture->SetWindow(size);
 
 
@@ -674,8 +1503,8 @@ void Game::CreateWindowSizeDependentResources()
     m_proj = Matrix::CreatePerspectiveFieldOfView(
         XM_PI / 4.f,
         float(size.right) / float(size.bottom),
-        0.1f,
-        100.f
+        c_nearPlane,
+        c_farPlane
     );
 
     m_effect->SetView(m_view);
@@ -687,57 +1516,182 @@ void Game::CreateWindowSizeDependentResources()
     m_fullscreenRect = m_deviceResources->GetOutputSize();
 }
 
+D3D12_CPU_DESCRIPTOR_HANDLE Game::GetSrvCpuHandle(DX::DescriptorAllocator::Handle handle) const
+{
+    return m_srvHeap->GetCpuHandle(m_srvAllocator->Resolve(handle));
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE Game::GetSrvGpuHandle(DX::DescriptorAllocator::Handle handle) const
+{
+    return m_srvHeap->GetGpuHandle(m_srvAllocator->Resolve(handle));
+}
+
+// Start loading every texture in m_textureLoadList. Each is drawn with the placeholder until UpdateTextures swaps it in.
 void Game::LoadTextures()
 {
     auto device = m_deviceResources->GetD3DDevice();
 
-    ResourceUploadBatch resourceUpload(device);
+    // Create the placeholder up front; it is a single texel, so waiting for it is cheap
+    {
+        ResourceUploadBatch resourceUpload(device);
 
-    resourceUpload.Begin();
+        resourceUpload.Begin();
 
-    m_texHands = std::make_unique<std::map<const wchar_t*, TexHand>>();
-    // Create the EffectTextureFactory, a helper object to provide sharing of texture resources from the existing reosurce heap
-    m_textureResources = std::make_unique<DirectX::EffectTextureFactory>(
-        device,
-        resourceUpload,
-        m_srvPile->Heap()
-    );
+        const uint32_t white = 0xFFFFFFFF;
+        D3D12_SUBRESOURCE_DATA initData = { &white, sizeof(white), sizeof(white) };
+        ThrowIfFailed(CreateTextureFromMemory(device, resourceUpload, 1u, 1u, DXGI_FORMAT_R8G8B8A8_UNORM, initData,
+            m_placeholderTexture.ReleaseAndGetAddressOf()));
+
+        auto uploadResourcesFinished = resourceUpload.End(
+            m_deviceResources->GetCommandQueue()
+        );
+        uploadResourcesFinished.wait();
+    }
+
+    m_placeholderDescriptor = m_srvAllocator->Allocate();
+    CreateShaderResourceView(device, m_placeholderTexture.Get(), GetSrvCpuHandle(m_placeholderDescriptor));
+
+    m_textureLoader = std::make_unique<TextureLoader>(
+        DX::D3D12TextureBackend(device, m_deviceResources->GetCopyQueue(), m_deviceResources->GetCopyTimeline()),
+        *m_jobs);
+
+    m_texHands = std::make_unique<DX::TextureRegistry<TexHand>>(m_textureLoadList.size());
 
-    size_t descriptor = Descriptors::Reserve;
     for (auto path : m_textureLoadList)
     {
-        // Create a texture from the path and tie it to a descriptor
-        size_t slot = m_textureResources->CreateTexture(path, descriptor);
-        TexHand th(descriptor, slot);
-        m_texHands->emplace(path, th);
-        descriptor++;
+        // Decoding starts on a worker straight away
+        m_texHands->Register(path, TexHand(m_placeholderDescriptor, m_placeholderTexture));
+        m_textureLoader->Load(path);
     }
+}
 
-    //Create a future allowing the upload process to potentially happen on another thread, and wait for the upload to comlete before continuing
-    auto uploadResourcesFinished = resourceUpload.End(
-        m_deviceResources->GetCommandQueue()
-    );
-    uploadResourcesFinished.wait();
+// Give each texture that has finished uploading its own descriptor. Runs on the main thread while no pass is recording.
+void Game::UpdateTextures()
+{
+    DX_PROFILE_ZONE("UpdateTextures");
+
+    if (!m_textureLoader)
+        return;
+
+    auto device = m_deviceResources->GetD3DDevice();
+
+    bool loaded = false;
+    for (auto const request : m_textureLoader->Update())
+    {
+        // Requests were made in m_textureLoadList order, so the handle indexes it
+        auto const path = m_textureLoadList[request];
+
+        if (!m_textureLoader->IsReady(request))
+        {
+            // Leave the placeholder in place of a texture that could not be loaded
+#ifdef _DEBUG
+            OutputDebugStringW(L"ERROR: Failed to load texture ");
+            OutputDebugStringW(path);
+            OutputDebugStringW(L"\n");
+#endif
+            continue;
+        }
+
+        // A fresh descriptor is used rather than overwriting the placeholder's, which frames in flight may still read
+        auto& image = m_textureLoader->GetImage(request);
+        auto descriptor = m_srvAllocator->Allocate();
+        CreateShaderResourceView(device, image.resource.Get(), GetSrvCpuHandle(descriptor), image.isCubeMap);
+
+        m_texHands->at(path) = TexHand(descriptor, image.resource);
+        loaded = true;
+    }
+
+    if (loaded)
+    {
+        BindEffectTextures();
+    }
+}
+
+// Point the lit effect, and the instanced effects that are ready, at the current descriptors for their textures.
+// Effects that become ready later are pointed at them by UpdateEffects.
+void Game::BindEffectTextures()
+{
+    BindEffectTextures(*m_effect);
+
+    for (auto const handle : m_instancedEffects)
+    {
+        if (m_effectCompiler->IsReady(handle))
+        {
+            BindEffectTextures(**m_effectCompiler->Resolve(handle));
+        }
+    }
+}
+
+void Game::BindEffectTextures(NormalMapEffect& effect)
+{
+    effect.SetTexture(GetSrvGpuHandle(m_texHands->at(c_rocksDiffuseTexture).desc), m_states->LinearClamp());
+    effect.SetNormalTexture(GetSrvGpuHandle(m_texHands->at(c_rocksNormalTexture).desc));
+}
+
+// Swap in the instanced effects whose pipelines have finished compiling. Runs on the main thread while no pass is
+// recording, so a frame's draws all see the same set.
+void Game::UpdateEffects()
+{
+    DX_PROFILE_ZONE("UpdateEffects");
+
+    if (!m_effectCompiler)
+        return;
+
+    for (auto const handle : m_effectCompiler->Update())
+    {
+        if (!m_effectCompiler->IsReady(handle))
+        {
+            // Its draws keep using the fallback
+#ifdef _DEBUG
+            OutputDebugStringA("ERROR: Failed to create an instanced effect\n");
+#endif
+            continue;
+        }
+
+        BindEffectTextures(**m_effectCompiler->Resolve(handle));
+    }
+}
+
+// Runs on a JobSystem worker. The device is free-threaded, and the effect is not shared until the compiler hands
+// it over in Update.
+auto Game::InstancedEffectBackend::Compile(Description const& diffuseColor) const -> Pipeline
+{
+    auto effect = std::make_unique<NormalMapEffect>(device,
+        EffectFlags::PerPixelLighting | EffectFlags::Texture | EffectFlags::Instancing, pipelineDescription);
+    effect->SetDiffuseColor(diffuseColor);
+    effect->SetLightEnabled(0, true);
+    effect->SetLightDiffuseColor(0, Colors::White);
+    return effect;
 }
 
 void Game::OnDeviceLost()
 {
     // TODO: Add Direct3D resource cleanup here.
+    m_uploadAllocator.reset();
     m_graphicsMemory.reset();
-    m_srvPile.reset();
+    m_srvAllocator.reset();
+    m_srvHeap.reset();
     m_spriteBatch.reset();
+    m_compositeBatch.reset();
     m_states.reset();
     m_effect.reset();
+    m_effectCompiler.reset();
+    m_instancedEffects.clear();
+    m_instanceBuffer = {};
     m_batch.reset();
     m_wireframeEffect.reset();
-    m_wireframeBatch.reset();
+    m_gridGeometry = nullptr;
+    m_debugGeometry.reset();
+    m_debugDrawRenderer.reset();
 
-    //Clean up textures
+    //Clean up textures, waiting for any that are still being decoded or copied
+    m_textureLoader.reset();
     m_textureLoadList.clear();
     m_texHands->clear();
-    m_textureResources->ReleaseCache();
-    m_textureResources.reset();
+    m_placeholderTexture.Reset();
     m_renderTexture->ReleaseDevice();
+    m_renderTargetProvider.reset();
+    m_renderTargetPool.reset();
     m_renderDescriptors.reset();
 
     //Clean up GUI
@@ -745,7 +1699,10 @@ void Game::OnDeviceLost()
     ImGui_ImplWin32_Shutdown();
     ImGui::DestroyContext();
 
-    m_shape.reset();
+    for (auto& mesh : m_meshes)
+    {
+        mesh.reset();
+    }
 }
 
 void Game::OnDeviceRestored()
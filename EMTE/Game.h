@@ -4,9 +4,28 @@
 
 #pragma once
 
+#include "AsyncPipelineCompiler.h"
+#include "AsyncTextureLoader.h"
+#include "BoundingVolumeHierarchy.h"
+#include "D3D12DebugDraw.h"
+#include "D3D12DebugGeometryBackend.h"
+#include "D3D12TextureBackend.h"
+#include "DescriptorAllocator.h"
+#include "D3D12FrameGraph.h"
+#include "D3D12Instancing.h"
+#include "D3D12UploadAllocator.h"
 #include "DeviceResources.h"
+#include "FramePacer.h"
+#include "FrameTimeHistogram.h"
+#include "FrustumCulling.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+#include "SnapshotBuffer.h"
 #include "StepTimer.h"
-#include "map"
+#include "TaskGraph.h"
+#include "TextureRegistry.h"
+#include "TraceCapture.h"
+#include "TransformSystem.h"
 
 
 // A basic game implementation that creates a D3D12 device and
@@ -48,62 +67,196 @@ public:
 
 private:
 
-    void Update(DX::StepTimer const& timer);
+    // Everything Render needs from Update. Handed over through a double buffer so the two can run concurrently; every
+    // Update rewrites all of it, as the buffer recycles the copy read two frames ago.
+    struct RenderState
+    {
+        struct Sprite
+        {
+            DX::TextureId                   texture;
+            DirectX::SimpleMath::Vector2    position;
+            bool                            fullscreen;
+        };
+
+        uint32_t                        frameCount = 0;
+        // When the input this state was simulated from was sampled, in system clock ticks
+        uint64_t                        inputTicks = 0;
+        DirectX::SimpleMath::Matrix     world;
+        DirectX::SimpleMath::Matrix     view;
+        DirectX::SimpleMath::Matrix     proj;
+        DirectX::SimpleMath::Vector3    lightDirection = -DirectX::SimpleMath::Vector3::UnitZ;
+        std::vector<Sprite>             sprites;
+        std::shared_ptr<const DX::DebugDrawList> debugDraw;
+        // Lit meshes, sorted so that each mesh and material is one instanced draw
+        DX::InstanceBatcher             instances;
+        size_t                          culledInstances = 0;
+    };
 
-    void Render();
+    void WaitForFrame();
+    bool Simulate();
+    void SampleInput();
+    void Update(DX::StepTimer const& timer);
 
-    void Clear();
+    // Tasks run by Update
+    void CreateUpdateGraph();
+    void UpdateInput();
+    void UpdateCamera();
+    void UpdateLight();
+    void UpdateSprites();
+    void UpdateDebugDraw();
+    void UpdateTransforms();
+    void UpdateInstances();
+    void PickInstance(RenderState const& state);
+
+    void ShowFrameStats();
+    void ShowProfiler();
+    void ExportTrace();
+
+    void Render(RenderState const& state);
+    void BuildFrameGraph(RenderState const& state);
+
+    void Clear(ID3D12GraphicsCommandList* commandList);
+
+    // Passes recorded concurrently by Render
+    void RenderSprites(ID3D12GraphicsCommandList* commandList, RenderState const& state);
+    void RenderWireframe(ID3D12GraphicsCommandList* commandList, RenderState const& state);
+    void RenderLit(ID3D12GraphicsCommandList* commandList, RenderState const& state);
+    void RenderComposite(ID3D12GraphicsCommandList* commandList);
+    void RenderGui(ID3D12GraphicsCommandList* commandList);
+    void DrawDebugLabels(RenderState const& state);
+
+    void SetOffscreenTarget(ID3D12GraphicsCommandList* commandList);
+    void SetBackBufferTarget(ID3D12GraphicsCommandList* commandList);
 
     void CreateDeviceDependentResources();
     void CreateWindowSizeDependentResources();
 
     void LoadTextures();
+    void UpdateTextures();
+    void UpdateEffects();
+    void BindEffectTextures();
+    void BindEffectTextures(DirectX::NormalMapEffect& effect);
+
+    // Resolve a descriptor handle to its location in m_srvHeap. Throws if the handle is stale.
+    D3D12_CPU_DESCRIPTOR_HANDLE GetSrvCpuHandle(DX::DescriptorAllocator::Handle handle) const;
+    D3D12_GPU_DESCRIPTOR_HANDLE GetSrvGpuHandle(DX::DescriptorAllocator::Handle handle) const;
 
     // Device resources.
     std::unique_ptr<DX::DeviceResources>        m_deviceResources;
 
     // Rendering loop timer.
     DX::StepTimer                               m_timer;
+    /// <summary>Durations of the last few hundred frames, measured on the main thread from one Tick to the next</summary>
+    DX::FrameTimeHistogram                      m_frameTimes{ DX::GetSystemClock().GetFrequency() };
+    uint64_t                                    m_lastFrameStart = 0;
+    /// <summary>Holds each frame back until just in time to sample its input, and measures input to present</summary>
+    DX::FramePacer                              m_framePacer{ DX::GetSystemClock().GetFrequency() };
+    uint64_t                                    m_frameInputTicks = 0;
+    uint64_t                                    m_frameWaitTicks = 0;
+    float                                       m_elapsedTime = 0.f;
+    float                                       m_totalTime = 0.f;
+
+    // Worker threads, and the tasks that make up an Update.
+    std::unique_ptr<DX::JobSystem>              m_jobs;
+    DX::TaskGraph                               m_updateGraph;
+
+    // Profiler zones, fence signals and waits, and frame starts, recorded while a capture runs. An export writes
+    // the capture on a worker into m_traceJob; once m_traceExport is done, the main thread moves its outcome into
+    // m_traceStatus and drops the job.
+    struct TraceExport
+    {
+        DX::TraceSnapshot                       snapshot;
+        std::string                             status;
+    };
+
+    DX::TraceCapture                            m_trace{ 64 * 1024 * 1024 };
+    DX::JobSystem::Counter                      m_traceExport;
+    std::shared_ptr<TraceExport>                m_traceJob;
+    std::string                                 m_traceStatus;
+
+    // When set, Update for the next frame overlaps Render for this one.
+    bool                                        m_pipelined = true;
+    DX::SnapshotBuffer<RenderState>             m_renderStates;
+
+    // Debug primitives drawn by any Update task, merged into the render state at the end of each Update. Every job
+    // worker and the main thread get a buffer of their own.
+    DX::DebugDraw                               m_debugDraw{ DX::JobSystem::DefaultWorkerCount() + 1 };
+    std::atomic<bool>                           m_showDebugDraw = true;
+
+    // Number of meshes circling the lit sphere, set from the GUI and read by the Transforms task.
+    std::atomic<uint32_t>                       m_ringInstanceCount = 64;
+
+    // Scene transforms: the lit sphere, and the ring's entities parented to a pivot that turns.
+    DX::TransformSystem                         m_transforms;
+    DX::Entity                                  m_litEntity;
+    DX::Entity                                  m_ringPivot;
+    std::vector<DX::Entity>                     m_ringEntities;
+    // Scratch for the Instances task: a bounding sphere per instance, and the indices of those in view.
+    DX::BoundingSphereSoA                       m_instanceBounds;
+    std::vector<uint32_t>                       m_visibleInstances;
+    // Every instance's box, in a tree for picking and nearest-object queries. Refit each frame as the ring turns.
+    std::vector<DX::Aabb>                       m_instanceBoxes;
+    DX::BoundingVolumeHierarchy                 m_instanceTree;
+    size_t                                      m_instanceTreeBuilds = 0;
+
+    // Rebuilt each frame from the passes Render records. m_passRecorders and m_graphResources are indexed by
+    // the graph's pass and resource ids.
+    DX::FrameGraph                                                      m_frameGraph;
+    DX::FrameGraph::ResourceId                                          m_offscreenResource = 0;
+    std::vector<std::function<void(ID3D12GraphicsCommandList*)>>        m_passRecorders;
+    std::vector<ID3D12Resource*>                                        m_graphResources;
+    std::vector<DX::DeviceResources::ContextPool::Pass>                 m_graphPasses;
 
     /// <summary><para>Manages video memory  allocations</para>
     /// <para>Call commit after presenting buffers to track and free memory</para>
     /// <para>Ensure initialization when creating resources</para></summary>
     std::unique_ptr<DirectX::GraphicsMemory> m_graphicsMemory;
+    /// <summary>Instance transforms and debug vertices for the frame being recorded, reused once the GPU is done with it</summary>
+    std::unique_ptr<DX::D3D12UploadAllocator> m_uploadAllocator;
 
     /// <summary>Stores and allocates objects needed by shaders</summary>
-    std::unique_ptr<DirectX::DescriptorPile> m_srvPile;
+    std::unique_ptr<DirectX::DescriptorHeap> m_srvHeap;
+    /// <summary><para>Hands out slots in m_srvHeap. Persistent slots are recycled when freed.</para>
+    /// <para>Every descriptor the game binds lives as long as its texture, so no slots are set aside for a
+    /// per-frame transient ring</para></summary>
+    std::unique_ptr<DX::DescriptorAllocator> m_srvAllocator;
+
+    static constexpr uint32_t SrvHeapCapacity = 4096;
+
+    DX::DescriptorAllocator::Handle m_guiDescriptor;
+    DX::DescriptorAllocator::Handle m_renderTextureDescriptor;
 
 
     RECT m_fullscreenRect;
 
     /// <summary><para>desc: The Texture's descriptor</para>
-    /// <para>slot: The Texture's slot for accessing it's resource in EffectTextureFactory</para></summary>
+    /// <para>resource: The Texture's resource</para>
+    /// <para>Both refer to the placeholder texture until the texture has finished loading</para></summary>
     struct TexHand
     {
-        size_t desc;
-        size_t slot;
+        DX::DescriptorAllocator::Handle desc;
+        Microsoft::WRL::ComPtr<ID3D12Resource> resource;
         /// <param name="desc">The Texture's descriptor</param>
-        /// <param name="slot">The Texture's slot for accessing it's resource in EffectTextureFactory</param>
-        TexHand(size_t desc, size_t slot)
+        /// <param name="resource">The Texture's resource</param>
+        TexHand(DX::DescriptorAllocator::Handle desc, Microsoft::WRL::ComPtr<ID3D12Resource> resource)
         {
             this->desc = desc;
-            this->slot = slot;
+            this->resource = std::move(resource);
         }
     };
 
-    std::unique_ptr<DirectX::EffectTextureFactory> m_textureResources;
-    /// <summary>Maps the name of a texture to its handles (slot and descriptor) for use with an EffectTextureFactory.</summary>
-    std::unique_ptr<std::map<const wchar_t*, TexHand>> m_texHands;
+    using TextureLoader = DX::AsyncTextureLoader<DX::D3D12TextureBackend>;
+
+    /// <summary>Decodes textures on the job system and uploads them on the copy queue</summary>
+    std::unique_ptr<TextureLoader> m_textureLoader;
+    /// <summary>Maps the name of a texture to its handles (resource and descriptor). Looked up by DX::TextureId in the hot path.</summary>
+    std::unique_ptr<DX::TextureRegistry<TexHand>> m_texHands;
     std::vector<const wchar_t*> m_textureLoadList;
 
+    /// <summary>A white texel drawn in place of textures that are still loading</summary>
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_placeholderTexture;
+    DX::DescriptorAllocator::Handle m_placeholderDescriptor;
 
-    enum Descriptors
-    {
-        Gui,
-        RenderTexture,
-        Reserve,
-        Count = 128
-    };
 
     enum RTDescriptors
     {
@@ -113,8 +266,8 @@ private:
 
     /// <summary>Helper that handles additional D3D resources required for drawing</summary>
     std::unique_ptr<DirectX::SpriteBatch> m_spriteBatch;
-
-    DirectX::SimpleMath::Vector2 m_origin;
+    /// <summary>Blits the offscreen texture to the back buffer, separate from m_spriteBatch so the two can be recorded concurrently</summary>
+    std::unique_ptr<DirectX::SpriteBatch> m_compositeBatch;
 
     std::unique_ptr<DirectX::CommonStates> m_states;
 
@@ -125,13 +278,17 @@ private:
     // provides vertex buffer and primitive topology
     std::unique_ptr<DirectX::PrimitiveBatch<VertexType>> m_batch;
 
-    //Do the same for the wireframe effect and batch
-    using WireframeVertexType = DirectX::VertexPositionColor;
+    // Unlit, vertex colored effect for debug lines
     std::unique_ptr<DirectX::BasicEffect> m_wireframeEffect;
-    std::unique_ptr<DirectX::PrimitiveBatch<WireframeVertexType>> m_wireframeBatch;
-
-    // world view and projection matrices
-    DirectX::SimpleMath::Matrix m_world;
+    /// <summary>Debug shapes generated once into static buffers, regenerated only when their parameters change</summary>
+    std::unique_ptr<DX::D3D12DebugGeometryCache> m_debugGeometry;
+    DX::DebugGrid m_grid;
+    /// <summary>The grid's buffers for the frame being recorded, or null while they are still uploading</summary>
+    DX::D3D12DebugGeometryBackend::Geometry const* m_gridGeometry = nullptr;
+    /// <summary>Draws each frame's merged debug primitives, one draw call per topology</summary>
+    std::unique_ptr<DX::D3D12DebugDrawRenderer> m_debugDrawRenderer;
+
+    // view and projection matrices
     DirectX::SimpleMath::Matrix m_view;
     DirectX::SimpleMath::Matrix m_proj;
     
@@ -144,14 +301,61 @@ private:
     DirectX::SimpleMath::Vector3 m_startPos = { 0.0f, 2.f, 2.f };
     
 
-    // geometric primitive for rendering simple sphere
-    std::unique_ptr<DirectX::GeometricPrimitive> m_shape;
+    // Meshes drawn instanced by RenderLit, indexed by InstanceMesh
+    enum InstanceMesh
+    {
+        SphereMesh,
+        CubeMesh,
+        InstanceMeshCount
+    };
+    std::unique_ptr<DirectX::GeometricPrimitive> m_meshes[InstanceMeshCount];
+    // Creates the instanced effects on workers, so their pipelines compile off the startup path
+    struct InstancedEffectBackend
+    {
+        using Description = DirectX::XMVECTORF32;      // diffuse color
+        using Pipeline = std::unique_ptr<DirectX::NormalMapEffect>;
+
+        ID3D12Device* device;
+        DirectX::EffectPipelineStateDescription pipelineDescription;
+
+        Pipeline Compile(Description const& diffuseColor) const;
+    };
+    using EffectCompiler = DX::AsyncPipelineCompiler<InstancedEffectBackend>;
+    std::unique_ptr<EffectCompiler> m_effectCompiler;
+    /// <summary>One instanced effect per material, indexed by the instances' material; they differ only in diffuse color</summary>
+    std::vector<EffectCompiler::Handle> m_instancedEffects;
+    /// <summary>Lit draws of the last frame made with a fallback effect, or skipped for want of one</summary>
+    size_t m_fallbackLitDraws = 0;
+    size_t m_skippedLitDraws = 0;
+    /// <summary>This frame's instance transforms, in the order of the render state's batches</summary>
+    DX::D3D12InstanceBuffer m_instanceBuffer;
+
+    // Pipelines of the lit pass's draw keys
+    enum LitPipeline : uint32_t
+    {
+        InstancedPipeline,
+        TrianglePipeline
+    };
+    // A lit draw: a mesh's instances on the instanced pipeline, or the triangle, which needs nothing more
+    struct LitDraw
+    {
+        uint32_t mesh;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+    /// <summary>The lit pass's draws, sorted by pipeline and material before they are recorded</summary>
+    DX::RenderQueue<LitDraw> m_litQueue;
 
     // rendering to texture
     std::unique_ptr<DirectX::DescriptorHeap> m_renderDescriptors;
+    /// <summary>Recycles offscreen render targets across resizes</summary>
+    std::unique_ptr<DX::D3D12RenderTargetPool> m_renderTargetPool;
+    std::unique_ptr<DX::D3D12RenderTargetProvider> m_renderTargetProvider;
     std::unique_ptr<DX::RenderTexture> m_renderTexture;
 
     // keyboard and mouse input
     std::unique_ptr<DirectX::Keyboard> m_keyboard;
     std::unique_ptr<DirectX::Mouse> m_mouse;
+    DirectX::Mouse::State m_mouseState = {};
+    DirectX::Keyboard::State m_keyboardState = {};
 };
@@ -0,0 +1,161 @@
+//
+// InstanceBatcher.h - Sorts instances by mesh and material and packs their transforms for instanced draws
+//
+
+#pragma once
+
+#include "RadixSort.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+
+namespace DX
+{
+    // A world transform as three rows of four, the transpose of a row-vector 4x3 matrix. This is the per-instance
+    // layout of the DirectXTK effects' instancing ("InstMatrix"), and of XMFLOAT3X4.
+    struct InstanceTransform
+    {
+        float m[3][4];
+    };
+
+    // Collects instances, then orders them so that every instance of a mesh with the same material is contiguous.
+    // Each such run is a Batch, drawn with one instanced draw call starting at its first instance.
+    //
+    // Instances are added in any order: their sort keys and transforms are kept in separate arrays, so sorting only
+    // moves 4-byte keys and indices. The transforms are gathered into sorted order as they are packed, which writes
+    // the destination strictly in sequence, as upload heap memory prefers.
+    class InstanceBatcher
+    {
+    public:
+        static constexpr uint32_t MaxMeshes = 0x10000;
+        static constexpr uint32_t MaxMaterials = 0x10000;
+
+        struct Batch
+        {
+            uint32_t    mesh;
+            uint32_t    material;
+            uint32_t    firstInstance;
+            uint32_t    instanceCount;
+        };
+
+        InstanceBatcher() noexcept : m_sorted(true) {}
+
+        void Clear() noexcept
+        {
+            m_keys.clear();
+            m_transforms.clear();
+            m_order.clear();
+            m_batches.clear();
+            m_sorted = true;
+        }
+
+        void Reserve(size_t count)
+        {
+            m_keys.reserve(count);
+            m_transforms.reserve(count);
+        }
+
+        // Add an instance. TMatrix is any 4x4 matrix with m[row][column], used with row vectors as DirectXMath does.
+        template<typename TMatrix>
+        void Add(uint32_t mesh, uint32_t material, TMatrix const& world)
+        {
+            InstanceTransform transform;
+            for (int row = 0; row < 3; ++row)
+            {
+                for (int column = 0; column < 4; ++column)
+                {
+                    transform.m[row][column] = world.m[column][row];
+                }
+            }
+            Add(mesh, material, transform);
+        }
+
+        void Add(uint32_t mesh, uint32_t material, InstanceTransform const& transform)
+        {
+            if (mesh >= MaxMeshes || material >= MaxMaterials)
+            {
+                throw std::out_of_range("InstanceBatcher mesh or material");
+            }
+
+            m_keys.push_back((mesh << 16) | material);
+            m_transforms.push_back(transform);
+            m_sorted = false;
+        }
+
+        // Order the instances by mesh, then material, and find the batches. Instances with equal keys keep the order
+        // they were added in.
+        void Sort()
+        {
+            const size_t count = m_keys.size();
+            m_sortedKeys.assign(m_keys.begin(), m_keys.end());
+            m_order.resize(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                m_order[i] = static_cast<uint32_t>(i);
+            }
+            RadixSort(m_sortedKeys, m_order, m_keyScratch, m_orderScratch);
+
+            m_batches.clear();
+            for (size_t i = 0; i < count; ++i)
+            {
+                const uint32_t key = m_sortedKeys[i];
+                if (m_batches.empty() || Key(m_batches.back()) != key)
+                {
+                    m_batches.push_back(Batch{ key >> 16, key & 0xFFFF, static_cast<uint32_t>(i), 0 });
+                }
+                m_batches.back().instanceCount++;
+            }
+
+            m_sorted = true;
+        }
+
+        // Bytes Pack writes.
+        size_t GetUploadSize() const noexcept { return m_transforms.size() * sizeof(InstanceTransform); }
+
+        // Write the transforms in batch order, GetUploadSize bytes.
+        void Pack(void* destination) const
+        {
+            CheckSorted();
+
+            auto out = static_cast<InstanceTransform*>(destination);
+            for (auto const index : m_order)
+            {
+                std::memcpy(out++, &m_transforms[index], sizeof(InstanceTransform));
+            }
+        }
+
+        // Runs of instances sharing a mesh and material, in sorted order.
+        std::span<const Batch> GetBatches() const
+        {
+            CheckSorted();
+            return m_batches;
+        }
+
+        size_t GetInstanceCount() const noexcept { return m_keys.size(); }
+
+    private:
+        static uint32_t Key(Batch const& batch) noexcept { return (batch.mesh << 16) | batch.material; }
+
+        void CheckSorted() const
+        {
+            if (!m_sorted)
+            {
+                throw std::logic_error("InstanceBatcher must be sorted after instances are added");
+            }
+        }
+
+        std::vector<uint32_t>           m_keys;
+        std::vector<InstanceTransform>  m_transforms;
+        std::vector<uint32_t>           m_sortedKeys;
+        std::vector<uint32_t>           m_order;
+        std::vector<uint32_t>           m_keyScratch;
+        std::vector<uint32_t>           m_orderScratch;
+        std::vector<Batch>              m_batches;
+        bool                            m_sorted;
+    };
+}
@@ -0,0 +1,312 @@
+//
+// JobSystem.h - A work-stealing job scheduler with fork/join counters
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace DX
+{
+    // Runs jobs on a fixed set of worker threads. Each worker owns a deque: it pushes and pops its own jobs from the
+    // back and steals from the front of other workers' deques when it runs dry. Threads that are not workers share
+    // a single injection deque. Any thread waiting on a Counter executes pending jobs rather than blocking.
+    class JobSystem
+    {
+    public:
+        using Job = std::function<void()>;
+
+        // Tracks completion of a group of jobs, and holds the first exception any of them threw.
+        class Counter
+        {
+        public:
+            Counter() noexcept : m_pending(0) {}
+
+            Counter(Counter const&) = delete;
+            Counter& operator= (Counter const&) = delete;
+
+            bool IsDone() const noexcept { return m_pending.load(std::memory_order_acquire) == 0; }
+
+        private:
+            friend class JobSystem;
+
+            std::atomic<uint32_t>   m_pending;
+            std::mutex              m_errorMutex;
+            std::exception_ptr      m_error;
+        };
+
+        // workerCount of zero runs every job on the thread that waits for it.
+        explicit JobSystem(unsigned int workerCount = DefaultWorkerCount()) :
+            m_queued(0),
+            m_stop(false)
+        {
+            // Queue 0 is shared by every thread that is not a worker.
+            for (unsigned int i = 0; i <= workerCount; ++i)
+            {
+                m_queues.emplace_back(std::make_unique<Queue>());
+            }
+
+            m_workers.reserve(workerCount);
+            for (unsigned int i = 1; i <= workerCount; ++i)
+            {
+                m_workers.emplace_back([this, i]() { WorkerMain(i); });
+            }
+        }
+
+        ~JobSystem()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_sleepMutex);
+                m_stop = true;
+            }
+            m_wake.notify_all();
+
+            for (auto& worker : m_workers)
+            {
+                worker.join();
+            }
+        }
+
+        JobSystem(JobSystem const&) = delete;
+        JobSystem& operator= (JobSystem const&) = delete;
+
+        static unsigned int DefaultWorkerCount() noexcept
+        {
+            const unsigned int cores = std::thread::hardware_concurrency();
+            return (cores > 1) ? cores - 1 : 0;
+        }
+
+        unsigned int GetWorkerCount() const noexcept { return static_cast<unsigned int>(m_workers.size()); }
+
+        // Index of the calling thread's queue: 1..GetWorkerCount() for workers, 0 for any other thread.
+        size_t GetCurrentThreadIndex() const noexcept { return (t_owner == this) ? t_queue : 0; }
+
+        // Queue a job. If counter is given, it will not report done until the job has run.
+        void Run(Job job, Counter* counter = nullptr)
+        {
+            if (counter)
+            {
+                counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            if (m_workers.empty())
+            {
+                Execute(Task{ std::move(job), counter });
+                return;
+            }
+
+            auto& queue = *m_queues[GetCurrentThreadIndex()];
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back(Task{ std::move(job), counter });
+            }
+
+            m_queued.fetch_add(1, std::memory_order_release);
+            {
+                // Synchronize with a worker that is about to sleep so the wake-up is not lost.
+                std::lock_guard<std::mutex> lock(m_sleepMutex);
+            }
+            m_wake.notify_one();
+        }
+
+        // Execute queued jobs on the calling thread until counter is done, then rethrow any job's exception.
+        void Wait(Counter& counter)
+        {
+            while (!counter.IsDone())
+            {
+                if (!TryRunPending())
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            std::exception_ptr error;
+            {
+                std::lock_guard<std::mutex> lock(counter.m_errorMutex);
+                std::swap(error, counter.m_error);
+            }
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+
+        // Run a single queued job on the calling thread, if one is available.
+        bool TryRunPending()
+        {
+            Task task;
+            if (!TryPop(GetCurrentThreadIndex(), task))
+                return false;
+
+            Execute(std::move(task));
+            return true;
+        }
+
+        // Call body(begin, end) over [0, count) in chunks of at most grain, and wait for all of them.
+        template<typename TBody>
+        void ParallelForRange(size_t count, size_t grain, TBody const& body)
+        {
+            grain = std::max<size_t>(grain, 1);
+            if (count <= grain || m_workers.empty())
+            {
+                if (count)
+                {
+                    body(size_t(0), count);
+                }
+                return;
+            }
+
+            Counter counter;
+            for (size_t begin = grain; begin < count; begin += grain)
+            {
+                const size_t end = std::min(begin + grain, count);
+                Run([&body, begin, end]() { body(begin, end); }, &counter);
+            }
+
+            // The calling thread takes the first chunk itself. The queued chunks refer to body and counter, so they
+            // must all finish before an exception from it may leave this frame.
+            try
+            {
+                body(size_t(0), grain);
+            }
+            catch (...)
+            {
+                try
+                {
+                    Wait(counter);
+                }
+                catch (...)
+                {
+                }
+                throw;
+            }
+            Wait(counter);
+        }
+
+        // Call body(i) for every i in [0, count), and wait for all of them.
+        template<typename TBody>
+        void ParallelFor(size_t count, TBody const& body)
+        {
+            ParallelForRange(count, 1, [&body](size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        body(i);
+                    }
+                });
+        }
+
+    private:
+        struct Task
+        {
+            Job         job;
+            Counter*    counter = nullptr;
+        };
+
+        struct Queue
+        {
+            std::mutex          mutex;
+            std::deque<Task>    tasks;
+        };
+
+        void WorkerMain(size_t index)
+        {
+            t_owner = this;
+            t_queue = index;
+
+            for (;;)
+            {
+                if (TryRunPending())
+                    continue;
+
+                std::unique_lock<std::mutex> lock(m_sleepMutex);
+                m_wake.wait(lock, [this]() { return m_stop || m_queued.load(std::memory_order_acquire) > 0; });
+                if (m_stop)
+                    return;
+            }
+        }
+
+        bool TryPop(size_t self, Task& task)
+        {
+            if (m_queued.load(std::memory_order_acquire) == 0)
+                return false;
+
+            // Newest job from our own deque first, for cache locality.
+            {
+                auto& queue = *m_queues[self];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.tasks.empty())
+                {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                    m_queued.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+
+            // Otherwise steal the oldest job from someone else.
+            const size_t count = m_queues.size();
+            for (size_t n = 1; n < count; ++n)
+            {
+                auto& queue = *m_queues[(self + n) % count];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.tasks.empty())
+                {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                    m_queued.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        static void Execute(Task task) noexcept
+        {
+            try
+            {
+                task.job();
+            }
+            catch (...)
+            {
+                if (!task.counter)
+                    std::terminate();
+
+                std::lock_guard<std::mutex> lock(task.counter->m_errorMutex);
+                if (!task.counter->m_error)
+                {
+                    task.counter->m_error = std::current_exception();
+                }
+            }
+
+            if (task.counter)
+            {
+                task.counter->m_pending.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        static inline thread_local JobSystem*   t_owner = nullptr;
+        static inline thread_local size_t       t_queue = 0;
+
+        std::vector<std::unique_ptr<Queue>>     m_queues;
+        std::vector<std::thread>                m_workers;
+
+        std::atomic<size_t>                     m_queued;
+        std::mutex                              m_sleepMutex;
+        std::condition_variable                 m_wake;
+        bool                                    m_stop;
+    };
+}
@@ -0,0 +1,312 @@
+//
+// PipelineCache.h - Compiled pipeline blobs keyed by a stable hash, saved to and reloaded from a file
+//
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+
+namespace DX
+{
+    // 64-bit FNV-1a over values added one at a time. Each value is hashed as its little-endian bytes, and strings
+    // by their characters and length, so a key never depends on struct padding, pointers or the platform.
+    class PipelineHasher
+    {
+    public:
+        PipelineHasher() noexcept : m_hash(14695981039346656037ull) {}
+
+        PipelineHasher& AddBytes(const void* data, size_t size) noexcept
+        {
+            auto const bytes = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; ++i)
+            {
+                m_hash ^= bytes[i];
+                m_hash *= 1099511628211ull;
+            }
+            return *this;
+        }
+
+        template<typename T>
+        PipelineHasher& Add(T value) noexcept
+        {
+            static_assert(std::is_integral_v<T> || std::is_enum_v<T> || std::is_floating_point_v<T>,
+                "Add fields one at a time; structs may contain padding");
+
+            uint64_t bits;
+            if constexpr (std::is_same_v<T, float>)
+            {
+                bits = std::bit_cast<uint32_t>(value);
+            }
+            else if constexpr (std::is_same_v<T, double>)
+            {
+                bits = std::bit_cast<uint64_t>(value);
+            }
+            else
+            {
+                bits = static_cast<uint64_t>(value);
+            }
+
+            for (size_t i = 0; i < sizeof(T); ++i)
+            {
+                const uint8_t byte = static_cast<uint8_t>(bits >> (i * 8));
+                AddBytes(&byte, 1);
+            }
+            return *this;
+        }
+
+        PipelineHasher& AddString(std::string_view text) noexcept
+        {
+            AddBytes(text.data(), text.size());
+            return Add(static_cast<uint64_t>(text.size()));
+        }
+
+        uint64_t GetHash() const noexcept { return m_hash; }
+
+    private:
+        uint64_t m_hash;
+    };
+
+    // The adapter and driver blobs were compiled by. Drivers reject blobs from another adapter or driver version,
+    // so a file saved by either is discarded as a whole when it is loaded.
+    struct PipelineCacheIdentity
+    {
+        uint32_t    vendorId;
+        uint32_t    deviceId;
+        uint32_t    subSysId;
+        uint32_t    revision;
+        uint64_t    driverVersion;
+
+        bool operator== (PipelineCacheIdentity const&) const noexcept = default;
+    };
+
+    // Holds compiled pipeline blobs by key. Loading never throws on a bad file: the cache keeps whatever it could
+    // verify, and is marked dirty so that the next Save replaces the file.
+    //
+    // File layout, all little-endian:
+    //     header      magic, format version, PipelineCacheIdentity, entry count
+    //     entries     key (8 bytes), blob size (4), FNV-1a of the key, size and blob (8), blob
+    class PipelineCache
+    {
+    public:
+        static constexpr uint32_t Magic = 0x4F535045;      // "EPSO"
+        static constexpr uint32_t Version = 1;
+        static constexpr size_t HeaderSize = 4 + 4 + 4 * 4 + 8 + 4;
+        static constexpr size_t EntryHeaderSize = 8 + 4 + 8;
+
+        enum class LoadResult
+        {
+            Loaded,     // every entry was read
+            Missing,    // there was no file
+            Stale,      // the file is from another adapter, driver or format version, and was ignored
+            Corrupt,    // the file was damaged; entries before the damage were kept
+        };
+
+        explicit PipelineCache(PipelineCacheIdentity const& identity) noexcept :
+            m_identity(identity),
+            m_dirty(false),
+            m_hitCount(0),
+            m_missCount(0)
+        {
+        }
+
+        // The blob stored for key, or null. Counts as a hit or a miss.
+        std::vector<uint8_t> const* Find(uint64_t key) noexcept
+        {
+            auto const it = m_entries.find(key);
+            if (it == m_entries.end())
+            {
+                m_missCount++;
+                return nullptr;
+            }
+
+            m_hitCount++;
+            return &it->second;
+        }
+
+        void Store(uint64_t key, const void* blob, size_t size)
+        {
+            if (size > UINT32_MAX)
+            {
+                throw std::length_error("Pipeline blob is too large");
+            }
+
+            auto const bytes = static_cast<const uint8_t*>(blob);
+            m_entries[key].assign(bytes, bytes + size);
+            m_dirty = true;
+        }
+
+        // Drop a blob the driver would not accept, so that it is recompiled and replaced.
+        void Remove(uint64_t key)
+        {
+            if (m_entries.erase(key))
+            {
+                m_dirty = true;
+            }
+        }
+
+        std::vector<uint8_t> Serialize() const
+        {
+            std::vector<uint8_t> data;
+            Write32(data, Magic);
+            Write32(data, Version);
+            Write32(data, m_identity.vendorId);
+            Write32(data, m_identity.deviceId);
+            Write32(data, m_identity.subSysId);
+            Write32(data, m_identity.revision);
+            Write64(data, m_identity.driverVersion);
+            Write32(data, static_cast<uint32_t>(m_entries.size()));
+
+            // Entries are written in key order, so that the same contents always give the same file
+            std::vector<uint64_t> keys;
+            keys.reserve(m_entries.size());
+            for (auto const& entry : m_entries)
+            {
+                keys.push_back(entry.first);
+            }
+            std::sort(keys.begin(), keys.end());
+
+            for (auto const key : keys)
+            {
+                auto const& blob = m_entries.at(key);
+                Write64(data, key);
+                Write32(data, static_cast<uint32_t>(blob.size()));
+                Write64(data, GetEntryChecksum(key, blob.data(), static_cast<uint32_t>(blob.size())));
+                data.insert(data.end(), blob.begin(), blob.end());
+            }
+            return data;
+        }
+
+        // Replace the cache's contents with those of a serialized cache.
+        LoadResult Deserialize(const uint8_t* data, size_t size)
+        {
+            m_entries.clear();
+            m_dirty = true;
+
+            if (size < HeaderSize || Read32(data) != Magic)
+                return LoadResult::Corrupt;
+
+            PipelineCacheIdentity identity;
+            identity.vendorId = Read32(data + 8);
+            identity.deviceId = Read32(data + 12);
+            identity.subSysId = Read32(data + 16);
+            identity.revision = Read32(data + 20);
+            identity.driverVersion = Read64(data + 24);
+            if (Read32(data + 4) != Version || identity != m_identity)
+                return LoadResult::Stale;
+
+            const uint32_t entryCount = Read32(data + 32);
+            size_t offset = HeaderSize;
+            for (uint32_t i = 0; i < entryCount; ++i)
+            {
+                if (size - offset < EntryHeaderSize)
+                    return LoadResult::Corrupt;
+
+                const uint64_t key = Read64(data + offset);
+                const uint32_t blobSize = Read32(data + offset + 8);
+                const uint64_t checksum = Read64(data + offset + 12);
+                offset += EntryHeaderSize;
+
+                if (size - offset < blobSize
+                    || GetEntryChecksum(key, data + offset, blobSize) != checksum)
+                    return LoadResult::Corrupt;
+
+                m_entries[key].assign(data + offset, data + offset + blobSize);
+                offset += blobSize;
+            }
+
+            if (offset != size)
+                return LoadResult::Corrupt;
+
+            m_dirty = false;
+            return LoadResult::Loaded;
+        }
+
+        LoadResult Load(std::filesystem::path const& path)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file)
+            {
+                m_entries.clear();
+                m_dirty = false;
+                return LoadResult::Missing;
+            }
+
+            const std::vector<uint8_t> data{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+            return Deserialize(data.data(), data.size());
+        }
+
+        // Write the cache to a temporary file and move it over path, so an interrupted save leaves the old file.
+        void Save(std::filesystem::path const& path)
+        {
+            auto const data = Serialize();
+            auto temporary = path;
+            temporary += ".tmp";
+            {
+                std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+                if (!file.flush())
+                {
+                    throw std::runtime_error("Failed to write the pipeline cache");
+                }
+            }
+            std::filesystem::rename(temporary, path);
+            m_dirty = false;
+        }
+
+        PipelineCacheIdentity const& GetIdentity() const noexcept { return m_identity; }
+        size_t GetEntryCount() const noexcept { return m_entries.size(); }
+        bool IsDirty() const noexcept { return m_dirty; }
+        size_t GetHitCount() const noexcept { return m_hitCount; }
+        size_t GetMissCount() const noexcept { return m_missCount; }
+
+    private:
+        // Covers the key and size too, so a damaged key cannot pass off a blob as another pipeline's
+        static uint64_t GetEntryChecksum(uint64_t key, const uint8_t* blob, uint32_t size) noexcept
+        {
+            return PipelineHasher().Add(key).Add(size).AddBytes(blob, size).GetHash();
+        }
+
+        static void Write32(std::vector<uint8_t>& data, uint32_t value)
+        {
+            for (size_t i = 0; i < 4; ++i)
+            {
+                data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+            }
+        }
+
+        static void Write64(std::vector<uint8_t>& data, uint64_t value)
+        {
+            Write32(data, static_cast<uint32_t>(value));
+            Write32(data, static_cast<uint32_t>(value >> 32));
+        }
+
+        static uint32_t Read32(const uint8_t* data) noexcept
+        {
+            return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+        }
+
+        static uint64_t Read64(const uint8_t* data) noexcept
+        {
+            return uint64_t(Read32(data)) | (uint64_t(Read32(data + 4)) << 32);
+        }
+
+        PipelineCacheIdentity                                   m_identity;
+        std::unordered_map<uint64_t, std::vector<uint8_t>>      m_entries;
+        bool                                                    m_dirty;
+        size_t                                                  m_hitCount;
+        size_t                                                  m_missCount;
+    };
+}
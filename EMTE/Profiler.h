@@ -0,0 +1,560 @@
+//
+// Profiler.h - Scoped CPU zones recorded per thread without locks, aggregated each frame into a call tree
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DX_PROFILE_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Define as 0 to compile every DX_PROFILE_ZONE out.
+#ifndef DX_PROFILE_ENABLED
+#define DX_PROFILE_ENABLED 1
+#endif
+
+
+namespace DX
+{
+    // A zone's call site. DX_PROFILE_ZONE declares one static constexpr, so its address interns the name at
+    // compile time and recording a zone never touches the string.
+    struct alignas(8) ProfileZoneInfo
+    {
+        const char*     name;
+        const wchar_t*  wideName;   // for PIX
+        const char*     file;
+        uint32_t        line;
+    };
+
+    // The time stamp counter where there is one, as it reads in a few nanoseconds; every x64 CPU of the last decade
+    // runs it at a constant rate. Elsewhere, the steady clock. The profiler calibrates either against the steady
+    // clock to report nanoseconds.
+    struct ProfileClock
+    {
+        static uint64_t Now() noexcept
+        {
+#ifdef DX_PROFILE_X86
+            return __rdtsc();
+#else
+            return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+        }
+    };
+
+    struct ProfileEvent
+    {
+        static constexpr uintptr_t EndBit = 1;
+
+        uint64_t    ticks;
+        uintptr_t   zone;       // the ProfileZoneInfo's address, with EndBit set where the zone ends
+
+        ProfileZoneInfo const* GetZone() const noexcept { return reinterpret_cast<ProfileZoneInfo const*>(zone & ~EndBit); }
+        bool IsEnd() const noexcept { return (zone & EndBit) != 0; }
+    };
+
+    // One thread's events: written by that thread, read by whichever ends frames. When the reader falls a whole
+    // ring behind, events are dropped and counted rather than making the writer wait. A begin is only written if
+    // there is room left for its end and those of the zones already open, so ends are never the ones dropped and a
+    // full ring cannot leave a zone open for good.
+    class ProfileThreadBuffer
+    {
+    public:
+        // capacity must be a power of two.
+        explicit ProfileThreadBuffer(size_t capacity) :
+            m_head(0),
+            m_cachedTail(0),
+            m_openCount(0),
+            m_tail(0),
+            m_dropped(0),
+            m_mask(capacity - 1),
+            m_events(std::make_unique<ProfileEvent[]>(capacity))
+        {
+            if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+            {
+                throw std::invalid_argument("ProfileThreadBuffer capacity must be a power of two");
+            }
+        }
+
+        ProfileThreadBuffer(ProfileThreadBuffer const&) = delete;
+        ProfileThreadBuffer& operator= (ProfileThreadBuffer const&) = delete;
+
+        bool Push(uint64_t ticks, uintptr_t zone) noexcept
+        {
+            const bool isEnd = (zone & ProfileEvent::EndBit) != 0;
+            const uint64_t needed = isEnd ? 1 : m_openCount + 2;
+            const uint64_t head = m_head.load(std::memory_order_relaxed);
+            if (head - m_cachedTail + needed > m_mask + 1)
+            {
+                m_cachedTail = m_tail.load(std::memory_order_acquire);
+                if (head - m_cachedTail + needed > m_mask + 1)
+                {
+                    m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+
+            m_events[head & m_mask] = ProfileEvent{ ticks, zone };
+            m_head.store(head + 1, std::memory_order_release);
+            m_openCount = isEnd ? (m_openCount ? m_openCount - 1 : 0) : m_openCount + 1;
+            return true;
+        }
+
+        // Hand every event written so far to func, oldest first, as at most two spans (the ring may wrap), then
+        // free their slots. One reader at a time.
+        template<typename TFunc>
+        void Drain(TFunc&& func)
+        {
+            const uint64_t tail = m_tail.load(std::memory_order_relaxed);
+            const uint64_t head = m_head.load(std::memory_order_acquire);
+            if (head == tail)
+                return;
+
+            const size_t start = static_cast<size_t>(tail & m_mask);
+            const size_t count = static_cast<size_t>(head - tail);
+            const size_t first = std::min(count, static_cast<size_t>(m_mask + 1) - start);
+            func(std::span<const ProfileEvent>(m_events.get() + start, first));
+            if (first != count)
+            {
+                func(std::span<const ProfileEvent>(m_events.get(), count - first));
+            }
+            m_tail.store(head, std::memory_order_release);
+        }
+
+        uint64_t GetDroppedCount() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+    private:
+        // The writer's and the reader's ends are kept on separate cache lines
+        alignas(64) std::atomic<uint64_t>       m_head;
+        uint64_t                                m_cachedTail;
+        uint64_t                                m_openCount;    // begins written whose ends are not yet
+        alignas(64) std::atomic<uint64_t>       m_tail;
+        std::atomic<uint64_t>                   m_dropped;
+        uint64_t                                m_mask;
+        std::unique_ptr<ProfileEvent[]>         m_events;
+    };
+
+    // Sees every event EndFrame drains, before it is aggregated, on the thread ending the frame.
+    class IProfileEventSink
+    {
+    public:
+        virtual ~IProfileEventSink() = default;
+
+        virtual void OnProfileEvents(uint32_t thread, std::span<const ProfileEvent> events) = 0;
+    };
+
+    // A call path's totals over one frame. A zone still open when the frame ends counts in the frame it closes.
+    struct ProfileNode
+    {
+        ProfileZoneInfo const*  zone;
+        uint32_t                thread;
+        uint32_t                depth;
+        uint32_t                calls;
+        uint64_t                inclusiveNanoseconds;
+        uint64_t                exclusiveNanoseconds;   // less the time in child zones
+    };
+
+    // Collects zones from any number of threads. Begin and End are wait-free after a thread's first zone, which
+    // registers it; EndFrame drains every thread's ring into a call tree per thread. EndFrame must be called from
+    // one thread at a time, but may run while others record.
+    class Profiler
+    {
+    public:
+        static constexpr size_t DefaultThreadCapacity = 1 << 16;
+        static constexpr size_t MaxDepth = 256;
+
+        explicit Profiler(size_t threadCapacity = DefaultThreadCapacity) :
+            m_id(NextId()),
+            m_threadCapacity(threadCapacity),
+            m_enabled(true),
+            m_calibrationTicks(ProfileClock::Now()),
+            m_calibrationTime(std::chrono::steady_clock::now()),
+            m_nanosecondsPerTick(1.0),
+            m_sink(nullptr),
+            m_unmatchedCount(0)
+        {
+        }
+
+        Profiler(Profiler const&) = delete;
+        Profiler& operator= (Profiler const&) = delete;
+
+        // Zones begun while disabled are not recorded, even if they end after it is enabled again.
+        void SetEnabled(bool enabled) noexcept { m_enabled.store(enabled, std::memory_order_relaxed); }
+        bool IsEnabled() const noexcept { return m_enabled.load(std::memory_order_relaxed); }
+
+        // Returns whether the zone was recorded, and so whether End should be called for it.
+        bool Begin(ProfileZoneInfo const& zone) noexcept
+        {
+            if (!m_enabled.load(std::memory_order_relaxed))
+                return false;
+
+            auto buffer = GetThreadBuffer();
+            return buffer && buffer->Push(ProfileClock::Now(), reinterpret_cast<uintptr_t>(&zone));
+        }
+
+        void End(ProfileZoneInfo const& zone) noexcept
+        {
+            if (auto buffer = GetThreadBuffer())
+            {
+                std::ignore = buffer->Push(ProfileClock::Now(), reinterpret_cast<uintptr_t>(&zone) | ProfileEvent::EndBit);
+            }
+        }
+
+        // Pass drained events to sink as well, or to nothing if it is null. Set it between EndFrames.
+        void SetEventSink(IProfileEventSink* sink) noexcept { m_sink = sink; }
+
+        // Label the calling thread in the call tree.
+        void SetThreadName(std::string name)
+        {
+            if (GetThreadBuffer())
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_threads[t_cache.index]->name = std::move(name);
+            }
+        }
+
+        // Drain every thread's zones into the call tree of the frame that just ended, and return it: each thread's
+        // paths depth first, children in the order they were first entered.
+        std::vector<ProfileNode> const& EndFrame()
+        {
+            Calibrate();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_active.clear();
+                for (auto const& state : m_threads)
+                {
+                    m_active.push_back(state.get());
+                }
+            }
+
+            m_tree.clear();
+            for (uint32_t thread = 0; thread < m_active.size(); ++thread)
+            {
+                auto& state = *m_active[thread];
+                state.firstRoot = NoNode;
+                state.lastRoot = NoNode;
+
+                // Zones left open by the last frame get their paths in this one
+                for (size_t i = 0; i < state.open.size(); ++i)
+                {
+                    state.open[i].node = FindOrAddNode(state, thread, i ? state.open[i - 1].node : NoNode, state.open[i].zone);
+                }
+
+                state.buffer.Drain([&](std::span<const ProfileEvent> events)
+                    {
+                        if (m_sink)
+                        {
+                            m_sink->OnProfileEvents(thread, events);
+                        }
+                        for (auto const& event : events)
+                        {
+                            Process(state, thread, event);
+                        }
+                    });
+            }
+
+            m_frame.clear();
+            m_frame.reserve(m_tree.size());
+            for (uint32_t thread = 0; thread < m_active.size(); ++thread)
+            {
+                for (uint32_t root = m_active[thread]->firstRoot; root != NoNode; root = m_tree[root].nextSibling)
+                {
+                    Flatten(root, 0);
+                }
+            }
+            return m_frame;
+        }
+
+        std::vector<ProfileNode> const& GetLastFrame() const noexcept { return m_frame; }
+
+        size_t GetThreadCount() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_threads.size();
+        }
+
+        std::string GetThreadName(uint32_t thread) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_threads.at(thread)->name;
+        }
+
+        // Events lost to full rings, and ends that matched no open zone (the begin having been lost).
+        uint64_t GetDroppedCount() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            uint64_t dropped = 0;
+            for (auto const& state : m_threads)
+            {
+                dropped += state->buffer.GetDroppedCount();
+            }
+            return dropped;
+        }
+        uint64_t GetUnmatchedCount() const noexcept { return m_unmatchedCount; }
+
+        // As calibrated by the last EndFrame.
+        double GetNanosecondsPerTick() const noexcept { return m_nanosecondsPerTick; }
+
+    private:
+        static constexpr uint32_t NoNode = UINT32_MAX;
+
+        struct OpenZone
+        {
+            ProfileZoneInfo const*  zone;
+            uint64_t                beginTicks;
+            uint64_t                childTicks;
+            uint32_t                node;
+        };
+
+        struct ThreadState
+        {
+            explicit ThreadState(size_t capacity) : buffer(capacity) {}
+
+            ProfileThreadBuffer     buffer;
+            std::string             name;
+            std::vector<OpenZone>   open;
+            uint32_t                firstRoot = NoNode;
+            uint32_t                lastRoot = NoNode;
+        };
+
+        struct TreeNode
+        {
+            ProfileZoneInfo const*  zone;
+            uint32_t                thread;
+            uint32_t                calls;
+            uint64_t                inclusiveTicks;
+            uint64_t                exclusiveTicks;
+            uint32_t                firstChild;
+            uint32_t                lastChild;
+            uint32_t                nextSibling;
+        };
+
+        // Thread storage starts zeroed, and no profiler has the id 0
+        struct ThreadCache
+        {
+            uint64_t                profiler;
+            ProfileThreadBuffer*    buffer;
+            uint32_t                index;
+        };
+
+        static uint64_t NextId() noexcept
+        {
+            static std::atomic<uint64_t> s_next(1);
+            return s_next.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Registers the calling thread on its first zone. Null if it cannot be registered.
+        ProfileThreadBuffer* GetThreadBuffer() noexcept
+        {
+            if (t_cache.profiler == m_id)
+                return t_cache.buffer;
+
+            try
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto state = std::make_unique<ThreadState>(m_threadCapacity);
+                state->name = "Thread " + std::to_string(m_threads.size());
+                t_cache.profiler = m_id;
+                t_cache.buffer = &state->buffer;
+                t_cache.index = static_cast<uint32_t>(m_threads.size());
+                m_threads.emplace_back(std::move(state));
+                return t_cache.buffer;
+            }
+            catch (...)
+            {
+                return nullptr;
+            }
+        }
+
+        // The rate is measured over the profiler's whole life, so it only gets more precise.
+        void Calibrate() noexcept
+        {
+            const uint64_t ticks = ProfileClock::Now() - m_calibrationTicks;
+            const auto elapsed = std::chrono::steady_clock::now() - m_calibrationTime;
+            if (ticks > 0 && elapsed > std::chrono::milliseconds(1))
+            {
+                m_nanosecondsPerTick = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())
+                    / static_cast<double>(ticks);
+            }
+        }
+
+        uint32_t FindOrAddNode(ThreadState& state, uint32_t thread, uint32_t parent, ProfileZoneInfo const* zone)
+        {
+            uint32_t& first = (parent == NoNode) ? state.firstRoot : m_tree[parent].firstChild;
+            for (uint32_t node = first; node != NoNode; node = m_tree[node].nextSibling)
+            {
+                if (m_tree[node].zone == zone)
+                    return node;
+            }
+
+            const uint32_t node = static_cast<uint32_t>(m_tree.size());
+            uint32_t& last = (parent == NoNode) ? state.lastRoot : m_tree[parent].lastChild;
+            if (last == NoNode)
+            {
+                first = node;
+            }
+            else
+            {
+                m_tree[last].nextSibling = node;
+            }
+            last = node;
+
+            // Added last, as growing the tree invalidates first and last
+            m_tree.push_back(TreeNode{ zone, thread, 0, 0, 0, NoNode, NoNode, NoNode });
+            return node;
+        }
+
+        void Process(ThreadState& state, uint32_t thread, ProfileEvent const& event)
+        {
+            auto const zone = event.GetZone();
+            if (!event.IsEnd())
+            {
+                if (state.open.size() == MaxDepth)
+                {
+                    m_unmatchedCount++;
+                    return;
+                }
+
+                const uint32_t parent = state.open.empty() ? NoNode : state.open.back().node;
+                const uint32_t node = FindOrAddNode(state, thread, parent, zone);
+                state.open.push_back(OpenZone{ zone, event.ticks, 0, node });
+                return;
+            }
+
+            // A zone whose end was dropped is closed by its parent's
+            size_t index = state.open.size();
+            while (index > 0 && state.open[index - 1].zone != zone)
+            {
+                --index;
+            }
+            if (index == 0)
+            {
+                m_unmatchedCount++;
+                return;
+            }
+            m_unmatchedCount += state.open.size() - index;
+            state.open.resize(index);
+
+            auto const open = state.open.back();
+            state.open.pop_back();
+
+            const uint64_t duration = event.ticks > open.beginTicks ? event.ticks - open.beginTicks : 0;
+            auto& node = m_tree[open.node];
+            node.calls++;
+            node.inclusiveTicks += duration;
+            node.exclusiveTicks += duration > open.childTicks ? duration - open.childTicks : 0;
+            if (!state.open.empty())
+            {
+                state.open.back().childTicks += duration;
+            }
+        }
+
+        void Flatten(uint32_t index, uint32_t depth)
+        {
+            auto const& node = m_tree[index];
+            m_frame.push_back(ProfileNode{ node.zone, node.thread, depth, node.calls,
+                ToNanoseconds(node.inclusiveTicks), ToNanoseconds(node.exclusiveTicks) });
+            for (uint32_t child = node.firstChild; child != NoNode; child = m_tree[child].nextSibling)
+            {
+                Flatten(child, depth + 1);
+            }
+        }
+
+        uint64_t ToNanoseconds(uint64_t ticks) const noexcept
+        {
+            return static_cast<uint64_t>(static_cast<double>(ticks) * m_nanosecondsPerTick);
+        }
+
+        static inline thread_local ThreadCache  t_cache;
+
+        uint64_t                                    m_id;
+        size_t                                      m_threadCapacity;
+        std::atomic<bool>                           m_enabled;
+
+        mutable std::mutex                          m_mutex;
+        std::vector<std::unique_ptr<ThreadState>>   m_threads;
+
+        // Threads registered as of the last EndFrame, which reads them without the lock
+        std::vector<ThreadState*>                   m_active;
+
+        uint64_t                                    m_calibrationTicks;
+        std::chrono::steady_clock::time_point       m_calibrationTime;
+        double                                      m_nanosecondsPerTick;
+
+        IProfileEventSink*                          m_sink;
+
+        std::vector<TreeNode>                       m_tree;
+        std::vector<ProfileNode>                    m_frame;
+        uint64_t                                    m_unmatchedCount;
+    };
+
+    // The profiler DX_PROFILE_ZONE records into.
+    inline Profiler& GetProfiler()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    // Records a zone from construction to destruction, and marks it for PIX on Windows.
+    class ProfileScope
+    {
+    public:
+        explicit ProfileScope(ProfileZoneInfo const& zone, Profiler& profiler = GetProfiler()) noexcept :
+            m_zone(zone),
+            m_profiler(profiler.Begin(zone) ? &profiler : nullptr)
+        {
+#ifdef _WIN32
+            PIXBeginEvent(PIX_COLOR_DEFAULT, zone.wideName);
+#endif
+        }
+
+        ~ProfileScope()
+        {
+#ifdef _WIN32
+            PIXEndEvent();
+#endif
+            if (m_profiler)
+            {
+                m_profiler->End(m_zone);
+            }
+        }
+
+        ProfileScope(ProfileScope const&) = delete;
+        ProfileScope& operator= (ProfileScope const&) = delete;
+
+    private:
+        ProfileZoneInfo const&  m_zone;
+        Profiler*               m_profiler;
+    };
+}
+
+#define DX_PROFILE_CONCAT_(a, b) a##b
+#define DX_PROFILE_CONCAT(a, b) DX_PROFILE_CONCAT_(a, b)
+
+// Profile the rest of the enclosing scope as a zone. name must be a string literal.
+#if DX_PROFILE_ENABLED
+#define DX_PROFILE_ZONE(name) \
+    static constexpr DX::ProfileZoneInfo DX_PROFILE_CONCAT(s_profileZone, __LINE__){ name, DX_PROFILE_CONCAT(L, name), __FILE__, __LINE__ }; \
+    const DX::ProfileScope DX_PROFILE_CONCAT(profileScope, __LINE__)(DX_PROFILE_CONCAT(s_profileZone, __LINE__))
+#else
+#define DX_PROFILE_ZONE(name) do {} while (false)
+#endif
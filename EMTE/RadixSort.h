@@ -0,0 +1,73 @@
+//
+// RadixSort.h - Stable least-significant-digit radix sort of integer keys with a value each
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+
+namespace DX
+{
+    // Sort keys ascending, moving values[i] along with keys[i]. Equal keys keep their order. Sorts a byte at a
+    // time; every byte's histogram is counted in one pass up front, and bytes that all keys share are skipped, so
+    // keys that only use their low bits cost only as many passes as they need. The histograms live on the stack
+    // (16 KB for 64-bit keys) and the scratch vectors are reused between calls, so a sort never allocates once the
+    // scratch has grown to fit.
+    template<typename TKey>
+    void RadixSort(std::vector<TKey>& keys, std::vector<uint32_t>& values,
+        std::vector<TKey>& keyScratch, std::vector<uint32_t>& valueScratch)
+    {
+        static_assert(std::is_unsigned_v<TKey>, "RadixSort keys must be unsigned integers");
+        constexpr size_t digitCount = sizeof(TKey);
+
+        const size_t count = keys.size();
+        if (values.size() != count)
+        {
+            throw std::invalid_argument("RadixSort needs a value per key");
+        }
+        if (count < 2)
+            return;
+
+        std::array<size_t, digitCount * 256> histograms{};
+        for (auto const key : keys)
+        {
+            for (size_t digit = 0; digit < digitCount; ++digit)
+            {
+                histograms[digit * 256 + ((key >> (digit * 8)) & 0xFF)]++;
+            }
+        }
+
+        keyScratch.resize(count);
+        valueScratch.resize(count);
+        for (size_t digit = 0; digit < digitCount; ++digit)
+        {
+            size_t* const offsets = &histograms[digit * 256];
+            const TKey firstByte = (keys[0] >> (digit * 8)) & 0xFF;
+            if (offsets[firstByte] == count)
+                continue;
+
+            size_t total = 0;
+            for (size_t bucket = 0; bucket < 256; ++bucket)
+            {
+                const size_t bucketCount = offsets[bucket];
+                offsets[bucket] = total;
+                total += bucketCount;
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const size_t destination = offsets[(keys[i] >> (digit * 8)) & 0xFF]++;
+                keyScratch[destination] = keys[i];
+                valueScratch[destination] = values[i];
+            }
+            keys.swap(keyScratch);
+            values.swap(valueScratch);
+        }
+    }
+}
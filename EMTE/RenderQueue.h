@@ -0,0 +1,172 @@
+//
+// RenderQueue.h - Draws ordered by a 64-bit sort key, submitted with redundant state changes skipped
+//
+
+#pragma once
+
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+
+namespace DX
+{
+    // A draw's place in the submission order, most significant field first:
+    //
+    //     63..60  pass        passes are submitted in order
+    //     59..56  layer       e.g. opaque before transparent within a pass
+    //     55..44  pipeline    pipeline state and root signature
+    //     43..28  material    descriptors and constants bound on top of the pipeline
+    //     27..4   depth       quantized view depth, nearest first unless reversed
+    //      3..0   unused
+    //
+    // Sorting by pipeline, then material, groups draws that share state, so each is bound once per run.
+    struct DrawKey
+    {
+        static constexpr uint32_t MaxPass = 0xF;
+        static constexpr uint32_t MaxLayer = 0xF;
+        static constexpr uint32_t MaxPipeline = 0xFFF;
+        static constexpr uint32_t MaxMaterial = 0xFFFF;
+        static constexpr uint32_t MaxDepth = 0xFFFFFF;
+
+        static uint64_t Make(uint32_t pass, uint32_t layer, uint32_t pipeline, uint32_t material, uint32_t depth = 0)
+        {
+            if (pass > MaxPass || layer > MaxLayer || pipeline > MaxPipeline || material > MaxMaterial || depth > MaxDepth)
+            {
+                throw std::out_of_range("DrawKey field");
+            }
+
+            return (uint64_t(pass) << 60) | (uint64_t(layer) << 56) | (uint64_t(pipeline) << 44)
+                | (uint64_t(material) << 28) | (uint64_t(depth) << 4);
+        }
+
+        // Quantize a view depth between nearPlane and farPlane. Reversed depths sort farthest first, for blending.
+        static uint32_t QuantizeDepth(float depth, float nearPlane, float farPlane, bool reversed = false) noexcept
+        {
+            const float t = std::clamp((depth - nearPlane) / (farPlane - nearPlane), 0.f, 1.f);
+            const auto quantized = static_cast<uint32_t>(t * float(MaxDepth));
+            return reversed ? MaxDepth - quantized : quantized;
+        }
+
+        static uint32_t GetPass(uint64_t key) noexcept { return uint32_t(key >> 60) & MaxPass; }
+        static uint32_t GetLayer(uint64_t key) noexcept { return uint32_t(key >> 56) & MaxLayer; }
+        static uint32_t GetPipeline(uint64_t key) noexcept { return uint32_t(key >> 44) & MaxPipeline; }
+        static uint32_t GetMaterial(uint64_t key) noexcept { return uint32_t(key >> 28) & MaxMaterial; }
+        static uint32_t GetDepth(uint64_t key) noexcept { return uint32_t(key >> 4) & MaxDepth; }
+    };
+
+    // Collects draws in any order, sorts them by key, and submits them to a backend, binding a pipeline or
+    // material only when it differs from the one already bound.
+    //
+    // TBackend must provide:
+    //     void BindPipeline(uint32_t pipeline);
+    //     void BindMaterial(uint32_t pipeline, uint32_t material);     // after BindPipeline if that changed
+    //     void Draw(TDraw const& draw);
+    template<typename TDraw>
+    class RenderQueue
+    {
+    public:
+        struct Statistics
+        {
+            size_t draws;
+            size_t pipelineBinds;
+            size_t materialBinds;
+        };
+
+        RenderQueue() noexcept : m_sorted(true), m_statistics{} {}
+
+        void Clear() noexcept
+        {
+            m_keys.clear();
+            m_draws.clear();
+            m_order.clear();
+            m_sorted = true;
+        }
+
+        void Reserve(size_t count)
+        {
+            m_keys.reserve(count);
+            m_draws.reserve(count);
+        }
+
+        void Submit(uint64_t key, TDraw const& draw)
+        {
+            if (m_draws.size() >= UINT32_MAX)
+            {
+                throw std::length_error("RenderQueue is full");
+            }
+
+            m_keys.push_back(key);
+            m_draws.push_back(draw);
+            m_sorted = false;
+        }
+
+        // Order the draws by key. Draws with equal keys keep the order they were submitted in.
+        void Sort()
+        {
+            m_order.resize(m_draws.size());
+            for (size_t i = 0; i < m_order.size(); ++i)
+            {
+                m_order[i] = static_cast<uint32_t>(i);
+            }
+            RadixSort(m_keys, m_order, m_keyScratch, m_orderScratch);
+            m_sorted = true;
+        }
+
+        // Submit every draw in key order. Bindings are not assumed to survive between calls.
+        template<typename TBackend>
+        void Execute(TBackend& backend)
+        {
+            if (!m_sorted)
+            {
+                throw std::logic_error("RenderQueue must be sorted after draws are submitted");
+            }
+
+            m_statistics = {};
+            uint32_t pipeline = UINT32_MAX;
+            uint32_t material = UINT32_MAX;
+            for (size_t i = 0; i < m_order.size(); ++i)
+            {
+                const uint32_t drawPipeline = DrawKey::GetPipeline(m_keys[i]);
+                const uint32_t drawMaterial = DrawKey::GetMaterial(m_keys[i]);
+                if (drawPipeline != pipeline)
+                {
+                    backend.BindPipeline(drawPipeline);
+                    pipeline = drawPipeline;
+                    material = UINT32_MAX;
+                    m_statistics.pipelineBinds++;
+                }
+                if (drawMaterial != material)
+                {
+                    backend.BindMaterial(pipeline, drawMaterial);
+                    material = drawMaterial;
+                    m_statistics.materialBinds++;
+                }
+
+                backend.Draw(m_draws[m_order[i]]);
+                m_statistics.draws++;
+            }
+        }
+
+        size_t GetDrawCount() const noexcept { return m_draws.size(); }
+
+        // Sorted keys, in the order Execute submits them.
+        std::vector<uint64_t> const& GetKeys() const noexcept { return m_keys; }
+
+        // Draws and bindings of the last Execute.
+        Statistics GetStatistics() const noexcept { return m_statistics; }
+
+    private:
+        std::vector<uint64_t>   m_keys;
+        std::vector<TDraw>      m_draws;
+        std::vector<uint32_t>   m_order;
+        std::vector<uint64_t>   m_keyScratch;
+        std::vector<uint32_t>   m_orderScratch;
+        bool                    m_sorted;
+        Statistics              m_statistics;
+    };
+}
@@ -0,0 +1,167 @@
+//
+// RenderTargetPool.h - Render targets recycled across frames instead of created on every resize
+//
+
+#pragma once
+
+#include "FenceTimeline.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // Everything that decides whether two render targets are interchangeable.
+    struct RenderTargetKey
+    {
+        uint32_t    format = 0;
+        uint32_t    width = 0;
+        uint32_t    height = 0;
+        uint32_t    flags = 0;
+        float       clearColor[4] = {};     // optimized clear value, baked into the resource when it is created
+
+        bool operator== (RenderTargetKey const&) const noexcept = default;
+    };
+
+    struct RenderTargetKeyHash
+    {
+        size_t operator()(RenderTargetKey const& key) const noexcept
+        {
+            uint64_t hash = 14695981039346656037ull;
+            auto const mix = [&hash](uint32_t value)
+                {
+                    hash ^= value;
+                    hash *= 1099511628211ull;
+                };
+
+            mix(key.format);
+            mix(key.width);
+            mix(key.height);
+            mix(key.flags);
+            for (auto const channel : key.clearColor)
+            {
+                mix(std::bit_cast<uint32_t>(channel));
+            }
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    // Hands out render targets without creating a new resource every time one is needed.
+    //
+    // Targets are acquired and released individually. A released target is kept, keyed by its description, and handed
+    // out again once the GPU has finished the frame it was released in; targets that sit unused for maxIdleFrames are
+    // destroyed.
+    //
+    // TBackend must provide:
+    //     using Target = ...;
+    //     Target Create(RenderTargetKey const& key);
+    template<typename TBackend>
+    class RenderTargetPool
+    {
+    public:
+        using Target = typename TBackend::Target;
+
+        RenderTargetPool(TBackend backend, FenceTimeline& timeline, uint32_t maxIdleFrames = 120) :
+            m_backend(std::move(backend)),
+            m_timeline(timeline),
+            m_maxIdleFrames(maxIdleFrames),
+            m_frame(0),
+            m_createdCount(0),
+            m_reusedCount(0)
+        {
+        }
+
+        RenderTargetPool(RenderTargetPool const&) = delete;
+        RenderTargetPool& operator= (RenderTargetPool const&) = delete;
+
+        // Get a target matching key, reusing a released one if the GPU has finished with it.
+        Target Acquire(RenderTargetKey const& key)
+        {
+            auto found = m_free.find(key);
+            if (found != m_free.end())
+            {
+                auto& targets = found->second;
+                for (auto it = targets.begin(); it != targets.end(); ++it)
+                {
+                    if (m_timeline.IsComplete(it->retireValue))
+                    {
+                        Target target = std::move(it->target);
+                        targets.erase(it);
+                        m_reusedCount++;
+                        return target;
+                    }
+                }
+            }
+
+            m_createdCount++;
+            return m_backend.Create(key);
+        }
+
+        // Return a target. It may still be in use by the frame being recorded, so it is not handed out
+        // again until that frame's fence value completes.
+        void Release(RenderTargetKey const& key, Target target)
+        {
+            m_free[key].push_back(Pooled{ std::move(target), m_timeline.GetNextValue(), m_frame });
+        }
+
+        // Start a frame, destroying anything that has been idle too long.
+        void BeginFrame()
+        {
+            m_frame++;
+
+            for (auto it = m_free.begin(); it != m_free.end();)
+            {
+                auto& targets = it->second;
+                std::erase_if(targets, [this](Pooled const& pooled) { return IsExpired(pooled.retireValue, pooled.frame); });
+                it = targets.empty() ? m_free.erase(it) : std::next(it);
+            }
+        }
+
+        size_t GetCreatedCount() const noexcept { return m_createdCount; }
+        size_t GetReusedCount() const noexcept { return m_reusedCount; }
+
+        size_t GetPooledCount() const noexcept
+        {
+            size_t count = 0;
+            for (auto const& entry : m_free)
+            {
+                count += entry.second.size();
+            }
+            return count;
+        }
+
+        TBackend& GetBackend() noexcept { return m_backend; }
+
+    private:
+        struct Pooled
+        {
+            Target      target;
+            uint64_t    retireValue;
+            uint64_t    frame;
+        };
+
+        bool IsExpired(uint64_t retireValue, uint64_t frame) noexcept
+        {
+            return m_frame - frame > m_maxIdleFrames && m_timeline.IsComplete(retireValue);
+        }
+
+        TBackend                                                                m_backend;
+        FenceTimeline&                                                          m_timeline;
+        uint32_t                                                                m_maxIdleFrames;
+        uint64_t                                                                m_frame;
+
+        // Released targets waiting to be reused.
+        std::unordered_map<RenderTargetKey, std::vector<Pooled>, RenderTargetKeyHash>  m_free;
+
+        size_t                                                                  m_createdCount;
+        size_t                                                                  m_reusedCount;
+    };
+}
@@ -0,0 +1,44 @@
+//
+// ResourceState.h - Graphics API independent resource states
+//
+
+#pragma once
+
+#include <cstdint>
+
+
+namespace DX
+{
+    // Graphics API independent resource states. Read states may be combined; write states are exclusive.
+    enum class ResourceState : uint32_t
+    {
+        Undefined               = 0,
+        RenderTarget            = 0x1,
+        DepthWrite              = 0x2,
+        UnorderedAccess         = 0x4,
+        CopyDest                = 0x8,
+        DepthRead               = 0x10,
+        PixelShaderResource     = 0x20,
+        NonPixelShaderResource  = 0x40,
+        CopySource              = 0x80,
+        Present                 = 0x100,
+    };
+
+    constexpr ResourceState operator| (ResourceState a, ResourceState b) noexcept
+    {
+        return static_cast<ResourceState>(static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
+    }
+
+    constexpr ResourceState operator& (ResourceState a, ResourceState b) noexcept
+    {
+        return static_cast<ResourceState>(static_cast<uint32_t>(a) & static_cast<uint32_t>(b));
+    }
+
+    constexpr ResourceState c_ReadStates = ResourceState::DepthRead | ResourceState::PixelShaderResource
+        | ResourceState::NonPixelShaderResource | ResourceState::CopySource;
+
+    constexpr bool IsReadState(ResourceState state) noexcept
+    {
+        return state != ResourceState::Undefined && (state & c_ReadStates) == state;
+    }
+}
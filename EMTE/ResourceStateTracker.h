@@ -0,0 +1,538 @@
+//
+// ResourceStateTracker.h - Tracks resource states across command lists and batches the barriers between them
+//
+
+#pragma once
+
+#include "ResourceState.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+
+namespace DX
+{
+    // Knows the state of every registered resource, per subresource, as of the last command list submitted.
+    //
+    // Command lists recorded in parallel can't know what state the lists ahead of them will leave a resource in, so
+    // each records against its own LocalState. The first time a list uses a resource it only notes the state it needs
+    // at the start of the list; later transitions within the list are known exactly, and are queued and flushed as one
+    // batch, with redundant ones dropped. At submit, Resolve is called for each list in submission order: it compares
+    // what the list needed with the tracked state, returns the fixup barriers to run in front of the list, and then
+    // records the state the list leaves everything in.
+    //
+    // With validation enabled, using a resource that was never registered, or assuming a state it is not actually in,
+    // throws std::logic_error instead of being quietly resolved.
+    class ResourceStateTracker
+    {
+    public:
+        using ResourceKey = const void*;
+
+        static constexpr uint32_t AllSubresources = 0xFFFFFFFF;
+
+        struct Barrier
+        {
+            ResourceKey     resource;
+            uint32_t        subresource;
+            ResourceState   before;
+            ResourceState   after;
+            bool            aliasing;       // the resource's memory may have held another resource
+        };
+
+        struct Statistics
+        {
+            uint64_t    transitions = 0;    // transitions requested
+            uint64_t    redundant = 0;      // requests that needed no barrier, or cancelled out within a batch
+            uint64_t    barriers = 0;       // barriers recorded in command lists
+            uint64_t    batches = 0;        // ResourceBarrier calls they were recorded with
+            uint64_t    fixups = 0;         // barriers added in front of lists at submit
+        };
+
+        // Resource states as seen by one command list.
+        class LocalState
+        {
+        public:
+            explicit LocalState(ResourceStateTracker& tracker) noexcept :
+                m_tracker(&tracker),
+                m_inherit(false)
+            {
+            }
+
+            LocalState(LocalState&&) = default;
+            LocalState& operator= (LocalState&&) = default;
+
+            LocalState(LocalState const&) = delete;
+            LocalState& operator= (LocalState const&) = delete;
+
+            // Forget everything, ready for the list to be recorded again.
+            void Reset() noexcept
+            {
+                m_states.clear();
+                m_requirements.clear();
+                m_pending.clear();
+                m_statistics = Statistics{};
+            }
+
+            // A list recorded after every list ahead of it has been resolved can read the tracked states directly,
+            // and so issues its first transitions itself rather than needing fixups.
+            void SetInheritGlobal(bool inherit) noexcept { m_inherit = inherit; }
+
+            // State that the caller knows a resource to be in at this point, e.g. from a compiled frame graph. Only has
+            // an effect before the list's first use of the resource; it is checked against the tracked state at Resolve.
+            void Assume(ResourceKey resource, ResourceState state, uint32_t subresource = AllSubresources)
+            {
+                auto& entry = GetEntry(resource);
+                auto const current = GetState(entry, subresource);
+                if (current != ResourceState::Undefined)
+                {
+                    if (current != state && m_tracker->m_validation)
+                    {
+                        throw std::logic_error("Assumed resource state does not match the command list's state");
+                    }
+                    return;
+                }
+
+                m_requirements.push_back(Requirement{ resource, subresource, state, true });
+                SetState(entry, resource, subresource, state);
+            }
+
+            // Queue a transition to after. Nothing is recorded until Flush.
+            void Transition(ResourceKey resource, ResourceState after, uint32_t subresource = AllSubresources)
+            {
+                if (after == ResourceState::Undefined)
+                {
+                    throw std::invalid_argument("Cannot transition a resource to Undefined");
+                }
+
+                m_statistics.transitions++;
+
+                auto& entry = GetEntry(resource);
+
+                if (subresource == AllSubresources && !entry.subresources.empty())
+                {
+                    // Subresources are in different states, so each moves on its own
+                    for (uint32_t i = 0; i < entry.subresources.size(); ++i)
+                    {
+                        TransitionOne(resource, i, entry.subresources[i], after);
+                    }
+                    entry.subresources.clear();
+                    entry.all = after;
+                    return;
+                }
+
+                auto const before = GetState(entry, subresource);
+                TransitionOne(resource, subresource, before, after);
+                SetState(entry, resource, subresource, after);
+            }
+
+            // Queue an aliasing barrier, for the first use of a resource placed in memory shared with others.
+            void Alias(ResourceKey resource)
+            {
+                m_pending.push_back(Barrier{ resource, AllSubresources, ResourceState::Undefined, ResourceState::Undefined, true });
+            }
+
+            // Hand the queued barriers to record(std::span<const Barrier>), normally as a single batch. A resource is
+            // only split across two batches when it is transitioned both whole and by subresource, or aliased and
+            // transitioned; different subresources of one resource share a batch.
+            template<typename TRecord>
+            void Flush(TRecord&& record)
+            {
+                size_t start = 0;
+                for (size_t i = 0; i < m_pending.size(); ++i)
+                {
+                    for (size_t j = start; j < i; ++j)
+                    {
+                        if (Overlaps(m_pending[j], m_pending[i]))
+                        {
+                            Emit(record, start, i);
+                            start = i;
+                            break;
+                        }
+                    }
+                }
+                Emit(record, start, m_pending.size());
+                m_pending.clear();
+            }
+
+            // State of a resource at this point in the list, or Undefined if the list has not used it yet.
+            ResourceState GetState(ResourceKey resource, uint32_t subresource = AllSubresources) const
+            {
+                auto const found = m_states.find(resource);
+                return found == m_states.end() ? ResourceState::Undefined : GetState(found->second, subresource);
+            }
+
+            size_t GetPendingCount() const noexcept { return m_pending.size(); }
+
+        private:
+            friend class ResourceStateTracker;
+
+            struct Entry
+            {
+                ResourceState               all = ResourceState::Undefined;     // when subresources is empty
+                std::vector<ResourceState>  subresources;
+            };
+
+            struct Requirement
+            {
+                ResourceKey     resource;
+                uint32_t        subresource;
+                ResourceState   state;
+                bool            assumed;
+            };
+
+            Entry& GetEntry(ResourceKey resource)
+            {
+                auto [found, inserted] = m_states.try_emplace(resource);
+                if (inserted)
+                {
+                    if (m_tracker->m_validation && !m_tracker->IsRegistered(resource))
+                    {
+                        m_states.erase(found);
+                        throw std::logic_error("Resource is not registered with the state tracker");
+                    }
+
+                    if (m_inherit)
+                    {
+                        m_tracker->CopyStates(resource, found->second.all, found->second.subresources);
+                    }
+                }
+                return found->second;
+            }
+
+            static ResourceState GetState(Entry const& entry, uint32_t subresource) noexcept
+            {
+                if (entry.subresources.empty())
+                    return entry.all;
+
+                if (subresource != AllSubresources)
+                    return subresource < entry.subresources.size() ? entry.subresources[subresource] : ResourceState::Undefined;
+
+                // The whole resource only has a state if every subresource agrees
+                for (auto const state : entry.subresources)
+                {
+                    if (state != entry.subresources.front())
+                        return ResourceState::Undefined;
+                }
+                return entry.subresources.front();
+            }
+
+            void SetState(Entry& entry, ResourceKey resource, uint32_t subresource, ResourceState state)
+            {
+                if (subresource == AllSubresources)
+                {
+                    entry.subresources.clear();
+                    entry.all = state;
+                    return;
+                }
+
+                if (entry.subresources.empty())
+                {
+                    entry.subresources.assign(m_tracker->GetSubresourceCount(resource), entry.all);
+                }
+
+                if (subresource >= entry.subresources.size())
+                {
+                    throw std::out_of_range("Subresource index");
+                }
+                entry.subresources[subresource] = state;
+
+                // Collapse back to a single state once every subresource agrees
+                for (auto const other : entry.subresources)
+                {
+                    if (other != state)
+                        return;
+                }
+                entry.subresources.clear();
+                entry.all = state;
+            }
+
+            void TransitionOne(ResourceKey resource, uint32_t subresource, ResourceState before, ResourceState after)
+            {
+                if (before == ResourceState::Undefined)
+                {
+                    // First use in this list: the state it is in is only known at submit
+                    m_requirements.push_back(Requirement{ resource, subresource, after, false });
+                    return;
+                }
+
+                if (before == after)
+                {
+                    m_statistics.redundant++;
+                    return;
+                }
+
+                // Fold into a transition of the same subresource that is still queued
+                for (size_t i = m_pending.size(); i-- > 0;)
+                {
+                    auto& pending = m_pending[i];
+                    if (pending.resource == resource && pending.subresource == subresource && !pending.aliasing)
+                    {
+                        m_statistics.redundant++;
+                        pending.after = after;
+                        if (pending.before == pending.after)
+                        {
+                            m_pending.erase(m_pending.begin() + static_cast<std::ptrdiff_t>(i));
+                        }
+                        return;
+                    }
+                }
+
+                m_pending.push_back(Barrier{ resource, subresource, before, after, false });
+            }
+
+            static bool Overlaps(Barrier const& a, Barrier const& b) noexcept
+            {
+                return a.resource == b.resource
+                    && (a.subresource == b.subresource || a.subresource == AllSubresources || b.subresource == AllSubresources);
+            }
+
+            template<typename TRecord>
+            void Emit(TRecord& record, size_t begin, size_t end)
+            {
+                if (begin == end)
+                    return;
+
+                record(std::span<const Barrier>(m_pending).subspan(begin, end - begin));
+                m_statistics.barriers += end - begin;
+                m_statistics.batches++;
+            }
+
+            ResourceStateTracker*                       m_tracker;
+            bool                                        m_inherit;
+            std::unordered_map<ResourceKey, Entry>      m_states;
+            std::vector<Requirement>                    m_requirements;
+            std::vector<Barrier>                        m_pending;
+            Statistics                                  m_statistics;
+        };
+
+        ResourceStateTracker() noexcept : m_validation(false) {}
+
+        ResourceStateTracker(ResourceStateTracker const&) = delete;
+        ResourceStateTracker& operator= (ResourceStateTracker const&) = delete;
+
+        // Start tracking a resource, or reset the state of one already tracked.
+        void Register(ResourceKey resource, uint32_t subresourceCount, ResourceState state)
+        {
+            if (subresourceCount == 0)
+            {
+                throw std::invalid_argument("subresourceCount");
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_resources[resource].assign(subresourceCount, state);
+        }
+
+        void Unregister(ResourceKey resource)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_resources.erase(resource);
+        }
+
+        void Clear()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_resources.clear();
+        }
+
+        bool IsRegistered(ResourceKey resource) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_resources.find(resource) != m_resources.end();
+        }
+
+        uint32_t GetSubresourceCount(ResourceKey resource) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return static_cast<uint32_t>(Find(resource).size());
+        }
+
+        // Tracked state of a resource. For the whole resource this is Undefined if its subresources disagree.
+        ResourceState GetState(ResourceKey resource, uint32_t subresource = AllSubresources) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto const& states = Find(resource);
+            if (subresource != AllSubresources)
+            {
+                return states.at(subresource);
+            }
+
+            for (auto const state : states)
+            {
+                if (state != states.front())
+                    return ResourceState::Undefined;
+            }
+            return states.front();
+        }
+
+        // Resolve a recorded list against the tracked states. Must be called for each list in submission order.
+        // Returns the barriers to execute before the list, valid until the next call.
+        std::span<const Barrier> Resolve(LocalState& local)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            // Check assumptions before changing anything, so that a failed Resolve leaves the tracked states as they were
+            if (m_validation)
+            {
+                for (auto const& requirement : local.m_requirements)
+                {
+                    if (requirement.assumed && !IsInState(Find(requirement.resource), requirement.subresource, requirement.state))
+                    {
+                        throw std::logic_error("Assumed resource state does not match the tracked state");
+                    }
+                }
+            }
+
+            m_fixups.clear();
+            for (auto const& requirement : local.m_requirements)
+            {
+                auto& states = Find(requirement.resource);
+
+                if (requirement.subresource == AllSubresources)
+                {
+                    bool uniform = true;
+                    for (auto const state : states)
+                    {
+                        uniform = uniform && state == states.front();
+                    }
+
+                    if (uniform)
+                    {
+                        AddFixup(requirement.resource, AllSubresources, states.front(), requirement.state);
+                    }
+                    else
+                    {
+                        for (uint32_t i = 0; i < states.size(); ++i)
+                        {
+                            AddFixup(requirement.resource, i, states[i], requirement.state);
+                        }
+                    }
+
+                    states.assign(states.size(), requirement.state);
+                }
+                else
+                {
+                    if (requirement.subresource >= states.size())
+                    {
+                        throw std::out_of_range("Subresource index");
+                    }
+
+                    AddFixup(requirement.resource, requirement.subresource, states[requirement.subresource], requirement.state);
+                    states[requirement.subresource] = requirement.state;
+                }
+            }
+
+            // Everything the list touched is left in the state the list last put it in
+            for (auto const& [resource, entry] : local.m_states)
+            {
+                auto& states = Find(resource);
+                if (entry.subresources.empty())
+                {
+                    if (entry.all != ResourceState::Undefined)
+                    {
+                        states.assign(states.size(), entry.all);
+                    }
+                    continue;
+                }
+
+                for (size_t i = 0; i < entry.subresources.size() && i < states.size(); ++i)
+                {
+                    if (entry.subresources[i] != ResourceState::Undefined)
+                    {
+                        states[i] = entry.subresources[i];
+                    }
+                }
+            }
+
+            auto const& statistics = local.m_statistics;
+            m_statistics.transitions += statistics.transitions;
+            m_statistics.redundant += statistics.redundant;
+            m_statistics.barriers += statistics.barriers + (m_fixups.empty() ? 0 : m_fixups.size());
+            m_statistics.batches += statistics.batches + (m_fixups.empty() ? 0 : 1);
+            m_statistics.fixups += m_fixups.size();
+            local.m_statistics = Statistics{};
+
+            return m_fixups;
+        }
+
+        void SetValidation(bool enable) noexcept { m_validation = enable; }
+        bool IsValidationEnabled() const noexcept { return m_validation; }
+
+        // Totals over every list resolved since the last reset.
+        Statistics GetStatistics() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_statistics;
+        }
+
+        void ResetStatistics()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_statistics = Statistics{};
+        }
+
+    private:
+        std::vector<ResourceState>& Find(ResourceKey resource)
+        {
+            auto found = m_resources.find(resource);
+            if (found == m_resources.end())
+            {
+                throw std::logic_error("Resource is not registered with the state tracker");
+            }
+            return found->second;
+        }
+
+        std::vector<ResourceState> const& Find(ResourceKey resource) const
+        {
+            return const_cast<ResourceStateTracker*>(this)->Find(resource);
+        }
+
+        static bool IsInState(std::vector<ResourceState> const& states, uint32_t subresource, ResourceState state) noexcept
+        {
+            if (subresource != AllSubresources)
+                return subresource < states.size() && states[subresource] == state;
+
+            for (auto const current : states)
+            {
+                if (current != state)
+                    return false;
+            }
+            return true;
+        }
+
+        void CopyStates(ResourceKey resource, ResourceState& all, std::vector<ResourceState>& subresources) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto const& states = Find(resource);
+
+            subresources.clear();
+            all = states.front();
+            for (auto const state : states)
+            {
+                if (state != all)
+                {
+                    subresources = states;
+                    return;
+                }
+            }
+        }
+
+        void AddFixup(ResourceKey resource, uint32_t subresource, ResourceState before, ResourceState after)
+        {
+            if (before != after)
+            {
+                m_fixups.push_back(Barrier{ resource, subresource, before, after, false });
+            }
+        }
+
+        mutable std::mutex                                          m_mutex;
+        std::unordered_map<ResourceKey, std::vector<ResourceState>> m_resources;
+        std::vector<Barrier>                                        m_fixups;
+        bool                                                        m_validation;
+        Statistics                                                  m_statistics;
+    };
+}
@@ -0,0 +1,47 @@
+//
+// SnapshotBuffer.h - Double-buffered state handed from simulation to rendering
+//
+
+#pragma once
+
+#include <cstdint>
+
+
+namespace DX
+{
+    // Holds two copies of T: one that the simulation writes, and one that rendering reads. The two sides never touch
+    // the same copy, so they can run concurrently as long as Publish is only called while neither is running.
+    template<typename T>
+    class SnapshotBuffer
+    {
+    public:
+        SnapshotBuffer() : m_write(0), m_generation(0) {}
+
+        SnapshotBuffer(SnapshotBuffer const&) = delete;
+        SnapshotBuffer& operator= (SnapshotBuffer const&) = delete;
+
+        // State being built by the simulation.
+        T& GetWrite() noexcept { return m_slots[m_write]; }
+
+        // State from the last Publish, for rendering.
+        T const& GetRead() const noexcept { return m_slots[m_write ^ 1]; }
+
+        // Make the written state readable, and hand the previously read copy back for writing. Nothing is copied,
+        // so the write side then holds the state from two publishes ago: the simulation must rewrite all of it before
+        // publishing again, and should not publish at all when it has nothing new (e.g. when a fixed timestep skips
+        // an update). Containers in T keep their capacity from one use of a slot to the next.
+        void Publish() noexcept
+        {
+            m_write ^= 1;
+            m_generation++;
+        }
+
+        // Number of times Publish has been called; zero means there is nothing to read yet.
+        uint64_t GetGeneration() const noexcept { return m_generation; }
+
+    private:
+        T           m_slots[2];
+        uint32_t    m_write;
+        uint64_t    m_generation;
+    };
+}
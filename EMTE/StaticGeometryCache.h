@@ -0,0 +1,122 @@
+//
+// StaticGeometryCache.h - Immutable GPU buffers for procedural geometry, keyed by the parameters that generated it
+//
+
+#pragma once
+
+#include "DebugGeometry.h"
+#include "FenceTimeline.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <unordered_map>
+#include <utility>
+
+
+namespace DX
+{
+    // Generates procedural geometry, such as a debug grid, once, and keeps it in buffers that are never written again.
+    // Each shape is looked up by the key of its parameters every frame; changing a parameter gives a new key, and so
+    // new geometry, while the old geometry is destroyed once it has gone unused for maxIdleFrames and the GPU is done
+    // with the last frame that drew it.
+    //
+    // TShape must provide:
+    //     DebugGeometryKey GetKey() const;
+    //     void Generate(DebugGeometryData& data) const;
+    //
+    // TBackend must provide:
+    //     using Geometry = ...;
+    //     Geometry Create(std::span<const DebugVertex> vertices, std::span<const uint32_t> indices);
+    //     bool IsReady(Geometry const& geometry);      // the upload has finished
+    template<typename TBackend>
+    class StaticGeometryCache
+    {
+    public:
+        using Geometry = typename TBackend::Geometry;
+
+        StaticGeometryCache(TBackend backend, FenceTimeline& timeline, uint32_t maxIdleFrames = 120) :
+            m_backend(std::move(backend)),
+            m_timeline(timeline),
+            m_maxIdleFrames(maxIdleFrames),
+            m_frame(0),
+            m_generatedCount(0),
+            m_generatedBytes(0)
+        {
+        }
+
+        StaticGeometryCache(StaticGeometryCache const&) = delete;
+        StaticGeometryCache& operator= (StaticGeometryCache const&) = delete;
+
+        // The geometry for shape, generating it the first time these parameters are seen. Returns nullptr until its
+        // buffers have been uploaded. The geometry stays alive until the GPU has finished the frame being recorded.
+        template<typename TShape>
+        Geometry const* Get(TShape const& shape)
+        {
+            auto [found, inserted] = m_entries.try_emplace(shape.GetKey());
+            auto& entry = found->second;
+            if (inserted)
+            {
+                // Don't leave an empty entry behind to be drawn next time if generating or uploading fails
+                try
+                {
+                    m_scratch.clear();
+                    shape.Generate(m_scratch);
+                    entry.geometry = m_backend.Create(m_scratch.vertices, m_scratch.indices);
+                }
+                catch (...)
+                {
+                    m_entries.erase(found);
+                    throw;
+                }
+
+                m_generatedCount++;
+                m_generatedBytes += m_scratch.GetByteSize();
+            }
+
+            entry.frame = m_frame;
+            entry.retireValue = m_timeline.GetNextValue();
+            return m_backend.IsReady(entry.geometry) ? &entry.geometry : nullptr;
+        }
+
+        // Start a frame, destroying geometry that has not been asked for recently.
+        void BeginFrame()
+        {
+            m_frame++;
+            for (auto it = m_entries.begin(); it != m_entries.end();)
+            {
+                auto const& entry = it->second;
+                const bool expired = m_frame - entry.frame > m_maxIdleFrames && m_timeline.IsComplete(entry.retireValue);
+                it = expired ? m_entries.erase(it) : std::next(it);
+            }
+        }
+
+        size_t GetCachedCount() const noexcept { return m_entries.size(); }
+
+        // Shapes generated so far, and the vertex and index bytes they produced. Drawing a cached shape produces none.
+        size_t GetGeneratedCount() const noexcept { return m_generatedCount; }
+        uint64_t GetGeneratedBytes() const noexcept { return m_generatedBytes; }
+
+        TBackend& GetBackend() noexcept { return m_backend; }
+
+    private:
+        struct Entry
+        {
+            Geometry    geometry{};
+            uint64_t    frame = 0;
+            uint64_t    retireValue = 0;
+        };
+
+        TBackend                                                            m_backend;
+        FenceTimeline&                                                      m_timeline;
+        uint32_t                                                            m_maxIdleFrames;
+        uint64_t                                                            m_frame;
+
+        std::unordered_map<DebugGeometryKey, Entry, DebugGeometryKeyHash>   m_entries;
+        DebugGeometryData                                                   m_scratch;
+
+        size_t                                                              m_generatedCount;
+        uint64_t                                                            m_generatedBytes;
+    };
+}
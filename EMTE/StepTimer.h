@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include "Clock.h"
+
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <exception>
@@ -11,33 +14,41 @@
 
 namespace DX
 {
-    // Helper class for animation and simulation timing.
+    // Helper class for animation and simulation timing. Reads the system clock unless given another, such as a
+    // ManualClock to step it deterministically.
     class StepTimer
     {
     public:
-        StepTimer() noexcept(false) :
+        explicit StepTimer(IClock* clock = nullptr) noexcept(false) :
+            m_clock(clock ? clock : &GetSystemClock()),
             m_elapsedTicks(0),
             m_totalTicks(0),
             m_leftOverTicks(0),
             m_frameCount(0),
             m_framesPerSecond(0),
             m_framesThisSecond(0),
-            m_qpcSecondCounter(0),
+            m_clockSecondCounter(0),
             m_isFixedTimeStep(false),
-            m_targetElapsedTicks(TicksPerSecond / 60)
+            m_targetElapsedTicks(TicksPerSecond / 60),
+            m_stepTicks(TicksPerSecond / 60),
+            m_maxUpdatesPerTick(0),
+            m_lastUpdateCount(0),
+            m_droppedTicks(0),
+            m_isAdaptive(false),
+            m_maxStepTicks(TicksPerSecond / 60),
+            m_overloadedTicks(0),
+            m_calmTicks(0)
         {
-            if (!QueryPerformanceFrequency(&m_qpcFrequency))
+            m_clockFrequency = m_clock->GetFrequency();
+            if (!m_clockFrequency)
             {
                 throw std::exception();
             }
 
-            if (!QueryPerformanceCounter(&m_qpcLastTime))
-            {
-                throw std::exception();
-            }
+            m_clockLastTime = m_clock->GetTicks();
 
             // Initialize max delta to 1/10 of a second.
-            m_qpcMaxDelta = static_cast<uint64_t>(m_qpcFrequency.QuadPart / 10);
+            m_clockMaxDelta = m_clockFrequency / 10;
         }
 
         // Get elapsed time since the previous Update call.
@@ -56,10 +67,56 @@ namespace DX
 
         // Set whether to use fixed or variable timestep mode.
         void SetFixedTimeStep(bool isFixedTimestep) noexcept { m_isFixedTimeStep = isFixedTimestep; }
+        bool IsFixedTimeStep() const noexcept { return m_isFixedTimeStep; }
 
         // Set how often to call Update when in fixed timestep mode.
-        void SetTargetElapsedTicks(uint64_t targetElapsed) noexcept { m_targetElapsedTicks = targetElapsed; }
-        void SetTargetElapsedSeconds(double targetElapsed) noexcept { m_targetElapsedTicks = SecondsToTicks(targetElapsed); }
+        void SetTargetElapsedTicks(uint64_t targetElapsed) noexcept
+        {
+            m_targetElapsedTicks = targetElapsed;
+            m_stepTicks = targetElapsed;
+            m_maxStepTicks = std::max(m_maxStepTicks, targetElapsed);
+            m_overloadedTicks = 0;
+            m_calmTicks = 0;
+        }
+        void SetTargetElapsedSeconds(double targetElapsed) noexcept { SetTargetElapsedTicks(SecondsToTicks(targetElapsed)); }
+
+        // Limit how many Updates one Tick may run in fixed timestep mode; 0 means no limit. Time the limit leaves
+        // unsimulated is dropped, so a frame slower than the Updates it runs cannot make the next frame slower
+        // still. The simulation then runs behind real time rather than spiralling.
+        void SetMaxUpdatesPerTick(uint32_t maxUpdates) noexcept { m_maxUpdatesPerTick = maxUpdates; }
+
+        // Let the step grow, doubling up to maxElapsedTicks, while Ticks keep hitting the Update limit, and shrink
+        // back towards the target once the measured frame and Update times show the shorter step would keep up.
+        // Has no effect without an Update limit.
+        void SetAdaptiveTimeStep(bool isAdaptive, uint64_t maxElapsedTicks) noexcept
+        {
+            m_isAdaptive = isAdaptive;
+            m_maxStepTicks = std::max(maxElapsedTicks, m_targetElapsedTicks);
+            if (!isAdaptive)
+            {
+                m_stepTicks = m_targetElapsedTicks;
+            }
+            m_overloadedTicks = 0;
+            m_calmTicks = 0;
+        }
+
+        // The step fixed timestep Updates currently advance by: the target, unless adaptation has lengthened it.
+        uint64_t GetStepTicks() const noexcept { return m_stepTicks; }
+
+        // How far real time has moved past the last Update, as a fraction of the step, for rendering between the
+        // previous and the latest simulation state. Always 1 in variable timestep mode, where the latest state is
+        // current. Just after the step shrinks, a whole step may be left over until the next Tick runs it.
+        double GetInterpolationAlpha() const noexcept
+        {
+            if (!m_isFixedTimeStep)
+                return 1.0;
+
+            return std::min(static_cast<double>(m_leftOverTicks) / static_cast<double>(m_stepTicks), 1.0);
+        }
+
+        // Updates run by the last Tick, and the time dropped by the Update limit since the start of the program.
+        uint32_t GetLastUpdateCount() const noexcept { return m_lastUpdateCount; }
+        uint64_t GetDroppedTicks() const noexcept { return m_droppedTicks; }
 
         // Integer format represents time using 10,000,000 ticks per second.
         static constexpr uint64_t TicksPerSecond = 10000000;
@@ -73,15 +130,12 @@ namespace DX
 
         void ResetElapsedTime()
         {
-            if (!QueryPerformanceCounter(&m_qpcLastTime))
-            {
-                throw std::exception();
-            }
+            m_clockLastTime = m_clock->GetTicks();
 
             m_leftOverTicks = 0;
             m_framesPerSecond = 0;
             m_framesThisSecond = 0;
-            m_qpcSecondCounter = 0;
+            m_clockSecondCounter = 0;
         }
 
         // Update timer state, calling the specified Update function the appropriate number of times.
@@ -89,27 +143,22 @@ namespace DX
         void Tick(const TUpdate& update)
         {
             // Query the current time.
-            LARGE_INTEGER currentTime;
-
-            if (!QueryPerformanceCounter(&currentTime))
-            {
-                throw std::exception();
-            }
+            const uint64_t currentTime = m_clock->GetTicks();
 
-            uint64_t timeDelta = static_cast<uint64_t>(currentTime.QuadPart - m_qpcLastTime.QuadPart);
+            uint64_t timeDelta = currentTime - m_clockLastTime;
 
-            m_qpcLastTime = currentTime;
-            m_qpcSecondCounter += timeDelta;
+            m_clockLastTime = currentTime;
+            m_clockSecondCounter += timeDelta;
 
             // Clamp excessively large time deltas (e.g. after paused in the debugger).
-            if (timeDelta > m_qpcMaxDelta)
+            if (timeDelta > m_clockMaxDelta)
             {
-                timeDelta = m_qpcMaxDelta;
+                timeDelta = m_clockMaxDelta;
             }
 
-            // Convert QPC units into a canonical tick format. This cannot overflow due to the previous clamp.
+            // Convert clock units into a canonical tick format. This cannot overflow due to the previous clamp.
             timeDelta *= TicksPerSecond;
-            timeDelta /= static_cast<uint64_t>(m_qpcFrequency.QuadPart);
+            timeDelta /= m_clockFrequency;
 
             const uint32_t lastFrameCount = m_frameCount;
 
@@ -124,22 +173,45 @@ namespace DX
                 // accumulate enough tiny errors that it would drop a frame. It is better to just round
                 // small deviations down to zero to leave things running smoothly.
 
-                if (static_cast<uint64_t>(std::abs(static_cast<int64_t>(timeDelta - m_targetElapsedTicks))) < TicksPerSecond / 4000)
+                if (static_cast<uint64_t>(std::abs(static_cast<int64_t>(timeDelta - m_stepTicks))) < TicksPerSecond / 4000)
                 {
-                    timeDelta = m_targetElapsedTicks;
+                    timeDelta = m_stepTicks;
                 }
 
                 m_leftOverTicks += timeDelta;
 
-                while (m_leftOverTicks >= m_targetElapsedTicks)
+                const bool isMeasuring = m_isAdaptive && m_maxUpdatesPerTick;
+                const uint64_t updateStart = isMeasuring ? m_clock->GetTicks() : 0;
+
+                uint32_t updateCount = 0;
+                bool isCapped = false;
+                while (m_leftOverTicks >= m_stepTicks)
                 {
-                    m_elapsedTicks = m_targetElapsedTicks;
-                    m_totalTicks += m_targetElapsedTicks;
-                    m_leftOverTicks -= m_targetElapsedTicks;
+                    if (m_maxUpdatesPerTick && updateCount == m_maxUpdatesPerTick)
+                    {
+                        // Keep the partial step, so that the interpolation alpha stays continuous
+                        const uint64_t dropped = m_leftOverTicks - m_leftOverTicks % m_stepTicks;
+                        m_droppedTicks += dropped;
+                        m_leftOverTicks -= dropped;
+                        isCapped = true;
+                        break;
+                    }
+
+                    m_elapsedTicks = m_stepTicks;
+                    m_totalTicks += m_stepTicks;
+                    m_leftOverTicks -= m_stepTicks;
                     m_frameCount++;
+                    updateCount++;
 
                     update();
                 }
+                m_lastUpdateCount = updateCount;
+
+                if (isMeasuring)
+                {
+                    const uint64_t updateTicks = (m_clock->GetTicks() - updateStart) * TicksPerSecond / m_clockFrequency;
+                    AdaptStep(isCapped, timeDelta, updateTicks);
+                }
             }
             else
             {
@@ -148,6 +220,7 @@ namespace DX
                 m_totalTicks += timeDelta;
                 m_leftOverTicks = 0;
                 m_frameCount++;
+                m_lastUpdateCount = 1;
 
                 update();
             }
@@ -158,19 +231,58 @@ namespace DX
                 m_framesThisSecond++;
             }
 
-            if (m_qpcSecondCounter >= static_cast<uint64_t>(m_qpcFrequency.QuadPart))
+            if (m_clockSecondCounter >= m_clockFrequency)
             {
                 m_framesPerSecond = m_framesThisSecond;
                 m_framesThisSecond = 0;
-                m_qpcSecondCounter %= static_cast<uint64_t>(m_qpcFrequency.QuadPart);
+                m_clockSecondCounter %= m_clockFrequency;
             }
         }
 
     private:
-        // Source timing data uses QPC units.
-        LARGE_INTEGER m_qpcFrequency;
-        LARGE_INTEGER m_qpcLastTime;
-        uint64_t m_qpcMaxDelta;
+        // Consecutive capped Ticks before the step doubles, and calm Ticks before it halves again.
+        static constexpr uint32_t OverloadTicks = 8;
+        static constexpr uint32_t RecoveryTicks = 120;
+
+        void AdaptStep(bool isCapped, uint64_t frameTicks, uint64_t updateTicks) noexcept
+        {
+            if (isCapped)
+            {
+                m_calmTicks = 0;
+                if (++m_overloadedTicks >= OverloadTicks && m_stepTicks < m_maxStepTicks)
+                {
+                    m_stepTicks = std::min(m_stepTicks * 2, m_maxStepTicks);
+                    m_overloadedTicks = 0;
+                }
+                return;
+            }
+            m_overloadedTicks = 0;
+
+            if (m_stepTicks == m_targetElapsedTicks)
+                return;
+
+            // Halving the step doubles the Updates per frame. The frame is calm if, paying for them, it would still
+            // use at most half the Update limit at the shorter step.
+            const uint64_t shorterStep = std::max(m_stepTicks / 2, m_targetElapsedTicks);
+            const uint64_t projectedTicks = frameTicks + updateTicks;
+            if (projectedTicks * 2 > shorterStep * m_maxUpdatesPerTick)
+            {
+                m_calmTicks = 0;
+                return;
+            }
+
+            if (++m_calmTicks >= RecoveryTicks)
+            {
+                m_stepTicks = shorterStep;
+                m_calmTicks = 0;
+            }
+        }
+
+        // Source timing data uses the clock's units.
+        IClock* m_clock;
+        uint64_t m_clockFrequency;
+        uint64_t m_clockLastTime;
+        uint64_t m_clockMaxDelta;
 
         // Derived timing data uses a canonical tick format.
         uint64_t m_elapsedTicks;
@@ -181,10 +293,20 @@ namespace DX
         uint32_t m_frameCount;
         uint32_t m_framesPerSecond;
         uint32_t m_framesThisSecond;
-        uint64_t m_qpcSecondCounter;
+        uint64_t m_clockSecondCounter;
 
         // Members for configuring fixed timestep mode.
         bool m_isFixedTimeStep;
         uint64_t m_targetElapsedTicks;
+        uint64_t m_stepTicks;
+
+        // Members for bounding catch-up Updates, and adapting the step under sustained overload.
+        uint32_t m_maxUpdatesPerTick;
+        uint32_t m_lastUpdateCount;
+        uint64_t m_droppedTicks;
+        bool m_isAdaptive;
+        uint64_t m_maxStepTicks;
+        uint32_t m_overloadedTicks;
+        uint32_t m_calmTicks;
     };
 }
@@ -0,0 +1,259 @@
+//
+// TaskGraph.h - A dependency graph of named tasks executed on a JobSystem
+//
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // A set of tasks and the order they must run in. The graph is built once and executed as many times as needed;
+    // independent tasks run in parallel, and the time each one took is kept from the last execution.
+    class TaskGraph
+    {
+    public:
+        using NodeId = size_t;
+
+        struct Timing
+        {
+            const char* name;
+            double      startSeconds;       // relative to the start of Execute
+            double      durationSeconds;
+            size_t      thread;             // JobSystem thread index that ran it; 0 for non-workers, which the
+                                            // caller of Execute is not when Execute itself runs as a job
+        };
+
+        TaskGraph() noexcept : m_validated(false), m_remaining(0) {}
+
+        TaskGraph(TaskGraph const&) = delete;
+        TaskGraph& operator= (TaskGraph const&) = delete;
+
+        // Add a task. Tasks marked mainThread only run on the thread that calls Execute.
+        NodeId AddNode(const char* name, std::function<void()> task, bool mainThread = false)
+        {
+            auto node = std::make_unique<Node>();
+            node->name = name;
+            node->task = std::move(task);
+            node->mainThread = mainThread;
+            m_nodes.emplace_back(std::move(node));
+            m_timings.push_back(Timing{ name, 0.0, 0.0, 0 });
+            m_validated = false;
+            return m_nodes.size() - 1;
+        }
+
+        // Require before to finish before after starts.
+        void AddDependency(NodeId before, NodeId after)
+        {
+            if (before >= m_nodes.size() || after >= m_nodes.size() || before == after)
+            {
+                throw std::out_of_range("AddDependency");
+            }
+
+            m_nodes[before]->successors.push_back(after);
+            m_nodes[after]->dependencyCount++;
+            m_validated = false;
+        }
+
+        void Clear() noexcept
+        {
+            m_nodes.clear();
+            m_timings.clear();
+            m_validated = false;
+        }
+
+        size_t GetNodeCount() const noexcept { return m_nodes.size(); }
+
+        // Run every task, respecting dependencies, and return once all have finished.
+        void Execute(JobSystem& jobs)
+        {
+            if (m_nodes.empty())
+                return;
+
+            if (!m_validated)
+            {
+                Validate();
+            }
+
+            for (auto& node : m_nodes)
+            {
+                node->remaining.store(node->dependencyCount, std::memory_order_relaxed);
+            }
+            m_remaining.store(m_nodes.size(), std::memory_order_relaxed);
+            m_start = std::chrono::steady_clock::now();
+
+            JobSystem::Counter counter;
+            for (NodeId id = 0; id < m_nodes.size(); ++id)
+            {
+                if (m_nodes[id]->dependencyCount == 0)
+                {
+                    Schedule(jobs, counter, id);
+                }
+            }
+
+            // Run main thread tasks as they become ready, and help with everything else in between.
+            while (m_remaining.load(std::memory_order_acquire) > 0)
+            {
+                NodeId id = 0;
+                bool haveMainTask = false;
+                {
+                    std::lock_guard<std::mutex> lock(m_mainMutex);
+                    if (!m_mainReady.empty())
+                    {
+                        id = m_mainReady.back();
+                        m_mainReady.pop_back();
+                        haveMainTask = true;
+                    }
+                }
+
+                if (haveMainTask)
+                {
+                    RunNode(jobs, counter, id);
+                }
+                else if (!jobs.TryRunPending())
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            jobs.Wait(counter);
+
+            if (m_error)
+            {
+                std::rethrow_exception(std::exchange(m_error, nullptr));
+            }
+        }
+
+        // Per-task timings from the last call to Execute, in the order tasks were added.
+        std::span<const Timing> GetTimings() const noexcept { return m_timings; }
+
+    private:
+        struct Node
+        {
+            const char*             name = nullptr;
+            std::function<void()>   task;
+            bool                    mainThread = false;
+            std::vector<NodeId>     successors;
+            uint32_t                dependencyCount = 0;
+            std::atomic<uint32_t>   remaining{ 0 };
+        };
+
+        // Reject cycles up front, as they would otherwise make Execute spin forever.
+        void Validate()
+        {
+            std::vector<uint32_t> pending(m_nodes.size());
+            std::vector<NodeId> ready;
+            for (NodeId id = 0; id < m_nodes.size(); ++id)
+            {
+                pending[id] = m_nodes[id]->dependencyCount;
+                if (pending[id] == 0)
+                {
+                    ready.push_back(id);
+                }
+            }
+
+            size_t visited = 0;
+            while (!ready.empty())
+            {
+                const NodeId id = ready.back();
+                ready.pop_back();
+                visited++;
+
+                for (auto const successor : m_nodes[id]->successors)
+                {
+                    if (--pending[successor] == 0)
+                    {
+                        ready.push_back(successor);
+                    }
+                }
+            }
+
+            if (visited != m_nodes.size())
+            {
+                throw std::logic_error("TaskGraph contains a cycle");
+            }
+
+            m_validated = true;
+        }
+
+        void Schedule(JobSystem& jobs, JobSystem::Counter& counter, NodeId id)
+        {
+            if (m_nodes[id]->mainThread)
+            {
+                std::lock_guard<std::mutex> lock(m_mainMutex);
+                m_mainReady.push_back(id);
+            }
+            else
+            {
+                jobs.Run([this, &jobs, &counter, id]() { RunNode(jobs, counter, id); }, &counter);
+            }
+        }
+
+        void RunNode(JobSystem& jobs, JobSystem::Counter& counter, NodeId id)
+        {
+            auto& node = *m_nodes[id];
+
+            // A failing task still releases its successors, so that Execute can finish and report the error.
+            auto const start = std::chrono::steady_clock::now();
+            try
+            {
+                node.task();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m_mainMutex);
+                if (!m_error)
+                {
+                    m_error = std::current_exception();
+                }
+            }
+            Finish(jobs, counter, id, start);
+        }
+
+        void Finish(JobSystem& jobs, JobSystem::Counter& counter, NodeId id, std::chrono::steady_clock::time_point start)
+        {
+            auto const end = std::chrono::steady_clock::now();
+
+            auto& timing = m_timings[id];
+            timing.startSeconds = std::chrono::duration<double>(start - m_start).count();
+            timing.durationSeconds = std::chrono::duration<double>(end - start).count();
+            timing.thread = jobs.GetCurrentThreadIndex();
+
+            for (auto const successor : m_nodes[id]->successors)
+            {
+                if (m_nodes[successor]->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    Schedule(jobs, counter, successor);
+                }
+            }
+
+            m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+        }
+
+        std::vector<std::unique_ptr<Node>>      m_nodes;
+        std::vector<Timing>                     m_timings;
+        bool                                    m_validated;
+
+        // Execution state.
+        std::atomic<size_t>                     m_remaining;
+        std::chrono::steady_clock::time_point   m_start;
+        std::mutex                              m_mainMutex;
+        std::vector<NodeId>                     m_mainReady;
+        std::exception_ptr                      m_error;
+    };
+}
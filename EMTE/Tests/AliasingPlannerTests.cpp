@@ -0,0 +1,220 @@
+//
+// AliasingPlannerTests.cpp - Checks that transients alive at the same time never share memory, and others do
+//
+
+#include "TestHarness.h"
+
+#include "AliasingPlanner.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    using Request = DX::AliasingPlanner::Request;
+    using Plan = DX::AliasingPlanner::Plan;
+
+    bool LifetimesOverlap(Request const& a, Request const& b) noexcept
+    {
+        return a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+    }
+
+    // Every request is aligned and inside the heap, and no two that are alive together overlap in memory.
+    void CheckPlan(std::vector<Request> const& requests, Plan const& plan)
+    {
+        DX_CHECK_EQUAL(plan.offsets.size(), requests.size());
+        for (size_t i = 0; i < requests.size(); ++i)
+        {
+            DX_CHECK_EQUAL(plan.offsets[i] % requests[i].alignment, uint64_t(0));
+            DX_CHECK(plan.offsets[i] + requests[i].size <= plan.heapSize);
+
+            for (size_t j = i + 1; j < requests.size(); ++j)
+            {
+                if (!LifetimesOverlap(requests[i], requests[j]))
+                    continue;
+
+                const bool disjoint = plan.offsets[i] + requests[i].size <= plan.offsets[j]
+                    || plan.offsets[j] + requests[j].size <= plan.offsets[i];
+                DX_CHECK(disjoint);
+            }
+        }
+        DX_CHECK_EQUAL(plan.GetSavedBytes(), (plan.heapSize < plan.unaliasedSize) ? plan.unaliasedSize - plan.heapSize : 0);
+    }
+
+    // The most bytes alive in any one pass: no plan can use a smaller heap.
+    uint64_t PeakLiveBytes(std::vector<Request> const& requests)
+    {
+        uint64_t peak = 0;
+        for (uint32_t pass = 0;; ++pass)
+        {
+            uint64_t live = 0;
+            bool later = false;
+            for (auto const& request : requests)
+            {
+                live += (request.firstUse <= pass && pass <= request.lastUse) ? request.size : 0;
+                later = later || pass < request.lastUse;
+            }
+            peak = std::max(peak, live);
+            if (!later)
+                return peak;
+        }
+    }
+}
+
+DX_TEST(AliasingPlanner, DisjointLifetimesShareMemory)
+{
+    const std::vector<Request> requests = {
+        { 4096, 256, 0, 1 },
+        { 4096, 256, 2, 3 },
+        { 4096, 256, 4, 5 },
+    };
+    auto const plan = DX::AliasingPlanner::Build(requests);
+
+    CheckPlan(requests, plan);
+    DX_CHECK_EQUAL(plan.offsets[0], uint64_t(0));
+    DX_CHECK_EQUAL(plan.offsets[1], uint64_t(0));
+    DX_CHECK_EQUAL(plan.offsets[2], uint64_t(0));
+    DX_CHECK_EQUAL(plan.heapSize, uint64_t(4096));
+    DX_CHECK_EQUAL(plan.GetSavedBytes(), uint64_t(8192));
+}
+
+DX_TEST(AliasingPlanner, FramePacksToItsPeak)
+{
+    // A deferred frame at 1080p, sizes rounded to 64 KB placements: shadows (0), G-buffer (1), decals (2),
+    // lighting (3), bloom down (4) and blur (5), tone map (6), UI (7)
+    constexpr uint64_t MB = 1024 * 1024;
+    const std::vector<Request> requests = {
+        { 16 * MB, 65536, 0, 3 },   // shadow map
+        { 8 * MB, 65536, 1, 3 },    // albedo
+        { 16 * MB, 65536, 1, 3 },   // normals
+        { 8 * MB, 65536, 1, 5 },    // depth
+        { 16 * MB, 65536, 3, 6 },   // HDR color
+        { 4 * MB, 65536, 4, 5 },    // bloom, half size
+        { 1 * MB, 65536, 5, 6 },    // bloom, quarter size
+        { 8 * MB, 65536, 6, 7 },    // tone mapped color
+    };
+    auto const plan = DX::AliasingPlanner::Build(requests);
+    CheckPlan(requests, plan);
+
+    uint64_t sum = 0;
+    for (auto const& request : requests)
+    {
+        sum += request.size;
+    }
+    DX_CHECK_EQUAL(plan.unaliasedSize, sum);
+    DX_CHECK_EQUAL(sum, 77 * MB);
+
+    // Lighting has the most alive at once; the aliased heap holds exactly that and nothing more
+    DX_CHECK_EQUAL(PeakLiveBytes(requests), 64 * MB);
+    DX_CHECK_EQUAL(plan.heapSize, PeakLiveBytes(requests));
+    DX_CHECK_EQUAL(plan.GetSavedBytes(), 13 * MB);
+
+    // Each post-processing target reuses memory the shadow map or G-buffer is done with
+    for (size_t post = 5; post < requests.size(); ++post)
+    {
+        bool shared = false;
+        for (size_t earlier = 0; earlier < 3; ++earlier)
+        {
+            shared = shared || (plan.offsets[post] < plan.offsets[earlier] + requests[earlier].size
+                && plan.offsets[earlier] < plan.offsets[post] + requests[post].size);
+        }
+        DX_CHECK(shared);
+    }
+}
+
+DX_TEST(AliasingPlanner, OverlappingLifetimesDoNotShareMemory)
+{
+    // Lifetimes are inclusive: a resource last used in pass 2 is still alive when another is first used in pass 2
+    const std::vector<Request> requests = {
+        { 4096, 256, 0, 2 },
+        { 4096, 256, 2, 4 },
+        { 1024, 256, 1, 3 },
+    };
+    auto const plan = DX::AliasingPlanner::Build(requests);
+
+    CheckPlan(requests, plan);
+    DX_CHECK_EQUAL(plan.heapSize, uint64_t(8192 + 1024));
+    DX_CHECK_EQUAL(plan.GetSavedBytes(), uint64_t(0));
+}
+
+DX_TEST(AliasingPlanner, SmallResourcesFillGapsLeftByLargeOnes)
+{
+    // The two small resources are alive at different times, so both fit beside the large one in the same space
+    const std::vector<Request> requests = {
+        { 1024, 256, 0, 0 },
+        { 8192, 256, 0, 3 },
+        { 1024, 256, 3, 3 },
+    };
+    auto const plan = DX::AliasingPlanner::Build(requests);
+
+    CheckPlan(requests, plan);
+    DX_CHECK_EQUAL(plan.offsets[1], uint64_t(0));
+    DX_CHECK_EQUAL(plan.offsets[0], uint64_t(8192));
+    DX_CHECK_EQUAL(plan.offsets[2], uint64_t(8192));
+    DX_CHECK_EQUAL(plan.heapSize, uint64_t(9216));
+}
+
+DX_TEST(AliasingPlanner, OffsetsRespectAlignment)
+{
+    const std::vector<Request> requests = {
+        { 100, 64, 0, 1 },
+        { 4096, 65536, 0, 1 },
+        { 300, 256, 1, 2 },
+    };
+    auto const plan = DX::AliasingPlanner::Build(requests);
+
+    CheckPlan(requests, plan);
+    DX_CHECK_EQUAL(plan.offsets[1], uint64_t(0));
+    DX_CHECK_EQUAL(plan.unaliasedSize, uint64_t(128 + 65536 + 512));
+}
+
+DX_TEST(AliasingPlanner, PaddingNeverReportsNegativeSavings)
+{
+    // Packed back to back, the first two push the third past a 64 KB boundary it would not cross on its own
+    const std::vector<Request> requests = {
+        { 65537, 1, 0, 0 },
+        { 65537, 1, 0, 0 },
+        { 10, 65536, 0, 0 },
+    };
+    auto const plan = DX::AliasingPlanner::Build(requests);
+
+    CheckPlan(requests, plan);
+    DX_CHECK(plan.heapSize > plan.unaliasedSize);
+    DX_CHECK_EQUAL(plan.GetSavedBytes(), uint64_t(0));
+}
+
+DX_TEST(AliasingPlanner, InvalidRequestsThrow)
+{
+    const std::vector<Request> backwards = { { 1024, 256, 3, 2 } };
+    DX_CHECK_THROWS(DX::AliasingPlanner::Build(backwards), std::invalid_argument);
+
+    const std::vector<Request> unaligned = { { 1024, 0, 0, 0 } };
+    DX_CHECK_THROWS(DX::AliasingPlanner::Build(unaligned), std::invalid_argument);
+
+    const std::vector<Request> notPowerOfTwo = { { 1024, 96, 0, 0 } };
+    DX_CHECK_THROWS(DX::AliasingPlanner::Build(notPowerOfTwo), std::invalid_argument);
+
+    DX_CHECK_EQUAL(DX::AliasingPlanner::Build({}).heapSize, uint64_t(0));
+}
+
+DX_TEST(AliasingPlanner, RandomFrameGraphsNeverOverlap)
+{
+    std::mt19937 random(1234);
+    for (int graph = 0; graph < 500; ++graph)
+    {
+        std::vector<Request> requests(1 + random() % 24);
+        for (auto& request : requests)
+        {
+            request.size = 1 + random() % (1 << 20);
+            request.alignment = uint64_t(1) << (random() % 17);
+            request.firstUse = random() % 16;
+            request.lastUse = request.firstUse + random() % 6;
+        }
+
+        CheckPlan(requests, DX::AliasingPlanner::Build(requests));
+    }
+}
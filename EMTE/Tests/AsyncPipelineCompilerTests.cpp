@@ -0,0 +1,326 @@
+//
+// AsyncPipelineCompilerTests.cpp - The request state machine against a fake compiler with programmable latency:
+// fallback chains, failures, promotion between frames, Flush and destruction with compiles in flight
+//
+
+#include "TestHarness.h"
+
+#include "AsyncPipelineCompiler.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    using namespace std::chrono_literals;
+
+    // What the fake compiler has been asked to do, shared by every copy of it.
+    struct CompilerLog
+    {
+        std::mutex                  mutex;
+        std::condition_variable     released;
+        std::set<uint32_t>          open;           // gated compiles allowed to finish
+        std::atomic<uint32_t>       started{ 0 };
+        std::atomic<uint32_t>       finished{ 0 };
+        std::atomic<uint32_t>       running{ 0 };
+
+        // Let the gated compile of id finish.
+        void Release(uint32_t id)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                open.insert(id);
+            }
+            released.notify_all();
+        }
+    };
+
+    // Takes latency to compile each description, or until the test releases it if gated, and throws if told to.
+    struct FakeCompiler
+    {
+        struct Description
+        {
+            uint32_t                    id;
+            std::chrono::microseconds   latency;
+            bool                        gated;
+            bool                        fails;
+        };
+
+        struct Pipeline
+        {
+            uint32_t    id;
+        };
+
+        Pipeline Compile(Description const& description)
+        {
+            log->started++;
+            log->running++;
+            std::this_thread::sleep_for(description.latency);
+            if (description.gated)
+            {
+                std::unique_lock<std::mutex> lock(log->mutex);
+                log->released.wait(lock, [&]() { return log->open.count(description.id) != 0; });
+            }
+            log->running--;
+            log->finished++;
+
+            if (description.fails)
+                throw std::runtime_error("Compile failed");
+            return Pipeline{ description.id };
+        }
+
+        std::shared_ptr<CompilerLog> log;
+    };
+
+    using Compiler = DX::AsyncPipelineCompiler<FakeCompiler>;
+
+    FakeCompiler::Description Immediate(uint32_t id) { return { id, 0us, false, false }; }
+    FakeCompiler::Description Gated(uint32_t id) { return { id, 0us, true, false }; }
+    FakeCompiler::Description Failing(uint32_t id) { return { id, 0us, false, true }; }
+
+    // Poll until handle leaves Compiling, as a frame loop would.
+    void WaitUntilCompiled(Compiler const& compiler, Compiler::Handle handle)
+    {
+        auto const timeout = std::chrono::steady_clock::now() + 5s;
+        while (compiler.GetState(handle) == Compiler::State::Compiling && std::chrono::steady_clock::now() < timeout)
+        {
+            std::this_thread::sleep_for(100us);
+        }
+        DX_CHECK(compiler.GetState(handle) != Compiler::State::Compiling);
+    }
+
+    uint32_t ResolvedId(Compiler& compiler, Compiler::Handle handle)
+    {
+        auto const pipeline = compiler.Resolve(handle);
+        return pipeline ? pipeline->id : UINT32_MAX;
+    }
+
+    std::vector<Compiler::Handle> ToVector(std::span<const Compiler::Handle> handles)
+    {
+        return std::vector<Compiler::Handle>(handles.begin(), handles.end());
+    }
+}
+
+DX_TEST(AsyncPipelineCompiler, CompiledPipelinesWaitForUpdate)
+{
+    DX::JobSystem jobs(2);
+    auto log = std::make_shared<CompilerLog>();
+    Compiler compiler(FakeCompiler{ log }, jobs);
+
+    const auto handle = compiler.Request(Gated(7));
+    DX_CHECK_EQUAL(handle, Compiler::Handle(0));
+    DX_CHECK(compiler.GetState(handle) == Compiler::State::Compiling);
+    DX_CHECK(compiler.Update().empty());
+    DX_CHECK(compiler.Resolve(handle) == nullptr);
+    DX_CHECK_EQUAL(compiler.GetPendingCount(), size_t(1));
+
+    // Compiled, but still not drawn with until the next Update
+    log->Release(7);
+    WaitUntilCompiled(compiler, handle);
+    DX_CHECK(compiler.GetState(handle) == Compiler::State::Compiled);
+    DX_CHECK(compiler.Resolve(handle) == nullptr);
+    DX_CHECK(!compiler.IsReady(handle));
+
+    DX_CHECK(ToVector(compiler.Update()) == std::vector<Compiler::Handle>{ handle });
+    DX_CHECK(compiler.IsReady(handle));
+    DX_CHECK_EQUAL(ResolvedId(compiler, handle), uint32_t(7));
+    DX_CHECK_EQUAL(compiler.GetPendingCount(), size_t(0));
+
+    // Reported once only
+    DX_CHECK(compiler.Update().empty());
+    DX_CHECK_THROWS(compiler.GetState(1), std::out_of_range);
+}
+
+DX_TEST(AsyncPipelineCompiler, FallbackChainsResolveToTheNearestReady)
+{
+    DX::JobSystem jobs(2);
+    auto log = std::make_shared<CompilerLog>();
+    Compiler compiler(FakeCompiler{ log }, jobs);
+
+    // basic <- lit <- skinned, each the one before's fallback
+    const auto basic = compiler.Request(Gated(1));
+    const auto lit = compiler.Request(Gated(2), basic);
+    const auto skinned = compiler.Request(Gated(3), lit);
+    DX_CHECK_THROWS(compiler.Request(Immediate(4), 9), std::invalid_argument);
+    DX_CHECK_EQUAL(compiler.GetRequestCount(), size_t(3));
+
+    // Nothing Ready yet: the draw is skipped
+    DX_CHECK(compiler.Resolve(skinned) == nullptr);
+
+    log->Release(1);
+    WaitUntilCompiled(compiler, basic);
+    compiler.Update();
+    DX_CHECK_EQUAL(ResolvedId(compiler, skinned), uint32_t(1));
+    DX_CHECK_EQUAL(ResolvedId(compiler, lit), uint32_t(1));
+
+    // The leaf can be ready before the middle of its chain
+    log->Release(3);
+    WaitUntilCompiled(compiler, skinned);
+    compiler.Update();
+    DX_CHECK_EQUAL(ResolvedId(compiler, skinned), uint32_t(3));
+    DX_CHECK_EQUAL(ResolvedId(compiler, lit), uint32_t(1));
+
+    log->Release(2);
+    WaitUntilCompiled(compiler, lit);
+    DX_CHECK(ToVector(compiler.Update()) == std::vector<Compiler::Handle>{ lit });
+    DX_CHECK_EQUAL(ResolvedId(compiler, lit), uint32_t(2));
+    DX_CHECK_EQUAL(ResolvedId(compiler, basic), uint32_t(1));
+}
+
+DX_TEST(AsyncPipelineCompiler, FailedRequestsFallBackForGood)
+{
+    DX::JobSystem jobs(2);
+    auto log = std::make_shared<CompilerLog>();
+    Compiler compiler(FakeCompiler{ log }, jobs);
+
+    const auto basic = compiler.Request(Immediate(1));
+    const auto broken = compiler.Request(Failing(2), basic);
+    const auto brokenRoot = compiler.Request(Failing(3));
+    const auto onBroken = compiler.Request(Gated(4), broken);
+    WaitUntilCompiled(compiler, basic);
+    WaitUntilCompiled(compiler, broken);
+    WaitUntilCompiled(compiler, brokenRoot);
+
+    // Failures are reported by Update like successes, in request order
+    DX_CHECK(ToVector(compiler.Update()) == (std::vector<Compiler::Handle>{ basic, broken, brokenRoot }));
+    DX_CHECK(compiler.GetState(broken) == Compiler::State::Failed);
+    DX_CHECK(compiler.GetState(brokenRoot) == Compiler::State::Failed);
+
+    // A failed pipeline resolves to its fallback, and a chain passes through it
+    DX_CHECK_EQUAL(ResolvedId(compiler, broken), uint32_t(1));
+    DX_CHECK_EQUAL(ResolvedId(compiler, onBroken), uint32_t(1));
+    DX_CHECK(compiler.Resolve(brokenRoot) == nullptr);
+
+    log->Release(4);
+    compiler.Flush();
+    DX_CHECK_EQUAL(ResolvedId(compiler, onBroken), uint32_t(4));
+    DX_CHECK(compiler.GetState(broken) == Compiler::State::Failed);
+    DX_CHECK_EQUAL(ResolvedId(compiler, broken), uint32_t(1));
+    DX_CHECK_EQUAL(log->finished.load(), uint32_t(4));
+}
+
+DX_TEST(AsyncPipelineCompiler, DrawsResolveTheSameWayBetweenUpdates)
+{
+    DX::JobSystem jobs(3);
+    auto log = std::make_shared<CompilerLog>();
+    Compiler compiler(FakeCompiler{ log }, jobs);
+
+    // A fallback everything can draw with, then requests finishing at random while frames are recorded
+    const auto basic = compiler.Request(Immediate(0));
+    compiler.Flush();
+
+    std::mt19937 random(19);
+    constexpr uint32_t count = 40;
+    for (uint32_t id = 1; id <= count; ++id)
+    {
+        const bool fails = random() % 8 == 0;
+        compiler.Request(FakeCompiler::Description{ id, std::chrono::microseconds(random() % 3000), false, fails },
+            (id > 1 && random() % 2) ? id - 1 : basic);
+    }
+
+    std::vector<uint32_t> reported(count + 1, 0);
+    bool ordered = true;
+    bool consistent = true;
+    for (int frame = 0; frame < 2000 && compiler.GetPendingCount(); ++frame)
+    {
+        auto const finished = compiler.Update();
+        for (size_t i = 0; i < finished.size(); ++i)
+        {
+            reported[finished[i]]++;
+            ordered &= i == 0 || finished[i - 1] < finished[i];
+        }
+
+        // Several passes over the frame's draws while workers finish more: all see what Update made Ready
+        std::vector<uint32_t> first;
+        for (int pass = 0; pass < 4; ++pass)
+        {
+            std::vector<uint32_t> resolved;
+            for (Compiler::Handle handle = 0; handle <= count; ++handle)
+            {
+                resolved.push_back(ResolvedId(compiler, handle));
+            }
+            consistent &= pass == 0 || resolved == first;
+            first = std::move(resolved);
+            std::this_thread::sleep_for(200us);
+        }
+    }
+
+    DX_CHECK_EQUAL(compiler.GetPendingCount(), size_t(0));
+    DX_CHECK(ordered);
+    DX_CHECK(consistent);
+    DX_CHECK(std::all_of(reported.begin() + 1, reported.end(), [](uint32_t r) { return r == 1; }));
+}
+
+DX_TEST(AsyncPipelineCompiler, FlushFinishesEveryRequest)
+{
+    DX::JobSystem jobs(2);
+    auto log = std::make_shared<CompilerLog>();
+    Compiler compiler(FakeCompiler{ log }, jobs);
+
+    constexpr uint32_t count = 24;
+    for (uint32_t id = 0; id < count; ++id)
+    {
+        compiler.Request(FakeCompiler::Description{ id, 2ms, false, id % 5 == 4 });
+    }
+    compiler.Flush();
+
+    DX_CHECK_EQUAL(compiler.GetPendingCount(), size_t(0));
+    DX_CHECK_EQUAL(log->finished.load(), count);
+    bool settled = true;
+    for (uint32_t id = 0; id < count; ++id)
+    {
+        settled &= compiler.GetState(id) == (id % 5 == 4 ? Compiler::State::Failed : Compiler::State::Ready);
+    }
+    DX_CHECK(settled);
+
+    // Every compile's time is counted, whichever thread ran it
+    DX_CHECK(compiler.GetCompileSeconds() >= 0.9 * count * 0.002);
+
+    // With nothing pending, Flush returns at once
+    compiler.Flush();
+}
+
+DX_TEST(AsyncPipelineCompiler, DestructionWaitsForCompilesInFlight)
+{
+    DX::JobSystem jobs(2);
+    auto log = std::make_shared<CompilerLog>();
+    std::thread releaser;
+    {
+        Compiler compiler(FakeCompiler{ log }, jobs);
+        for (uint32_t id = 0; id < 8; ++id)
+        {
+            compiler.Request(FakeCompiler::Description{ id, 5ms, false, false });
+        }
+        compiler.Request(Gated(100));
+
+        // The gated compile is only let go once destruction has begun
+        releaser = std::thread([log]()
+            {
+                std::this_thread::sleep_for(30ms);
+                log->Release(100);
+            });
+    }
+
+    // Nothing is left running against the destroyed entries
+    DX_CHECK_EQUAL(log->finished.load(), uint32_t(9));
+    DX_CHECK_EQUAL(log->running.load(), uint32_t(0));
+    releaser.join();
+
+    // Nor is any job left queued that would touch them later
+    DX_CHECK(!jobs.TryRunPending());
+    DX_CHECK_EQUAL(log->started.load(), uint32_t(9));
+}
@@ -0,0 +1,231 @@
+//
+// AsyncTextureLoaderBenchmark.cpp - Startup time over a corpus of texture files, loaded one after another as
+// LoadTextures did, and through the loader on worker threads
+//
+
+#include "TestHarness.h"
+
+#include "AsyncTextureLoader.h"
+#include "FenceTimeline.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    constexpr uint32_t c_fileCount = 300;
+
+    // A copy queue that finishes each batch as it is submitted.
+    class ImmediateCopyQueue final : public DX::IFenceBackend
+    {
+    public:
+        bool Signal(uint64_t value) noexcept override { m_completed = value; return true; }
+        uint64_t GetCompletedValue() noexcept override { return m_completed; }
+        bool Wait(uint64_t, uint32_t) noexcept override { return true; }
+
+    private:
+        uint64_t    m_completed = 0;
+    };
+
+    // Two kinds of file stand in for the corpus. ".dds" holds a 128-byte header then raw RGBA, read and copied as
+    // DDSTextureLoader does. ".jpg" holds the same pixels delta coded per row and run-length coded, which has to be
+    // decoded pixel by pixel as WIC does; it is cheaper than JPEG, so this understates what decoding costs.
+    std::vector<uint8_t> MakePixels(uint32_t width, uint32_t height, uint32_t seed)
+    {
+        std::vector<uint8_t> pixels(size_t(width) * height * 4);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                uint8_t* pixel = &pixels[(size_t(y) * width + x) * 4];
+                pixel[0] = static_cast<uint8_t>((x / 8 + seed) * 17);
+                pixel[1] = static_cast<uint8_t>((y / 8 + seed) * 29);
+                pixel[2] = static_cast<uint8_t>(((x ^ y) & 16) ? seed : 255 - seed);
+                pixel[3] = 255;
+            }
+        }
+        return pixels;
+    }
+
+    std::vector<uint8_t> EncodeDds(uint32_t width, uint32_t height, std::vector<uint8_t> const& pixels)
+    {
+        std::vector<uint8_t> file(128);
+        std::memcpy(file.data(), "DDS ", 4);
+        std::memcpy(file.data() + 12, &height, 4);
+        std::memcpy(file.data() + 16, &width, 4);
+        file.insert(file.end(), pixels.begin(), pixels.end());
+        return file;
+    }
+
+    std::vector<uint8_t> EncodeDeltaRle(uint32_t width, uint32_t height, std::vector<uint8_t> const& pixels)
+    {
+        std::vector<uint8_t> deltas(pixels.size());
+        const size_t rowBytes = size_t(width) * 4;
+        for (size_t i = 0; i < pixels.size(); ++i)
+        {
+            deltas[i] = (i % rowBytes < 4) ? pixels[i] : static_cast<uint8_t>(pixels[i] - pixels[i - 4]);
+        }
+
+        std::vector<uint8_t> file(8);
+        std::memcpy(file.data(), &width, 4);
+        std::memcpy(file.data() + 4, &height, 4);
+        for (size_t i = 0; i < deltas.size();)
+        {
+            size_t run = 1;
+            while (i + run < deltas.size() && run < 255 && deltas[i + run] == deltas[i])
+            {
+                run++;
+            }
+            file.push_back(static_cast<uint8_t>(run));
+            file.push_back(deltas[i]);
+            i += run;
+        }
+        return file;
+    }
+
+    struct DecodedImage
+    {
+        uint32_t                width = 0;
+        uint32_t                height = 0;
+        std::vector<uint8_t>    pixels;
+    };
+
+    DecodedImage DecodeFile(std::filesystem::path const& path)
+    {
+        std::ifstream stream(path, std::ios::binary);
+        std::vector<uint8_t> file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+        DecodedImage image;
+        if (path.extension() == ".dds")
+        {
+            if (file.size() < 128 || std::memcmp(file.data(), "DDS ", 4) != 0)
+                throw std::runtime_error("Not a DDS file");
+            std::memcpy(&image.height, file.data() + 12, 4);
+            std::memcpy(&image.width, file.data() + 16, 4);
+            image.pixels.assign(file.begin() + 128, file.end());
+            return image;
+        }
+
+        std::memcpy(&image.width, file.data(), 4);
+        std::memcpy(&image.height, file.data() + 4, 4);
+        image.pixels.resize(size_t(image.width) * image.height * 4);
+        const size_t rowBytes = size_t(image.width) * 4;
+        size_t out = 0;
+        for (size_t i = 8; i + 1 < file.size(); i += 2)
+        {
+            for (uint8_t run = file[i]; run > 0; --run, ++out)
+            {
+                image.pixels[out] = (out % rowBytes < 4) ? file[i + 1] : static_cast<uint8_t>(file[i + 1] + image.pixels[out - 4]);
+            }
+        }
+        return image;
+    }
+
+    // Writes the corpus to a temporary directory and removes it afterwards.
+    class Corpus
+    {
+    public:
+        Corpus() : m_directory(std::filesystem::temp_directory_path() / "EMTETextureCorpus"), m_bytes(0)
+        {
+            std::filesystem::create_directories(m_directory);
+            for (uint32_t i = 0; i < c_fileCount; ++i)
+            {
+                const uint32_t size = (i % 3 == 0) ? 256 : 128;
+                auto const pixels = MakePixels(size, size, i);
+                const bool dds = i % 2 == 0;
+                auto const file = dds ? EncodeDds(size, size, pixels) : EncodeDeltaRle(size, size, pixels);
+                m_paths.push_back(m_directory / (std::to_string(i) + (dds ? ".dds" : ".jpg")));
+                std::ofstream(m_paths.back(), std::ios::binary).write(reinterpret_cast<const char*>(file.data()),
+                    static_cast<std::streamsize>(file.size()));
+                m_bytes += file.size();
+            }
+        }
+
+        ~Corpus() { std::filesystem::remove_all(m_directory); }
+
+        std::vector<std::filesystem::path> const& GetPaths() const noexcept { return m_paths; }
+        size_t GetBytes() const noexcept { return m_bytes; }
+
+    private:
+        std::filesystem::path               m_directory;
+        std::vector<std::filesystem::path>  m_paths;
+        size_t                              m_bytes;
+    };
+
+    // Decodes from disk, and uploads by copying into staging memory as ResourceUploadBatch would.
+    struct FileTextureBackend
+    {
+        using Image = DecodedImage;
+
+        Image Decode(std::wstring const& path) { return DecodeFile(path); }
+
+        uint64_t Upload(std::span<Image* const> images)
+        {
+            for (auto const image : images)
+            {
+                staging.insert(staging.end(), image->pixels.begin(), image->pixels.end());
+            }
+            return copyTimeline->Signal();
+        }
+
+        bool IsUploadComplete(uint64_t ticket) noexcept { return copyTimeline->IsComplete(ticket); }
+
+        DX::FenceTimeline*      copyTimeline;
+        std::vector<uint8_t>    staging;
+    };
+}
+
+DX_BENCHMARK(AsyncTextureLoader, StartupCorpus)
+{
+    Corpus corpus;
+    ImmediateCopyQueue queue;
+    DX::FenceTimeline copyTimeline(&queue);
+
+    // As LoadTextures did: each file read, decoded and staged in turn, then one wait for the copies
+    std::vector<uint8_t> staging;
+    auto start = std::chrono::steady_clock::now();
+    for (auto const& path : corpus.GetPaths())
+    {
+        auto const image = DecodeFile(path);
+        staging.insert(staging.end(), image.pixels.begin(), image.pixels.end());
+    }
+    copyTimeline.Wait(copyTimeline.Signal());
+    const double sequential = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const size_t pixelBytes = staging.size();
+
+    const unsigned int workers = std::max(DX::JobSystem::DefaultWorkerCount(), 3u);
+    DX::JobSystem jobs(workers);
+    start = std::chrono::steady_clock::now();
+    size_t uploaded = 0;
+    double decodeSeconds = 0.0;
+    {
+        DX::AsyncTextureLoader<FileTextureBackend> loader(FileTextureBackend{ &copyTimeline, {} }, jobs);
+        for (auto const& path : corpus.GetPaths())
+        {
+            loader.Load(path.wstring());
+        }
+        loader.Flush();
+        uploaded = loader.GetBackend().staging.size();
+        decodeSeconds = loader.GetDecodeSeconds();
+    }
+    const double async = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("  %u files, %.1f MB on disk, %.1f MB of pixels, warm in the page cache\n", c_fileCount,
+        corpus.GetBytes() / 1048576.0, pixelBytes / 1048576.0);
+    std::printf("  one after another: %.1f ms\n", sequential * 1e3);
+    std::printf("  loader on %u workers: %.1f ms (%.2fx), %.1f ms decoding across them, %.1f MB uploaded\n", workers,
+        async * 1e3, sequential / async, decodeSeconds * 1e3, uploaded / 1048576.0);
+}
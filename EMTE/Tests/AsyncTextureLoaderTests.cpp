@@ -0,0 +1,340 @@
+//
+// AsyncTextureLoaderTests.cpp - Decodes into CPU images on workers and uploads against a simulated copy timeline:
+// decode before upload, tickets, failures, Flush and destruction
+//
+
+#include "TestHarness.h"
+
+#include "AsyncTextureLoader.h"
+#include "FenceTimeline.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    using namespace std::chrono_literals;
+
+    // A copy queue whose work completes when the test says so, or at once if told to.
+    class CopyQueue final : public DX::IFenceBackend
+    {
+    public:
+        bool Signal(uint64_t value) noexcept override
+        {
+            if (completeAtOnce)
+            {
+                completed = value;
+            }
+            return true;
+        }
+        uint64_t GetCompletedValue() noexcept override { return completed.load(); }
+        bool Wait(uint64_t value, uint32_t) noexcept override { return completed.load() >= value; }
+
+        std::atomic<uint64_t>   completed{ 0 };
+        std::atomic<bool>       completeAtOnce{ false };
+    };
+
+    // What the fake decoder and copy queue were asked to do, shared by every copy of the backend.
+    struct LoaderLog
+    {
+        std::mutex                              mutex;
+        std::condition_variable                 released;
+        std::set<std::wstring>                  open;           // gated paths allowed to finish decoding
+        std::vector<std::vector<std::wstring>>  batches;        // each upload's images, by path
+        size_t                                  undecodedUploads = 0;
+        bool                                    failUploads = false;
+        std::atomic<uint32_t>                   decoding{ 0 };
+        std::atomic<uint32_t>                   decoded{ 0 };
+
+        void Release(std::wstring const& path)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                open.insert(path);
+            }
+            released.notify_all();
+        }
+    };
+
+    // Decodes a path into a CPU image whose pixels are derived from it, so an upload can check what it was given.
+    // Paths starting "gated/" wait for the test to release them, "slow/" take a few milliseconds, and "missing/"
+    // throw as a file that cannot be read would.
+    struct FakeTextureBackend
+    {
+        struct Image
+        {
+            std::wstring            path;
+            std::vector<uint32_t>   pixels;
+        };
+
+        static std::vector<uint32_t> PixelsFor(std::wstring const& path)
+        {
+            std::vector<uint32_t> pixels(64);
+            uint32_t hash = 2166136261u;
+            for (const wchar_t c : path)
+            {
+                hash = (hash ^ static_cast<uint32_t>(c)) * 16777619u;
+            }
+            for (auto& pixel : pixels)
+            {
+                pixel = hash = hash * 1664525u + 1013904223u;
+            }
+            return pixels;
+        }
+
+        Image Decode(std::wstring const& path)
+        {
+            log->decoding++;
+            if (path.starts_with(L"gated/"))
+            {
+                std::unique_lock<std::mutex> lock(log->mutex);
+                log->released.wait(lock, [&]() { return log->open.count(path) != 0; });
+            }
+            else if (path.starts_with(L"slow/"))
+            {
+                std::this_thread::sleep_for(3ms);
+            }
+            log->decoding--;
+
+            if (path.starts_with(L"missing/"))
+                throw std::runtime_error("Cannot open file");
+
+            log->decoded++;
+            return Image{ path, PixelsFor(path) };
+        }
+
+        uint64_t Upload(std::span<Image* const> images)
+        {
+            std::lock_guard<std::mutex> lock(log->mutex);
+            if (log->failUploads)
+                throw std::runtime_error("Out of upload memory");
+
+            std::vector<std::wstring> batch;
+            for (auto const image : images)
+            {
+                log->undecodedUploads += image->pixels != PixelsFor(image->path);
+                batch.push_back(image->path);
+            }
+            log->batches.push_back(std::move(batch));
+            return copyTimeline->Signal();
+        }
+
+        bool IsUploadComplete(uint64_t ticket) noexcept { return copyTimeline->IsComplete(ticket); }
+
+        std::shared_ptr<LoaderLog>  log;
+        DX::FenceTimeline*          copyTimeline;
+    };
+
+    using Loader = DX::AsyncTextureLoader<FakeTextureBackend>;
+
+    // A loader on two workers over a copy queue the test completes by hand.
+    struct Fixture
+    {
+        DX::JobSystem               jobs{ 2 };
+        CopyQueue                   queue;
+        DX::FenceTimeline           copyTimeline{ &queue };
+        std::shared_ptr<LoaderLog>  log = std::make_shared<LoaderLog>();
+        Loader                      loader{ FakeTextureBackend{ log, &copyTimeline }, jobs };
+    };
+
+    void WaitUntilDecoded(Loader const& loader, Loader::Handle handle)
+    {
+        auto const timeout = std::chrono::steady_clock::now() + 5s;
+        while (loader.GetState(handle) == Loader::State::Decoding && std::chrono::steady_clock::now() < timeout)
+        {
+            std::this_thread::sleep_for(100us);
+        }
+        DX_CHECK(loader.GetState(handle) != Loader::State::Decoding);
+    }
+
+    std::vector<Loader::Handle> ToVector(std::span<const Loader::Handle> handles)
+    {
+        return std::vector<Loader::Handle>(handles.begin(), handles.end());
+    }
+}
+
+DX_TEST(AsyncTextureLoader, DecodedImagesUploadAtTheNextUpdate)
+{
+    Fixture fixture;
+    auto& loader = fixture.loader;
+    auto& log = *fixture.log;
+
+    const auto slow = loader.Load(L"gated/rock.dds");
+    const auto grass = loader.Load(L"grass.dds");
+    const auto sky = loader.Load(L"sky.jpg");
+    DX_CHECK_EQUAL(slow, Loader::Handle(0));
+    DX_CHECK(loader.GetPath(grass) == L"grass.dds");
+
+    // Decoded, but nothing is uploaded until Update
+    WaitUntilDecoded(loader, grass);
+    WaitUntilDecoded(loader, sky);
+    DX_CHECK(loader.GetState(grass) == Loader::State::Decoded);
+    DX_CHECK(log.batches.empty());
+
+    // Everything decoded by then goes in one batch, in request order; the rest waits for a later one
+    DX_CHECK(loader.Update().empty());
+    DX_CHECK_EQUAL(log.batches.size(), size_t(1));
+    DX_CHECK(log.batches[0] == (std::vector<std::wstring>{ L"grass.dds", L"sky.jpg" }));
+    DX_CHECK(loader.GetState(grass) == Loader::State::Uploading);
+    DX_CHECK(loader.GetState(slow) == Loader::State::Decoding);
+
+    // An Update with nothing newly decoded submits nothing
+    loader.Update();
+    DX_CHECK_EQUAL(log.batches.size(), size_t(1));
+
+    fixture.log->Release(L"gated/rock.dds");
+    WaitUntilDecoded(loader, slow);
+    loader.Update();
+    DX_CHECK_EQUAL(log.batches.size(), size_t(2));
+    DX_CHECK(log.batches[1] == std::vector<std::wstring>{ L"gated/rock.dds" });
+
+    // Each image was decoded in full before its upload, and uploaded once
+    DX_CHECK_EQUAL(log.undecodedUploads, size_t(0));
+    fixture.queue.completed = fixture.copyTimeline.GetLastSignaledValue();
+    DX_CHECK(ToVector(loader.Update()) == (std::vector<Loader::Handle>{ slow, grass, sky }));
+    DX_CHECK_EQUAL(log.batches.size(), size_t(2));
+}
+
+DX_TEST(AsyncTextureLoader, TicketsCompleteWithTheCopyTimeline)
+{
+    Fixture fixture;
+    auto& loader = fixture.loader;
+    auto& queue = fixture.queue;
+
+    const auto first = loader.Load(L"first.dds");
+    WaitUntilDecoded(loader, first);
+    loader.Update();
+    const auto second = loader.Load(L"second.dds");
+    const auto third = loader.Load(L"third.dds");
+    WaitUntilDecoded(loader, second);
+    WaitUntilDecoded(loader, third);
+    loader.Update();
+    DX_CHECK_EQUAL(fixture.copyTimeline.GetLastSignaledValue(), uint64_t(2));
+
+    // Not Ready, nor usable, until the copy queue passes the batch's ticket
+    DX_CHECK(loader.Update().empty());
+    DX_CHECK(loader.GetState(first) == Loader::State::Uploading);
+    DX_CHECK_THROWS(loader.GetImage(first), std::logic_error);
+
+    queue.completed = 1;
+    DX_CHECK(ToVector(loader.Update()) == std::vector<Loader::Handle>{ first });
+    DX_CHECK(loader.IsReady(first));
+    DX_CHECK(!loader.IsReady(second));
+    DX_CHECK(loader.GetImage(first).pixels == FakeTextureBackend::PixelsFor(L"first.dds"));
+
+    // A batch completes as a whole, reported in request order
+    queue.completed = 2;
+    DX_CHECK(ToVector(loader.Update()) == (std::vector<Loader::Handle>{ second, third }));
+    DX_CHECK(loader.GetImage(third).path == L"third.dds");
+    DX_CHECK_EQUAL(loader.GetPendingCount(), size_t(0));
+    DX_CHECK(loader.Update().empty());
+}
+
+DX_TEST(AsyncTextureLoader, FailuresAreReportedAndNeverUploaded)
+{
+    Fixture fixture;
+    auto& loader = fixture.loader;
+    auto& log = *fixture.log;
+
+    const auto good = loader.Load(L"good.dds");
+    const auto missing = loader.Load(L"missing/bad.dds");
+    WaitUntilDecoded(loader, good);
+    WaitUntilDecoded(loader, missing);
+    DX_CHECK(loader.GetState(missing) == Loader::State::Failed);
+
+    // A failed decode is reported at once, while the good image waits on its copy
+    DX_CHECK(ToVector(loader.Update()) == std::vector<Loader::Handle>{ missing });
+    DX_CHECK(log.batches.size() == 1 && log.batches[0] == std::vector<std::wstring>{ L"good.dds" });
+    DX_CHECK_THROWS(loader.GetImage(missing), std::logic_error);
+
+    // An upload that throws fails its whole batch, and nothing else
+    {
+        std::lock_guard<std::mutex> lock(log.mutex);
+        log.failUploads = true;
+    }
+    const auto lost0 = loader.Load(L"lost0.dds");
+    const auto lost1 = loader.Load(L"lost1.dds");
+    WaitUntilDecoded(loader, lost0);
+    WaitUntilDecoded(loader, lost1);
+    DX_CHECK(ToVector(loader.Update()) == (std::vector<Loader::Handle>{ lost0, lost1 }));
+    DX_CHECK(loader.GetState(lost1) == Loader::State::Failed);
+    DX_CHECK(loader.GetState(good) == Loader::State::Uploading);
+
+    fixture.queue.completed = fixture.copyTimeline.GetLastSignaledValue();
+    DX_CHECK(ToVector(loader.Update()) == std::vector<Loader::Handle>{ good });
+    DX_CHECK_EQUAL(log.batches.size(), size_t(1));
+}
+
+DX_TEST(AsyncTextureLoader, FlushLoadsEverything)
+{
+    Fixture fixture;
+    auto& loader = fixture.loader;
+    fixture.queue.completeAtOnce = true;
+
+    constexpr uint32_t count = 40;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        loader.Load((i % 9 == 8 ? L"missing/" : L"slow/") + std::to_wstring(i) + L".dds");
+    }
+    loader.Flush();
+
+    DX_CHECK_EQUAL(loader.GetPendingCount(), size_t(0));
+    bool settled = true;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        settled &= loader.GetState(i) == (i % 9 == 8 ? Loader::State::Failed : Loader::State::Ready);
+    }
+    DX_CHECK(settled);
+    DX_CHECK_EQUAL(fixture.log->undecodedUploads, size_t(0));
+    DX_CHECK(loader.GetDecodeSeconds() >= 0.9 * (count - count / 9) * 0.003);
+
+    // Every good image was uploaded exactly once, whichever batch it fell in
+    size_t uploaded = 0;
+    for (auto const& batch : fixture.log->batches)
+    {
+        uploaded += batch.size();
+    }
+    DX_CHECK_EQUAL(uploaded, size_t(count - count / 9));
+}
+
+DX_TEST(AsyncTextureLoader, DestructionWaitsForDecodesInFlight)
+{
+    DX::JobSystem jobs(2);
+    CopyQueue queue;
+    DX::FenceTimeline copyTimeline(&queue);
+    auto log = std::make_shared<LoaderLog>();
+    std::thread releaser;
+    {
+        Loader loader(FakeTextureBackend{ log, &copyTimeline }, jobs);
+        for (uint32_t i = 0; i < 6; ++i)
+        {
+            loader.Load(L"slow/" + std::to_wstring(i) + L".jpg");
+        }
+        loader.Load(L"gated/last.jpg");
+
+        releaser = std::thread([log]()
+            {
+                std::this_thread::sleep_for(30ms);
+                log->Release(L"gated/last.jpg");
+            });
+    }
+
+    DX_CHECK_EQUAL(log->decoded.load(), uint32_t(7));
+    DX_CHECK_EQUAL(log->decoding.load(), uint32_t(0));
+    DX_CHECK(!jobs.TryRunPending());
+    releaser.join();
+}
@@ -0,0 +1,11 @@
+//
+// BenchmarkMain.cpp - Runs the benchmarks whose names start with the first argument, or all of them
+//
+
+#include "TestHarness.h"
+
+
+int main(int argc, char** argv)
+{
+    return DX::Test::Run(DX::Test::GetBenchmarks(), argc > 1 ? argv[1] : "") ? 1 : 0;
+}
@@ -0,0 +1,165 @@
+//
+// BoundingVolumeHierarchyBenchmark.cpp - Building, refitting and querying a tree of 100k objects, against testing every object
+//
+
+#include "TestHarness.h"
+
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    constexpr size_t c_objectCount = 100000;
+
+    // Boxes of a few units scattered through a city-sized cube.
+    std::vector<DX::Aabb> MakeScene(std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> position(-500.f, 500.f);
+        std::uniform_real_distribution<float> size(0.5f, 4.f);
+        std::vector<DX::Aabb> boxes(c_objectCount);
+        for (auto& box : boxes)
+        {
+            const float x = position(random), y = position(random) * 0.1f, z = position(random);
+            const float half = size(random);
+            box = DX::Aabb{ { x - half, y - half, z - half }, { x + half, y + half, z + half } };
+        }
+        return boxes;
+    }
+
+    // The camera at the origin looking down +Z, seeing 200 units.
+    DX::Frustum MakeFrustum()
+    {
+        struct
+        {
+            float m[4][4];
+        } projection = { {
+            { 1.8304877f / (16.f / 9.f), 0.f, 0.f, 0.f },
+            { 0.f, 1.8304877f, 0.f, 0.f },
+            { 0.f, 0.f, 1.0005003f, 1.f },
+            { 0.f, 0.f, -0.1000500f, 0.f },
+        } };
+        return DX::Frustum::FromMatrix(projection);
+    }
+
+    bool Intersects(DX::Frustum const& frustum, DX::Aabb const& box)
+    {
+        for (auto const& p : frustum.planes)
+        {
+            const float distance = p.a * (box.min.x + box.max.x) * 0.5f + p.b * (box.min.y + box.max.y) * 0.5f
+                + p.c * (box.min.z + box.max.z) * 0.5f + p.d;
+            const float reach = (std::fabs(p.a) * (box.max.x - box.min.x) + std::fabs(p.b) * (box.max.y - box.min.y)
+                + std::fabs(p.c) * (box.max.z - box.min.z)) * 0.5f;
+            if (distance < -reach)
+                return false;
+        }
+        return true;
+    }
+}
+
+DX_BENCHMARK(BoundingVolumeHierarchy, BuildAndRefit)
+{
+    std::mt19937 random(3);
+    auto boxes = MakeScene(random);
+
+    DX::BoundingVolumeHierarchy bvh;
+    const double build = DX::Test::MeasureNanoseconds(3, [&]() { bvh.Build(boxes); });
+
+    for (auto& box : boxes)
+    {
+        box.min.x += 1.f;
+        box.max.x += 1.f;
+    }
+    const double refit = DX::Test::MeasureNanoseconds(10, [&]() { bvh.Refit(boxes); });
+
+    std::printf("  %zu objects: build %.2f ms, refit %.2f ms, %zu nodes, cost %.1f\n", c_objectCount, build * 1e-6,
+        refit * 1e-6, bvh.GetNodes().size(), bvh.GetCost());
+}
+
+DX_BENCHMARK(BoundingVolumeHierarchy, Queries)
+{
+    std::mt19937 random(5);
+    auto const boxes = MakeScene(random);
+    DX::BoundingVolumeHierarchy bvh;
+    bvh.Build(boxes);
+
+    auto const frustum = MakeFrustum();
+    std::vector<uint32_t> visible;
+    const double treeFrustum = DX::Test::MeasureNanoseconds(20, [&]() { bvh.QueryFrustum(frustum, visible); });
+    const size_t visibleCount = visible.size();
+    const double bruteFrustum = DX::Test::MeasureNanoseconds(5, [&]()
+        {
+            visible.clear();
+            for (uint32_t object = 0; object < boxes.size(); ++object)
+            {
+                if (Intersects(frustum, boxes[object]))
+                {
+                    visible.push_back(object);
+                }
+            }
+        });
+    std::printf("  frustum, %zu visible: tree %.3f ms, every object %.3f ms (%.1fx)\n", visibleCount, treeFrustum * 1e-6,
+        bruteFrustum * 1e-6, bruteFrustum / treeFrustum);
+
+    // Rays from around the scene in random directions, and points anywhere in it
+    std::uniform_real_distribution<float> position(-500.f, 500.f);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    std::vector<DX::BvhPoint> origins(256), directions(256);
+    for (size_t i = 0; i < origins.size(); ++i)
+    {
+        origins[i] = DX::BvhPoint(position(random), 0.f, position(random));
+        const DX::BvhPoint d(unit(random), unit(random) * 0.1f, unit(random));
+        const float length = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+        directions[i] = DX::BvhPoint(d.x / length, d.y / length, d.z / length);
+    }
+
+    size_t query = 0;
+    size_t hits = 0;
+    const double treeRay = DX::Test::MeasureNanoseconds(256, [&]()
+        {
+            hits += bvh.Raycast(origins[query % 256], directions[query % 256]) ? 1 : 0;
+            query++;
+        });
+    const double bruteRay = DX::Test::MeasureNanoseconds(16, [&]()
+        {
+            auto const origin = origins[query % 256], direction = directions[query % 256];
+            const DX::BvhPoint inverse(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+            float nearest = std::numeric_limits<float>::infinity();
+            for (auto const& box : boxes)
+            {
+                nearest = std::min(nearest, DX::BoundingVolumeHierarchy::RayDistance(box, origin, inverse, nearest));
+            }
+            hits += (nearest < std::numeric_limits<float>::infinity()) ? 1 : 0;
+            query++;
+        });
+    std::printf("  raycast, %zu of %zu rays hit: tree %.2f us, every object %.2f us (%.0fx)\n", hits, query,
+        treeRay * 1e-3, bruteRay * 1e-3, bruteRay / treeRay);
+
+    float farthest = 0.f;
+    const double treeNearest = DX::Test::MeasureNanoseconds(256, [&]()
+        {
+            farthest = std::max(farthest, bvh.FindNearest(origins[query % 256])->distance);
+            query++;
+        });
+    const double bruteNearest = DX::Test::MeasureNanoseconds(16, [&]()
+        {
+            auto const point = origins[query % 256];
+            float nearest = std::numeric_limits<float>::infinity();
+            for (auto const& box : boxes)
+            {
+                nearest = std::min(nearest, box.GetDistance(point));
+            }
+            farthest = std::max(farthest, nearest);
+            query++;
+        });
+    std::printf("  nearest, at most %.2f away: tree %.2f us, every object %.2f us (%.0fx)\n", farthest,
+        treeNearest * 1e-3, bruteNearest * 1e-3, bruteNearest / treeNearest);
+}
@@ -0,0 +1,462 @@
+//
+// BoundingVolumeHierarchyTests.cpp - Checks every query against brute force, after builds, refits and on degenerate scenes
+//
+
+#include "TestHarness.h"
+
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+
+namespace
+{
+    struct Matrix
+    {
+        float m[4][4];
+    };
+
+    // A perspective camera at eye, turned yaw radians about +Y from looking down +Z, as XMMatrixLookToLH and
+    // XMMatrixPerspectiveFovLH build it.
+    DX::Frustum MakeFrustum(DX::BvhPoint eye, float yaw, float farZ = 60.f)
+    {
+        const DX::BvhPoint right(std::cos(yaw), 0.f, -std::sin(yaw));
+        const DX::BvhPoint up(0.f, 1.f, 0.f);
+        const DX::BvhPoint forward(std::sin(yaw), 0.f, std::cos(yaw));
+        auto const dot = [&eye](DX::BvhPoint axis) { return axis.x * eye.x + axis.y * eye.y + axis.z * eye.z; };
+        const Matrix view = { {
+            { right.x, up.x, forward.x, 0.f },
+            { right.y, up.y, forward.y, 0.f },
+            { right.z, up.z, forward.z, 0.f },
+            { -dot(right), -dot(up), -dot(forward), 1.f },
+        } };
+
+        constexpr float nearZ = 0.1f;
+        const float yScale = 1.f / std::tan(0.5f);
+        const float range = farZ / (farZ - nearZ);
+        const Matrix projection = { {
+            { yScale / (16.f / 9.f), 0.f, 0.f, 0.f },
+            { 0.f, yScale, 0.f, 0.f },
+            { 0.f, 0.f, range, 1.f },
+            { 0.f, 0.f, -range * nearZ, 0.f },
+        } };
+
+        Matrix viewProjection = {};
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int column = 0; column < 4; ++column)
+            {
+                for (int k = 0; k < 4; ++k)
+                {
+                    viewProjection.m[row][column] += view.m[row][k] * projection.m[k][column];
+                }
+            }
+        }
+        return DX::Frustum::FromMatrix(viewProjection);
+    }
+
+    float Uniform(std::mt19937& random, float low, float high)
+    {
+        return std::uniform_real_distribution<float>(low, high)(random);
+    }
+
+    DX::BvhPoint RandomPoint(std::mt19937& random, float range)
+    {
+        return DX::BvhPoint(Uniform(random, -range, range), Uniform(random, -range, range), Uniform(random, -range, range));
+    }
+
+    // Boxes of assorted sizes scattered through a cube.
+    std::vector<DX::Aabb> RandomScene(std::mt19937& random, size_t count, float range = 100.f)
+    {
+        std::vector<DX::Aabb> boxes(count);
+        for (auto& box : boxes)
+        {
+            auto const center = RandomPoint(random, range);
+            const DX::BvhPoint half(Uniform(random, 0.1f, 3.f), Uniform(random, 0.1f, 3.f), Uniform(random, 0.1f, 3.f));
+            box = DX::Aabb{ { center.x - half.x, center.y - half.y, center.z - half.z }, { center.x + half.x, center.y + half.y, center.z + half.z } };
+        }
+        return boxes;
+    }
+
+    bool Contains(DX::Aabb const& outer, DX::Aabb const& inner)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (inner.min[axis] < outer.min[axis] || inner.max[axis] > outer.max[axis])
+                return false;
+        }
+        return true;
+    }
+
+    // Check the tree holds every object once, that each node bounds what is below it, and return its depth.
+    uint32_t CheckTree(DX::BoundingVolumeHierarchy const& bvh, std::vector<DX::Aabb> const& boxes)
+    {
+        auto const nodes = bvh.GetNodes();
+        auto const objects = bvh.GetObjects();
+        DX_CHECK_EQUAL(objects.size(), boxes.size());
+
+        std::vector<uint32_t> seen(boxes.size(), 0);
+        std::vector<uint32_t> depths(nodes.size(), 0);
+        uint32_t maxDepth = 0;
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            auto const& node = nodes[i];
+            maxDepth = std::max(maxDepth, depths[i]);
+            if (node.count)
+            {
+                for (uint32_t o = node.first; o < node.first + node.count; ++o)
+                {
+                    seen[objects[o]]++;
+                    DX_CHECK(Contains(node.bounds, boxes[objects[o]]));
+                }
+                continue;
+            }
+
+            DX_CHECK(node.first > i && node.first + 1 < nodes.size());
+            DX_CHECK(Contains(node.bounds, nodes[node.first].bounds));
+            DX_CHECK(Contains(node.bounds, nodes[node.first + 1].bounds));
+            depths[node.first] = depths[node.first + 1] = depths[i] + 1;
+        }
+        DX_CHECK(std::all_of(seen.begin(), seen.end(), [](uint32_t count) { return count == 1; }));
+        return maxDepth;
+    }
+
+    size_t GetLargestLeaf(DX::BoundingVolumeHierarchy const& bvh)
+    {
+        size_t largest = 0;
+        for (auto const& node : bvh.GetNodes())
+        {
+            largest = std::max<size_t>(largest, node.count);
+        }
+        return largest;
+    }
+
+    // The tree's frustum test, one box at a time.
+    std::vector<uint32_t> BruteForceFrustum(DX::Frustum const& frustum, std::vector<DX::Aabb> const& boxes)
+    {
+        std::vector<uint32_t> visible;
+        for (uint32_t object = 0; object < boxes.size(); ++object)
+        {
+            auto const& box = boxes[object];
+            bool outside = false;
+            for (auto const& p : frustum.planes)
+            {
+                const float distance = p.a * (box.min.x + box.max.x) * 0.5f + p.b * (box.min.y + box.max.y) * 0.5f
+                    + p.c * (box.min.z + box.max.z) * 0.5f + p.d;
+                const float reach = (std::fabs(p.a) * (box.max.x - box.min.x) + std::fabs(p.b) * (box.max.y - box.min.y)
+                    + std::fabs(p.c) * (box.max.z - box.min.z)) * 0.5f;
+                outside |= distance < -reach;
+            }
+            if (!outside)
+            {
+                visible.push_back(object);
+            }
+        }
+        return visible;
+    }
+
+    float BruteForceRay(std::vector<DX::Aabb> const& boxes, DX::BvhPoint origin, DX::BvhPoint direction, float maxDistance)
+    {
+        const DX::BvhPoint inverse(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+        float nearest = std::numeric_limits<float>::infinity();
+        for (auto const& box : boxes)
+        {
+            const float distance = DX::BoundingVolumeHierarchy::RayDistance(box, origin, inverse, maxDistance);
+            if (distance < maxDistance)
+            {
+                nearest = std::min(nearest, distance);
+            }
+        }
+        return nearest;
+    }
+
+    float BruteForceNearest(std::vector<DX::Aabb> const& boxes, DX::BvhPoint point, float maxDistance)
+    {
+        float nearest = std::numeric_limits<float>::infinity();
+        for (auto const& box : boxes)
+        {
+            const float distance = box.GetDistance(point);
+            if (distance < maxDistance)
+            {
+                nearest = std::min(nearest, distance);
+            }
+        }
+        return nearest;
+    }
+
+    // Run random frustum, ray and nearest-point queries on the tree and by brute force, and check they agree.
+    // Ties may be broken either way, so hits are compared by distance. Unless exactFrustum, the tree may find more
+    // objects in a frustum than brute force, but never fewer.
+    void CheckQueries(DX::BoundingVolumeHierarchy const& bvh, std::vector<DX::Aabb> const& boxes, std::mt19937& random,
+        float range = 100.f, bool exactFrustum = true)
+    {
+        std::vector<uint32_t> visible;
+        for (int query = 0; query < 40; ++query)
+        {
+            auto const frustum = MakeFrustum(RandomPoint(random, range), Uniform(random, 0.f, 6.2831853f), range * 0.6f);
+            bvh.QueryFrustum(frustum, visible);
+            std::sort(visible.begin(), visible.end());
+            auto const expected = BruteForceFrustum(frustum, boxes);
+            DX_CHECK(exactFrustum ? visible == expected : std::includes(visible.begin(), visible.end(), expected.begin(), expected.end()));
+        }
+
+        for (int query = 0; query < 200; ++query)
+        {
+            auto const origin = RandomPoint(random, range * 1.2f);
+            auto direction = RandomPoint(random, 1.f);
+            const float length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+            direction = DX::BvhPoint(direction.x / length, direction.y / length, direction.z / length);
+            const float maxDistance = (query % 2) ? std::numeric_limits<float>::infinity() : range * 0.5f;
+
+            auto const hit = bvh.Raycast(origin, direction, maxDistance);
+            const float expected = BruteForceRay(boxes, origin, direction, maxDistance);
+            DX_CHECK_EQUAL(hit.has_value(), expected < maxDistance);
+            if (hit)
+            {
+                DX_CHECK_EQUAL(hit->distance, expected);
+                const DX::BvhPoint inverse(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+                DX_CHECK_EQUAL(DX::BoundingVolumeHierarchy::RayDistance(boxes[hit->object], origin, inverse, maxDistance), expected);
+            }
+        }
+
+        for (int query = 0; query < 200; ++query)
+        {
+            auto const point = RandomPoint(random, range * 1.2f);
+            const float maxDistance = (query % 2) ? std::numeric_limits<float>::infinity() : range * 0.05f;
+
+            auto const hit = bvh.FindNearest(point, maxDistance);
+            const float expected = BruteForceNearest(boxes, point, maxDistance);
+            DX_CHECK_EQUAL(hit.has_value(), expected < maxDistance);
+            if (hit)
+            {
+                DX_CHECK_EQUAL(hit->distance, expected);
+                DX_CHECK_EQUAL(boxes[hit->object].GetDistance(point), expected);
+            }
+        }
+    }
+}
+
+DX_TEST(BoundingVolumeHierarchy, EmptyAndSingleObject)
+{
+    DX::BoundingVolumeHierarchy bvh;
+    bvh.Build({});
+    DX_CHECK_EQUAL(bvh.GetObjectCount(), size_t(0));
+    DX_CHECK_EQUAL(bvh.GetCost(), 0.f);
+
+    std::vector<uint32_t> visible(4, 0);
+    bvh.QueryFrustum(MakeFrustum(DX::BvhPoint(), 0.f), visible);
+    DX_CHECK(visible.empty());
+    DX_CHECK(!bvh.Raycast(DX::BvhPoint(), DX::BvhPoint(0.f, 0.f, 1.f)).has_value());
+    DX_CHECK(!bvh.FindNearest(DX::BvhPoint()).has_value());
+
+    const std::vector<DX::Aabb> one = { DX::Aabb::FromSphere(DX::BvhPoint(0.f, 0.f, 10.f), 1.f) };
+    bvh.Build(one);
+    DX_CHECK_EQUAL(bvh.GetNodes().size(), size_t(1));
+    bvh.QueryFrustum(MakeFrustum(DX::BvhPoint(), 0.f), visible);
+    DX_CHECK(visible == std::vector<uint32_t>{ 0 });
+
+    auto const hit = bvh.Raycast(DX::BvhPoint(), DX::BvhPoint(0.f, 0.f, 1.f));
+    DX_CHECK(hit.has_value() && hit->object == 0 && hit->distance == 9.f);
+    DX_CHECK(!bvh.Raycast(DX::BvhPoint(), DX::BvhPoint(0.f, 0.f, 1.f), 8.f).has_value());
+    DX_CHECK(!bvh.Raycast(DX::BvhPoint(), DX::BvhPoint(0.f, 0.f, -1.f)).has_value());
+    DX_CHECK_EQUAL(bvh.FindNearest(DX::BvhPoint(0.f, 0.f, 5.f))->distance, 4.f);
+
+    bvh.Clear();
+    DX_CHECK_EQUAL(bvh.GetObjectCount(), size_t(0));
+    DX_CHECK(!bvh.FindNearest(DX::BvhPoint()).has_value());
+}
+
+DX_TEST(BoundingVolumeHierarchy, QueriesMatchBruteForce)
+{
+    std::mt19937 random(17);
+    for (size_t const count : { 2, 7, 100, 3000 })
+    {
+        auto const boxes = RandomScene(random, count);
+        DX::BoundingVolumeHierarchy bvh;
+        bvh.Build(boxes);
+        CheckTree(bvh, boxes);
+        DX_CHECK(GetLargestLeaf(bvh) <= DX::BoundingVolumeHierarchy::MaxLeafSize);
+        DX_CHECK_EQUAL(bvh.GetCost(), bvh.GetBuiltCost());
+        CheckQueries(bvh, boxes, random);
+    }
+}
+
+DX_TEST(BoundingVolumeHierarchy, CustomIntersectAndDistance)
+{
+    // Spheres in their boxes: the tree prunes by box, and the callbacks decide hits on the spheres themselves
+    std::mt19937 random(23);
+    std::vector<DX::BvhPoint> centers(500);
+    std::vector<DX::Aabb> boxes(centers.size());
+    for (size_t i = 0; i < centers.size(); ++i)
+    {
+        centers[i] = RandomPoint(random, 50.f);
+        boxes[i] = DX::Aabb::FromSphere(centers[i], 1.f);
+    }
+
+    DX::BoundingVolumeHierarchy bvh;
+    bvh.Build(boxes);
+
+    auto const distanceTo = [&](uint32_t object, DX::BvhPoint point)
+        {
+            const float dx = point.x - centers[object].x, dy = point.y - centers[object].y, dz = point.z - centers[object].z;
+            return std::max(std::sqrt(dx * dx + dy * dy + dz * dz) - 1.f, 0.f);
+        };
+
+    for (int query = 0; query < 200; ++query)
+    {
+        auto const point = RandomPoint(random, 60.f);
+        float expected = std::numeric_limits<float>::infinity();
+        for (uint32_t object = 0; object < centers.size(); ++object)
+        {
+            expected = std::min(expected, distanceTo(object, point));
+        }
+
+        auto const hit = bvh.FindNearest(point, std::numeric_limits<float>::infinity(),
+            [&](uint32_t object) { return distanceTo(object, point); });
+        DX_CHECK(hit.has_value() && hit->distance == expected);
+    }
+
+    // Along +X through the plane of some centers: the first sphere reached along the ray
+    for (int query = 0; query < 200; ++query)
+    {
+        const DX::BvhPoint origin(-60.f, Uniform(random, -50.f, 50.f), Uniform(random, -50.f, 50.f));
+        auto const sphereDistance = [&](uint32_t object, float limit)
+            {
+                const float dy = origin.y - centers[object].y, dz = origin.z - centers[object].z;
+                const float offset = dy * dy + dz * dz;
+                if (offset > 1.f)
+                    return std::numeric_limits<float>::infinity();
+                const float distance = centers[object].x - origin.x - std::sqrt(1.f - offset);
+                return distance < limit ? distance : std::numeric_limits<float>::infinity();
+            };
+
+        float expected = std::numeric_limits<float>::infinity();
+        for (uint32_t object = 0; object < centers.size(); ++object)
+        {
+            expected = std::min(expected, sphereDistance(object, std::numeric_limits<float>::infinity()));
+        }
+
+        auto const hit = bvh.Raycast(origin, DX::BvhPoint(1.f, 0.f, 0.f), std::numeric_limits<float>::infinity(), sphereDistance);
+        DX_CHECK_EQUAL(hit.has_value(), expected != std::numeric_limits<float>::infinity());
+        if (hit)
+        {
+            DX_CHECK_EQUAL(hit->distance, expected);
+        }
+    }
+}
+
+DX_TEST(BoundingVolumeHierarchy, RefitFollowsMovedObjects)
+{
+    std::mt19937 random(29);
+    auto boxes = RandomScene(random, 2000);
+    DX::BoundingVolumeHierarchy bvh;
+    bvh.Build(boxes);
+    const size_t nodeCount = bvh.GetNodes().size();
+
+    // Refitting unmoved boxes changes nothing
+    bvh.Refit(boxes);
+    DX_CHECK_EQUAL(bvh.GetCost(), bvh.GetBuiltCost());
+
+    // Every object drifts, a tenth of them right across the scene: queries stay exact, only the cost grows
+    for (int frame = 0; frame < 4; ++frame)
+    {
+        for (size_t i = 0; i < boxes.size(); ++i)
+        {
+            auto const move = (i % 10 == 0) ? RandomPoint(random, 80.f) : RandomPoint(random, 4.f);
+            boxes[i].min = DX::BvhPoint(boxes[i].min.x + move.x, boxes[i].min.y + move.y, boxes[i].min.z + move.z);
+            boxes[i].max = DX::BvhPoint(boxes[i].max.x + move.x, boxes[i].max.y + move.y, boxes[i].max.z + move.z);
+        }
+        bvh.Refit(boxes);
+        DX_CHECK_EQUAL(bvh.GetNodes().size(), nodeCount);
+        CheckTree(bvh, boxes);
+        CheckQueries(bvh, boxes, random, 120.f);
+    }
+    DX_CHECK(bvh.GetCost() > bvh.GetBuiltCost() * 1.5f);
+
+    // A rebuild brings the cost back down
+    const float refitCost = bvh.GetCost();
+    bvh.Build(boxes);
+    DX_CHECK(bvh.GetCost() < refitCost);
+    DX_CHECK_EQUAL(bvh.GetCost(), bvh.GetBuiltCost());
+
+    boxes.pop_back();
+    DX_CHECK_THROWS(bvh.Refit(boxes), std::invalid_argument);
+}
+
+DX_TEST(BoundingVolumeHierarchy, CoincidentCentroids)
+{
+    // Nested boxes about the origin give the binned split nothing to bin, so nodes are halved down to leaf size
+    std::vector<DX::Aabb> boxes;
+    for (int i = 0; i < 1000; ++i)
+    {
+        boxes.push_back(DX::Aabb::FromSphere(DX::BvhPoint(), 0.5f + float(i) * 0.01f));
+    }
+
+    DX::BoundingVolumeHierarchy bvh;
+    bvh.Build(boxes);
+    DX_CHECK_EQUAL(CheckTree(bvh, boxes), 7u);
+    DX_CHECK(GetLargestLeaf(bvh) <= DX::BoundingVolumeHierarchy::MaxLeafSize);
+
+    std::mt19937 random(31);
+    CheckQueries(bvh, boxes, random, 20.f);
+
+    // Identical boxes too
+    boxes.assign(500, DX::Aabb::FromSphere(DX::BvhPoint(1.f, 1.f, 1.f), 1.f));
+    bvh.Build(boxes);
+    CheckTree(bvh, boxes);
+    DX_CHECK(GetLargestLeaf(bvh) <= DX::BoundingVolumeHierarchy::MaxLeafSize);
+    CheckQueries(bvh, boxes, random, 5.f);
+}
+
+DX_TEST(BoundingVolumeHierarchy, BoxesWithoutArea)
+{
+    // Points along a line: every split's estimated cost is undefined, and the nodes must still be halved
+    std::vector<DX::Aabb> boxes;
+    for (int i = 0; i < 1000; ++i)
+    {
+        const DX::BvhPoint point(float(i % 97) * 0.1f, 0.f, 0.f);
+        boxes.push_back(DX::Aabb{ point, point });
+    }
+
+    DX::BoundingVolumeHierarchy bvh;
+    bvh.Build(boxes);
+    CheckTree(bvh, boxes);
+    DX_CHECK(GetLargestLeaf(bvh) <= DX::BoundingVolumeHierarchy::MaxLeafSize);
+    auto const nearest = bvh.FindNearest(DX::BvhPoint(float(40) * 0.1f, 3.f, 0.f));
+    DX_CHECK(nearest.has_value() && nearest->distance == 3.f);
+
+    std::mt19937 random(37);
+    CheckQueries(bvh, boxes, random, 12.f);
+}
+
+DX_TEST(BoundingVolumeHierarchy, DeepTreesSwitchToMedianSplits)
+{
+    // Each object twice as far out as the last, from 2^-120 to 2^120: the binned split peels the four in the top
+    // fifteen sixteenths off at a time, and past depth 32 the build halves nodes instead, which keeps the tree
+    // within its traversal stack
+    std::vector<DX::Aabb> boxes;
+    for (int i = -120; i <= 120; ++i)
+    {
+        const float x = std::ldexp(1.f, i);
+        boxes.push_back(DX::Aabb{ { x * 0.75f, 0.f, 0.f }, { x * 1.25f, 1.f, 1.f } });
+    }
+
+    DX::BoundingVolumeHierarchy bvh;
+    bvh.Build(boxes);
+    const uint32_t depth = CheckTree(bvh, boxes);
+    DX_CHECK(depth > 32);
+    DX_CHECK(depth < 72);
+    DX_CHECK(GetLargestLeaf(bvh) <= DX::BoundingVolumeHierarchy::MaxLeafSize);
+
+    // Queries near the origin, where the tree is deepest. Nodes spanning 2^120 round away the planes' offsets, so
+    // they may be taken as wholly inside a plane their small objects are outside; such objects are kept, not lost.
+    std::mt19937 random(41);
+    CheckQueries(bvh, boxes, random, 40.f, false);
+}
@@ -0,0 +1,144 @@
+//
+// CommandContextPoolBenchmark.cpp - Frame record time as passes spread across more workers
+//
+
+#include "TestHarness.h"
+
+#include "CommandContextPool.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    constexpr size_t c_drawsPerPass = 4000;
+
+    class CompletedQueue final : public DX::IFenceBackend
+    {
+    public:
+        bool Signal(uint64_t value) noexcept override { m_completed = value; return true; }
+        uint64_t GetCompletedValue() noexcept override { return m_completed; }
+        bool Wait(uint64_t, uint32_t) noexcept override { return true; }
+
+    private:
+        uint64_t    m_completed = 0;
+    };
+
+    struct Command
+    {
+        uint32_t    op;
+        uint32_t    arguments[3];
+        float       constants[4];
+    };
+
+    // Lists that keep what is recorded in memory, as a driver would, and keep their capacity across resets.
+    struct RecordingDevice
+    {
+        struct Allocator {};
+
+        struct List
+        {
+            std::vector<Command>    commands;
+        };
+
+        Allocator CreateAllocator() { return {}; }
+        List CreateList(Allocator const&) { return {}; }
+        void Reset(Allocator&, List& list) { list.commands.clear(); }
+        void Close(List&) {}
+    };
+
+    using Pool = DX::CommandContextPool<RecordingDevice>;
+
+    // A draw: set its constants, bind its geometry, draw, with arithmetic standing in for the runtime's validation.
+    void RecordDraw(RecordingDevice::List& list, uint32_t pass, uint32_t draw)
+    {
+        float value = static_cast<float>(draw);
+        for (int n = 0; n < 24; ++n)
+        {
+            value = std::sqrt(value * 1.0001f + 1.0f);
+        }
+        list.commands.push_back(Command{ 1, { pass, draw, 0 }, { value, value, value, 1.f } });
+        list.commands.push_back(Command{ 2, { draw % 64, 0, 0 }, {} });
+        list.commands.push_back(Command{ 3, { 36, 1, 0 }, {} });
+    }
+
+    std::vector<Pool::Pass> MakePasses()
+    {
+        static const char* const names[] = { "Sprites", "Wireframe", "Lit 0", "Lit 1", "Lit 2", "Lit 3", "Lit 4", "GUI" };
+        std::vector<Pool::Pass> passes;
+        for (uint32_t pass = 0; pass < std::size(names); ++pass)
+        {
+            passes.push_back(Pool::Pass{ names[pass], [pass](RecordingDevice::List& list)
+                {
+                    for (uint32_t draw = 0; draw < c_drawsPerPass; ++draw)
+                    {
+                        RecordDraw(list, pass, draw);
+                    }
+                } });
+        }
+        return passes;
+    }
+
+    // Record a frame of passes and submit it, best of several, in nanoseconds.
+    double MeasureFrame(Pool& pool, DX::FenceTimeline& timeline, std::vector<Pool::Pass> const& passes)
+    {
+        return DX::Test::MeasureNanoseconds(20, [&]()
+            {
+                pool.Record(passes);
+                pool.GetFrameContexts();
+                pool.EndFrame(timeline.Signal());
+            });
+    }
+}
+
+DX_BENCHMARK(CommandContextPool, RecordScaling)
+{
+    CompletedQueue queue;
+    DX::FenceTimeline timeline(&queue);
+    Pool pool(RecordingDevice{}, timeline);
+    auto const passes = MakePasses();
+
+    pool.SetExecutor([](size_t count, std::function<void(size_t)> const& body)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                body(i);
+            }
+        });
+
+    // Lists keep their capacity, so the first frame's growth is not counted against the serial run
+    pool.Record(passes);
+    pool.EndFrame(timeline.Signal());
+    const double serial = MeasureFrame(pool, timeline, passes);
+
+    std::printf("  %zu passes of %zu draws, %u hardware threads\n", passes.size(), c_drawsPerPass,
+        std::thread::hardware_concurrency());
+    std::printf("  serial: %.2f ms a frame\n", serial * 1e-6);
+
+    // The recording thread helps its workers, so n workers record on n + 1 threads
+    const unsigned int maxWorkers = std::max(DX::JobSystem::DefaultWorkerCount(), 3u);
+    for (unsigned int workers = 1;; workers = std::min(workers * 2, maxWorkers))
+    {
+        DX::JobSystem jobs(workers);
+        pool.SetExecutor([&jobs](size_t count, std::function<void(size_t)> const& body) { jobs.ParallelFor(count, body); });
+        const double parallel = MeasureFrame(pool, timeline, passes);
+        std::printf("  %u workers: %.2f ms a frame (%.2fx)\n", workers, parallel * 1e-6, serial / parallel);
+        pool.SetExecutor(nullptr);
+        if (workers == maxWorkers)
+            break;
+    }
+
+    const double async = MeasureFrame(pool, timeline, passes);
+    std::printf("  a thread a pass: %.2f ms a frame (%.2fx)\n", async * 1e-6, serial / async);
+    std::printf("  %zu contexts created\n", pool.GetCreatedCount());
+}
@@ -0,0 +1,292 @@
+//
+// CommandContextPoolTests.cpp - Fence-gated recycling and pass ordering against a recording-only mock device
+//
+
+#include "TestHarness.h"
+
+#include "CommandContextPool.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    // A queue that completes whatever the test tells it to.
+    class ManualQueue final : public DX::IFenceBackend
+    {
+    public:
+        bool Signal(uint64_t) noexcept override { return true; }
+        uint64_t GetCompletedValue() noexcept override { return completed.load(); }
+        bool Wait(uint64_t value, uint32_t) noexcept override { return completed.load() >= value; }
+
+        std::atomic<uint64_t>   completed{ 0 };
+    };
+
+    // What the mock device was asked to do.
+    struct DeviceLog
+    {
+        std::mutex                      mutex;
+        uint32_t                        allocators = 0;
+        std::vector<uint32_t>           resets;                 // allocator ids, in order
+        std::vector<uint64_t>           completedAtReset;       // the queue's progress at each
+        size_t                          resetsOfOpenLists = 0;
+        std::map<uint32_t, uint64_t>    inFlightUntil;          // allocator id to the fence value its work retires at
+        size_t                          resetsInFlight = 0;
+    };
+
+    // Allocators and lists that only remember what was recorded, and check they are used as D3D12 requires: a list
+    // is reset only once closed, and an allocator only once the GPU is done with what it recorded.
+    struct MockDevice
+    {
+        struct Allocator
+        {
+            uint32_t    id;
+        };
+
+        struct List
+        {
+            uint32_t                    allocator;
+            bool                        open;
+            std::vector<std::string>    commands;
+        };
+
+        Allocator CreateAllocator()
+        {
+            std::lock_guard<std::mutex> lock(log->mutex);
+            return Allocator{ log->allocators++ };
+        }
+
+        List CreateList(Allocator const& allocator) { return List{ allocator.id, true, {} }; }
+
+        void Reset(Allocator& allocator, List& list)
+        {
+            std::lock_guard<std::mutex> lock(log->mutex);
+            log->resets.push_back(allocator.id);
+            log->completedAtReset.push_back(queue->completed.load());
+            log->resetsOfOpenLists += list.open;
+            auto const inFlight = log->inFlightUntil.find(allocator.id);
+            log->resetsInFlight += inFlight != log->inFlightUntil.end() && queue->completed.load() < inFlight->second;
+
+            list.allocator = allocator.id;
+            list.open = true;
+            list.commands.clear();
+        }
+
+        void Close(List& list) { list.open = false; }
+
+        std::shared_ptr<DeviceLog>  log;
+        ManualQueue*                queue;
+    };
+
+    using Pool = DX::CommandContextPool<MockDevice>;
+
+    // Submit the frame: note the fence value each context's allocator is in flight until, then retire them with it.
+    void Submit(Pool& pool, DX::FenceTimeline& timeline, DeviceLog& log)
+    {
+        const uint64_t value = timeline.Signal();
+        {
+            std::lock_guard<std::mutex> lock(log.mutex);
+            for (auto const& context : pool.GetFrameContexts())
+            {
+                log.inFlightUntil[context->allocator.id] = value;
+            }
+        }
+        pool.EndFrame(value);
+    }
+
+    // Passes that each record their name and index, taking varying time so they finish out of order.
+    std::vector<Pool::Pass> MakePasses(std::vector<std::string> const& names, uint32_t seed)
+    {
+        std::vector<Pool::Pass> passes;
+        std::mt19937 random(seed);
+        for (auto const& name : names)
+        {
+            const auto delay = std::chrono::microseconds(random() % 2000);
+            passes.push_back(Pool::Pass{ name.c_str(), [name, delay](MockDevice::List& list)
+                {
+                    std::this_thread::sleep_for(delay);
+                    for (int i = 0; i < 3; ++i)
+                    {
+                        list.commands.push_back(name + std::to_string(i));
+                    }
+                } });
+        }
+        return passes;
+    }
+
+    // The frame's lists in submission order, each as the name of the pass that recorded it, checking each is closed.
+    std::vector<std::string> SubmittedPasses(Pool& pool)
+    {
+        std::vector<std::string> submitted;
+        for (auto const& context : pool.GetFrameContexts())
+        {
+            DX_CHECK(!context->list.open);
+            DX_CHECK_EQUAL(context->list.commands.size(), size_t(3));
+            auto const& first = context->list.commands.front();
+            submitted.push_back(first.substr(0, first.size() - 1));
+        }
+        return submitted;
+    }
+}
+
+DX_TEST(CommandContextPool, AllocatorsRecycleOnlyOnceTheirFenceCompletes)
+{
+    auto log = std::make_shared<DeviceLog>();
+    ManualQueue queue;
+    DX::FenceTimeline timeline(&queue);
+    Pool pool(MockDevice{ log, &queue }, timeline);
+
+    // Three lists a frame, with the GPU done with all but the last frame when the next starts: two frames' worth are
+    // in use at once
+    const std::vector<std::string> names = { "Sprites", "Wireframe", "Lit", "GUI" };
+    for (uint32_t frame = 1; frame <= 30; ++frame)
+    {
+        if (frame > 2)
+        {
+            queue.completed = frame - 2;
+        }
+        for (uint32_t order = 0; order < 3; ++order)
+        {
+            auto& context = pool.Acquire(order);
+            DX_CHECK(context.list.open);
+            DX_CHECK(context.list.commands.empty());
+            context.list.commands.push_back(names[order] + "0");
+            context.list.commands.push_back(names[order] + "1");
+            context.list.commands.push_back(names[order] + "2");
+            context.list.open = false;
+        }
+        Submit(pool, timeline, *log);
+    }
+    DX_CHECK_EQUAL(pool.GetCreatedCount(), size_t(6));
+    DX_CHECK_EQUAL(log->resets.size(), size_t(30 * 3 - 6));
+    DX_CHECK_EQUAL(log->resetsInFlight, size_t(0));
+    DX_CHECK_EQUAL(log->resetsOfOpenLists, size_t(0));
+
+    // The oldest retired is reused first
+    DX_CHECK_EQUAL(log->resets[0], uint32_t(0));
+    DX_CHECK_EQUAL(log->resets[1], uint32_t(1));
+
+    // While the GPU stalls nothing is reused: the pool grows instead
+    const size_t resets = log->resets.size();
+    for (uint32_t frame = 0; frame < 3; ++frame)
+    {
+        pool.Acquire(0).list.open = false;
+        pool.Acquire(1).list.open = false;
+        Submit(pool, timeline, *log);
+    }
+    DX_CHECK_EQUAL(log->resets.size(), resets);
+    DX_CHECK_EQUAL(pool.GetCreatedCount(), size_t(6 + 3 * 2));
+
+    // Once it catches up, every context is reused and none created
+    queue.completed = timeline.GetLastSignaledValue();
+    const size_t created = pool.GetCreatedCount();
+    for (uint32_t order = 0; order < created; ++order)
+    {
+        pool.Acquire(order).list.open = false;
+    }
+    DX_CHECK_EQUAL(pool.GetCreatedCount(), created);
+    DX_CHECK_EQUAL(log->resetsInFlight, size_t(0));
+}
+
+DX_TEST(CommandContextPool, RecordSubmitsInPassOrder)
+{
+    auto log = std::make_shared<DeviceLog>();
+    ManualQueue queue;
+    DX::FenceTimeline timeline(&queue);
+    Pool pool(MockDevice{ log, &queue }, timeline);
+
+    // Without an executor every pass but the first gets a thread of its own
+    const std::vector<std::string> names = { "Sprites", "Wireframe", "Lit", "GUI", "Post", "Debug" };
+    for (uint32_t frame = 0; frame < 8; ++frame)
+    {
+        queue.completed = timeline.GetLastSignaledValue();
+
+        // Contexts acquired around Record by hand take their place by order too
+        auto& clear = pool.Acquire(0);
+        clear.list.commands = { "Clear0", "Clear1", "Clear2" };
+        pool.GetBackend().Close(clear.list);
+
+        auto const passes = MakePasses(names, frame);
+        pool.Record(passes, 1);
+
+        auto& present = pool.Acquire(100);
+        present.list.commands = { "Present0", "Present1", "Present2" };
+        pool.GetBackend().Close(present.list);
+
+        std::vector<std::string> expected = { "Clear" };
+        expected.insert(expected.end(), names.begin(), names.end());
+        expected.push_back("Present");
+        DX_CHECK(SubmittedPasses(pool) == expected);
+        DX_CHECK_EQUAL(pool.GetPassSeconds().size(), names.size());
+        Submit(pool, timeline, *log);
+    }
+    DX_CHECK_EQUAL(pool.GetCreatedCount(), names.size() + 2);
+    DX_CHECK_EQUAL(log->resetsInFlight, size_t(0));
+    DX_CHECK(pool.GetRecordSeconds() > 0.0);
+
+    // Nothing to record is fine
+    pool.Record({});
+    DX_CHECK(pool.GetFrameContexts().empty());
+}
+
+DX_TEST(CommandContextPool, RecordRunsOnTheExecutor)
+{
+    auto log = std::make_shared<DeviceLog>();
+    ManualQueue queue;
+    DX::FenceTimeline timeline(&queue);
+    Pool pool(MockDevice{ log, &queue }, timeline);
+
+    DX::JobSystem jobs(3);
+    std::atomic<size_t> calls{ 0 };
+    std::mutex threadsMutex;
+    std::set<std::thread::id> threads;
+    pool.SetExecutor([&](size_t count, std::function<void(size_t)> const& body)
+        {
+            calls++;
+            jobs.ParallelFor(count, [&](size_t i)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(threadsMutex);
+                        threads.insert(std::this_thread::get_id());
+                    }
+                    body(i);
+                });
+        });
+
+    const std::vector<std::string> names = { "Sprites", "Wireframe", "Lit", "GUI", "Post", "Debug", "Shadows", "Sky" };
+    for (uint32_t frame = 0; frame < 8; ++frame)
+    {
+        queue.completed = timeline.GetLastSignaledValue();
+        auto const passes = MakePasses(names, 100 + frame);
+        pool.Record(passes);
+        DX_CHECK(SubmittedPasses(pool) == names);
+        Submit(pool, timeline, *log);
+    }
+    DX_CHECK_EQUAL(calls.load(), size_t(8));
+    DX_CHECK(threads.size() > 1);
+    DX_CHECK_EQUAL(pool.GetCreatedCount(), names.size());
+    DX_CHECK_EQUAL(log->resetsInFlight, size_t(0));
+
+    // A serial executor gives the same batch
+    pool.SetExecutor([](size_t count, std::function<void(size_t)> const& body)
+        {
+            for (size_t i = count; i-- > 0;)
+            {
+                body(i);
+            }
+        });
+    pool.Record(MakePasses(names, 7));
+    DX_CHECK(SubmittedPasses(pool) == names);
+}
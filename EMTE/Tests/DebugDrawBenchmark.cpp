@@ -0,0 +1,65 @@
+//
+// DebugDrawBenchmark.cpp - Cost of drawing and merging a million debug lines a frame
+//
+
+#include "TestHarness.h"
+
+#include "DebugDraw.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+
+namespace
+{
+    constexpr size_t LinesPerFrame = 1000000;
+
+    void DrawLines(DX::DebugDraw& draw, size_t begin, size_t end)
+    {
+        auto writer = draw.GetWriter();
+        for (size_t i = begin; i < end; ++i)
+        {
+            const float x = static_cast<float>(i);
+            writer.Line(DX::DebugPoint(x, 0.f, 0.f), DX::DebugPoint(x, 1.f, 0.f), DX::DebugColor(0.f, 1.f, 0.f));
+        }
+    }
+}
+
+DX_BENCHMARK(DebugDraw, MillionLinesPerFrame)
+{
+    // At least a few workers, so that there are buffers to merge even on small machines
+    DX::JobSystem jobs(std::max(DX::JobSystem::DefaultWorkerCount(), 3u));
+
+    // Every worker and the caller may draw; with a single buffer the rest go through the shared, locked one
+    for (uint32_t const maxThreads : { jobs.GetWorkerCount() + 1, 1u })
+    {
+        DX::DebugDraw draw(maxThreads);
+        std::shared_ptr<const DX::DebugDrawList> list;
+
+        // Best of several frames, each drawn then merged
+        double bestDraw = 0.0;
+        double bestMerge = 0.0;
+        for (int frame = 0; frame < 8; ++frame)
+        {
+            list.reset();
+            auto const start = std::chrono::steady_clock::now();
+            jobs.ParallelForRange(LinesPerFrame, 16384, [&](size_t begin, size_t end) { DrawLines(draw, begin, end); });
+            auto const drawn = std::chrono::steady_clock::now();
+            list = draw.Merge();
+            auto const merged = std::chrono::steady_clock::now();
+
+            const double drawMs = std::chrono::duration<double, std::milli>(drawn - start).count();
+            const double mergeMs = std::chrono::duration<double, std::milli>(merged - drawn).count();
+            bestDraw = (frame == 0) ? drawMs : std::min(bestDraw, drawMs);
+            bestMerge = (frame == 0) ? mergeMs : std::min(bestMerge, mergeMs);
+        }
+
+        std::printf("  %u buffers, %u workers: %zu lines drawn in %.2f ms, merged in %.2f ms\n",
+            maxThreads, jobs.GetWorkerCount(), list->GetLineCount(), bestDraw, bestMerge);
+    }
+}
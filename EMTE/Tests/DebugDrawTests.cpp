@@ -0,0 +1,180 @@
+//
+// DebugDrawTests.cpp - Checks that merging gathers every thread's primitives whole and in order
+//
+
+#include "TestHarness.h"
+
+#include "DebugDraw.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    // Each line is tagged with the thread that drew it in x and its index on that thread in y, at both ends.
+    void DrawTagged(DX::DebugDraw& draw, uint32_t thread, uint32_t count)
+    {
+        auto writer = draw.GetWriter();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            writer.Line(DX::DebugPoint(float(thread), float(i), 0.f), DX::DebugPoint(float(thread), float(i), 1.f));
+        }
+    }
+
+    // Run body on count threads of its own, each with its index.
+    template<typename TBody>
+    void OnThreads(uint32_t count, TBody const& body)
+    {
+        std::vector<std::thread> threads;
+        for (uint32_t thread = 0; thread < count; ++thread)
+        {
+            threads.emplace_back([&body, thread]() { body(thread); });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    // Check every line in list is whole, and that each thread's lines are all there in the order drawn.
+    bool IsWholeAndOrdered(DX::DebugDrawList const& list, uint32_t threads, uint32_t perThread)
+    {
+        auto const vertices = list.GetVertices(DX::DebugTopology::Lines);
+        if (vertices.size() != size_t(threads) * perThread * 2)
+            return false;
+
+        std::vector<uint32_t> next(threads, 0);
+        for (size_t i = 0; i < vertices.size(); i += 2)
+        {
+            auto const& a = vertices[i];
+            auto const& b = vertices[i + 1];
+            if (a.position[0] != b.position[0] || a.position[1] != b.position[1] || a.position[2] != 0.f || b.position[2] != 1.f)
+                return false;
+
+            const auto thread = static_cast<uint32_t>(a.position[0]);
+            if (thread >= threads || a.position[1] != float(next[thread]))
+                return false;
+
+            next[thread]++;
+        }
+        return true;
+    }
+}
+
+DX_TEST(DebugDraw, ShapesEmitTheirEdges)
+{
+    DX::DebugDraw draw(4);
+    auto writer = draw.GetWriter();
+
+    writer.Box(DX::DebugPoint(-1.f, -2.f, -3.f), DX::DebugPoint(1.f, 2.f, 3.f));
+    auto const box = draw.Merge();
+    DX_CHECK_EQUAL(box->GetLineCount(), size_t(12));
+
+    // Every edge of an axis-aligned box runs along exactly one axis
+    auto const vertices = box->GetVertices(DX::DebugTopology::Lines);
+    for (size_t i = 0; i < vertices.size(); i += 2)
+    {
+        int axes = 0;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            axes += (vertices[i].position[axis] != vertices[i + 1].position[axis]) ? 1 : 0;
+        }
+        DX_CHECK_EQUAL(axes, 1);
+    }
+
+    struct Matrix
+    {
+        float m[4][4];
+    };
+    constexpr Matrix identity = { { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } } };
+
+    writer.Sphere(DX::DebugPoint(0.f, 0.f, 0.f), 2.f, DX::DebugColor(1.f, 0.f, 0.f), 8);
+    writer.Frustum(identity);
+    writer.Triangle(DX::DebugPoint(0.f, 0.f, 0.f), DX::DebugPoint(1.f, 0.f, 0.f), DX::DebugPoint(0.f, 1.f, 0.f));
+    writer.Label(DX::DebugPoint(0.f, 1.f, 0.f), "origin");
+
+    auto const shapes = draw.Merge();
+    DX_CHECK_EQUAL(shapes->GetLineCount(), size_t(3 * 8 + 12));
+    DX_CHECK_EQUAL(shapes->GetTriangleCount(), size_t(1));
+    DX_CHECK_EQUAL(shapes->labels.size(), size_t(1));
+    DX_CHECK_EQUAL(shapes->labels[0].text, std::string("origin"));
+
+    // The sphere's points lie on it, and the identity frustum is the clip-space box
+    auto const lines = shapes->GetVertices(DX::DebugTopology::Lines);
+    for (size_t i = 0; i < 3 * 8 * 2; ++i)
+    {
+        auto const& p = lines[i].position;
+        DX_CHECK(std::abs(std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]) - 2.f) < 1e-5f);
+        DX_CHECK_EQUAL(lines[i].color[1], 0.f);
+    }
+    for (size_t i = 3 * 8 * 2; i < lines.size(); ++i)
+    {
+        auto const& p = lines[i].position;
+        DX_CHECK(std::abs(p[0]) == 1.f && std::abs(p[1]) == 1.f && (p[2] == 0.f || p[2] == 1.f));
+    }
+}
+
+DX_TEST(DebugDraw, MergeGathersEveryThread)
+{
+    DX::DebugDraw draw(8);
+    for (int frame = 0; frame < 3; ++frame)
+    {
+        OnThreads(8, [&](uint32_t thread)
+            {
+                DrawTagged(draw, thread, 1000);
+                draw.GetWriter().Label(DX::DebugPoint(), "thread");
+            });
+
+        auto const list = draw.Merge();
+        DX_CHECK(IsWholeAndOrdered(*list, 8, 1000));
+        DX_CHECK_EQUAL(list->labels.size(), size_t(8));
+        DX_CHECK_EQUAL(draw.GetMergedLineCount(), size_t(8000));
+    }
+
+    // Every frame's threads are new ones, so each claimed a buffer; merging emptied them all
+    DX_CHECK_EQUAL(draw.GetThreadCount(), 8u * 3u);
+    auto const empty = draw.Merge();
+    DX_CHECK_EQUAL(empty->GetLineCount(), size_t(0));
+    DX_CHECK_EQUAL(empty->labels.size(), size_t(0));
+}
+
+DX_TEST(DebugDraw, ThreadsBeyondTheLimitShareABuffer)
+{
+    // More threads than buffers, all drawing at once: the extra ones lock a shared buffer instead of failing
+    DX::DebugDraw draw(2);
+    OnThreads(12, [&](uint32_t thread) { DrawTagged(draw, thread, 5000); });
+
+    auto const list = draw.Merge();
+    DX_CHECK(IsWholeAndOrdered(*list, 12, 5000));
+    DX_CHECK_EQUAL(draw.GetThreadCount(), 12u);
+
+    // A second round through the shared buffer merges as cleanly
+    OnThreads(12, [&](uint32_t thread) { DrawTagged(draw, thread, 100); });
+    DX_CHECK(IsWholeAndOrdered(*draw.Merge(), 12, 100));
+}
+
+DX_TEST(DebugDraw, HeldListsAreNotReused)
+{
+    DX::DebugDraw draw;
+    DrawTagged(draw, 0, 10);
+    auto held = draw.Merge();
+    DX::DebugDrawList const* const heldAddress = held.get();
+
+    // The renderer still holds the last list, so the next merge fills another
+    DrawTagged(draw, 0, 20);
+    auto next = draw.Merge();
+    DX_CHECK(next.get() != heldAddress);
+    DX_CHECK(IsWholeAndOrdered(*held, 1, 10));
+    DX_CHECK(IsWholeAndOrdered(*next, 1, 20));
+
+    // Once released, a list is reused
+    held.reset();
+    DrawTagged(draw, 0, 30);
+    auto const reused = draw.Merge();
+    DX_CHECK(reused.get() == heldAddress);
+    DX_CHECK(IsWholeAndOrdered(*reused, 1, 30));
+}
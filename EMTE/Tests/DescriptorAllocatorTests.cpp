@@ -0,0 +1,203 @@
+//
+// DescriptorAllocatorTests.cpp - Generation handles, free-list reuse and the transient ring's wrap and retire
+//
+
+#include "TestHarness.h"
+
+#include "DescriptorAllocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+DX_TEST(DescriptorAllocator, SplitsTheHeap)
+{
+    DX::DescriptorAllocator allocator(100, 30);
+    DX_CHECK_EQUAL(allocator.GetCapacity(), 100u);
+    DX_CHECK_EQUAL(allocator.GetPersistentCapacity(), 70u);
+    DX_CHECK_EQUAL(allocator.GetTransientCapacity(), 30u);
+
+    DX_CHECK_THROWS(DX::DescriptorAllocator(10, 11), std::out_of_range);
+}
+
+DX_TEST(DescriptorAllocator, StaleHandlesAreRejected)
+{
+    DX::DescriptorAllocator allocator(16, 0);
+    auto const a = allocator.Allocate();
+    auto const b = allocator.Allocate();
+    DX_CHECK_EQUAL(a.index, 0u);
+    DX_CHECK_EQUAL(b.index, 1u);
+    DX_CHECK_EQUAL(allocator.Resolve(b), 1u);
+
+    // Freeing bumps the slot's generation, so the old handle no longer resolves even once the slot is reused
+    allocator.Free(b);
+    DX_CHECK(!allocator.IsAlive(b));
+    DX_CHECK_THROWS(allocator.Resolve(b), std::invalid_argument);
+    DX_CHECK_THROWS(allocator.Free(b), std::invalid_argument);
+
+    auto const c = allocator.Allocate();
+    DX_CHECK_EQUAL(c.index, 1u);
+    DX_CHECK_EQUAL(c.generation, 1u);
+    DX_CHECK(allocator.IsAlive(c));
+    DX_CHECK(!allocator.IsAlive(b));
+    DX_CHECK(allocator.IsAlive(a));
+
+    // Default handles, and indices never handed out, are invalid
+    DX::DescriptorAllocator::Handle none;
+    DX_CHECK(!none.IsValid());
+    DX_CHECK(!allocator.IsAlive(none));
+    DX_CHECK(!allocator.IsAlive(DX::DescriptorAllocator::Handle{ 5, 0 }));
+    DX_CHECK_THROWS(allocator.Resolve(none), std::invalid_argument);
+}
+
+DX_TEST(DescriptorAllocator, FreedSlotsAreReusedFirst)
+{
+    DX::DescriptorAllocator allocator(8, 0);
+    std::vector<DX::DescriptorAllocator::Handle> handles;
+    for (int i = 0; i < 5; ++i)
+    {
+        handles.push_back(allocator.Allocate());
+    }
+
+    allocator.Free(handles[1]);
+    allocator.Free(handles[3]);
+    DX_CHECK_EQUAL(allocator.GetAllocatedCount(), 3u);
+
+    // The most recently freed slot comes back first, and the high water mark does not move
+    DX_CHECK_EQUAL(allocator.Allocate().index, 3u);
+    DX_CHECK_EQUAL(allocator.Allocate().index, 1u);
+    DX_CHECK_EQUAL(allocator.Allocate().index, 5u);
+    DX_CHECK_EQUAL(allocator.GetHighWaterMark(), 6u);
+    DX_CHECK_EQUAL(allocator.GetAllocatedCount(), 6u);
+}
+
+DX_TEST(DescriptorAllocator, PersistentRegionFills)
+{
+    DX::DescriptorAllocator allocator(6, 2);
+    std::vector<DX::DescriptorAllocator::Handle> handles;
+    for (int i = 0; i < 4; ++i)
+    {
+        handles.push_back(allocator.Allocate());
+    }
+
+    // The transient ring's slots are never handed out as persistent ones
+    DX_CHECK_THROWS(allocator.Allocate(), std::runtime_error);
+
+    allocator.Free(handles[2]);
+    DX_CHECK_EQUAL(allocator.Allocate().index, 2u);
+    DX_CHECK_THROWS(allocator.Allocate(), std::runtime_error);
+}
+
+DX_TEST(DescriptorAllocator, TransientRingWrapsAndRetires)
+{
+    // Heap indices 8 to 15 are the ring
+    DX::DescriptorAllocator allocator(16, 8);
+    DX_CHECK_EQUAL(allocator.AllocateTransient(3), 8u);
+    DX_CHECK_EQUAL(allocator.AllocateTransient(3), 11u);
+    allocator.EndFrame(1);
+    DX_CHECK_EQUAL(allocator.GetTransientInUse(), 6u);
+
+    // Three more would straddle the end of the ring, so they wrap to its start, which frame 1 still holds
+    DX_CHECK_THROWS(allocator.AllocateTransient(3), std::runtime_error);
+    DX_CHECK_EQUAL(allocator.AllocateTransient(2), 14u);
+    allocator.EndFrame(2);
+
+    // Retiring frame 1 frees its six slots; the wrap then skips nothing, as the ring's end is exactly full
+    allocator.RetireTransient(1);
+    DX_CHECK_EQUAL(allocator.GetTransientInUse(), 2u);
+    DX_CHECK_EQUAL(allocator.AllocateTransient(3), 8u);
+    DX_CHECK_EQUAL(allocator.AllocateTransient(3), 11u);
+    DX_CHECK_THROWS(allocator.AllocateTransient(1), std::runtime_error);
+    allocator.EndFrame(3);
+
+    // Frames retire only once their own value completes, in order
+    allocator.RetireTransient(2);
+    DX_CHECK_EQUAL(allocator.GetTransientInUse(), 6u);
+    DX_CHECK_EQUAL(allocator.AllocateTransient(1), 14u);
+    allocator.EndFrame(4);
+    allocator.RetireTransient(4);
+    DX_CHECK_EQUAL(allocator.GetTransientInUse(), 0u);
+
+    // A skipped remainder counts as in use until its frame retires
+    DX_CHECK_EQUAL(allocator.AllocateTransient(2), 8u);
+    DX_CHECK_EQUAL(allocator.GetTransientInUse(), 3u);
+}
+
+DX_TEST(DescriptorAllocator, TransientRequestsAreBounded)
+{
+    DX::DescriptorAllocator allocator(16, 8);
+    DX_CHECK_THROWS(allocator.AllocateTransient(0), std::out_of_range);
+    DX_CHECK_THROWS(allocator.AllocateTransient(9), std::out_of_range);
+    DX_CHECK_EQUAL(allocator.AllocateTransient(8), 8u);
+
+    // A frame without transient allocations adds nothing to retire
+    allocator.EndFrame(1);
+    allocator.EndFrame(2);
+    allocator.RetireTransient(1);
+    DX_CHECK_EQUAL(allocator.GetTransientInUse(), 0u);
+
+    DX::DescriptorAllocator persistentOnly(16, 0);
+    DX_CHECK_THROWS(persistentOnly.AllocateTransient(1), std::out_of_range);
+}
+
+DX_TEST(DescriptorAllocator, TransientSlotsInFlightNeverOverlap)
+{
+    // Random frames with up to three in flight: a slot handed out must not belong to any frame the GPU may still read
+    constexpr uint32_t Persistent = 4;
+    constexpr uint32_t Ring = 64;
+    DX::DescriptorAllocator allocator(Persistent + Ring, Ring);
+
+    std::mt19937 random(11);
+    std::vector<uint64_t> owner(Ring, 0);
+    std::deque<uint64_t> inFlight;
+    size_t allocations = 0;
+    size_t fullRings = 0;
+    for (uint64_t frame = 1; frame <= 5000; ++frame)
+    {
+        if (inFlight.size() == 3)
+        {
+            allocator.RetireTransient(inFlight.front());
+            inFlight.pop_front();
+        }
+
+        const uint32_t requests = random() % 6;
+        for (uint32_t request = 0; request < requests; ++request)
+        {
+            const uint32_t count = 1 + random() % 12;
+            uint32_t first;
+            try
+            {
+                first = allocator.AllocateTransient(count);
+            }
+            catch (std::runtime_error const&)
+            {
+                fullRings++;
+                continue;
+            }
+
+            DX_CHECK(first >= Persistent && first + count <= Persistent + Ring);
+            for (uint32_t slot = first - Persistent; slot < first - Persistent + count; ++slot)
+            {
+                DX_CHECK(owner[slot] != frame);
+                for (auto const pending : inFlight)
+                {
+                    DX_CHECK(owner[slot] != pending);
+                }
+                owner[slot] = frame;
+            }
+            allocations++;
+        }
+
+        allocator.EndFrame(frame);
+        inFlight.push_back(frame);
+    }
+
+    // The test is only meaningful if the ring both wrapped many times and ran out now and then
+    DX_CHECK(allocations > 10000);
+    DX_CHECK(fullRings > 0);
+}
@@ -0,0 +1,343 @@
+//
+// FenceTimelineTests.cpp - Drives fence timelines against a simulated queue: waits, timeouts and deferred callbacks
+//
+
+#include "TestHarness.h"
+
+#include "FenceTimeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    // A queue whose work completes only when the test says so. Waits block on a condition variable, as the D3D12
+    // backend blocks on an event.
+    class SimulatedQueue final : public DX::IFenceBackend
+    {
+    public:
+        bool Signal(uint64_t value) noexcept override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_signaled = value;
+            return !m_rejectSignals;
+        }
+
+        uint64_t GetCompletedValue() noexcept override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_completed;
+        }
+
+        bool Wait(uint64_t value, uint32_t timeoutMs) noexcept override
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_waits++;
+
+            // As a stale event registration for a lower value would
+            if (m_wakeEarly)
+                return true;
+
+            auto const reached = [&]() { return m_completed >= value; };
+            if (timeoutMs == DX::FenceTimeline::Infinite)
+            {
+                m_condition.wait(lock, reached);
+                return true;
+            }
+            return m_condition.wait_for(lock, std::chrono::milliseconds(timeoutMs), reached);
+        }
+
+        // Complete the queue's work up to value.
+        void Complete(uint64_t value)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_completed = std::max(m_completed, value);
+            }
+            m_condition.notify_all();
+        }
+
+        void CompleteAll() { Complete(m_signaled); }
+
+        void SetWakeEarly(bool wakeEarly) { std::lock_guard<std::mutex> lock(m_mutex); m_wakeEarly = wakeEarly; }
+        void SetRejectSignals(bool reject) { std::lock_guard<std::mutex> lock(m_mutex); m_rejectSignals = reject; }
+        size_t GetWaits() { std::lock_guard<std::mutex> lock(m_mutex); return m_waits; }
+
+    private:
+        std::mutex                  m_mutex;
+        std::condition_variable     m_condition;
+        uint64_t                    m_signaled = 0;
+        uint64_t                    m_completed = 0;
+        size_t                      m_waits = 0;
+        bool                        m_wakeEarly = false;
+        bool                        m_rejectSignals = false;
+    };
+
+    // Complete value on queue after delay, from another thread.
+    std::thread CompleteLater(SimulatedQueue& queue, uint64_t value, std::chrono::milliseconds delay)
+    {
+        return std::thread([&queue, value, delay]()
+            {
+                std::this_thread::sleep_for(delay);
+                queue.Complete(value);
+            });
+    }
+
+    class RecordingObserver final : public DX::IFenceObserver
+    {
+    public:
+        void OnSignal(DX::FenceTimeline const&, uint64_t value) noexcept override { events.push_back('S'); values.push_back(value); }
+        void OnWaitBegin(DX::FenceTimeline const&, uint64_t value) noexcept override { events.push_back('B'); values.push_back(value); }
+        void OnWaitEnd(DX::FenceTimeline const&, uint64_t value) noexcept override { events.push_back('E'); values.push_back(value); }
+
+        std::vector<char>       events;
+        std::vector<uint64_t>   values;
+    };
+}
+
+DX_TEST(FenceTimeline, SignalsAreMonotonic)
+{
+    SimulatedQueue queue;
+    DX::FenceTimeline timeline(&queue, 10);
+
+    DX_CHECK_EQUAL(timeline.GetNextValue(), uint64_t(11));
+    DX_CHECK_EQUAL(timeline.Signal(), uint64_t(11));
+    DX_CHECK_EQUAL(timeline.Signal(), uint64_t(12));
+    DX_CHECK_EQUAL(timeline.GetLastSignaledValue(), uint64_t(12));
+    DX_CHECK(timeline.IsComplete(10));
+    DX_CHECK(!timeline.IsComplete(11));
+
+    queue.Complete(11);
+    DX_CHECK(timeline.IsComplete(11));
+    DX_CHECK(!timeline.IsComplete(12));
+
+    // A rejected signal does not use up its value
+    queue.SetRejectSignals(true);
+    DX_CHECK_EQUAL(timeline.Signal(), uint64_t(0));
+    DX_CHECK_EQUAL(timeline.GetNextValue(), uint64_t(13));
+
+    DX::FenceTimeline unbound;
+    DX_CHECK_EQUAL(unbound.Signal(), uint64_t(0));
+    DX_CHECK(!unbound.Wait(1, 0));
+}
+
+DX_TEST(FenceTimeline, WaitBlocksUntilTheQueueCompletes)
+{
+    SimulatedQueue queue;
+    DX::FenceTimeline timeline(&queue);
+    const uint64_t value = timeline.Signal();
+
+    auto completer = CompleteLater(queue, value, std::chrono::milliseconds(20));
+    DX_CHECK(timeline.Wait(value));
+    completer.join();
+
+    DX_CHECK(timeline.IsComplete(value));
+    DX_CHECK_EQUAL(timeline.GetWaitCount(), uint64_t(1));
+    DX_CHECK(timeline.GetWaitSeconds() >= 0.015);
+
+    // Waiting on a value already reached does not block, and is not idle time
+    DX_CHECK(timeline.Wait(value));
+    DX_CHECK_EQUAL(timeline.GetWaitCount(), uint64_t(1));
+
+    timeline.ResetWaitStatistics();
+    DX_CHECK_EQUAL(timeline.GetWaitCount(), uint64_t(0));
+    DX_CHECK_EQUAL(timeline.GetWaitSeconds(), 0.0);
+}
+
+DX_TEST(FenceTimeline, WaitTimesOut)
+{
+    SimulatedQueue queue;
+    DX::FenceTimeline timeline(&queue);
+    const uint64_t value = timeline.Signal();
+
+    auto const start = std::chrono::steady_clock::now();
+    DX_CHECK(!timeline.Wait(value, 10));
+    DX_CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(10));
+    DX_CHECK(!timeline.IsComplete(value));
+    DX_CHECK_EQUAL(timeline.GetWaitCount(), uint64_t(1));
+    DX_CHECK(timeline.GetWaitSeconds() >= 0.009);
+
+    // A value never signaled could never complete, so it fails without waiting
+    DX_CHECK(!timeline.Wait(value + 1));
+    DX_CHECK_EQUAL(queue.GetWaits(), size_t(1));
+}
+
+DX_TEST(FenceTimeline, EarlyWakeDoesNotCompleteTheValue)
+{
+    SimulatedQueue queue;
+    DX::FenceTimeline timeline(&queue);
+    const uint64_t first = timeline.Signal();
+    const uint64_t second = timeline.Signal();
+
+    bool fired = false;
+    timeline.OnCompletion(second, [&]() { fired = true; });
+
+    // The backend reports success while the queue has only reached the first value
+    queue.Complete(first);
+    queue.SetWakeEarly(true);
+    DX_CHECK(!timeline.Wait(second));
+    DX_CHECK_EQUAL(timeline.GetCompletedValue(), first);
+    DX_CHECK(!timeline.IsComplete(second));
+    DX_CHECK_EQUAL(timeline.ProcessCompletions(), size_t(0));
+    DX_CHECK(!fired);
+
+    queue.SetWakeEarly(false);
+    queue.Complete(second);
+    DX_CHECK(timeline.Wait(second));
+    DX_CHECK_EQUAL(timeline.ProcessCompletions(), size_t(1));
+    DX_CHECK(fired);
+}
+
+DX_TEST(FenceTimeline, CallbacksRunInOrderOnceTheirValueCompletes)
+{
+    SimulatedQueue queue;
+    DX::FenceTimeline timeline(&queue);
+
+    std::vector<int> order;
+    const uint64_t first = timeline.Signal();
+    timeline.OnCompletion(first, [&]() { order.push_back(1); });
+    timeline.OnCompletion(first, [&]() { order.push_back(2); });
+    const uint64_t second = timeline.Signal();
+    timeline.OnCompletion(second, [&]() { order.push_back(3); });
+
+    DX_CHECK_EQUAL(timeline.ProcessCompletions(), size_t(0));
+    DX_CHECK_EQUAL(timeline.GetPendingCallbackCount(), size_t(3));
+
+    queue.Complete(first);
+    DX_CHECK_EQUAL(timeline.ProcessCompletions(), size_t(2));
+    DX_CHECK(order == (std::vector<int>{ 1, 2 }));
+
+    // A callback may add another; it runs on a later pass
+    timeline.OnCompletion(second, [&]() { timeline.OnCompletion(second, [&]() { order.push_back(4); }); });
+    queue.CompleteAll();
+    DX_CHECK_EQUAL(timeline.ProcessCompletions(), size_t(2));
+    DX_CHECK(order == (std::vector<int>{ 1, 2, 3 }));
+    DX_CHECK_EQUAL(timeline.ProcessCompletions(), size_t(1));
+    DX_CHECK(order == (std::vector<int>{ 1, 2, 3, 4 }));
+
+    // Rebinding the backend drops whatever is still pending
+    timeline.OnCompletion(timeline.Signal(), [&]() { order.push_back(5); });
+    SimulatedQueue replacement;
+    timeline.SetBackend(&replacement);
+    DX_CHECK_EQUAL(timeline.GetPendingCallbackCount(), size_t(0));
+    DX_CHECK_EQUAL(timeline.GetNextValue(), uint64_t(1));
+}
+
+DX_TEST(FenceTimeline, WaitAnyReturnsTheFirstToComplete)
+{
+    SimulatedQueue graphics;
+    SimulatedQueue copy;
+    DX::FenceTimeline graphicsTimeline(&graphics);
+    DX::FenceTimeline copyTimeline(&copy);
+
+    const DX::FenceTimeline::Point points[] =
+    {
+        { &graphicsTimeline, graphicsTimeline.Signal() },
+        { &copyTimeline, copyTimeline.Signal() },
+    };
+
+    auto completer = CompleteLater(copy, 1, std::chrono::milliseconds(20));
+    DX_CHECK_EQUAL(DX::FenceTimeline::WaitAny(points), size_t(1));
+    completer.join();
+    DX_CHECK(!graphicsTimeline.IsComplete(1));
+
+    // Nothing more completes, so a bounded wait for the graphics point times out
+    DX_CHECK_EQUAL(DX::FenceTimeline::WaitAny(std::span(points, 1), 10), size_t(1));
+
+    // A point that was never signaled fails at once
+    const DX::FenceTimeline::Point unsignaled[] = { { &graphicsTimeline, 2 } };
+    DX_CHECK_EQUAL(DX::FenceTimeline::WaitAny(unsignaled), size_t(1));
+    DX_CHECK_EQUAL(DX::FenceTimeline::WaitAny({}), size_t(0));
+
+    // Waking on one queue never completes the other
+    graphics.SetWakeEarly(true);
+    DX_CHECK_EQUAL(DX::FenceTimeline::WaitAny(std::span(points, 1), 10), size_t(1));
+    DX_CHECK(!graphicsTimeline.IsComplete(1));
+}
+
+DX_TEST(FenceTimeline, WaitAllWaitsForEveryPoint)
+{
+    SimulatedQueue graphics;
+    SimulatedQueue copy;
+    DX::FenceTimeline graphicsTimeline(&graphics);
+    DX::FenceTimeline copyTimeline(&copy);
+
+    const DX::FenceTimeline::Point points[] =
+    {
+        { &graphicsTimeline, graphicsTimeline.Signal() },
+        { &copyTimeline, copyTimeline.Signal() },
+    };
+
+    // Only one queue finishes in time
+    copy.Complete(1);
+    DX_CHECK(!DX::FenceTimeline::WaitAll(points, 10));
+
+    auto completer = CompleteLater(graphics, 1, std::chrono::milliseconds(20));
+    DX_CHECK(DX::FenceTimeline::WaitAll(points));
+    completer.join();
+    DX_CHECK(graphicsTimeline.IsComplete(1) && copyTimeline.IsComplete(1));
+    DX_CHECK(DX::FenceTimeline::WaitAll({}));
+}
+
+DX_TEST(FenceTimeline, ObserverSeesSignalsAndBlockingWaits)
+{
+    SimulatedQueue queue;
+    DX::FenceTimeline timeline(&queue);
+    RecordingObserver observer;
+    timeline.SetObserver(&observer);
+
+    const uint64_t value = timeline.Signal();
+    DX_CHECK(!timeline.Wait(value, 1));
+    queue.Complete(value);
+    DX_CHECK(timeline.Wait(value));
+    timeline.SetObserver(nullptr);
+    timeline.Signal();
+
+    // The second wait found the value complete, so did not block
+    DX_CHECK(observer.events == (std::vector<char>{ 'S', 'B', 'E' }));
+    DX_CHECK(observer.values == (std::vector<uint64_t>{ 1, 1, 1 }));
+}
+
+DX_TEST(FenceTimeline, ConcurrentWaitersAllWake)
+{
+    SimulatedQueue queue;
+    DX::FenceTimeline timeline(&queue);
+    for (int i = 0; i < 8; ++i)
+    {
+        timeline.Signal();
+    }
+
+    // Each thread waits on its own value, some with timeouts that keep expiring and retrying
+    std::vector<std::thread> waiters;
+    std::vector<int> results(8, 0);
+    for (uint64_t value = 1; value <= 8; ++value)
+    {
+        waiters.emplace_back([&, value]()
+            {
+                while (!timeline.Wait(value, (value % 2) ? 1 : DX::FenceTimeline::Infinite))
+                {
+                }
+                results[value - 1] = timeline.IsComplete(value) ? 1 : 0;
+            });
+    }
+
+    for (uint64_t value = 1; value <= 8; ++value)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        queue.Complete(value);
+    }
+    for (auto& waiter : waiters)
+    {
+        waiter.join();
+    }
+
+    DX_CHECK(results == std::vector<int>(8, 1));
+    DX_CHECK_EQUAL(timeline.GetCompletedValue(), uint64_t(8));
+}
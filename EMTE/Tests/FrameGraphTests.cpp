@@ -0,0 +1,246 @@
+//
+// FrameGraphTests.cpp - Golden barrier sequences for compiled frame graphs, including the game's own
+//
+
+#include "TestHarness.h"
+
+#include "FrameGraph.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+
+namespace
+{
+    using DX::ResourceState;
+
+    std::string ToString(ResourceState state)
+    {
+        static constexpr struct { ResourceState state; const char* name; } names[] = {
+            { ResourceState::RenderTarget, "RenderTarget" },
+            { ResourceState::DepthWrite, "DepthWrite" },
+            { ResourceState::UnorderedAccess, "UnorderedAccess" },
+            { ResourceState::CopyDest, "CopyDest" },
+            { ResourceState::DepthRead, "DepthRead" },
+            { ResourceState::PixelShaderResource, "PixelShaderResource" },
+            { ResourceState::NonPixelShaderResource, "NonPixelShaderResource" },
+            { ResourceState::CopySource, "CopySource" },
+            { ResourceState::Present, "Present" },
+        };
+
+        std::string text;
+        for (auto const& entry : names)
+        {
+            if ((state & entry.state) == entry.state)
+            {
+                text += (text.empty() ? "" : "|") + std::string(entry.name);
+            }
+        }
+        return text.empty() ? "Undefined" : text;
+    }
+
+    std::string ToString(DX::FrameGraph const& graph, DX::FrameGraph::Barrier const& barrier)
+    {
+        return std::string(graph.GetResource(barrier.resource).name) + " " + ToString(barrier.before) + "->"
+            + ToString(barrier.after) + (barrier.aliasing ? " (aliasing)" : "");
+    }
+
+    // The compiled graph, one line per surviving pass with the barriers issued before it, then the final barriers.
+    std::string Describe(DX::FrameGraph const& graph)
+    {
+        std::string text;
+        for (auto const& pass : graph.GetCompiledPasses())
+        {
+            text += pass.name;
+            text += ":";
+            for (auto const& barrier : pass.GetBarriers(graph))
+            {
+                text += " [" + ToString(graph, barrier) + "]";
+            }
+            text += "\n";
+        }
+
+        text += "final:";
+        for (auto const& barrier : graph.GetFinalBarriers())
+        {
+            text += " [" + ToString(graph, barrier) + "]";
+        }
+        text += "\n";
+        return text;
+    }
+
+    // The graph Game::BuildFrameGraph declares, with the offscreen target starting in offscreenState.
+    void BuildGameGraph(DX::FrameGraph& graph, ResourceState offscreenState)
+    {
+        auto const offscreen = graph.Import("Offscreen", offscreenState);
+        auto const depth = graph.Import("Depth", ResourceState::DepthWrite, ResourceState::DepthWrite);
+        auto const backBuffer = graph.Import("BackBuffer", ResourceState::RenderTarget, ResourceState::RenderTarget, true);
+
+        graph.AddPass("Clear")
+            .Write(offscreen, ResourceState::RenderTarget, true)
+            .Write(depth, ResourceState::DepthWrite, true);
+        graph.AddPass("Sprites")
+            .Write(offscreen, ResourceState::RenderTarget);
+        graph.AddPass("Wireframe")
+            .Write(offscreen, ResourceState::RenderTarget)
+            .Write(depth, ResourceState::DepthWrite);
+        graph.AddPass("Lit")
+            .Write(offscreen, ResourceState::RenderTarget)
+            .Write(depth, ResourceState::DepthWrite);
+        graph.AddPass("Composite")
+            .Read(offscreen, ResourceState::PixelShaderResource)
+            .Write(backBuffer, ResourceState::RenderTarget);
+        graph.AddPass("GUI")
+            .Write(backBuffer, ResourceState::RenderTarget);
+    }
+}
+
+DX_TEST(FrameGraph, GameFrame)
+{
+    // Every frame after the first: the offscreen target was last sampled by the previous frame's composite
+    DX::FrameGraph graph;
+    BuildGameGraph(graph, ResourceState::PixelShaderResource);
+    graph.Compile();
+
+    DX_CHECK_EQUAL(Describe(graph),
+        "Clear: [Offscreen PixelShaderResource->RenderTarget]\n"
+        "Sprites:\n"
+        "Wireframe:\n"
+        "Lit:\n"
+        "Composite: [Offscreen RenderTarget->PixelShaderResource]\n"
+        "GUI:\n"
+        "final:\n");
+    DX_CHECK_EQUAL(graph.GetBarrierCount(), size_t(2));
+    DX_CHECK_EQUAL(graph.GetCulledCount(), size_t(0));
+    DX_CHECK(graph.GetResource(0).endState == ResourceState::PixelShaderResource);
+}
+
+DX_TEST(FrameGraph, GameFirstFrame)
+{
+    // A new or pooled target starts as a render target, so the first frame needs no transition into Clear
+    DX::FrameGraph graph;
+    BuildGameGraph(graph, ResourceState::RenderTarget);
+    graph.Compile();
+
+    DX_CHECK_EQUAL(Describe(graph),
+        "Clear:\n"
+        "Sprites:\n"
+        "Wireframe:\n"
+        "Lit:\n"
+        "Composite: [Offscreen RenderTarget->PixelShaderResource]\n"
+        "GUI:\n"
+        "final:\n");
+
+    // Rebuilding after Reset gives the same result
+    graph.Reset();
+    BuildGameGraph(graph, ResourceState::PixelShaderResource);
+    graph.Compile();
+    DX_CHECK_EQUAL(graph.GetBarrierCount(), size_t(2));
+}
+
+DX_TEST(FrameGraph, UnusedPassesAreCulled)
+{
+    DX::FrameGraph graph;
+    auto const backBuffer = graph.Import("BackBuffer", ResourceState::Present, ResourceState::Present, true);
+    auto const unused = graph.CreateTransient("Unused");
+    auto const scene = graph.CreateTransient("Scene");
+
+    graph.AddPass("Overwritten").Write(scene, ResourceState::RenderTarget);
+    graph.AddPass("Nobody reads this").Write(unused, ResourceState::UnorderedAccess);
+    graph.AddPass("Scene").Write(scene, ResourceState::RenderTarget, true);
+    graph.AddPass("Capture").Read(scene, ResourceState::CopySource).SideEffect();
+    graph.AddPass("Tonemap").Read(scene, ResourceState::PixelShaderResource).Write(backBuffer, ResourceState::RenderTarget);
+    graph.Compile();
+
+    // The discarding write makes the first pass's output irrelevant; the two reads share one combined transition
+    DX_CHECK_EQUAL(Describe(graph),
+        "Scene: [Scene Undefined->RenderTarget (aliasing)]\n"
+        "Capture: [Scene RenderTarget->PixelShaderResource|CopySource]\n"
+        "Tonemap: [BackBuffer Present->RenderTarget]\n"
+        "final: [BackBuffer RenderTarget->Present]\n");
+    DX_CHECK_EQUAL(graph.GetCulledCount(), size_t(2));
+    DX_CHECK_EQUAL(graph.GetResource(unused).firstPass, DX::FrameGraph::Unused);
+    DX_CHECK_EQUAL(graph.GetResource(scene).firstPass, uint32_t(0));
+    DX_CHECK_EQUAL(graph.GetResource(scene).lastPass, uint32_t(2));
+}
+
+DX_TEST(FrameGraph, ReadsBetweenWritesTransitionOnce)
+{
+    DX::FrameGraph graph;
+    auto const depth = graph.Import("Depth", ResourceState::DepthWrite, ResourceState::DepthWrite);
+    auto const color = graph.Import("Color", ResourceState::RenderTarget, ResourceState::Undefined, true);
+
+    graph.AddPass("Prepass").Write(depth, ResourceState::DepthWrite);
+    graph.AddPass("Test").Read(depth, ResourceState::DepthRead).Write(color, ResourceState::RenderTarget);
+    graph.AddPass("Sample").Read(depth, ResourceState::NonPixelShaderResource).Write(color, ResourceState::RenderTarget);
+    graph.AddPass("Fog").Read(depth, ResourceState::PixelShaderResource).Write(color, ResourceState::RenderTarget);
+    graph.AddPass("Decals").Write(depth, ResourceState::DepthWrite).Write(color, ResourceState::RenderTarget);
+    graph.AddPass("Again").Read(depth, ResourceState::PixelShaderResource).Write(color, ResourceState::RenderTarget);
+    graph.Compile();
+
+    DX_CHECK_EQUAL(Describe(graph),
+        "Prepass:\n"
+        "Test: [Depth DepthWrite->DepthRead|PixelShaderResource|NonPixelShaderResource]\n"
+        "Sample:\n"
+        "Fog:\n"
+        "Decals: [Depth DepthRead|PixelShaderResource|NonPixelShaderResource->DepthWrite]\n"
+        "Again: [Depth DepthWrite->PixelShaderResource]\n"
+        "final: [Depth PixelShaderResource->DepthWrite]\n");
+
+    // Color has no final state, so it is left as the last pass left it
+    DX_CHECK(graph.GetResource(color).endState == ResourceState::RenderTarget);
+}
+
+DX_TEST(FrameGraph, TransientsAliasOnFirstUse)
+{
+    DX::FrameGraph graph;
+    auto const output = graph.Import("Output", ResourceState::RenderTarget, ResourceState::Undefined, true);
+    auto const half = graph.CreateTransient("Half", ResourceState::PixelShaderResource);
+    auto const quarter = graph.CreateTransient("Quarter");
+
+    graph.AddPass("Down").Write(half, ResourceState::RenderTarget);
+    graph.AddPass("Down again").Read(half, ResourceState::PixelShaderResource).Write(quarter, ResourceState::UnorderedAccess);
+    graph.AddPass("Up").Read(quarter, ResourceState::PixelShaderResource)
+        .Read(quarter, ResourceState::NonPixelShaderResource).Write(output, ResourceState::RenderTarget);
+    graph.Compile();
+
+    // A transient's first barrier is an aliasing barrier even when its state is unchanged, and a pass declaring a
+    // resource twice gets one barrier for it
+    DX_CHECK_EQUAL(Describe(graph),
+        "Down: [Half PixelShaderResource->RenderTarget (aliasing)]\n"
+        "Down again: [Half RenderTarget->PixelShaderResource] [Quarter Undefined->UnorderedAccess (aliasing)]\n"
+        "Up: [Quarter UnorderedAccess->PixelShaderResource|NonPixelShaderResource]\n"
+        "final:\n");
+
+    graph.Reset();
+    auto const target = graph.CreateTransient("Target", ResourceState::RenderTarget);
+    graph.AddPass("Draw").Write(target, ResourceState::RenderTarget).SideEffect();
+    graph.Compile();
+    DX_CHECK_EQUAL(Describe(graph), "Draw: [Target RenderTarget->RenderTarget (aliasing)]\nfinal:\n");
+}
+
+DX_TEST(FrameGraph, MisuseThrows)
+{
+    DX::FrameGraph graph;
+    auto const target = graph.Import("Target", ResourceState::RenderTarget, ResourceState::Undefined, true);
+
+    DX_CHECK_THROWS(graph.GetCompiledPasses(), std::logic_error);
+
+    auto first = graph.AddPass("First");
+    DX_CHECK_THROWS(first.Read(target, ResourceState::RenderTarget), std::invalid_argument);
+    DX_CHECK_THROWS(first.Write(target, ResourceState::PixelShaderResource), std::invalid_argument);
+    DX_CHECK_THROWS(first.Write(target, ResourceState::Undefined), std::invalid_argument);
+    DX_CHECK_THROWS(first.Write(target + 1, ResourceState::RenderTarget), std::out_of_range);
+
+    graph.AddPass("Second").Write(target, ResourceState::RenderTarget);
+    DX_CHECK_THROWS(first.Write(target, ResourceState::RenderTarget), std::logic_error);
+
+    graph.Compile();
+    DX_CHECK_EQUAL(graph.GetCompiledPasses().size(), size_t(1));
+
+    // Declaring anything more invalidates the compiled result
+    graph.AddPass("Third");
+    DX_CHECK_THROWS(graph.GetFinalBarriers(), std::logic_error);
+}
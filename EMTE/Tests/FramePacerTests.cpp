@@ -0,0 +1,274 @@
+//
+// FramePacerTests.cpp - Replays synthetic 60 and 144 Hz displays through the pacer: refresh estimates, missed
+// deadlines, the safety margin and queued frames
+//
+
+#include "TestHarness.h"
+
+#include "FramePacer.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <stdexcept>
+
+
+namespace
+{
+    // A QueryPerformanceCounter rate.
+    constexpr uint64_t c_frequency = 10000000;
+
+    struct ReplayTotals
+    {
+        size_t      frames = 0;
+        size_t      droppedRefreshes = 0;   // frames shown later than the first refresh after they were ready
+        uint64_t    sleepTicks = 0;
+        uint64_t    inputToDisplayTicks = 0;
+
+        double MeanInputToDisplay() const { return double(inputToDisplayTicks) / double(frames) / double(c_frequency); }
+    };
+
+    // A display refreshing on a fixed grid, behind a swap chain that queues one frame: the game may start the next
+    // frame once the display has taken the last one, and wakes a little after it can. A frame presents its work's
+    // ticks after sampling input, and is shown at the first refresh after that.
+    class DisplayReplay
+    {
+    public:
+        DisplayReplay(DX::FramePacer& pacer, double hz, uint64_t wakeJitterTicks = 200) :
+            m_pacer(pacer),
+            m_refreshTicks(static_cast<uint64_t>(std::llround(double(c_frequency) / hz))),
+            m_firstRefreshTicks(123457),
+            m_readyTicks(m_firstRefreshTicks),
+            m_random(60144),
+            m_wakeJitter(0, wakeJitterTicks)
+        {
+        }
+
+        uint64_t GetRefreshTicks() const noexcept { return m_refreshTicks; }
+
+        // The first refresh at or after ticks.
+        uint64_t RefreshAtOrAfter(uint64_t ticks) const noexcept
+        {
+            const uint64_t since = ticks - m_firstRefreshTicks;
+            return m_firstRefreshTicks + (since + m_refreshTicks - 1) / m_refreshTicks * m_refreshTicks;
+        }
+
+        // Run frames, each taking work(frame) ticks from input to present.
+        ReplayTotals Run(size_t frames, std::function<uint64_t(size_t)> const& work)
+        {
+            ReplayTotals totals;
+            for (size_t frame = 0; frame < frames; ++frame)
+            {
+                const uint64_t inputTicks = m_pacer.Schedule(m_readyTicks, true);
+                DX_CHECK(inputTicks >= m_readyTicks);
+
+                const uint64_t presentTicks = inputTicks + work(frame);
+                const uint64_t displayTicks = RefreshAtOrAfter(presentTicks);
+                m_pacer.Complete(inputTicks, presentTicks);
+
+                totals.frames++;
+                totals.droppedRefreshes += displayTicks > RefreshAtOrAfter(m_readyTicks + 1);
+                totals.sleepTicks += inputTicks - m_readyTicks;
+                totals.inputToDisplayTicks += displayTicks - inputTicks;
+
+                m_readyTicks = displayTicks + m_wakeJitter(m_random);
+            }
+            return totals;
+        }
+
+        // Work of fraction of a refresh, give or take jitter of it.
+        std::function<uint64_t(size_t)> Steady(double fraction, double jitter)
+        {
+            return [this, fraction, jitter](size_t)
+                {
+                    std::uniform_real_distribution<double> spread(-jitter, jitter);
+                    return static_cast<uint64_t>((fraction + spread(m_random)) * double(m_refreshTicks));
+                };
+        }
+
+    private:
+        DX::FramePacer&                             m_pacer;
+        uint64_t                                    m_refreshTicks;
+        uint64_t                                    m_firstRefreshTicks;
+        uint64_t                                    m_readyTicks;
+        std::mt19937                                m_random;
+        std::uniform_int_distribution<uint64_t>     m_wakeJitter;
+    };
+
+    uint64_t MarginTicks(DX::FramePacer const& pacer)
+    {
+        return static_cast<uint64_t>(std::llround(pacer.GetStatistics().marginSeconds * double(c_frequency)));
+    }
+}
+
+DX_TEST(FramePacer, RejectsBadSettings)
+{
+    DX_CHECK_THROWS(DX::FramePacer(0), std::invalid_argument);
+    DX_CHECK_THROWS(DX::FramePacer(c_frequency, 0), std::out_of_range);
+
+    DX::FramePacer pacer(c_frequency, 2);
+    DX_CHECK_THROWS(pacer.SetQueuedFrames(17), std::out_of_range);
+    pacer.SetQueuedFrames(16);
+
+    // A clock slower than the assumed refresh rate still has a refresh of a tick, never zero, to divide by
+    for (const uint64_t frequency : { 1ull, 30ull, 59ull })
+    {
+        DX::FramePacer slow(frequency);
+        DX_CHECK_EQUAL(slow.GetRefreshTicks(), uint64_t(1));
+        DX_CHECK_EQUAL(slow.Schedule(5, true), uint64_t(5));
+        slow.Complete(5, 6);
+        DX_CHECK(slow.Schedule(9, true) >= 9);
+        DX_CHECK(slow.GetRefreshTicks() >= 1);
+    }
+}
+
+DX_TEST(FramePacer, RefreshEstimateConverges)
+{
+    // Until a frame waits for the display, 60 Hz is assumed
+    DX::FramePacer fresh(c_frequency);
+    DX_CHECK_EQUAL(fresh.GetRefreshTicks(), c_frequency / 60);
+
+    for (const double hz : { 60.0, 59.94, 144.0 })
+    {
+        // Every 16th frame overruns, missing a refresh and so spanning two
+        DX::FramePacer pacer(c_frequency);
+        DisplayReplay display(pacer, hz);
+        auto const steady = display.Steady(0.3, 0.05);
+        auto const totals = display.Run(300, [&](size_t frame) { return (frame % 16 == 15) ? display.GetRefreshTicks() * 3 / 2 : steady(frame); });
+
+        DX_CHECK(totals.droppedRefreshes >= 300 / 16);
+        const double error = std::abs(double(pacer.GetRefreshTicks()) - double(display.GetRefreshTicks())) / double(display.GetRefreshTicks());
+        DX_CHECK(error < 0.002);
+        DX_CHECK(std::abs(pacer.GetStatistics().refreshSeconds - 1.0 / hz) < 0.002 / hz);
+    }
+}
+
+DX_TEST(FramePacer, PacedFramesStartLateAndStillMakeTheirRefresh)
+{
+    for (const double hz : { 60.0, 144.0 })
+    {
+        DX::FramePacer paced(c_frequency);
+        DisplayReplay pacedDisplay(paced, hz);
+        pacedDisplay.Run(100, pacedDisplay.Steady(0.3, 0.05));
+        auto const pacedTotals = pacedDisplay.Run(500, pacedDisplay.Steady(0.3, 0.05));
+
+        DX::FramePacer unpaced(c_frequency);
+        unpaced.SetEnabled(false);
+        DisplayReplay unpacedDisplay(unpaced, hz);
+        auto const unpacedTotals = unpacedDisplay.Run(500, unpacedDisplay.Steady(0.3, 0.05));
+
+        // Unpaced, input is sampled as soon as the frame can start, a whole refresh before it is shown
+        DX_CHECK_EQUAL(unpacedTotals.sleepTicks, uint64_t(0));
+        DX_CHECK_EQUAL(unpacedTotals.droppedRefreshes, size_t(0));
+        DX_CHECK(unpacedTotals.MeanInputToDisplay() > 0.95 / hz);
+
+        // Paced, frames sleep most of the slack away and none is shown late
+        DX_CHECK_EQUAL(pacedTotals.droppedRefreshes, size_t(0));
+        DX_CHECK(pacedTotals.sleepTicks > 0);
+        DX_CHECK(pacedTotals.MeanInputToDisplay() < 0.6 * unpacedTotals.MeanInputToDisplay());
+        DX_CHECK(pacedTotals.MeanInputToDisplay() > 0.3 / hz);
+
+        auto const statistics = paced.GetStatistics();
+        DX_CHECK_EQUAL(statistics.frameCount, uint64_t(600));
+        DX_CHECK_EQUAL(statistics.missedCount, uint64_t(0));
+        DX_CHECK(statistics.predictedWorkSeconds > 0.3 / hz && statistics.predictedWorkSeconds < 0.36 / hz);
+        DX_CHECK(statistics.meanInputLatencySeconds > 0.25 / hz && statistics.meanInputLatencySeconds < 0.35 / hz);
+    }
+}
+
+DX_TEST(FramePacer, MarginDoublesOnMissesAndDecaysOtherwise)
+{
+    for (const double hz : { 60.0, 144.0 })
+    {
+        DX::FramePacer pacer(c_frequency);
+        DisplayReplay display(pacer, hz);
+        auto const steady = display.Steady(0.3, 0.02);
+
+        // It starts at a millisecond, and frames that make their deadlines wear it down to its floor of half of one
+        const uint64_t floorTicks = c_frequency / 2000;
+        DX_CHECK_EQUAL(MarginTicks(pacer), c_frequency / 1000);
+        display.Run(400, steady);
+        DX_CHECK_EQUAL(pacer.GetStatistics().missedCount, uint64_t(0));
+        DX_CHECK_EQUAL(MarginTicks(pacer), floorTicks);
+
+        // Each miss doubles it, up to half a refresh
+        const uint64_t missed = pacer.GetStatistics().missedCount;
+        uint64_t margin = floorTicks;
+        for (int i = 0; i < 4; ++i)
+        {
+            display.Run(1, [&](size_t) { return display.GetRefreshTicks() * 3 / 2; });
+            margin = std::min(margin * 2, pacer.GetRefreshTicks() / 2);
+            DX_CHECK_EQUAL(MarginTicks(pacer), margin);
+        }
+        DX_CHECK_EQUAL(pacer.GetStatistics().missedCount, missed + 4);
+
+        // Then it decays again, a 64th a frame, never rising while frames keep making it
+        display.Run(1, steady);
+        DX_CHECK_EQUAL(MarginTicks(pacer), margin - margin / 64);
+        bool decaying = true;
+        for (int i = 0; i < 300; ++i)
+        {
+            const uint64_t before = MarginTicks(pacer);
+            display.Run(1, steady);
+            decaying &= MarginTicks(pacer) <= before;
+        }
+        DX_CHECK(decaying);
+        DX_CHECK_EQUAL(MarginTicks(pacer), floorTicks);
+        DX_CHECK_EQUAL(pacer.GetStatistics().missedCount, missed + 4);
+    }
+}
+
+DX_TEST(FramePacer, QueuedFramesMoveTheDeadline)
+{
+    // Two pacers that have seen the same 60 Hz display, one allowed a second queued frame
+    const uint64_t refresh = c_frequency / 60;
+    DX::FramePacer one(c_frequency, 1);
+    DX::FramePacer two(c_frequency, 2);
+    for (uint64_t vblank = refresh; vblank <= 20 * refresh; vblank += refresh)
+    {
+        for (auto pacer : { &one, &two })
+        {
+            const uint64_t input = pacer->Schedule(vblank, true);
+            pacer->Complete(input, input + refresh / 4);
+        }
+    }
+    DX_CHECK_EQUAL(one.GetRefreshTicks(), refresh);
+    DX_CHECK_EQUAL(two.GetRefreshTicks(), refresh);
+
+    // The last frame was presented before the next refresh, so it is not queued: both aim at that refresh
+    const uint64_t ready = 21 * refresh;
+    const uint64_t oneWake = one.Schedule(ready, true);
+    const uint64_t twoWake = two.Schedule(ready, true);
+    DX_CHECK_EQUAL(oneWake, twoWake);
+    DX_CHECK(oneWake > ready);
+
+    // Now the last frame presents right before the next refresh, and the swap chain takes another at once. With one
+    // queued frame that refresh is the deadline, too close to wait for. With two, the frame just presented is still
+    // queued for it, so the new one is shown a refresh later and waits until its budget before that.
+    one.Complete(oneWake, 22 * refresh - 10);
+    two.Complete(twoWake, 22 * refresh - 10);
+    const uint64_t early = 22 * refresh - 5;
+    DX_CHECK_EQUAL(one.Schedule(early, false), early);
+    const uint64_t budget = two.GetPredictedWorkTicks() + MarginTicks(two);
+    DX_CHECK_EQUAL(two.Schedule(early, false), 23 * refresh - budget);
+    DX_CHECK(23 * refresh - budget > early);
+}
+
+DX_TEST(FramePacer, DisabledFramesStartWhenReady)
+{
+    DX::FramePacer pacer(c_frequency);
+    pacer.SetEnabled(false);
+    DX_CHECK(!pacer.IsEnabled());
+
+    DisplayReplay display(pacer, 144.0);
+    auto const totals = display.Run(50, display.Steady(0.5, 0.1));
+    DX_CHECK_EQUAL(totals.sleepTicks, uint64_t(0));
+
+    // Still measured, so pacing can resume where it left off
+    auto const statistics = pacer.GetStatistics();
+    DX_CHECK_EQUAL(statistics.frameCount, uint64_t(50));
+    DX_CHECK(std::abs(statistics.refreshSeconds - 1.0 / 144.0) < 0.002 / 144.0);
+    DX_CHECK_EQUAL(statistics.sleepSeconds, 0.0);
+}
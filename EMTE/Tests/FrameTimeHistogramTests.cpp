@@ -0,0 +1,145 @@
+//
+// FrameTimeHistogramTests.cpp - Checks the percentiles against known windows, and that summaries never see torn frames
+//
+
+#include "TestHarness.h"
+
+#include "FrameTimeHistogram.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+DX_TEST(FrameTimeHistogram, EmptyWindow)
+{
+    DX::FrameTimeHistogram histogram(1000);
+    auto const summary = histogram.Summarize();
+    DX_CHECK_EQUAL(summary.frameCount, size_t(0));
+    DX_CHECK_EQUAL(summary.maxSeconds, 0.0);
+    DX_CHECK_EQUAL(summary.stutterCount, size_t(0));
+
+    DX_CHECK_THROWS(DX::FrameTimeHistogram(0), std::invalid_argument);
+}
+
+DX_TEST(FrameTimeHistogram, NearestRankPercentiles)
+{
+    // Frames of 1 to 100 ms, recorded out of order
+    std::vector<uint64_t> frames(100);
+    std::iota(frames.begin(), frames.end(), uint64_t(1));
+    std::shuffle(frames.begin(), frames.end(), std::mt19937(7));
+
+    DX::FrameTimeHistogram histogram(1000);
+    for (auto const frame : frames)
+    {
+        histogram.Record(frame, 0);
+    }
+
+    auto const summary = histogram.Summarize();
+    DX_CHECK_EQUAL(summary.frameCount, size_t(100));
+    DX_CHECK_EQUAL(summary.p50Seconds, 0.050);
+    DX_CHECK_EQUAL(summary.p95Seconds, 0.095);
+    DX_CHECK_EQUAL(summary.p99Seconds, 0.099);
+    DX_CHECK_EQUAL(summary.maxSeconds, 0.100);
+
+    // With one frame every percentile is that frame
+    DX::FrameTimeHistogram single(1000);
+    single.Record(17, 0);
+    auto const one = single.Summarize();
+    DX_CHECK_EQUAL(one.p50Seconds, 0.017);
+    DX_CHECK_EQUAL(one.p99Seconds, 0.017);
+    DX_CHECK_EQUAL(one.maxSeconds, 0.017);
+}
+
+DX_TEST(FrameTimeHistogram, WindowKeepsTheLatestFrames)
+{
+    DX::FrameTimeHistogram histogram(1);
+    const uint64_t recorded = 3 * DX::FrameTimeHistogram::WindowSize + 100;
+    for (uint64_t frame = 1; frame <= recorded; ++frame)
+    {
+        histogram.Record(frame, 0);
+    }
+
+    // Only the last WindowSize frames remain, so the shortest left is recorded - WindowSize + 1
+    auto const summary = histogram.Summarize(1.0);
+    DX_CHECK_EQUAL(histogram.GetRecordedCount(), recorded);
+    DX_CHECK_EQUAL(summary.frameCount, DX::FrameTimeHistogram::WindowSize);
+    DX_CHECK_EQUAL(summary.maxSeconds, static_cast<double>(recorded));
+    DX_CHECK_EQUAL(summary.p50Seconds, static_cast<double>(recorded - DX::FrameTimeHistogram::WindowSize / 2));
+    DX_CHECK_EQUAL(summary.cpuSeconds, static_cast<double>(recorded) - (DX::FrameTimeHistogram::WindowSize - 1) / 2.0);
+}
+
+DX_TEST(FrameTimeHistogram, StuttersAndWaits)
+{
+    DX::FrameTimeHistogram histogram(1000);
+    for (int frame = 0; frame < 95; ++frame)
+    {
+        histogram.Record(10, 4);
+    }
+
+    // Exactly twice the median is not a stutter; longer is
+    histogram.Record(20, 4);
+    histogram.Record(21, 4);
+    histogram.Record(40, 4);
+    histogram.Record(100, 4);
+
+    // Waits longer than the frame count as the whole frame
+    histogram.Record(10, 50);
+
+    auto const summary = histogram.Summarize();
+    DX_CHECK_EQUAL(summary.frameCount, size_t(100));
+    DX_CHECK_EQUAL(summary.p50Seconds, 0.010);
+    DX_CHECK_EQUAL(summary.stutterCount, size_t(3));
+    DX_CHECK_EQUAL(histogram.Summarize(1.0).stutterCount, size_t(4));
+    DX_CHECK_EQUAL(histogram.Summarize(10.0).stutterCount, size_t(0));
+
+    // 1141 ms in all, 406 of them waiting
+    DX_CHECK(std::abs(summary.waitSeconds - 0.00406) < 1e-12);
+    DX_CHECK(std::abs(summary.cpuSeconds - 0.00735) < 1e-12);
+}
+
+DX_TEST(FrameTimeHistogram, SummariesNeverSeeTornFrames)
+{
+    // Every frame recorded spends exactly Cpu ticks not waiting, however long it is. Pairing one frame's time with
+    // another's wait would break that, and show in the mean CPU time.
+    constexpr uint64_t Cpu = 1000;
+    constexpr uint64_t Frames = 2000000;
+
+    DX::FrameTimeHistogram histogram(1);
+    std::atomic<bool> done = false;
+    std::thread recorder([&]()
+        {
+            for (uint64_t frame = 0; frame < Frames; ++frame)
+            {
+                const uint64_t wait = (frame * 7919) % 100000;
+                histogram.Record(Cpu + wait, wait);
+            }
+            done = true;
+        });
+
+    size_t summaries = 0;
+    bool whole = true;
+    bool ordered = true;
+    while (!done)
+    {
+        auto const summary = histogram.Summarize();
+        whole = whole && (summary.frameCount == 0 || summary.cpuSeconds == static_cast<double>(Cpu));
+        ordered = ordered && summary.p50Seconds <= summary.p95Seconds && summary.p95Seconds <= summary.p99Seconds
+            && summary.p99Seconds <= summary.maxSeconds;
+        summaries++;
+    }
+    recorder.join();
+
+    DX_CHECK(whole);
+    DX_CHECK(ordered);
+    DX_CHECK(summaries > 0);
+    DX_CHECK_EQUAL(histogram.GetRecordedCount(), Frames);
+    DX_CHECK_EQUAL(histogram.Summarize().cpuSeconds, static_cast<double>(Cpu));
+}
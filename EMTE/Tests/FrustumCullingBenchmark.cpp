@@ -0,0 +1,89 @@
+//
+// FrustumCullingBenchmark.cpp - Culling a million bounding volumes on each path
+//
+
+#include "TestHarness.h"
+
+#include "FrustumCulling.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    constexpr size_t c_objectCount = 1000000;
+
+    DX::Frustum MakeFrustum()
+    {
+        struct
+        {
+            float m[4][4];
+        } projection = { {
+            { 1.8304877f / (16.f / 9.f), 0.f, 0.f, 0.f },
+            { 0.f, 1.8304877f, 0.f, 0.f },
+            { 0.f, 0.f, 1.001001f, 1.f },
+            { 0.f, 0.f, -0.1001001f, 0.f },
+        } };
+        return DX::Frustum::FromMatrix(projection);
+    }
+
+    // Print the time per object on each supported path, and its speedup over the scalar path.
+    template<typename TVolumes>
+    void Measure(const char* kind, TVolumes const& volumes)
+    {
+        auto const frustum = MakeFrustum();
+        std::vector<uint32_t> visible;
+        double scalar = 0.0;
+        for (auto const path : { DX::CullPath::Scalar, DX::CullPath::Sse, DX::CullPath::Avx2 })
+        {
+            if (!DX::FrustumCuller::IsSupported(path))
+                continue;
+
+            const double nanoseconds = DX::Test::MeasureNanoseconds(5, [&]()
+                {
+                    DX::FrustumCuller::Cull(frustum, volumes, visible, path);
+                });
+            scalar = (path == DX::CullPath::Scalar) ? nanoseconds : scalar;
+
+            constexpr const char* names[] = { "scalar", "SSE", "AVX2" };
+            std::printf("  %zu %s, %s: %.2f ms (%.2f ns each, %.2fx), %zu visible\n", volumes.size(), kind,
+                names[static_cast<int>(path)], nanoseconds * 1e-6, nanoseconds / static_cast<double>(volumes.size()),
+                scalar / nanoseconds, visible.size());
+        }
+    }
+}
+
+DX_BENCHMARK(FrustumCulling, Spheres)
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> position(-100.f, 100.f);
+    std::uniform_real_distribution<float> radius(0.1f, 2.f);
+
+    DX::BoundingSphereSoA spheres;
+    spheres.reserve(c_objectCount);
+    for (size_t i = 0; i < c_objectCount; ++i)
+    {
+        spheres.push_back(position(random), position(random), position(random), radius(random));
+    }
+    Measure("spheres", spheres);
+}
+
+DX_BENCHMARK(FrustumCulling, Boxes)
+{
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> position(-100.f, 100.f);
+    std::uniform_real_distribution<float> extent(0.1f, 2.f);
+
+    DX::BoundingBoxSoA boxes;
+    boxes.reserve(c_objectCount);
+    for (size_t i = 0; i < c_objectCount; ++i)
+    {
+        boxes.push_back(position(random), position(random), position(random), extent(random), extent(random), extent(random));
+    }
+    Measure("boxes", boxes);
+}
@@ -0,0 +1,197 @@
+//
+// FrustumCullingTests.cpp - Checks that every SIMD path gives exactly the scalar path's result
+//
+
+#include "TestHarness.h"
+
+#include "FrustumCulling.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    struct Matrix
+    {
+        float m[4][4];
+    };
+
+    // A left-handed perspective projection looking down +Z from the origin, as XMMatrixPerspectiveFovLH builds.
+    DX::Frustum MakeFrustum(float fovY = 1.0f, float aspect = 16.f / 9.f, float nearZ = 0.1f, float farZ = 100.f)
+    {
+        const float yScale = 1.f / std::tan(fovY * 0.5f);
+        const float range = farZ / (farZ - nearZ);
+        const Matrix projection = { {
+            { yScale / aspect, 0.f, 0.f, 0.f },
+            { 0.f, yScale, 0.f, 0.f },
+            { 0.f, 0.f, range, 1.f },
+            { 0.f, 0.f, -range * nearZ, 0.f },
+        } };
+        return DX::Frustum::FromMatrix(projection);
+    }
+
+    const DX::CullPath c_paths[] = { DX::CullPath::Scalar, DX::CullPath::Sse, DX::CullPath::Avx2, DX::CullPath::Best };
+
+    // Cull with every path this CPU supports, and check each agrees with the scalar path index for index.
+    template<typename TVolumes>
+    std::vector<uint32_t> CullEveryPath(DX::Frustum const& frustum, TVolumes const& volumes)
+    {
+        std::vector<uint32_t> expected;
+        DX::FrustumCuller::Cull(frustum, volumes, expected, DX::CullPath::Scalar);
+
+        for (auto const path : c_paths)
+        {
+            if (!DX::FrustumCuller::IsSupported(path))
+                continue;
+
+            std::vector<uint32_t> visible(3, 12345);
+            const size_t count = DX::FrustumCuller::Cull(frustum, volumes, visible, path);
+            DX_CHECK_EQUAL(count, visible.size());
+            DX_CHECK(visible == expected);
+        }
+        return expected;
+    }
+
+    // Points spread through and around the frustum, so that some volumes are inside, some outside and some straddle.
+    float RandomCoordinate(std::mt19937& random, float range)
+    {
+        return std::uniform_real_distribution<float>(-range, range)(random);
+    }
+}
+
+DX_TEST(FrustumCulling, PathsAreSupported)
+{
+    DX_CHECK(DX::FrustumCuller::IsSupported(DX::CullPath::Scalar));
+    DX_CHECK(DX::FrustumCuller::IsSupported(DX::CullPath::Best));
+#if defined(DX_CULLING_X86)
+    DX_CHECK(DX::FrustumCuller::IsSupported(DX::CullPath::Sse));
+#else
+    std::vector<uint32_t> visible;
+    DX_CHECK_THROWS(DX::FrustumCuller::Cull(MakeFrustum(), DX::BoundingSphereSoA{}, visible, DX::CullPath::Sse),
+        std::invalid_argument);
+#endif
+}
+
+DX_TEST(FrustumCulling, SpheresAreCulledBehindPlanes)
+{
+    DX::BoundingSphereSoA spheres;
+    spheres.push_back(0.f, 0.f, 10.f, 1.f);        // ahead
+    spheres.push_back(0.f, 0.f, -10.f, 1.f);       // behind the camera
+    spheres.push_back(0.f, 0.f, 200.f, 1.f);       // beyond the far plane
+    spheres.push_back(0.f, 0.f, 100.5f, 1.f);      // straddles the far plane
+    spheres.push_back(50.f, 0.f, 10.f, 1.f);       // off to the right
+    spheres.push_back(0.f, 0.f, -0.5f, 1.f);       // straddles the near plane
+    spheres.push_back(0.f, 0.f, 0.f, 0.f);         // a point behind the near plane
+
+    auto const visible = CullEveryPath(MakeFrustum(), spheres);
+    DX_CHECK(visible == std::vector<uint32_t>({ 0, 3, 5 }));
+}
+
+DX_TEST(FrustumCulling, SpheresMatchScalarExactly)
+{
+    auto const frustum = MakeFrustum();
+    std::mt19937 random(17);
+
+    // Sizes around the vector widths, so that every path runs its scalar tail
+    for (size_t count = 0; count < 40; ++count)
+    {
+        DX::BoundingSphereSoA spheres;
+        for (size_t i = 0; i < count; ++i)
+        {
+            spheres.push_back(RandomCoordinate(random, 60.f), RandomCoordinate(random, 60.f),
+                RandomCoordinate(random, 120.f), std::fabs(RandomCoordinate(random, 5.f)));
+        }
+        CullEveryPath(frustum, spheres);
+    }
+
+    DX::BoundingSphereSoA spheres;
+    for (size_t i = 0; i < 100003; ++i)
+    {
+        spheres.push_back(RandomCoordinate(random, 60.f), RandomCoordinate(random, 60.f),
+            RandomCoordinate(random, 120.f), std::fabs(RandomCoordinate(random, 5.f)));
+    }
+    auto const visible = CullEveryPath(frustum, spheres);
+    DX_CHECK(!visible.empty() && visible.size() < spheres.size());
+}
+
+DX_TEST(FrustumCulling, SpheresTouchingAPlaneMatchScalarExactly)
+{
+    // Centers exactly one radius behind each plane, where rounding decides the result, and values that are not finite
+    auto const frustum = MakeFrustum(1.3f, 1.f, 1.f, 10.f);
+    constexpr float infinity = std::numeric_limits<float>::infinity();
+    constexpr float nan = std::numeric_limits<float>::quiet_NaN();
+
+    DX::BoundingSphereSoA spheres;
+    for (auto const& p : frustum.planes)
+    {
+        for (float const r : { 0.f, 1e-30f, 0.25f, 1.f, 3.f })
+        {
+            // The point on the plane nearest the origin, pushed back along its normal by r
+            const float t = -p.d - r;
+            spheres.push_back(p.a * t, p.b * t, p.c * t, r);
+            spheres.push_back(std::nextafter(p.a * t, infinity), p.b * t, p.c * t, r);
+            spheres.push_back(p.a * t, p.b * t, std::nextafter(p.c * t, -infinity), r);
+        }
+    }
+    spheres.push_back(0.f, 0.f, 5.f, infinity);
+    spheres.push_back(0.f, 0.f, infinity, 1.f);
+    spheres.push_back(nan, 0.f, 5.f, 1.f);
+    spheres.push_back(0.f, 0.f, 5.f, nan);
+    spheres.push_back(0.f, 0.f, 5.f, -0.f);
+    spheres.push_back(0.f, 0.f, 5.f, std::numeric_limits<float>::denorm_min());
+
+    CullEveryPath(frustum, spheres);
+}
+
+DX_TEST(FrustumCulling, BoxesMatchScalarExactly)
+{
+    auto const frustum = MakeFrustum();
+    std::mt19937 random(23);
+
+    for (size_t count = 0; count < 40; ++count)
+    {
+        DX::BoundingBoxSoA boxes;
+        for (size_t i = 0; i < count; ++i)
+        {
+            boxes.push_back(RandomCoordinate(random, 60.f), RandomCoordinate(random, 60.f), RandomCoordinate(random, 120.f),
+                std::fabs(RandomCoordinate(random, 5.f)), std::fabs(RandomCoordinate(random, 5.f)),
+                std::fabs(RandomCoordinate(random, 5.f)));
+        }
+        CullEveryPath(frustum, boxes);
+    }
+
+    // Boxes resting against each plane from behind, with one corner exactly on it
+    DX::BoundingBoxSoA boxes;
+    for (auto const& p : frustum.planes)
+    {
+        for (float const half : { 0.f, 0.5f, 2.f })
+        {
+            const float reach = std::fabs(p.a) * half + std::fabs(p.b) * half + std::fabs(p.c) * half;
+            const float t = -p.d - reach;
+            boxes.push_back(p.a * t, p.b * t, p.c * t, half, half, half);
+            boxes.push_back(p.a * t, p.b * t, std::nextafter(p.c * t, 0.f), half, half, half);
+        }
+    }
+    boxes.push_back(0.f, 0.f, 5.f, std::numeric_limits<float>::infinity(), 1.f, 1.f);
+    boxes.push_back(0.f, std::numeric_limits<float>::quiet_NaN(), 5.f, 1.f, 1.f, 1.f);
+    CullEveryPath(frustum, boxes);
+}
+
+DX_TEST(FrustumCulling, BoxesAreCulledBehindPlanes)
+{
+    DX::BoundingBoxSoA boxes;
+    boxes.push_back(0.f, 0.f, 10.f, 1.f, 1.f, 1.f);         // ahead
+    boxes.push_back(0.f, 0.f, -10.f, 1.f, 1.f, 1.f);        // behind the camera
+    boxes.push_back(30.f, 0.f, 10.f, 1.f, 1.f, 1.f);        // off to the right
+    boxes.push_back(30.f, 0.f, 10.f, 30.f, 1.f, 1.f);       // long enough to reach into view
+    boxes.push_back(0.f, 0.f, 150.f, 1.f, 1.f, 49.f);       // wholly beyond the far plane
+    boxes.push_back(0.f, 0.f, 150.f, 1.f, 1.f, 51.f);       // reaches back in front of it
+
+    auto const visible = CullEveryPath(MakeFrustum(), boxes);
+    DX_CHECK(visible == std::vector<uint32_t>({ 0, 3, 5 }));
+}
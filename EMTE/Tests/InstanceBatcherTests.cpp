@@ -0,0 +1,184 @@
+//
+// InstanceBatcherTests.cpp - Key packing, batch order after sorting, and the 3x4 transform layout
+//
+
+#include "TestHarness.h"
+
+#include "InstanceBatcher.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+
+namespace
+{
+    struct Matrix
+    {
+        float m[4][4];
+    };
+
+    // A transform that records which instance it belongs to, so its place after sorting can be checked.
+    DX::InstanceTransform Tagged(uint32_t mesh, uint32_t material, uint32_t added)
+    {
+        DX::InstanceTransform transform = {};
+        transform.m[0][0] = float(mesh);
+        transform.m[0][1] = float(material);
+        transform.m[0][2] = float(added);
+        return transform;
+    }
+
+    std::vector<DX::InstanceTransform> Packed(DX::InstanceBatcher const& batcher)
+    {
+        std::vector<DX::InstanceTransform> packed(batcher.GetInstanceCount());
+        DX_CHECK_EQUAL(batcher.GetUploadSize(), packed.size() * sizeof(DX::InstanceTransform));
+        batcher.Pack(packed.data());
+        return packed;
+    }
+}
+
+DX_TEST(InstanceBatcher, KeysPackMeshAboveMaterial)
+{
+    // Sixteen bits each, mesh in the high half: mesh decides the order before material does
+    DX::InstanceBatcher batcher;
+    batcher.Add(0xFFFF, 0xFFFF, Tagged(0xFFFF, 0xFFFF, 0));
+    batcher.Add(1, 0, Tagged(1, 0, 1));
+    batcher.Add(0, 0xFFFF, Tagged(0, 0xFFFF, 2));
+    batcher.Add(0, 0, Tagged(0, 0, 3));
+    batcher.Add(1, 0, Tagged(1, 0, 4));
+    batcher.Sort();
+
+    auto const batches = batcher.GetBatches();
+    DX_CHECK_EQUAL(batches.size(), size_t(4));
+    const uint32_t expected[4][4] = { { 0, 0, 0, 1 }, { 0, 0xFFFF, 1, 1 }, { 1, 0, 2, 2 }, { 0xFFFF, 0xFFFF, 4, 1 } };
+    for (size_t i = 0; i < batches.size(); ++i)
+    {
+        DX_CHECK_EQUAL(batches[i].mesh, expected[i][0]);
+        DX_CHECK_EQUAL(batches[i].material, expected[i][1]);
+        DX_CHECK_EQUAL(batches[i].firstInstance, expected[i][2]);
+        DX_CHECK_EQUAL(batches[i].instanceCount, expected[i][3]);
+    }
+
+    DX_CHECK_THROWS(batcher.Add(DX::InstanceBatcher::MaxMeshes, 0, Tagged(0, 0, 0)), std::out_of_range);
+    DX_CHECK_THROWS(batcher.Add(0, DX::InstanceBatcher::MaxMaterials, Tagged(0, 0, 0)), std::out_of_range);
+    DX_CHECK_EQUAL(batcher.GetInstanceCount(), size_t(5));
+}
+
+DX_TEST(InstanceBatcher, BatchesFollowTheSortedOrder)
+{
+    std::mt19937 random(19);
+    DX::InstanceBatcher batcher;
+    constexpr uint32_t count = 50000;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        // Mostly a few common meshes, with a long tail, as a scene has
+        const uint32_t mesh = (random() % 4) ? random() % 8 : random() % 3000;
+        const uint32_t material = random() % 40;
+        batcher.Add(mesh, material, Tagged(mesh, material, i));
+    }
+    batcher.Sort();
+
+    auto const batches = batcher.GetBatches();
+    auto const packed = Packed(batcher);
+
+    // Batches tile the instances in strictly increasing key order, and each holds only its own mesh and material,
+    // in the order they were added
+    uint32_t next = 0;
+    for (size_t b = 0; b < batches.size(); ++b)
+    {
+        auto const& batch = batches[b];
+        DX_CHECK_EQUAL(batch.firstInstance, next);
+        DX_CHECK(batch.instanceCount > 0);
+        if (b > 0)
+        {
+            auto const& previous = batches[b - 1];
+            DX_CHECK(previous.mesh < batch.mesh || (previous.mesh == batch.mesh && previous.material < batch.material));
+        }
+
+        bool own = true;
+        bool stable = true;
+        for (uint32_t i = batch.firstInstance; i < batch.firstInstance + batch.instanceCount; ++i)
+        {
+            own &= packed[i].m[0][0] == float(batch.mesh) && packed[i].m[0][1] == float(batch.material);
+            stable &= i == batch.firstInstance || packed[i].m[0][2] > packed[i - 1].m[0][2];
+        }
+        DX_CHECK(own);
+        DX_CHECK(stable);
+        next += batch.instanceCount;
+    }
+    DX_CHECK_EQUAL(next, count);
+
+    // Every instance is packed exactly once
+    std::vector<uint8_t> seen(count, 0);
+    for (auto const& transform : packed)
+    {
+        seen[static_cast<uint32_t>(transform.m[0][2])]++;
+    }
+    bool once = true;
+    for (auto const s : seen)
+    {
+        once &= s == 1;
+    }
+    DX_CHECK(once);
+}
+
+DX_TEST(InstanceBatcher, TransformsPackAsThreeRowsOfFour)
+{
+    // m[r][c] = 10r + c: packing keeps the first three columns, each as a row, and drops the fourth
+    Matrix world;
+    for (int row = 0; row < 4; ++row)
+    {
+        for (int column = 0; column < 4; ++column)
+        {
+            world.m[row][column] = float(10 * row + column);
+        }
+    }
+
+    DX::InstanceBatcher batcher;
+    batcher.Add(3, 1, world);
+    batcher.Add(2, 1, Tagged(2, 1, 7));
+    batcher.Sort();
+    auto const packed = Packed(batcher);
+
+    // The InstanceTransform overload is copied as is
+    DX_CHECK_EQUAL(packed[0].m[0][2], 7.f);
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int column = 0; column < 4; ++column)
+        {
+            DX_CHECK_EQUAL(packed[1].m[row][column], float(10 * column + row));
+        }
+    }
+    DX_CHECK_EQUAL(sizeof(DX::InstanceTransform), size_t(48));
+}
+
+DX_TEST(InstanceBatcher, MustBeSortedBeforeUse)
+{
+    DX::InstanceBatcher batcher;
+    DX_CHECK_EQUAL(batcher.GetBatches().size(), size_t(0));
+    DX_CHECK_EQUAL(batcher.GetUploadSize(), size_t(0));
+
+    batcher.Add(1, 1, Tagged(1, 1, 0));
+    DX_CHECK_THROWS(batcher.GetBatches(), std::logic_error);
+    DX::InstanceTransform out[2];
+    DX_CHECK_THROWS(batcher.Pack(out), std::logic_error);
+
+    batcher.Sort();
+    DX_CHECK_EQUAL(batcher.GetBatches().size(), size_t(1));
+
+    // Adding more needs another sort, which takes in everything added so far
+    batcher.Add(0, 1, Tagged(0, 1, 1));
+    DX_CHECK_THROWS(batcher.GetBatches(), std::logic_error);
+    batcher.Sort();
+    DX_CHECK_EQUAL(batcher.GetBatches().size(), size_t(2));
+    batcher.Pack(out);
+    DX_CHECK_EQUAL(out[0].m[0][2], 1.f);
+    DX_CHECK_EQUAL(out[1].m[0][2], 0.f);
+
+    // Clearing starts the next frame empty and usable
+    batcher.Clear();
+    DX_CHECK_EQUAL(batcher.GetInstanceCount(), size_t(0));
+    DX_CHECK_EQUAL(batcher.GetBatches().size(), size_t(0));
+}
@@ -0,0 +1,91 @@
+//
+// JobSystemBenchmark.cpp - Scheduling overhead of the job system and task graph
+//
+
+#include "TestHarness.h"
+
+#include "JobSystem.h"
+#include "TaskGraph.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+
+namespace
+{
+    // Enough arithmetic per element that the work, not the scheduling, should dominate.
+    float Work(size_t i) noexcept
+    {
+        float value = static_cast<float>(i);
+        for (int n = 0; n < 64; ++n)
+        {
+            value = std::sqrt(value * 1.0001f + 1.0f);
+        }
+        return value;
+    }
+}
+
+DX_BENCHMARK(JobSystem, RunAndWait)
+{
+    DX::JobSystem jobs;
+    const double nanoseconds = DX::Test::MeasureNanoseconds(20000, [&]()
+        {
+            DX::JobSystem::Counter counter;
+            jobs.Run([]() {}, &counter);
+            jobs.Wait(counter);
+        });
+    std::printf("  %u workers: Run + Wait of an empty job %.0f ns\n", jobs.GetWorkerCount(), nanoseconds);
+}
+
+DX_BENCHMARK(JobSystem, ParallelFor)
+{
+    DX::JobSystem jobs;
+    std::vector<float> results(1 << 16);
+
+    const double serial = DX::Test::MeasureNanoseconds(10, [&]()
+        {
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                results[i] = Work(i);
+            }
+        });
+
+    for (size_t const grain : { size_t(64), size_t(1024), size_t(8192) })
+    {
+        const double parallel = DX::Test::MeasureNanoseconds(10, [&]()
+            {
+                jobs.ParallelForRange(results.size(), grain, [&](size_t begin, size_t end)
+                    {
+                        for (size_t i = begin; i < end; ++i)
+                        {
+                            results[i] = Work(i);
+                        }
+                    });
+            });
+        std::printf("  %zu elements, grain %zu: serial %.2f ms, %u workers %.2f ms (%.2fx)\n", results.size(), grain,
+            serial * 1e-6, jobs.GetWorkerCount(), parallel * 1e-6, serial / parallel);
+    }
+}
+
+DX_BENCHMARK(TaskGraph, Execute)
+{
+    // Shaped like Update: a few chains feeding a join, with independent tasks beside them
+    DX::JobSystem jobs;
+    DX::TaskGraph graph;
+    std::atomic<uint32_t> ran = 0;
+    std::vector<DX::TaskGraph::NodeId> nodes;
+    for (int i = 0; i < 16; ++i)
+    {
+        nodes.push_back(graph.AddNode("Task", [&]() { ran.fetch_add(1, std::memory_order_relaxed); }));
+    }
+    for (size_t i = 0; i + 4 < nodes.size(); i += 4)
+    {
+        graph.AddDependency(nodes[i], nodes[i + 4]);
+    }
+
+    const double nanoseconds = DX::Test::MeasureNanoseconds(2000, [&]() { graph.Execute(jobs); });
+    std::printf("  %zu empty tasks: %.1f us per Execute\n", graph.GetNodeCount(), nanoseconds * 1e-3);
+}
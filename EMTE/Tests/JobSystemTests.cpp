@@ -0,0 +1,161 @@
+//
+// JobSystemTests.cpp - Stress tests for the work-stealing job system
+//
+
+#include "TestHarness.h"
+
+#include "JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    constexpr unsigned int c_workers = 4;
+
+    uint64_t SumBelow(DX::JobSystem& jobs, uint64_t begin, uint64_t end)
+    {
+        if (end - begin <= 64)
+        {
+            uint64_t sum = 0;
+            for (uint64_t i = begin; i < end; ++i)
+            {
+                sum += i;
+            }
+            return sum;
+        }
+
+        // Fork both halves from inside a job, so waits nest inside workers
+        const uint64_t middle = begin + (end - begin) / 2;
+        uint64_t left = 0;
+        uint64_t right = 0;
+        DX::JobSystem::Counter counter;
+        jobs.Run([&]() { left = SumBelow(jobs, begin, middle); }, &counter);
+        jobs.Run([&]() { right = SumBelow(jobs, middle, end); }, &counter);
+        jobs.Wait(counter);
+        return left + right;
+    }
+}
+
+DX_TEST(JobSystem, ParallelForVisitsEveryIndexOnce)
+{
+    DX::JobSystem jobs(c_workers);
+    for (int round = 0; round < 50; ++round)
+    {
+        std::vector<std::atomic<uint32_t>> visits(10007);
+        jobs.ParallelForRange(visits.size(), 97, [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    visits[i].fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+
+        for (auto const& visit : visits)
+        {
+            DX_CHECK_EQUAL(visit.load(), 1u);
+        }
+    }
+}
+
+DX_TEST(JobSystem, NestedForkJoin)
+{
+    DX::JobSystem jobs(c_workers);
+    for (int round = 0; round < 20; ++round)
+    {
+        DX_CHECK_EQUAL(SumBelow(jobs, 0, 100000), uint64_t(100000) * 99999 / 2);
+    }
+}
+
+DX_TEST(JobSystem, RunsFromManyExternalThreads)
+{
+    DX::JobSystem jobs(c_workers);
+    std::atomic<uint32_t> ran = 0;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < 4; ++p)
+    {
+        producers.emplace_back([&]()
+            {
+                DX::JobSystem::Counter counter;
+                for (int i = 0; i < 5000; ++i)
+                {
+                    jobs.Run([&]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+                }
+                jobs.Wait(counter);
+            });
+    }
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+    DX_CHECK_EQUAL(ran.load(), 20000u);
+}
+
+DX_TEST(JobSystem, WaitRethrowsTheFirstError)
+{
+    DX::JobSystem jobs(c_workers);
+    DX::JobSystem::Counter counter;
+    std::atomic<uint32_t> ran = 0;
+    for (int i = 0; i < 100; ++i)
+    {
+        jobs.Run([&, i]()
+            {
+                ran.fetch_add(1);
+                if (i % 10 == 0)
+                    throw std::runtime_error("job failed");
+            }, &counter);
+    }
+    DX_CHECK_THROWS(jobs.Wait(counter), std::runtime_error);
+    DX_CHECK_EQUAL(ran.load(), 100u);
+
+    // The error was consumed, so the counter can be reused
+    jobs.Run([]() {}, &counter);
+    jobs.Wait(counter);
+}
+
+DX_TEST(JobSystem, ParallelForWaitsForQueuedChunksWhenTheCallerThrows)
+{
+    DX::JobSystem jobs(c_workers);
+    for (int round = 0; round < 20; ++round)
+    {
+        std::atomic<uint32_t> finished = 0;
+        bool threw = false;
+        try
+        {
+            jobs.ParallelForRange(64, 1, [&](size_t begin, size_t)
+                {
+                    if (begin == 0)
+                        throw std::runtime_error("first chunk failed");
+
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    finished.fetch_add(1);
+                });
+        }
+        catch (std::runtime_error const&)
+        {
+            threw = true;
+        }
+
+        // Every queued chunk ran to completion before the exception left ParallelForRange
+        DX_CHECK(threw);
+        DX_CHECK_EQUAL(finished.load(), 63u);
+    }
+}
+
+DX_TEST(JobSystem, WithoutWorkersJobsRunInline)
+{
+    DX::JobSystem jobs(0);
+    DX_CHECK_EQUAL(jobs.GetWorkerCount(), 0u);
+
+    const auto caller = std::this_thread::get_id();
+    bool inline_ = true;
+    jobs.ParallelFor(100, [&](size_t) { inline_ = inline_ && std::this_thread::get_id() == caller; });
+    DX_CHECK(inline_);
+    DX_CHECK_EQUAL(SumBelow(jobs, 0, 1000), uint64_t(1000) * 999 / 2);
+}
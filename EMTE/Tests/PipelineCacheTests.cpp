@@ -0,0 +1,196 @@
+//
+// PipelineCacheTests.cpp - Checks that damaged, stale or missing cache files are recovered from without throwing
+//
+
+#include "TestHarness.h"
+
+#include "PipelineCache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    constexpr DX::PipelineCacheIdentity c_identity = { 0x10DE, 0x2204, 0x1, 0xA1, 0x001F000E000A1234ull };
+
+    // Three entries of different sizes, serialized in key order: 1, 2, 3.
+    DX::PipelineCache MakeCache()
+    {
+        DX::PipelineCache cache(c_identity);
+        const std::vector<uint8_t> small(16, 0xA1);
+        const std::vector<uint8_t> large(4096, 0xB2);
+        const std::vector<uint8_t> empty;
+        cache.Store(2, large.data(), large.size());
+        cache.Store(1, small.data(), small.size());
+        cache.Store(3, empty.data(), empty.size());
+        return cache;
+    }
+
+    // Where the entry for key begins in MakeCache's serialized form.
+    size_t GetEntryOffset(uint64_t key)
+    {
+        size_t offset = DX::PipelineCache::HeaderSize;
+        if (key > 1)
+            offset += DX::PipelineCache::EntryHeaderSize + 16;
+        if (key > 2)
+            offset += DX::PipelineCache::EntryHeaderSize + 4096;
+        return offset;
+    }
+
+    // A file in the system's temporary directory, removed (with its .tmp) when the test ends.
+    struct TemporaryFile
+    {
+        std::filesystem::path path;
+
+        explicit TemporaryFile(const char* name) : path(std::filesystem::temp_directory_path() / name)
+        {
+            Remove();
+        }
+
+        ~TemporaryFile() { Remove(); }
+
+        void Remove() const
+        {
+            std::error_code error;
+            std::filesystem::remove(path, error);
+            auto temporary = path;
+            temporary += ".tmp";
+            std::filesystem::remove(temporary, error);
+        }
+
+        void Write(std::vector<uint8_t> const& data) const
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        }
+    };
+}
+
+DX_TEST(PipelineCache, RoundTripsEveryEntry)
+{
+    auto const data = MakeCache().Serialize();
+
+    DX::PipelineCache loaded(c_identity);
+    DX_CHECK(loaded.Deserialize(data.data(), data.size()) == DX::PipelineCache::LoadResult::Loaded);
+    DX_CHECK_EQUAL(loaded.GetEntryCount(), size_t(3));
+    DX_CHECK(!loaded.IsDirty());
+    DX_CHECK_EQUAL(loaded.Find(2)->size(), size_t(4096));
+    DX_CHECK_EQUAL(loaded.Find(3)->size(), size_t(0));
+    DX_CHECK(loaded.Find(4) == nullptr);
+    DX_CHECK_EQUAL(loaded.GetHitCount(), size_t(2));
+    DX_CHECK_EQUAL(loaded.GetMissCount(), size_t(1));
+
+    // The same contents always give the same bytes, whatever order they were stored in
+    DX_CHECK(loaded.Serialize() == data);
+}
+
+DX_TEST(PipelineCache, TruncatedFilesKeepTheEntriesBeforeTheDamage)
+{
+    auto const data = MakeCache().Serialize();
+
+    // Cut at every byte: never throws or reads past the end, and keeps exactly the entries that were whole
+    for (size_t size = 0; size < data.size(); ++size)
+    {
+        DX::PipelineCache loaded(c_identity);
+        DX_CHECK(loaded.Deserialize(data.data(), size) == DX::PipelineCache::LoadResult::Corrupt);
+        DX_CHECK(loaded.IsDirty());
+
+        size_t whole = 0;
+        for (uint64_t key = 1; key <= 3; ++key)
+        {
+            const size_t end = (key < 3) ? GetEntryOffset(key + 1) : data.size();
+            whole += (size >= end) ? 1 : 0;
+        }
+        DX_CHECK_EQUAL(loaded.GetEntryCount(), whole);
+    }
+}
+
+DX_TEST(PipelineCache, DamagedEntriesAreDropped)
+{
+    auto const data = MakeCache().Serialize();
+
+    // A flipped bit anywhere in an entry, its key and size included, fails its checksum
+    for (uint64_t key = 1; key <= 2; ++key)
+    {
+        for (size_t byte : { size_t(0), size_t(8), size_t(12), DX::PipelineCache::EntryHeaderSize + 5 })
+        {
+            auto damaged = data;
+            damaged[GetEntryOffset(key) + byte] ^= 0x04;
+
+            DX::PipelineCache loaded(c_identity);
+            DX_CHECK(loaded.Deserialize(damaged.data(), damaged.size()) == DX::PipelineCache::LoadResult::Corrupt);
+            DX_CHECK_EQUAL(loaded.GetEntryCount(), size_t(key - 1));
+            DX_CHECK(loaded.Find(key) == nullptr);
+        }
+    }
+
+    // An entry count larger than the file holds, and bytes after the last entry
+    auto overcounted = data;
+    overcounted[32] = 0xFF;
+    DX::PipelineCache loaded(c_identity);
+    DX_CHECK(loaded.Deserialize(overcounted.data(), overcounted.size()) == DX::PipelineCache::LoadResult::Corrupt);
+    DX_CHECK_EQUAL(loaded.GetEntryCount(), size_t(3));
+
+    auto trailing = data;
+    trailing.push_back(0);
+    DX_CHECK(loaded.Deserialize(trailing.data(), trailing.size()) == DX::PipelineCache::LoadResult::Corrupt);
+    DX_CHECK_EQUAL(loaded.GetEntryCount(), size_t(3));
+
+    auto badMagic = data;
+    badMagic[0] ^= 0xFF;
+    DX_CHECK(loaded.Deserialize(badMagic.data(), badMagic.size()) == DX::PipelineCache::LoadResult::Corrupt);
+    DX_CHECK_EQUAL(loaded.GetEntryCount(), size_t(0));
+}
+
+DX_TEST(PipelineCache, OtherAdaptersAndVersionsAreStale)
+{
+    auto const data = MakeCache().Serialize();
+
+    auto otherDriver = c_identity;
+    otherDriver.driverVersion++;
+    DX::PipelineCache loaded(otherDriver);
+    DX_CHECK(loaded.Deserialize(data.data(), data.size()) == DX::PipelineCache::LoadResult::Stale);
+    DX_CHECK_EQUAL(loaded.GetEntryCount(), size_t(0));
+    DX_CHECK(loaded.IsDirty());
+
+    auto otherVersion = data;
+    otherVersion[4]++;
+    DX::PipelineCache current(c_identity);
+    DX_CHECK(current.Deserialize(otherVersion.data(), otherVersion.size()) == DX::PipelineCache::LoadResult::Stale);
+    DX_CHECK_EQUAL(current.GetEntryCount(), size_t(0));
+}
+
+DX_TEST(PipelineCache, CorruptFilesAreReplacedOnSave)
+{
+    TemporaryFile file("EMTEPipelineCacheTest.bin");
+
+    DX::PipelineCache missing(c_identity);
+    DX_CHECK(missing.Load(file.path) == DX::PipelineCache::LoadResult::Missing);
+    DX_CHECK(!missing.IsDirty());
+
+    auto data = MakeCache().Serialize();
+    data[GetEntryOffset(2) + DX::PipelineCache::EntryHeaderSize] ^= 0x01;
+    file.Write(data);
+
+    // Load keeps the entry before the damage and marks the cache dirty, so that Save rewrites the file whole
+    DX::PipelineCache damaged(c_identity);
+    DX_CHECK(damaged.Load(file.path) == DX::PipelineCache::LoadResult::Corrupt);
+    DX_CHECK_EQUAL(damaged.GetEntryCount(), size_t(1));
+    DX_CHECK(damaged.IsDirty());
+    damaged.Save(file.path);
+    DX_CHECK(!damaged.IsDirty());
+
+    DX::PipelineCache reloaded(c_identity);
+    DX_CHECK(reloaded.Load(file.path) == DX::PipelineCache::LoadResult::Loaded);
+    DX_CHECK_EQUAL(reloaded.GetEntryCount(), size_t(1));
+    DX_CHECK(reloaded.Find(1) != nullptr);
+
+    auto temporary = file.path;
+    temporary += ".tmp";
+    DX_CHECK(!std::filesystem::exists(temporary));
+}
@@ -0,0 +1,321 @@
+//
+// ProfilerTests.cpp - Call tree aggregation, zones spanning frames, full rings and unmatched ends
+//
+
+#include "TestHarness.h"
+
+#include "Profiler.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    constexpr DX::ProfileZoneInfo c_frame{ "Frame", L"Frame", __FILE__, __LINE__ };
+    constexpr DX::ProfileZoneInfo c_update{ "Update", L"Update", __FILE__, __LINE__ };
+    constexpr DX::ProfileZoneInfo c_render{ "Render", L"Render", __FILE__, __LINE__ };
+    constexpr DX::ProfileZoneInfo c_work{ "Work", L"Work", __FILE__, __LINE__ };
+
+    // Keeps every event the profiler drains, per thread.
+    class RecordingSink : public DX::IProfileEventSink
+    {
+    public:
+        void OnProfileEvents(uint32_t thread, std::span<const DX::ProfileEvent> events) override
+        {
+            if (thread >= threads.size())
+            {
+                threads.resize(thread + 1);
+            }
+            threads[thread].insert(threads[thread].end(), events.begin(), events.end());
+        }
+
+        std::vector<std::vector<DX::ProfileEvent>> threads;
+    };
+
+    struct Totals
+    {
+        uint32_t    calls = 0;
+        uint64_t    inclusiveTicks = 0;
+        uint64_t    exclusiveTicks = 0;
+    };
+
+    using Path = std::vector<DX::ProfileZoneInfo const*>;
+
+    // Aggregate well-nested events by call path, the slow way.
+    std::map<Path, Totals> Aggregate(std::vector<DX::ProfileEvent> const& events)
+    {
+        struct Open
+        {
+            uint64_t    begin;
+            uint64_t    children;
+        };
+
+        std::map<Path, Totals> totals;
+        Path path;
+        std::vector<Open> open;
+        for (auto const& event : events)
+        {
+            if (!event.IsEnd())
+            {
+                path.push_back(event.GetZone());
+                open.push_back(Open{ event.ticks, 0 });
+                continue;
+            }
+
+            const uint64_t duration = event.ticks - open.back().begin;
+            auto& node = totals[path];
+            node.calls++;
+            node.inclusiveTicks += duration;
+            node.exclusiveTicks += duration - open.back().children;
+            path.pop_back();
+            open.pop_back();
+            if (!open.empty())
+            {
+                open.back().children += duration;
+            }
+        }
+        return totals;
+    }
+
+    // The call paths of one thread's nodes, rebuilt from their depths.
+    std::vector<Path> GetPaths(std::vector<DX::ProfileNode> const& frame, uint32_t thread)
+    {
+        std::vector<Path> paths;
+        Path path;
+        for (auto const& node : frame)
+        {
+            if (node.thread != thread)
+                continue;
+            path.resize(node.depth);
+            path.push_back(node.zone);
+            paths.push_back(path);
+        }
+        return paths;
+    }
+
+    void Spin(std::chrono::microseconds duration)
+    {
+        auto const end = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < end)
+        {
+        }
+    }
+
+    DX::ProfileNode const* Find(std::vector<DX::ProfileNode> const& frame, DX::ProfileZoneInfo const& zone, uint32_t depth)
+    {
+        for (auto const& node : frame)
+        {
+            if (node.zone == &zone && node.depth == depth)
+                return &node;
+        }
+        return nullptr;
+    }
+}
+
+DX_TEST(Profiler, CallTreeAggregatesByPath)
+{
+    DX::Profiler profiler;
+    RecordingSink sink;
+    profiler.SetEventSink(&sink);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+    {
+        DX::ProfileScope frame(c_frame, profiler);
+        for (int i = 0; i < 3; ++i)
+        {
+            DX::ProfileScope update(c_update, profiler);
+            DX::ProfileScope work(c_work, profiler);
+            Spin(std::chrono::microseconds(50));
+        }
+        {
+            DX::ProfileScope render(c_render, profiler);
+            DX::ProfileScope work(c_work, profiler);
+            Spin(std::chrono::microseconds(50));
+        }
+    }
+    auto const& tree = profiler.EndFrame();
+
+    // Depth first, children in the order first entered; Work is counted apart under each parent
+    DX_CHECK_EQUAL(tree.size(), size_t(5));
+    auto const paths = GetPaths(tree, 0);
+    const std::vector<Path> expectedPaths = {
+        { &c_frame }, { &c_frame, &c_update }, { &c_frame, &c_update, &c_work },
+        { &c_frame, &c_render }, { &c_frame, &c_render, &c_work } };
+    DX_CHECK(paths == expectedPaths);
+
+    // Every node's totals are those of the raw events, in nanoseconds
+    DX_CHECK_EQUAL(sink.threads.size(), size_t(1));
+    auto const totals = Aggregate(sink.threads[0]);
+    const double nanosecondsPerTick = profiler.GetNanosecondsPerTick();
+    auto const toNanoseconds = [=](uint64_t ticks) { return static_cast<uint64_t>(static_cast<double>(ticks) * nanosecondsPerTick); };
+    for (size_t i = 0; i < tree.size(); ++i)
+    {
+        auto const& expected = totals.at(paths[i]);
+        DX_CHECK_EQUAL(tree[i].calls, expected.calls);
+        DX_CHECK_EQUAL(tree[i].inclusiveNanoseconds, toNanoseconds(expected.inclusiveTicks));
+        DX_CHECK_EQUAL(tree[i].exclusiveNanoseconds, toNanoseconds(expected.exclusiveTicks));
+        DX_CHECK(tree[i].exclusiveNanoseconds <= tree[i].inclusiveNanoseconds);
+    }
+    DX_CHECK_EQUAL(tree[1].calls, 3u);
+    DX_CHECK_EQUAL(tree[2].calls, 3u);
+    DX_CHECK_EQUAL(tree[4].calls, 1u);
+    DX_CHECK(tree[2].inclusiveNanoseconds >= 3 * 40000);
+
+    // The next frame starts from nothing
+    DX_CHECK(profiler.EndFrame().empty());
+    DX_CHECK_EQUAL(profiler.GetDroppedCount(), uint64_t(0));
+    DX_CHECK_EQUAL(profiler.GetUnmatchedCount(), uint64_t(0));
+}
+
+DX_TEST(Profiler, ThreadsHaveTreesOfTheirOwn)
+{
+    DX::Profiler profiler;
+    profiler.SetThreadName("Main");
+    std::thread worker([&]()
+        {
+            profiler.SetThreadName("Worker");
+            DX::ProfileScope work(c_work, profiler);
+        });
+    worker.join();
+    {
+        DX::ProfileScope update(c_update, profiler);
+    }
+
+    auto const& tree = profiler.EndFrame();
+    DX_CHECK_EQUAL(profiler.GetThreadCount(), size_t(2));
+    DX_CHECK_EQUAL(profiler.GetThreadName(0), std::string("Main"));
+    DX_CHECK_EQUAL(profiler.GetThreadName(1), std::string("Worker"));
+    DX_CHECK_EQUAL(tree.size(), size_t(2));
+    DX_CHECK(tree[0].zone == &c_update && tree[0].thread == 0);
+    DX_CHECK(tree[1].zone == &c_work && tree[1].thread == 1 && tree[1].depth == 0);
+}
+
+DX_TEST(Profiler, ZonesOpenAtEndFrameCountWhenTheyClose)
+{
+    // Calibrated before the first frame, so that every frame converts ticks alike
+    DX::Profiler profiler;
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    profiler.EndFrame();
+
+    DX_CHECK(profiler.Begin(c_frame));
+    {
+        DX::ProfileScope update(c_update, profiler);
+        Spin(std::chrono::microseconds(200));
+    }
+
+    // Still open: the path is there, with its finished child, but no call yet
+    auto const first = profiler.EndFrame();
+    DX_CHECK_EQUAL(first.size(), size_t(2));
+    DX_CHECK(first[0].zone == &c_frame && first[0].calls == 0 && first[0].inclusiveNanoseconds == 0);
+    DX_CHECK(first[1].zone == &c_update && first[1].depth == 1 && first[1].calls == 1);
+    const uint64_t updateNanoseconds = first[1].inclusiveNanoseconds;
+
+    // Zones begun in the next frame nest under it
+    {
+        DX::ProfileScope render(c_render, profiler);
+    }
+    auto const second = profiler.EndFrame();
+    DX_CHECK(Find(second, c_render, 1) != nullptr);
+    DX_CHECK(Find(second, c_frame, 0)->calls == 0);
+
+    // It closes in the third, with its whole span; the child time taken off is from both earlier frames
+    Spin(std::chrono::microseconds(200));
+    profiler.End(c_frame);
+    auto const third = profiler.EndFrame();
+    DX_CHECK_EQUAL(third.size(), size_t(1));
+    DX_CHECK_EQUAL(third[0].calls, 1u);
+    DX_CHECK(third[0].inclusiveNanoseconds > updateNanoseconds);
+    DX_CHECK(third[0].exclusiveNanoseconds < third[0].inclusiveNanoseconds - updateNanoseconds + 1000);
+    DX_CHECK_EQUAL(profiler.GetUnmatchedCount(), uint64_t(0));
+}
+
+DX_TEST(Profiler, FullRingsDropBeginsNotEnds)
+{
+    // Room for eight events: the frame zone goes in, then inner zones only while their ends and its will still fit
+    DX::Profiler profiler(8);
+    RecordingSink sink;
+    profiler.SetEventSink(&sink);
+    {
+        DX::ProfileScope frame(c_frame, profiler);
+        for (int i = 0; i < 100; ++i)
+        {
+            DX::ProfileScope work(c_work, profiler);
+        }
+    }
+    auto const& tree = profiler.EndFrame();
+
+    DX_CHECK(profiler.GetDroppedCount() > 0);
+    DX_CHECK_EQUAL(profiler.GetUnmatchedCount(), uint64_t(0));
+    DX_CHECK_EQUAL(tree.size(), size_t(2));
+    DX_CHECK(tree[0].zone == &c_frame && tree[0].calls == 1);
+    DX_CHECK(tree[1].zone == &c_work && tree[1].calls == 3);
+    DX_CHECK_EQUAL(sink.threads[0].size(), size_t(8));
+    DX_CHECK(sink.threads[0].back().IsEnd() && sink.threads[0].back().GetZone() == &c_frame);
+
+    // Once drained the ring records again, and nothing was left open to nest the next frame under
+    {
+        DX::ProfileScope frame(c_frame, profiler);
+        DX::ProfileScope work(c_work, profiler);
+    }
+    auto const& next = profiler.EndFrame();
+    DX_CHECK_EQUAL(next.size(), size_t(2));
+    DX_CHECK(next[0].zone == &c_frame && next[0].depth == 0 && next[0].calls == 1);
+    DX_CHECK_EQUAL(profiler.GetUnmatchedCount(), uint64_t(0));
+
+    // A ring too small for a begin and its end records nothing
+    DX::Profiler tiny(1);
+    DX_CHECK(!tiny.Begin(c_frame));
+    DX_CHECK(tiny.EndFrame().empty());
+    DX_CHECK_EQUAL(tiny.GetDroppedCount(), uint64_t(1));
+
+    DX_CHECK_THROWS(DX::ProfileThreadBuffer(12), std::invalid_argument);
+}
+
+DX_TEST(Profiler, UnmatchedEndsAreCounted)
+{
+    DX::Profiler profiler;
+
+    // An end with no begin is ignored
+    profiler.End(c_work);
+    DX_CHECK(profiler.EndFrame().empty());
+    DX_CHECK_EQUAL(profiler.GetUnmatchedCount(), uint64_t(1));
+
+    // A zone left open inside another is closed with it
+    profiler.Begin(c_frame);
+    profiler.Begin(c_update);
+    profiler.End(c_frame);
+    auto const& tree = profiler.EndFrame();
+    DX_CHECK_EQUAL(profiler.GetUnmatchedCount(), uint64_t(2));
+    DX_CHECK_EQUAL(tree.size(), size_t(2));
+    DX_CHECK(tree[0].zone == &c_frame && tree[0].calls == 1);
+    DX_CHECK(tree[1].zone == &c_update && tree[1].calls == 0);
+
+    // And the next frame is clean
+    {
+        DX::ProfileScope update(c_update, profiler);
+    }
+    auto const& next = profiler.EndFrame();
+    DX_CHECK(next.size() == 1 && next[0].depth == 0 && next[0].calls == 1);
+}
+
+DX_TEST(Profiler, DisabledZonesAreNotRecorded)
+{
+    DX::Profiler profiler;
+    profiler.SetEnabled(false);
+    DX_CHECK(!profiler.IsEnabled());
+    {
+        DX::ProfileScope frame(c_frame, profiler);
+
+        // Enabled again before the end: the zone was not begun, so it is not ended either
+        profiler.SetEnabled(true);
+    }
+    DX_CHECK(profiler.EndFrame().empty());
+    DX_CHECK_EQUAL(profiler.GetUnmatchedCount(), uint64_t(0));
+}
@@ -0,0 +1,126 @@
+//
+// RadixSortTests.cpp - Checks the radix sort against std::stable_sort, including keys that share bytes
+//
+
+#include "TestHarness.h"
+
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+
+namespace
+{
+    // Sort keys with RadixSort and with std::stable_sort, and check they agree key for key and value for value.
+    template<typename TKey>
+    void CheckAgainstStableSort(std::vector<TKey> keys)
+    {
+        std::vector<uint32_t> values(keys.size());
+        std::iota(values.begin(), values.end(), 0u);
+
+        std::vector<std::pair<TKey, uint32_t>> expected;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            expected.emplace_back(keys[i], values[i]);
+        }
+        std::stable_sort(expected.begin(), expected.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+
+        std::vector<TKey> keyScratch;
+        std::vector<uint32_t> valueScratch;
+        DX::RadixSort(keys, values, keyScratch, valueScratch);
+
+        DX_CHECK_EQUAL(keys.size(), expected.size());
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            DX_CHECK_EQUAL(keys[i], expected[i].first);
+            DX_CHECK_EQUAL(values[i], expected[i].second);
+        }
+    }
+}
+
+DX_TEST(RadixSort, MatchesStableSort)
+{
+    std::mt19937_64 random(42);
+    for (size_t const count : { size_t(0), size_t(1), size_t(2), size_t(17), size_t(1000), size_t(65536) })
+    {
+        std::vector<uint64_t> keys(count);
+        for (auto& key : keys)
+        {
+            key = random();
+        }
+        CheckAgainstStableSort(keys);
+
+        // Few distinct keys, so that stability decides most of the order
+        for (auto& key : keys)
+        {
+            key = random() % 7;
+        }
+        CheckAgainstStableSort(keys);
+    }
+}
+
+DX_TEST(RadixSort, SkipsBytesEveryKeyShares)
+{
+    // Draw keys differ only in a few fields; the bytes between them are the same for every key
+    std::mt19937 random(7);
+    std::vector<uint64_t> keys(5000);
+    for (auto& key : keys)
+    {
+        key = (uint64_t(0x3) << 60) | (uint64_t(random() % 4) << 44) | (uint64_t(random() % 300) << 28);
+    }
+    CheckAgainstStableSort(keys);
+
+    std::vector<uint32_t> small(5000);
+    for (auto& key : small)
+    {
+        key = random() & 0x00FF00FF;
+    }
+    CheckAgainstStableSort(small);
+
+    CheckAgainstStableSort(std::vector<uint16_t>(300, 0xABCD));
+}
+
+DX_TEST(RadixSort, ScratchIsReused)
+{
+    std::vector<uint64_t> keys(4096);
+    std::vector<uint32_t> values(keys.size());
+    std::vector<uint64_t> keyScratch;
+    std::vector<uint32_t> valueScratch;
+    std::mt19937_64 random(3);
+
+    auto const sort = [&]()
+        {
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                keys[i] = random();
+                values[i] = static_cast<uint32_t>(i);
+            }
+            DX::RadixSort(keys, values, keyScratch, valueScratch);
+        };
+
+    // Passes swap the vectors with their scratch; after the first sort, the same two buffers trade places
+    sort();
+    const uint64_t* const buffers[] = { keys.data(), keyScratch.data() };
+    for (int i = 0; i < 8; ++i)
+    {
+        sort();
+        DX_CHECK(keys.data() == buffers[0] || keys.data() == buffers[1]);
+        DX_CHECK(keyScratch.data() == buffers[0] || keyScratch.data() == buffers[1]);
+        DX_CHECK(std::is_sorted(keys.begin(), keys.end()));
+    }
+}
+
+DX_TEST(RadixSort, NeedsAValuePerKey)
+{
+    std::vector<uint64_t> keys(4);
+    std::vector<uint32_t> values(3);
+    std::vector<uint64_t> keyScratch;
+    std::vector<uint32_t> valueScratch;
+    DX_CHECK_THROWS(DX::RadixSort(keys, values, keyScratch, valueScratch), std::invalid_argument);
+}
@@ -0,0 +1,97 @@
+//
+// RenderQueueBenchmark.cpp - Sorting draw keys, and submitting a sorted queue
+//
+
+#include "TestHarness.h"
+
+#include "RadixSort.h"
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    constexpr size_t c_drawCount = 500000;
+
+    // Keys shaped like the lit pass's: a few pipelines, a few hundred materials and a quantized depth.
+    std::vector<uint64_t> MakeKeys()
+    {
+        std::mt19937 random(5);
+        std::vector<uint64_t> keys(c_drawCount);
+        for (auto& key : keys)
+        {
+            key = DX::DrawKey::Make(random() % 2, 0, random() % 8, random() % 300, random() % DX::DrawKey::MaxDepth);
+        }
+        return keys;
+    }
+
+    struct NullBackend
+    {
+        size_t binds = 0;
+
+        void BindPipeline(uint32_t) noexcept { binds++; }
+        void BindMaterial(uint32_t, uint32_t) noexcept { binds++; }
+        void Draw(uint32_t) noexcept {}
+    };
+}
+
+DX_BENCHMARK(RadixSort, DrawKeys)
+{
+    auto const source = MakeKeys();
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> values;
+    std::vector<uint64_t> keyScratch;
+    std::vector<uint32_t> valueScratch;
+
+    const double radix = DX::Test::MeasureNanoseconds(10, [&]()
+        {
+            keys = source;
+            values.resize(keys.size());
+            std::iota(values.begin(), values.end(), 0u);
+            DX::RadixSort(keys, values, keyScratch, valueScratch);
+        });
+
+    std::vector<std::pair<uint64_t, uint32_t>> pairs;
+    const double stable = DX::Test::MeasureNanoseconds(10, [&]()
+        {
+            pairs.clear();
+            for (uint32_t i = 0; i < source.size(); ++i)
+            {
+                pairs.emplace_back(source[i], i);
+            }
+            std::stable_sort(pairs.begin(), pairs.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+        });
+
+    std::printf("  %zu keys: RadixSort %.2f ms, std::stable_sort %.2f ms (%.1fx)\n", source.size(), radix * 1e-6,
+        stable * 1e-6, stable / radix);
+}
+
+DX_BENCHMARK(RenderQueue, SortAndExecute)
+{
+    auto const keys = MakeKeys();
+    DX::RenderQueue<uint32_t> queue;
+    queue.Reserve(keys.size());
+    NullBackend backend;
+
+    const double nanoseconds = DX::Test::MeasureNanoseconds(10, [&]()
+        {
+            queue.Clear();
+            for (uint32_t i = 0; i < keys.size(); ++i)
+            {
+                queue.Submit(keys[i], i);
+            }
+            queue.Sort();
+            queue.Execute(backend);
+        });
+
+    auto const statistics = queue.GetStatistics();
+    std::printf("  %zu draws: %.2f ms to submit, sort and execute, %zu pipeline and %zu material binds\n",
+        statistics.draws, nanoseconds * 1e-6, statistics.pipelineBinds, statistics.materialBinds);
+}
@@ -0,0 +1,177 @@
+//
+// RenderQueueTests.cpp - Checks that sorted draws bind each pipeline and material once per run
+//
+
+#include "TestHarness.h"
+
+#include "RenderQueue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace
+{
+    struct Draw
+    {
+        uint32_t    pipeline;
+        uint32_t    material;
+        uint32_t    id;
+    };
+
+    // Records what was bound, and checks each draw is made with its own pipeline and material bound.
+    struct Backend
+    {
+        uint32_t                pipeline = UINT32_MAX;
+        uint32_t                material = UINT32_MAX;
+        size_t                  pipelineBinds = 0;
+        size_t                  materialBinds = 0;
+        std::vector<uint32_t>   drawn;
+        bool                    mismatched = false;
+
+        void BindPipeline(uint32_t value)
+        {
+            pipeline = value;
+            material = UINT32_MAX;
+            pipelineBinds++;
+        }
+
+        void BindMaterial(uint32_t boundPipeline, uint32_t value)
+        {
+            mismatched = mismatched || boundPipeline != pipeline;
+            material = value;
+            materialBinds++;
+        }
+
+        void Draw(Draw const& draw)
+        {
+            mismatched = mismatched || draw.pipeline != pipeline || draw.material != material;
+            drawn.push_back(draw.id);
+        }
+    };
+
+    // Bindings an unsorted submission would make: one per change between consecutive draws.
+    std::pair<size_t, size_t> CountUnsortedBinds(std::vector<Draw> const& draws)
+    {
+        size_t pipelines = 0;
+        size_t materials = 0;
+        uint32_t pipeline = UINT32_MAX;
+        uint32_t material = UINT32_MAX;
+        for (auto const& draw : draws)
+        {
+            if (draw.pipeline != pipeline)
+            {
+                pipelines++;
+                pipeline = draw.pipeline;
+                material = UINT32_MAX;
+            }
+            if (draw.material != material)
+            {
+                materials++;
+                material = draw.material;
+            }
+        }
+        return { pipelines, materials };
+    }
+}
+
+DX_TEST(RenderQueue, EachStateIsBoundOncePerRun)
+{
+    std::mt19937 random(11);
+    std::vector<Draw> draws(10000);
+    std::set<uint32_t> pipelines;
+    std::set<std::pair<uint32_t, uint32_t>> materials;
+    for (uint32_t i = 0; i < draws.size(); ++i)
+    {
+        draws[i] = Draw{ static_cast<uint32_t>(random() % 6), static_cast<uint32_t>(random() % 40), i };
+        pipelines.insert(draws[i].pipeline);
+        materials.emplace(draws[i].pipeline, draws[i].material);
+    }
+
+    DX::RenderQueue<Draw> queue;
+    for (auto const& draw : draws)
+    {
+        queue.Submit(DX::DrawKey::Make(0, 0, draw.pipeline, draw.material), draw);
+    }
+    queue.Sort();
+
+    Backend backend;
+    queue.Execute(backend);
+
+    // Sorted, every pipeline and every material used with it is bound exactly once
+    DX_CHECK(!backend.mismatched);
+    DX_CHECK_EQUAL(backend.drawn.size(), draws.size());
+    DX_CHECK_EQUAL(backend.pipelineBinds, pipelines.size());
+    DX_CHECK_EQUAL(backend.materialBinds, materials.size());
+
+    auto const statistics = queue.GetStatistics();
+    DX_CHECK_EQUAL(statistics.draws, draws.size());
+    DX_CHECK_EQUAL(statistics.pipelineBinds, pipelines.size());
+    DX_CHECK_EQUAL(statistics.materialBinds, materials.size());
+
+    // Against the submission order, which changes state almost every draw
+    auto const unsorted = CountUnsortedBinds(draws);
+    DX_CHECK(unsorted.first > statistics.pipelineBinds * 100);
+    DX_CHECK(unsorted.second > statistics.materialBinds * 20);
+}
+
+DX_TEST(RenderQueue, PassesAndLayersComeBeforeState)
+{
+    // Pass and layer order first; state that carries over from one pass to the next is not bound again, and draws
+    // with equal keys keep their order
+    DX::RenderQueue<Draw> queue;
+    queue.Submit(DX::DrawKey::Make(1, 0, 2, 5), Draw{ 2, 5, 0 });
+    queue.Submit(DX::DrawKey::Make(0, 1, 2, 5), Draw{ 2, 5, 1 });
+    queue.Submit(DX::DrawKey::Make(0, 0, 2, 5), Draw{ 2, 5, 2 });
+    queue.Submit(DX::DrawKey::Make(0, 0, 1, 5), Draw{ 1, 5, 3 });
+    queue.Submit(DX::DrawKey::Make(1, 0, 2, 5), Draw{ 2, 5, 4 });
+    queue.Submit(DX::DrawKey::Make(0, 0, 1, 5), Draw{ 1, 5, 5 });
+    queue.Sort();
+
+    Backend backend;
+    queue.Execute(backend);
+    DX_CHECK(!backend.mismatched);
+    DX_CHECK(backend.drawn == std::vector<uint32_t>({ 3, 5, 2, 1, 0, 4 }));
+    DX_CHECK_EQUAL(backend.pipelineBinds, size_t(2));
+    DX_CHECK_EQUAL(backend.materialBinds, size_t(2));
+}
+
+DX_TEST(RenderQueue, DepthOrdersDrawsWithinState)
+{
+    DX::RenderQueue<Draw> queue;
+    const float depths[] = { 50.f, 2.f, 900.f, 10.f };
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        queue.Submit(DX::DrawKey::Make(0, 0, 0, 0, DX::DrawKey::QuantizeDepth(depths[i], 0.1f, 1000.f)), Draw{ 0, 0, i });
+        queue.Submit(DX::DrawKey::Make(0, 1, 0, 0, DX::DrawKey::QuantizeDepth(depths[i], 0.1f, 1000.f, true)), Draw{ 0, 0, 4 + i });
+    }
+    queue.Sort();
+
+    // Opaque nearest first, then the next layer farthest first; depth alone never rebinds anything
+    Backend backend;
+    queue.Execute(backend);
+    DX_CHECK(backend.drawn == std::vector<uint32_t>({ 1, 3, 0, 2, 6, 4, 7, 5 }));
+    DX_CHECK_EQUAL(backend.pipelineBinds, size_t(1));
+    DX_CHECK_EQUAL(backend.materialBinds, size_t(1));
+}
+
+DX_TEST(RenderQueue, ExecuteNeedsSortedDraws)
+{
+    DX::RenderQueue<Draw> queue;
+    queue.Submit(DX::DrawKey::Make(0, 0, 1, 1), Draw{ 1, 1, 0 });
+
+    Backend backend;
+    DX_CHECK_THROWS(queue.Execute(backend), std::logic_error);
+    DX_CHECK_THROWS(DX::DrawKey::Make(0, 0, DX::DrawKey::MaxPipeline + 1, 0), std::out_of_range);
+
+    queue.Sort();
+    queue.Execute(backend);
+    queue.Clear();
+    queue.Execute(backend);
+    DX_CHECK_EQUAL(queue.GetStatistics().draws, size_t(0));
+}
@@ -0,0 +1,127 @@
+//
+// RenderTargetPoolTests.cpp - Checks that released render targets are reused only once the GPU is done with them
+//
+
+#include "TestHarness.h"
+
+#include "RenderTargetPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+
+namespace
+{
+    // A queue whose fence only moves when the test says the GPU has finished.
+    class FakeFence final : public DX::IFenceBackend
+    {
+    public:
+        bool Signal(uint64_t value) noexcept override { m_signaled = value; return true; }
+        uint64_t GetCompletedValue() noexcept override { return m_completed; }
+        bool Wait(uint64_t value, uint32_t) noexcept override { return value <= m_completed; }
+
+        void Complete() noexcept { m_completed = m_signaled; }
+
+    private:
+        uint64_t    m_signaled = 0;
+        uint64_t    m_completed = 0;
+    };
+
+    // Targets are numbered in creation order, and keep a count of how many are alive.
+    struct Backend
+    {
+        using Target = std::shared_ptr<int>;
+
+        int*    created;
+
+        Target Create(DX::RenderTargetKey const&) { return std::make_shared<int>((*created)++); }
+    };
+
+    DX::RenderTargetKey MakeKey(uint32_t width, uint32_t height)
+    {
+        DX::RenderTargetKey key = {};
+        key.format = 28;
+        key.width = width;
+        key.height = height;
+        return key;
+    }
+}
+
+DX_TEST(RenderTargetPool, ReleasedTargetsWaitForTheirFrame)
+{
+    FakeFence fence;
+    DX::FenceTimeline timeline(&fence);
+    int created = 0;
+    DX::RenderTargetPool<Backend> pool(Backend{ &created }, timeline);
+
+    auto const key = MakeKey(1280, 720);
+    auto target = pool.Acquire(key);
+    pool.Release(key, target);
+
+    // The frame that released it has not even been submitted, so a new target is needed
+    DX_CHECK(pool.Acquire(key) != target);
+    timeline.Signal();
+    DX_CHECK(pool.Acquire(key) != target);
+
+    fence.Complete();
+    DX_CHECK(pool.Acquire(key) == target);
+    DX_CHECK_EQUAL(pool.GetCreatedCount(), size_t(3));
+    DX_CHECK_EQUAL(pool.GetReusedCount(), size_t(1));
+    DX_CHECK_EQUAL(pool.GetPooledCount(), size_t(0));
+}
+
+DX_TEST(RenderTargetPool, TargetsAreOnlyReusedForTheSameKey)
+{
+    FakeFence fence;
+    DX::FenceTimeline timeline(&fence);
+    int created = 0;
+    DX::RenderTargetPool<Backend> pool(Backend{ &created }, timeline);
+
+    // Resizing back and forth, as RenderTexture does, only creates one target per size
+    auto small = pool.Acquire(MakeKey(640, 360));
+    for (int frame = 0; frame < 10; ++frame)
+    {
+        pool.Release(MakeKey(640, 360), std::move(small));
+        auto large = pool.Acquire(MakeKey(1920, 1080));
+        timeline.Signal();
+        fence.Complete();
+        pool.BeginFrame();
+
+        pool.Release(MakeKey(1920, 1080), std::move(large));
+        small = pool.Acquire(MakeKey(640, 360));
+        timeline.Signal();
+        fence.Complete();
+        pool.BeginFrame();
+    }
+
+    DX_CHECK_EQUAL(pool.GetCreatedCount(), size_t(2));
+    DX_CHECK_EQUAL(pool.GetReusedCount(), size_t(19));
+    DX_CHECK_EQUAL(pool.GetPooledCount(), size_t(1));
+}
+
+DX_TEST(RenderTargetPool, IdleTargetsAreDestroyed)
+{
+    FakeFence fence;
+    DX::FenceTimeline timeline(&fence);
+    int created = 0;
+    DX::RenderTargetPool<Backend> pool(Backend{ &created }, timeline, 4);
+
+    auto const key = MakeKey(1280, 720);
+    auto target = pool.Acquire(key);
+    std::weak_ptr<int> const watch = target;
+    pool.Release(key, std::move(target));
+
+    // Idle for long enough, but the GPU may still be using it
+    for (int frame = 0; frame < 8; ++frame)
+    {
+        pool.BeginFrame();
+    }
+    DX_CHECK_EQUAL(pool.GetPooledCount(), size_t(1));
+
+    timeline.Signal();
+    fence.Complete();
+    pool.BeginFrame();
+    DX_CHECK_EQUAL(pool.GetPooledCount(), size_t(0));
+    DX_CHECK(watch.expired());
+}
@@ -0,0 +1,252 @@
+//
+// ResourceStateTrackerTests.cpp - Barrier counts and batches recorded into mock command lists
+//
+
+#include "TestHarness.h"
+
+#include "ResourceStateTracker.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+
+namespace
+{
+    using DX::ResourceState;
+    using Barrier = DX::ResourceStateTracker::Barrier;
+
+    // Records each ResourceBarrier call as a batch, as DX::RecordBarriers would issue them.
+    struct MockCommandList
+    {
+        std::vector<std::vector<Barrier>> batches;
+
+        void ResourceBarrier(std::span<const Barrier> barriers)
+        {
+            batches.emplace_back(barriers.begin(), barriers.end());
+        }
+
+        void Flush(DX::ResourceStateTracker::LocalState& states)
+        {
+            states.Flush([this](std::span<const Barrier> barriers) { ResourceBarrier(barriers); });
+        }
+
+        size_t GetBarrierCount() const noexcept
+        {
+            size_t count = 0;
+            for (auto const& batch : batches)
+            {
+                count += batch.size();
+            }
+            return count;
+        }
+    };
+
+    bool IsTransition(Barrier const& barrier, const void* resource, ResourceState before, ResourceState after,
+        uint32_t subresource = DX::ResourceStateTracker::AllSubresources) noexcept
+    {
+        return barrier.resource == resource && barrier.subresource == subresource && barrier.before == before
+            && barrier.after == after && !barrier.aliasing;
+    }
+}
+
+DX_TEST(ResourceStateTracker, RedundantTransitionsAreDropped)
+{
+    DX::ResourceStateTracker tracker;
+    int target = 0;
+    tracker.Register(&target, 1, ResourceState::RenderTarget);
+
+    DX::ResourceStateTracker::LocalState states(tracker);
+    states.SetInheritGlobal(true);
+    MockCommandList list;
+
+    // Already in the state asked for, and a round trip that cancels out before it is flushed
+    states.Transition(&target, ResourceState::RenderTarget);
+    states.Transition(&target, ResourceState::PixelShaderResource);
+    states.Transition(&target, ResourceState::RenderTarget);
+    list.Flush(states);
+    DX_CHECK_EQUAL(list.batches.size(), size_t(0));
+
+    // Two queued transitions of the same resource fold into one
+    states.Transition(&target, ResourceState::PixelShaderResource);
+    states.Transition(&target, ResourceState::CopySource);
+    list.Flush(states);
+    DX_CHECK_EQUAL(list.batches.size(), size_t(1));
+    DX_CHECK_EQUAL(list.GetBarrierCount(), size_t(1));
+    DX_CHECK(IsTransition(list.batches[0][0], &target, ResourceState::RenderTarget, ResourceState::CopySource));
+
+    DX_CHECK_EQUAL(tracker.Resolve(states).size(), size_t(0));
+    auto const statistics = tracker.GetStatistics();
+    DX_CHECK_EQUAL(statistics.transitions, uint64_t(5));
+    DX_CHECK_EQUAL(statistics.redundant, uint64_t(3));
+    DX_CHECK_EQUAL(statistics.barriers, uint64_t(1));
+    DX_CHECK_EQUAL(statistics.batches, uint64_t(1));
+    DX_CHECK(tracker.GetState(&target) == ResourceState::CopySource);
+}
+
+DX_TEST(ResourceStateTracker, TransitionsAreBatched)
+{
+    DX::ResourceStateTracker tracker;
+    int targets[8] = {};
+    int texture = 0;
+    for (auto& target : targets)
+    {
+        tracker.Register(&target, 1, ResourceState::RenderTarget);
+    }
+    tracker.Register(&texture, 4, ResourceState::CopyDest);
+
+    DX::ResourceStateTracker::LocalState states(tracker);
+    states.SetInheritGlobal(true);
+    MockCommandList list;
+
+    for (auto& target : targets)
+    {
+        states.Transition(&target, ResourceState::PixelShaderResource);
+    }
+    list.Flush(states);
+    DX_CHECK_EQUAL(list.batches.size(), size_t(1));
+    DX_CHECK_EQUAL(list.batches[0].size(), size_t(8));
+
+    // Each mip on its own still goes out in one call
+    for (uint32_t mip = 0; mip < 4; ++mip)
+    {
+        states.Transition(&texture, ResourceState::PixelShaderResource, mip);
+    }
+    list.Flush(states);
+    DX_CHECK_EQUAL(list.batches.size(), size_t(2));
+    DX_CHECK_EQUAL(list.batches[1].size(), size_t(4));
+    DX_CHECK(states.GetState(&texture) == ResourceState::PixelShaderResource);
+
+    // Moving the whole resource while its mips disagree moves each mip, still as one batch
+    states.Transition(&texture, ResourceState::CopyDest, 2);
+    states.Transition(&texture, ResourceState::CopySource);
+    list.Flush(states);
+    DX_CHECK_EQUAL(list.batches.size(), size_t(3));
+    DX_CHECK_EQUAL(list.batches[2].size(), size_t(4));
+    DX_CHECK(IsTransition(list.batches[2][0], &texture, ResourceState::PixelShaderResource, ResourceState::CopySource, 2));
+
+    // The whole resource and one of its subresources can't share a batch
+    states.Transition(&texture, ResourceState::PixelShaderResource);
+    states.Transition(&texture, ResourceState::CopyDest, 0);
+    list.Flush(states);
+    DX_CHECK_EQUAL(list.batches.size(), size_t(5));
+    DX_CHECK(IsTransition(list.batches[3][0], &texture, ResourceState::CopySource, ResourceState::PixelShaderResource));
+    DX_CHECK(IsTransition(list.batches[4][0], &texture, ResourceState::PixelShaderResource, ResourceState::CopyDest, 0));
+
+    DX_CHECK_EQUAL(tracker.Resolve(states).size(), size_t(0));
+    DX_CHECK(tracker.GetState(&texture, 0) == ResourceState::CopyDest);
+    DX_CHECK(tracker.GetState(&texture, 3) == ResourceState::PixelShaderResource);
+    DX_CHECK(tracker.GetState(&texture) == ResourceState::Undefined);
+}
+
+DX_TEST(ResourceStateTracker, AliasingBarriersComeFirst)
+{
+    DX::ResourceStateTracker tracker;
+    int transient = 0;
+    int other = 0;
+    tracker.Register(&transient, 1, ResourceState::PixelShaderResource);
+    tracker.Register(&other, 1, ResourceState::RenderTarget);
+
+    DX::ResourceStateTracker::LocalState states(tracker);
+    states.SetInheritGlobal(true);
+    MockCommandList list;
+
+    states.Alias(&transient);
+    states.Transition(&other, ResourceState::PixelShaderResource);
+    states.Transition(&transient, ResourceState::RenderTarget);
+    list.Flush(states);
+
+    DX_CHECK_EQUAL(list.batches.size(), size_t(2));
+    DX_CHECK_EQUAL(list.batches[0].size(), size_t(2));
+    DX_CHECK(list.batches[0][0].aliasing);
+    DX_CHECK(IsTransition(list.batches[1][0], &transient, ResourceState::PixelShaderResource, ResourceState::RenderTarget));
+}
+
+DX_TEST(ResourceStateTracker, ParallelListsAreFixedUpInSubmissionOrder)
+{
+    DX::ResourceStateTracker tracker;
+    int shared = 0;
+    int texture = 0;
+    tracker.Register(&shared, 1, ResourceState::RenderTarget);
+    tracker.Register(&texture, 1, ResourceState::PixelShaderResource);
+
+    // Recorded at the same time: neither knows what state the other leaves things in
+    DX::ResourceStateTracker::LocalState first(tracker);
+    MockCommandList firstList;
+    first.Transition(&shared, ResourceState::PixelShaderResource);
+    first.Transition(&shared, ResourceState::RenderTarget);
+    firstList.Flush(first);
+
+    DX::ResourceStateTracker::LocalState second(tracker);
+    MockCommandList secondList;
+    second.Transition(&shared, ResourceState::CopySource);
+    second.Transition(&texture, ResourceState::PixelShaderResource);
+    secondList.Flush(second);
+
+    // Only the transition the first list knew the start of was recorded in it
+    DX_CHECK_EQUAL(firstList.GetBarrierCount(), size_t(1));
+    DX_CHECK(IsTransition(firstList.batches[0][0], &shared, ResourceState::PixelShaderResource, ResourceState::RenderTarget));
+    DX_CHECK_EQUAL(secondList.GetBarrierCount(), size_t(0));
+
+    auto fixups = tracker.Resolve(first);
+    DX_CHECK_EQUAL(fixups.size(), size_t(1));
+    DX_CHECK(IsTransition(fixups[0], &shared, ResourceState::RenderTarget, ResourceState::PixelShaderResource));
+
+    // The second list starts from where the first left it; the texture was already where it needed to be
+    fixups = tracker.Resolve(second);
+    DX_CHECK_EQUAL(fixups.size(), size_t(1));
+    DX_CHECK(IsTransition(fixups[0], &shared, ResourceState::RenderTarget, ResourceState::CopySource));
+
+    auto statistics = tracker.GetStatistics();
+    DX_CHECK_EQUAL(statistics.barriers, uint64_t(3));
+    DX_CHECK_EQUAL(statistics.batches, uint64_t(3));
+    DX_CHECK_EQUAL(statistics.fixups, uint64_t(2));
+
+    // A list recorded after both were resolved inherits their states, and needs no fixups
+    DX::ResourceStateTracker::LocalState third(tracker);
+    third.SetInheritGlobal(true);
+    MockCommandList thirdList;
+    third.Transition(&shared, ResourceState::RenderTarget);
+    thirdList.Flush(third);
+    DX_CHECK(IsTransition(thirdList.batches[0][0], &shared, ResourceState::CopySource, ResourceState::RenderTarget));
+    DX_CHECK_EQUAL(tracker.Resolve(third).size(), size_t(0));
+
+    statistics = tracker.GetStatistics();
+    DX_CHECK_EQUAL(statistics.barriers, uint64_t(4));
+    DX_CHECK_EQUAL(statistics.fixups, uint64_t(2));
+}
+
+DX_TEST(ResourceStateTracker, ValidationCatchesWrongAssumptions)
+{
+    DX::ResourceStateTracker tracker;
+    tracker.SetValidation(true);
+    int target = 0;
+    int unregistered = 0;
+    tracker.Register(&target, 1, ResourceState::RenderTarget);
+
+    DX::ResourceStateTracker::LocalState states(tracker);
+    DX_CHECK_THROWS(states.Transition(&unregistered, ResourceState::RenderTarget), std::logic_error);
+    DX_CHECK(states.GetState(&unregistered) == ResourceState::Undefined);
+    DX_CHECK_THROWS(states.Transition(&unregistered, ResourceState::RenderTarget), std::logic_error);
+    DX_CHECK_THROWS(states.Transition(&target, ResourceState::Undefined), std::invalid_argument);
+
+    // A frame graph that says the target is a shader resource when it is not; the tracked state is left alone
+    states.Reset();
+    states.Assume(&target, ResourceState::PixelShaderResource);
+    DX_CHECK_THROWS(tracker.Resolve(states), std::logic_error);
+    DX_CHECK(tracker.GetState(&target) == ResourceState::RenderTarget);
+
+    DX::ResourceStateTracker::LocalState correct(tracker);
+    correct.Assume(&target, ResourceState::RenderTarget);
+    DX_CHECK_THROWS(correct.Assume(&target, ResourceState::CopySource), std::logic_error);
+    DX_CHECK_EQUAL(tracker.Resolve(correct).size(), size_t(0));
+
+    // Without validation the wrong assumption is quietly fixed up instead
+    tracker.SetValidation(false);
+    DX::ResourceStateTracker::LocalState quiet(tracker);
+    quiet.Assume(&target, ResourceState::PixelShaderResource);
+    DX_CHECK_EQUAL(tracker.Resolve(quiet).size(), size_t(1));
+    DX_CHECK(tracker.GetState(&target) == ResourceState::PixelShaderResource);
+}
@@ -0,0 +1,110 @@
+//
+// StaticGeometryCacheBenchmark.cpp - Vertex bytes streamed a frame for the floor grid, rebuilt every frame as
+// PrimitiveBatch drew it and drawn from the cache
+//
+
+#include "TestHarness.h"
+
+#include "StaticGeometryCache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <vector>
+
+
+namespace
+{
+    constexpr uint64_t c_frames = 1000;
+
+    class CompletedQueue final : public DX::IFenceBackend
+    {
+    public:
+        bool Signal(uint64_t value) noexcept override { m_completed = value; return true; }
+        uint64_t GetCompletedValue() noexcept override { return m_completed; }
+        bool Wait(uint64_t, uint32_t) noexcept override { return true; }
+
+    private:
+        uint64_t    m_completed = 0;
+    };
+
+    // Copies what it is given into "GPU" memory once; the upload has always finished.
+    struct CopyingBackend
+    {
+        struct Geometry
+        {
+            std::vector<DX::DebugVertex>    vertices;
+            std::vector<uint32_t>           indices;
+        };
+
+        Geometry Create(std::span<const DX::DebugVertex> vertices, std::span<const uint32_t> indices)
+        {
+            uploadedBytes += vertices.size_bytes() + indices.size_bytes();
+            return Geometry{ { vertices.begin(), vertices.end() }, { indices.begin(), indices.end() } };
+        }
+
+        bool IsReady(Geometry const&) const noexcept { return true; }
+
+        uint64_t    uploadedBytes = 0;
+    };
+
+    struct Result
+    {
+        double      nanoseconds;
+        uint64_t    streamedBytes;
+    };
+
+    // As Game drew the grid before: every line generated and written into the batch's dynamic vertex buffer.
+    // PrimitiveBatch draws unindexed lines, so only the vertices are streamed.
+    Result MeasureStreamed(DX::DebugGrid const& grid)
+    {
+        DX::DebugGeometryData scratch;
+        std::vector<DX::DebugVertex> dynamicBuffer;
+        uint64_t streamedBytes = 0;
+        const double nanoseconds = DX::Test::MeasureNanoseconds(c_frames, [&]()
+            {
+                scratch.clear();
+                grid.Generate(scratch);
+                dynamicBuffer.assign(scratch.vertices.begin(), scratch.vertices.end());
+                streamedBytes += dynamicBuffer.size() * sizeof(DX::DebugVertex);
+            });
+        return Result{ nanoseconds, streamedBytes / (5 * c_frames) };
+    }
+
+    // The cache: the grid looked up every frame, generated and uploaded in the first.
+    Result MeasureCached(DX::DebugGrid const& grid, uint64_t& firstFrameBytes)
+    {
+        CompletedQueue queue;
+        DX::FenceTimeline timeline(&queue);
+        DX::StaticGeometryCache<CopyingBackend> cache(CopyingBackend{}, timeline);
+        auto const frame = [&]()
+            {
+                cache.BeginFrame();
+                cache.Get(grid);
+                timeline.Signal();
+            };
+
+        frame();
+        firstFrameBytes = cache.GetBackend().uploadedBytes;
+        const double nanoseconds = DX::Test::MeasureNanoseconds(c_frames, frame);
+        return Result{ nanoseconds, (cache.GetBackend().uploadedBytes - firstFrameBytes) / (5 * c_frames) };
+    }
+}
+
+DX_BENCHMARK(StaticGeometryCache, GridBytesPerFrame)
+{
+    for (uint32_t const divisions : { 20u, 100u, 1000u })
+    {
+        DX::DebugGrid grid;
+        grid.divisions = divisions;
+
+        uint64_t firstFrameBytes = 0;
+        auto const streamed = MeasureStreamed(grid);
+        auto const cached = MeasureCached(grid, firstFrameBytes);
+        std::printf("  %u divisions: rebuilt %llu vertex bytes a frame (%.2f us), cached %llu a frame (%.3f us) "
+            "after %llu in the first\n", divisions, static_cast<unsigned long long>(streamed.streamedBytes),
+            streamed.nanoseconds * 1e-3, static_cast<unsigned long long>(cached.streamedBytes), cached.nanoseconds * 1e-3,
+            static_cast<unsigned long long>(firstFrameBytes));
+    }
+}
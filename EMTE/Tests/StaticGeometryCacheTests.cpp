@@ -0,0 +1,143 @@
+//
+// StaticGeometryCacheTests.cpp - Checks that geometry is generated once per set of parameters, and only kept if it succeeds
+//
+
+#include "TestHarness.h"
+
+#include "StaticGeometryCache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+
+namespace
+{
+    class FakeFence final : public DX::IFenceBackend
+    {
+    public:
+        bool Signal(uint64_t value) noexcept override { m_signaled = value; return true; }
+        uint64_t GetCompletedValue() noexcept override { return m_completed; }
+        bool Wait(uint64_t value, uint32_t) noexcept override { return value <= m_completed; }
+
+        void Complete() noexcept { m_completed = m_signaled; }
+
+    private:
+        uint64_t    m_signaled = 0;
+        uint64_t    m_completed = 0;
+    };
+
+    // Geometry is the number of vertices uploaded; uploads finish at once, and fail while failing is set.
+    struct Backend
+    {
+        using Geometry = size_t;
+
+        bool    failing = false;
+
+        Geometry Create(std::span<const DX::DebugVertex> vertices, std::span<const uint32_t>)
+        {
+            if (failing)
+                throw std::runtime_error("Upload failed");
+            return vertices.size();
+        }
+
+        bool IsReady(Geometry const&) const noexcept { return true; }
+    };
+
+    // Generates nothing but an exception.
+    struct BrokenShape
+    {
+        DX::DebugGeometryKey GetKey() const { return DX::MakeDebugGeometryKey(99, { 1.f }); }
+        void Generate(DX::DebugGeometryData&) const { throw std::runtime_error("Generate failed"); }
+    };
+}
+
+DX_TEST(StaticGeometryCache, EachParameterSetIsGeneratedOnce)
+{
+    FakeFence fence;
+    DX::FenceTimeline timeline(&fence);
+    DX::StaticGeometryCache<Backend> cache(Backend{}, timeline);
+
+    DX::DebugGrid grid;
+    grid.divisions = 4;
+    for (int frame = 0; frame < 10; ++frame)
+    {
+        cache.BeginFrame();
+        auto const geometry = cache.Get(grid);
+        DX_CHECK(geometry != nullptr);
+        DX_CHECK_EQUAL(*geometry, size_t(20));
+    }
+    DX_CHECK_EQUAL(cache.GetGeneratedCount(), size_t(1));
+
+    grid.divisions = 5;
+    DX_CHECK_EQUAL(*cache.Get(grid), size_t(24));
+    DX_CHECK_EQUAL(cache.GetGeneratedCount(), size_t(2));
+    DX_CHECK_EQUAL(cache.GetCachedCount(), size_t(2));
+}
+
+DX_TEST(StaticGeometryCache, KeysCompareEveryParameter)
+{
+    // Same values, different kind; and parameters that are equal as floats but not bit for bit
+    DX_CHECK(!(DX::MakeDebugGeometryKey(1, { 1.f, 2.f }) == DX::MakeDebugGeometryKey(2, { 1.f, 2.f })));
+    DX_CHECK(!(DX::MakeDebugGeometryKey(1, { 0.f }) == DX::MakeDebugGeometryKey(1, { -0.f })));
+    DX_CHECK(!(DX::MakeDebugGeometryKey(1, { 1.f }) == DX::MakeDebugGeometryKey(1, { 1.f, 0.f })));
+    DX_CHECK(DX::DebugAxes{}.GetKey() == DX::DebugAxes{}.GetKey());
+    DX_CHECK_THROWS(DX::MakeDebugGeometryKey(1, { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f }),
+        std::length_error);
+
+    FakeFence fence;
+    DX::FenceTimeline timeline(&fence);
+    DX::StaticGeometryCache<Backend> cache(Backend{}, timeline);
+
+    DX::DebugBox box;
+    DX::DebugBox flipped;
+    flipped.min[0] = -0.f;
+    flipped.max[0] = 0.f;
+    box.min[0] = 0.f;
+    box.max[0] = 0.f;
+    cache.Get(box);
+    cache.Get(flipped);
+    cache.Get(DX::DebugAxes{});
+    DX_CHECK_EQUAL(cache.GetGeneratedCount(), size_t(3));
+}
+
+DX_TEST(StaticGeometryCache, FailedGenerationLeavesNoEntry)
+{
+    FakeFence fence;
+    DX::FenceTimeline timeline(&fence);
+    DX::StaticGeometryCache<Backend> cache(Backend{}, timeline);
+
+    DX_CHECK_THROWS(cache.Get(BrokenShape{}), std::runtime_error);
+    DX_CHECK_EQUAL(cache.GetCachedCount(), size_t(0));
+    DX_CHECK_EQUAL(cache.GetGeneratedCount(), size_t(0));
+
+    // A failed upload is retried on the next request rather than handing out empty geometry
+    DX::DebugAxes axes;
+    cache.GetBackend().failing = true;
+    DX_CHECK_THROWS(cache.Get(axes), std::runtime_error);
+    DX_CHECK_EQUAL(cache.GetCachedCount(), size_t(0));
+
+    cache.GetBackend().failing = false;
+    DX_CHECK_EQUAL(*cache.Get(axes), size_t(6));
+    DX_CHECK_EQUAL(cache.GetGeneratedCount(), size_t(1));
+}
+
+DX_TEST(StaticGeometryCache, IdleGeometryOutlivesTheGpu)
+{
+    FakeFence fence;
+    DX::FenceTimeline timeline(&fence);
+    DX::StaticGeometryCache<Backend> cache(Backend{}, timeline, 2);
+
+    cache.Get(DX::DebugAxes{});
+    for (int frame = 0; frame < 5; ++frame)
+    {
+        cache.BeginFrame();
+    }
+    DX_CHECK_EQUAL(cache.GetCachedCount(), size_t(1));
+
+    timeline.Signal();
+    fence.Complete();
+    cache.BeginFrame();
+    DX_CHECK_EQUAL(cache.GetCachedCount(), size_t(0));
+}
@@ -0,0 +1,340 @@
+//
+// StepTimerTests.cpp - Steps the timer with a manual clock, counting the Updates each Tick runs and how long they take
+//
+
+#include "TestHarness.h"
+
+#include "Clock.h"
+#include "StepTimer.h"
+
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <vector>
+
+
+namespace
+{
+    constexpr uint64_t Step = DX::StepTimer::TicksPerSecond / 60;
+
+    // Advance the clock by ticks, Tick once, and return how many Updates ran.
+    uint32_t TickAfter(DX::ManualClock& clock, DX::StepTimer& timer, uint64_t ticks)
+    {
+        clock.Advance(ticks);
+
+        uint32_t updates = 0;
+        timer.Tick([&]()
+            {
+                DX_CHECK_EQUAL(timer.GetElapsedTicks(), timer.IsFixedTimeStep() ? timer.GetStepTicks() : ticks);
+                updates++;
+            });
+        DX_CHECK_EQUAL(timer.GetLastUpdateCount(), updates);
+        return updates;
+    }
+
+    // Spend frameTicks outside Updates, then Tick with each Update taking updateTicks. Returns how many Updates ran.
+    uint32_t TickUnder(DX::ManualClock& clock, DX::StepTimer& timer, uint64_t frameTicks, uint64_t updateTicks)
+    {
+        clock.Advance(frameTicks);
+
+        uint32_t updates = 0;
+        timer.Tick([&]()
+            {
+                clock.Advance(updateTicks);
+                updates++;
+            });
+        return updates;
+    }
+}
+
+DX_TEST(StepTimer, OneUpdatePerStep)
+{
+    DX::ManualClock clock;
+    DX::StepTimer timer(&clock);
+    timer.SetFixedTimeStep(true);
+
+    for (int frame = 0; frame < 600; ++frame)
+    {
+        DX_CHECK_EQUAL(TickAfter(clock, timer, Step), 1u);
+    }
+    DX_CHECK_EQUAL(timer.GetFrameCount(), 600u);
+    DX_CHECK_EQUAL(timer.GetTotalTicks(), 600 * Step);
+}
+
+DX_TEST(StepTimer, CatchesUpMissedSteps)
+{
+    DX::ManualClock clock;
+    DX::StepTimer timer(&clock);
+    timer.SetFixedTimeStep(true);
+
+    // A frame three steps long runs three Updates, each a whole step
+    DX_CHECK_EQUAL(TickAfter(clock, timer, 3 * Step), 3u);
+    DX_CHECK_EQUAL(timer.GetTotalTicks(), 3 * Step);
+
+    // Partial steps carry over until they add up to a whole one
+    DX_CHECK_EQUAL(TickAfter(clock, timer, Step / 2), 0u);
+    DX_CHECK_EQUAL(TickAfter(clock, timer, Step / 2), 1u);
+    DX_CHECK_EQUAL(TickAfter(clock, timer, 2 * Step + Step / 3), 2u);
+    DX_CHECK_EQUAL(TickAfter(clock, timer, Step - Step / 3), 1u);
+    DX_CHECK_EQUAL(timer.GetFrameCount(), 7u);
+    DX_CHECK_EQUAL(timer.GetTotalTicks(), 7 * Step);
+}
+
+DX_TEST(StepTimer, StallsAreClampedToATenthOfASecond)
+{
+    DX::ManualClock clock;
+    DX::StepTimer timer(&clock);
+    timer.SetFixedTimeStep(true);
+
+    // A second in the debugger catches up a tenth of a second only: six whole steps, the rest carried over
+    DX_CHECK_EQUAL(TickAfter(clock, timer, DX::StepTimer::TicksPerSecond), 6u);
+    DX_CHECK_EQUAL(TickAfter(clock, timer, Step - DX::StepTimer::TicksPerSecond / 10 % Step), 1u);
+
+    // After ResetElapsedTime the stall is not caught up at all
+    clock.Advance(DX::StepTimer::TicksPerSecond);
+    timer.ResetElapsedTime();
+    DX_CHECK_EQUAL(TickAfter(clock, timer, Step), 1u);
+    DX_CHECK_EQUAL(timer.GetFrameCount(), 8u);
+}
+
+DX_TEST(StepTimer, NearTargetFramesSnapToTheStep)
+{
+    DX::ManualClock clock;
+    DX::StepTimer timer(&clock);
+    timer.SetFixedTimeStep(true);
+
+    // A 60 Hz step on a 59.94 Hz display: without snapping the excess would add an Update every ~1000 frames
+    const uint64_t ntscFrame = DX::StepTimer::TicksPerSecond * 1001 / 60000;
+    for (int frame = 0; frame < 10000; ++frame)
+    {
+        DX_CHECK_EQUAL(TickAfter(clock, timer, ntscFrame), 1u);
+    }
+    DX_CHECK_EQUAL(timer.GetTotalTicks(), 10000 * Step);
+
+    // A quarter of a millisecond off is not near enough
+    const uint64_t slowFrame = Step + DX::StepTimer::TicksPerSecond / 4000;
+    uint32_t updates = 0;
+    for (int frame = 0; frame < 1000; ++frame)
+    {
+        updates += TickAfter(clock, timer, slowFrame);
+    }
+    DX_CHECK_EQUAL(updates, static_cast<uint32_t>(1000 * slowFrame / Step));
+}
+
+DX_TEST(StepTimer, ConvertsClockUnits)
+{
+    // A nanosecond clock, as SystemClock is outside Windows
+    DX::ManualClock clock(1000000000);
+    DX::StepTimer timer(&clock);
+    timer.SetFixedTimeStep(true);
+
+    std::vector<uint32_t> updates;
+    for (uint64_t nanoseconds : { 16666667ull, 50000000ull, 8333333ull, 8333333ull, 1000000000ull })
+    {
+        updates.push_back(TickAfter(clock, timer, nanoseconds));
+    }
+    DX_CHECK(updates == (std::vector<uint32_t>{ 1, 3, 0, 1, 6 }));
+}
+
+DX_TEST(StepTimer, VariableStepRunsOneUpdatePerTick)
+{
+    DX::ManualClock clock;
+    DX::StepTimer timer(&clock);
+
+    DX_CHECK_EQUAL(TickAfter(clock, timer, 12345), 1u);
+    DX_CHECK_EQUAL(TickAfter(clock, timer, 0), 1u);
+    DX_CHECK_EQUAL(TickAfter(clock, timer, 3 * Step), 1u);
+    DX_CHECK_EQUAL(timer.GetTotalTicks(), 12345 + 3 * Step);
+}
+
+DX_TEST(StepTimer, CountsFramesPerSecond)
+{
+    DX::ManualClock clock;
+    DX::StepTimer timer(&clock);
+
+    for (int frame = 0; frame < 49; ++frame)
+    {
+        TickAfter(clock, timer, DX::StepTimer::TicksPerSecond / 50);
+    }
+    DX_CHECK_EQUAL(timer.GetFramesPerSecond(), 0u);
+
+    TickAfter(clock, timer, DX::StepTimer::TicksPerSecond / 50);
+    DX_CHECK_EQUAL(timer.GetFramesPerSecond(), 50u);
+}
+
+DX_TEST(StepTimer, ClockWithoutFrequencyThrows)
+{
+    DX::ManualClock clock(0);
+    DX_CHECK_THROWS(DX::StepTimer(&clock), std::exception);
+}
+
+DX_TEST(StepTimer, UpdateLimitDropsTheRest)
+{
+    DX::ManualClock clock;
+    DX::StepTimer timer(&clock);
+    timer.SetFixedTimeStep(true);
+    timer.SetMaxUpdatesPerTick(2);
+
+    // Five and a half steps run two Updates; three whole steps are dropped and the half is kept
+    DX_CHECK_EQUAL(TickAfter(clock, timer, 5 * Step + Step / 2), 2u);
+    DX_CHECK_EQUAL(timer.GetDroppedTicks(), 3 * Step);
+    DX_CHECK_EQUAL(timer.GetTotalTicks(), 2 * Step);
+    DX_CHECK(std::abs(timer.GetInterpolationAlpha() - 0.5) < 1e-5);
+
+    DX_CHECK_EQUAL(TickAfter(clock, timer, Step / 2), 1u);
+    DX_CHECK_EQUAL(timer.GetInterpolationAlpha(), 0.0);
+    DX_CHECK_EQUAL(timer.GetDroppedTicks(), 3 * Step);
+
+    // 0 lifts the limit
+    timer.SetMaxUpdatesPerTick(0);
+    DX_CHECK_EQUAL(TickAfter(clock, timer, 5 * Step), 5u);
+    DX_CHECK_EQUAL(timer.GetDroppedTicks(), 3 * Step);
+
+    // Variable timestep renders the latest state as it is
+    timer.SetFixedTimeStep(false);
+    DX_CHECK_EQUAL(TickAfter(clock, timer, Step / 3), 1u);
+    DX_CHECK_EQUAL(timer.GetInterpolationAlpha(), 1.0);
+}
+
+DX_TEST(StepTimer, UpdateLimitStopsTheSpiral)
+{
+    // Each Update takes twice the step it simulates, so every catch-up makes the next frame longer
+    constexpr uint64_t RenderTicks = Step / 4;
+    constexpr uint64_t UpdateTicks = 2 * Step;
+
+    uint32_t updates[2] = {};
+    uint64_t frameTicks[2] = {};
+    for (uint32_t limit : { 0u, 2u })
+    {
+        DX::ManualClock clock;
+        DX::StepTimer timer(&clock);
+        timer.SetFixedTimeStep(true);
+        timer.SetMaxUpdatesPerTick(limit);
+
+        for (int frame = 0; frame < 100; ++frame)
+        {
+            const uint64_t start = clock.GetTicks();
+            updates[limit / 2] = TickUnder(clock, timer, RenderTicks, UpdateTicks);
+            frameTicks[limit / 2] = clock.GetTicks() - start;
+        }
+    }
+
+    // Unbounded, the frames grow until the tenth-of-a-second clamp holds them at six Updates, 200 ms each
+    DX_CHECK_EQUAL(updates[0], 6u);
+    DX_CHECK_EQUAL(frameTicks[0], RenderTicks + 6 * UpdateTicks);
+
+    // With the limit, a frame costs at most two Updates
+    DX_CHECK_EQUAL(updates[1], 2u);
+    DX_CHECK_EQUAL(frameTicks[1], RenderTicks + 2 * UpdateTicks);
+}
+
+DX_TEST(StepTimer, AdaptiveStepGrowsUnderSustainedOverload)
+{
+    DX::ManualClock clock;
+    DX::StepTimer timer(&clock);
+    timer.SetFixedTimeStep(true);
+    timer.SetMaxUpdatesPerTick(2);
+    timer.SetAdaptiveTimeStep(true, 4 * Step);
+
+    // Updates take three times the step: only a step four times as long keeps up
+    uint64_t dropped = 0;
+    uint32_t cappedRun = 0;
+    std::vector<uint64_t> steps{ timer.GetStepTicks() };
+    for (int frame = 0; frame < 400; ++frame)
+    {
+        const uint64_t step = timer.GetStepTicks();
+        DX_CHECK(TickUnder(clock, timer, Step / 4, 3 * Step) <= 2);
+
+        cappedRun = (timer.GetDroppedTicks() > dropped) ? cappedRun + 1 : 0;
+        dropped = timer.GetDroppedTicks();
+
+        // The step doubles on the eighth capped Tick in a row, and only then
+        if (timer.GetStepTicks() != step)
+        {
+            DX_CHECK_EQUAL(cappedRun, 8u);
+            DX_CHECK_EQUAL(timer.GetStepTicks(), 2 * step);
+            steps.push_back(timer.GetStepTicks());
+            cappedRun = 0;
+        }
+        DX_CHECK(cappedRun < 8);
+    }
+    DX_CHECK(steps == (std::vector<uint64_t>{ Step, 2 * Step, 4 * Step }));
+
+    // At the longest step the simulation keeps up again, and nothing more is dropped
+    for (int frame = 0; frame < 100; ++frame)
+    {
+        TickUnder(clock, timer, Step / 4, 3 * Step);
+    }
+    DX_CHECK_EQUAL(timer.GetDroppedTicks(), dropped);
+    DX_CHECK_EQUAL(timer.GetStepTicks(), 4 * Step);
+}
+
+DX_TEST(StepTimer, AdaptiveStepRecoversWhenTheLoadDrops)
+{
+    DX::ManualClock clock;
+    DX::StepTimer timer(&clock);
+    timer.SetFixedTimeStep(true);
+    timer.SetMaxUpdatesPerTick(2);
+    timer.SetAdaptiveTimeStep(true, 4 * Step);
+
+    for (int frame = 0; frame < 100; ++frame)
+    {
+        TickUnder(clock, timer, Step / 4, 3 * Step);
+    }
+    DX_CHECK_EQUAL(timer.GetStepTicks(), 4 * Step);
+
+    // Cheap Updates: the step halves after 120 calm Ticks at each length, back down to the target. The first Tick
+    // still measures the last expensive Updates, so is not calm.
+    std::vector<int> halvedAt;
+    for (int frame = 1; frame <= 1000; ++frame)
+    {
+        const uint64_t step = timer.GetStepTicks();
+        TickUnder(clock, timer, Step / 4, Step / 10);
+        if (timer.GetStepTicks() != step)
+        {
+            DX_CHECK_EQUAL(timer.GetStepTicks(), step / 2);
+            halvedAt.push_back(frame);
+        }
+    }
+    DX_CHECK(halvedAt == (std::vector<int>{ 121, 241 }));
+    DX_CHECK_EQUAL(timer.GetStepTicks(), Step);
+}
+
+DX_TEST(StepTimer, AdaptiveStepHoldsUnderSteadyLoad)
+{
+    DX::ManualClock clock;
+    DX::StepTimer timer(&clock);
+    timer.SetFixedTimeStep(true);
+    timer.SetMaxUpdatesPerTick(2);
+    timer.SetAdaptiveTimeStep(true, 4 * Step);
+
+    // A load the doubled step just keeps up with must not make the step go back and forth
+    uint32_t changes = 0;
+    for (int frame = 0; frame < 2000; ++frame)
+    {
+        const uint64_t step = timer.GetStepTicks();
+        TickUnder(clock, timer, Step / 4, Step * 3 / 2);
+        changes += (timer.GetStepTicks() != step) ? 1 : 0;
+    }
+    DX_CHECK_EQUAL(changes, 1u);
+    DX_CHECK_EQUAL(timer.GetStepTicks(), 2 * Step);
+
+    // Turning adaptation off goes straight back to the target step
+    timer.SetAdaptiveTimeStep(false, 4 * Step);
+    DX_CHECK_EQUAL(timer.GetStepTicks(), Step);
+}
+
+DX_TEST(StepTimer, AdaptiveStepNeedsAnUpdateLimit)
+{
+    DX::ManualClock clock;
+    DX::StepTimer timer(&clock);
+    timer.SetFixedTimeStep(true);
+    timer.SetAdaptiveTimeStep(true, 4 * Step);
+
+    for (int frame = 0; frame < 100; ++frame)
+    {
+        TickUnder(clock, timer, Step / 4, 2 * Step);
+    }
+    DX_CHECK_EQUAL(timer.GetStepTicks(), Step);
+    DX_CHECK_EQUAL(timer.GetDroppedTicks(), uint64_t(0));
+}
@@ -0,0 +1,129 @@
+//
+// TaskGraphTests.cpp - Dependency order, main thread tasks and error handling of the task graph
+//
+
+#include "TestHarness.h"
+
+#include "JobSystem.h"
+#include "TaskGraph.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    constexpr unsigned int c_workers = 4;
+}
+
+DX_TEST(TaskGraph, RespectsDependencies)
+{
+    DX::JobSystem jobs(c_workers);
+    DX::TaskGraph graph;
+
+    // A diamond, a long chain off it, and unrelated tasks to steal
+    constexpr size_t chainLength = 16;
+    std::atomic<uint32_t> clock = 0;
+    std::vector<uint32_t> finished(4 + chainLength + 32);
+    auto const stamp = [&](size_t node)
+        {
+            return [&, node]()
+                {
+                    std::this_thread::yield();
+                    finished[node] = clock.fetch_add(1) + 1;
+                };
+        };
+
+    for (size_t node = 0; node < finished.size(); ++node)
+    {
+        graph.AddNode("Task", stamp(node));
+    }
+    graph.AddDependency(0, 1);
+    graph.AddDependency(0, 2);
+    graph.AddDependency(1, 3);
+    graph.AddDependency(2, 3);
+    graph.AddDependency(3, 4);
+    for (size_t node = 4; node + 1 < 4 + chainLength; ++node)
+    {
+        graph.AddDependency(node, node + 1);
+    }
+
+    for (int round = 0; round < 200; ++round)
+    {
+        clock = 0;
+        graph.Execute(jobs);
+
+        DX_CHECK(finished[0] < finished[1] && finished[0] < finished[2]);
+        DX_CHECK(finished[1] < finished[3] && finished[2] < finished[3]);
+        for (size_t node = 3; node + 1 < 4 + chainLength; ++node)
+        {
+            DX_CHECK(finished[node] < finished[node + 1]);
+        }
+        DX_CHECK_EQUAL(clock.load(), static_cast<uint32_t>(finished.size()));
+    }
+}
+
+DX_TEST(TaskGraph, MainThreadTasksRunOnTheCaller)
+{
+    DX::JobSystem jobs(c_workers);
+    DX::TaskGraph graph;
+
+    const auto caller = std::this_thread::get_id();
+    std::atomic<bool> onCaller = true;
+    auto const worker = graph.AddNode("Worker", []() { std::this_thread::sleep_for(std::chrono::microseconds(100)); });
+    auto const main = graph.AddNode("Main", [&]() { onCaller = std::this_thread::get_id() == caller; }, true);
+    graph.AddDependency(worker, main);
+
+    for (int round = 0; round < 50; ++round)
+    {
+        graph.Execute(jobs);
+        DX_CHECK(onCaller.load());
+    }
+
+    auto const timings = graph.GetTimings();
+    DX_CHECK_EQUAL(timings.size(), size_t(2));
+    DX_CHECK_EQUAL(timings[main].thread, size_t(0));
+    DX_CHECK(timings[worker].thread <= c_workers);
+    DX_CHECK(timings[main].startSeconds >= timings[worker].startSeconds + timings[worker].durationSeconds);
+}
+
+DX_TEST(TaskGraph, ExecuteAsAJob)
+{
+    // As pipelined Update does: the graph's own caller is a worker, so its timings report worker indices
+    DX::JobSystem jobs(c_workers);
+    DX::TaskGraph graph;
+    std::atomic<uint32_t> ran = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        graph.AddNode("Task", [&]() { ran.fetch_add(1); });
+    }
+
+    for (int round = 0; round < 50; ++round)
+    {
+        DX::JobSystem::Counter counter;
+        jobs.Run([&]() { graph.Execute(jobs); }, &counter);
+        jobs.Wait(counter);
+    }
+    DX_CHECK_EQUAL(ran.load(), 400u);
+}
+
+DX_TEST(TaskGraph, ErrorsAndCycles)
+{
+    DX::JobSystem jobs(c_workers);
+    DX::TaskGraph graph;
+    std::atomic<bool> successorRan = false;
+    auto const failing = graph.AddNode("Failing", []() { throw std::runtime_error("task failed"); });
+    auto const successor = graph.AddNode("Successor", [&]() { successorRan = true; });
+    graph.AddDependency(failing, successor);
+    DX_CHECK_THROWS(graph.Execute(jobs), std::runtime_error);
+    DX_CHECK(successorRan.load());
+
+    DX_CHECK_THROWS(graph.AddDependency(failing, failing), std::out_of_range);
+    graph.AddDependency(successor, failing);
+    DX_CHECK_THROWS(graph.Execute(jobs), std::logic_error);
+}
@@ -0,0 +1,144 @@
+//
+// TestHarness.h - Registration and checks for the host-side unit tests and benchmarks
+//
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace DX::Test
+{
+    // Thrown by a failed check; the runner reports it and moves on to the next test.
+    class Failure : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    struct Case
+    {
+        const char*             name;
+        std::function<void()>   body;
+    };
+
+    inline std::vector<Case>& GetTests()
+    {
+        static std::vector<Case> tests;
+        return tests;
+    }
+
+    inline std::vector<Case>& GetBenchmarks()
+    {
+        static std::vector<Case> benchmarks;
+        return benchmarks;
+    }
+
+    struct Registrar
+    {
+        Registrar(std::vector<Case>& cases, const char* name, void (*body)()) { cases.push_back(Case{ name, body }); }
+    };
+
+    [[noreturn]] inline void Fail(const char* file, int line, std::string const& message)
+    {
+        std::ostringstream stream;
+        stream << file << "(" << line << "): " << message;
+        throw Failure(stream.str());
+    }
+
+    template<typename TLeft, typename TRight>
+    void CheckEqual(TLeft const& left, TRight const& right, const char* expression, const char* file, int line)
+    {
+        if (!(left == right))
+        {
+            std::ostringstream stream;
+            stream << expression << ": " << left << " != " << right;
+            Fail(file, line, stream.str());
+        }
+    }
+
+    // Run every case whose name starts with filter. Returns the number that failed.
+    inline int Run(std::vector<Case> const& cases, std::string_view filter)
+    {
+        int run = 0;
+        int failed = 0;
+        for (auto const& test : cases)
+        {
+            if (std::string_view(test.name).substr(0, filter.size()) != filter)
+                continue;
+
+            run++;
+            try
+            {
+                test.body();
+                std::printf("[ pass ] %s\n", test.name);
+            }
+            catch (std::exception const& e)
+            {
+                failed++;
+                std::printf("[ FAIL ] %s\n         %s\n", test.name, e.what());
+            }
+        }
+
+        std::printf("%d of %d passed\n", run - failed, run);
+        return (run == 0) ? 1 : failed;
+    }
+
+    // Time repeated calls of body, and return the best per-call time in nanoseconds.
+    template<typename TBody>
+    double MeasureNanoseconds(size_t repetitions, TBody&& body)
+    {
+        double best = 0.0;
+        for (int round = 0; round < 5; ++round)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < repetitions; ++i)
+            {
+                body();
+            }
+            const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()
+                / static_cast<double>(repetitions);
+            best = (round == 0) ? elapsed : std::min(best, elapsed);
+        }
+        return best;
+    }
+}
+
+#define DX_TEST_CONCAT_INNER(a, b) a##b
+#define DX_TEST_CONCAT(a, b) DX_TEST_CONCAT_INNER(a, b)
+
+// DX_TEST(Suite, Name) { ... } registers a test named "Suite.Name".
+#define DX_TEST(suite, name) \
+    static void DX_TEST_CONCAT(suite##_##name, _Test)(); \
+    static DX::Test::Registrar DX_TEST_CONCAT(suite##_##name, _Registrar)( \
+        DX::Test::GetTests(), #suite "." #name, &DX_TEST_CONCAT(suite##_##name, _Test)); \
+    static void DX_TEST_CONCAT(suite##_##name, _Test)()
+
+#define DX_BENCHMARK(suite, name) \
+    static void DX_TEST_CONCAT(suite##_##name, _Benchmark)(); \
+    static DX::Test::Registrar DX_TEST_CONCAT(suite##_##name, _BenchmarkRegistrar)( \
+        DX::Test::GetBenchmarks(), #suite "." #name, &DX_TEST_CONCAT(suite##_##name, _Benchmark)); \
+    static void DX_TEST_CONCAT(suite##_##name, _Benchmark)()
+
+#define DX_CHECK(expression) \
+    do { if (!(expression)) DX::Test::Fail(__FILE__, __LINE__, #expression); } while (false)
+
+#define DX_CHECK_EQUAL(left, right) \
+    DX::Test::CheckEqual((left), (right), #left " == " #right, __FILE__, __LINE__)
+
+#define DX_CHECK_THROWS(expression, exception) \
+    do \
+    { \
+        bool threw = false; \
+        try { (void)(expression); } catch (exception const&) { threw = true; } \
+        if (!threw) DX::Test::Fail(__FILE__, __LINE__, #expression " did not throw " #exception); \
+    } while (false)
@@ -0,0 +1,11 @@
+//
+// TestMain.cpp - Runs the unit tests whose names start with the first argument, or all of them
+//
+
+#include "TestHarness.h"
+
+
+int main(int argc, char** argv)
+{
+    return DX::Test::Run(DX::Test::GetTests(), argc > 1 ? argv[1] : "") ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+//
+// TextureRegistryBenchmark.cpp - A frame's texture lookups over 10k textures, through the maps Game used to keep and
+// through the registry by path, by ID and by handle
+//
+
+#include "TestHarness.h"
+
+#include "TextureRegistry.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    constexpr size_t c_textureCount = 10000;
+
+    struct TexHand
+    {
+        uint32_t    desc;
+        uint32_t    width;
+    };
+
+    // Paths as an asset tree names them, sharing long prefixes.
+    std::vector<std::wstring> MakePaths()
+    {
+        static const wchar_t* const folders[] = { L"textures/characters/", L"textures/environment/", L"textures/props/" };
+        std::vector<std::wstring> paths;
+        for (size_t i = 0; i < c_textureCount; ++i)
+        {
+            paths.push_back(folders[i % 3] + std::to_wstring(i) + ((i % 2) ? L"_diffuse.dds" : L"_normal.dds"));
+        }
+        return paths;
+    }
+}
+
+DX_BENCHMARK(TextureRegistry, FrameOfLookups)
+{
+    auto const paths = MakePaths();
+
+    // Each texture drawn once a frame, in an order unrelated to how they were loaded
+    std::vector<size_t> order(c_textureCount);
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(5));
+
+    std::map<std::wstring, TexHand> byString;
+    std::map<const wchar_t*, TexHand> byPointer;
+    DX::TextureRegistry<TexHand> registry(c_textureCount);
+    std::vector<DX::TextureId> ids;
+    std::vector<DX::TextureRegistry<TexHand>::Handle> handles;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        const TexHand texHand{ static_cast<uint32_t>(i), 256 };
+        byString.emplace(paths[i], texHand);
+        byPointer.emplace(paths[i].c_str(), texHand);
+        handles.push_back(registry.Register(paths[i], texHand));
+        ids.emplace_back(paths[i]);
+    }
+
+    // Every way sums the descriptors it finds, so none can be skipped and all must agree
+    uint64_t expected = 0;
+    for (size_t i = 0; i < c_textureCount; ++i)
+    {
+        expected += i;
+    }
+    uint64_t sum = 0;
+    auto measure = [&](auto&& lookup)
+    {
+        const double frame = DX::Test::MeasureNanoseconds(20, [&]()
+            {
+                sum = 0;
+                for (auto const i : order)
+                {
+                    sum += lookup(i).desc;
+                }
+            });
+        DX_CHECK_EQUAL(sum, expected);
+        return frame;
+    };
+
+    const double stringMap = measure([&](size_t i) -> TexHand const& { return byString.at(paths[i]); });
+    const double pointerMap = measure([&](size_t i) -> TexHand const& { return byPointer.at(paths[i].c_str()); });
+    const double byPath = measure([&](size_t i) -> TexHand const& { return registry.at(paths[i]); });
+    const double byId = measure([&](size_t i) -> TexHand const& { return registry.at(ids[i]); });
+    const double byHandle = measure([&](size_t i) -> TexHand const& { return registry.Get(handles[i]); });
+
+    std::printf("  %zu textures, each looked up once a frame\n", c_textureCount);
+    std::printf("  std::map by string: %.1f us a frame (%.1f ns each)\n", stringMap * 1e-3, stringMap / c_textureCount);
+    std::printf("  std::map by pointer: %.1f us a frame (%.1f ns each)\n", pointerMap * 1e-3, pointerMap / c_textureCount);
+    std::printf("  registry by path: %.1f us a frame (%.1f ns each)\n", byPath * 1e-3, byPath / c_textureCount);
+    std::printf("  registry by ID: %.1f us a frame (%.1f ns each)\n", byId * 1e-3, byId / c_textureCount);
+    std::printf("  registry by handle: %.1f us a frame (%.1f ns each)\n", byHandle * 1e-3, byHandle / c_textureCount);
+}
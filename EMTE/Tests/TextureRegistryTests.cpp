@@ -0,0 +1,126 @@
+//
+// TextureRegistryTests.cpp - Lookup by content, collision rejection and table growth
+//
+
+#include "TestHarness.h"
+
+#include "TextureRegistry.h"
+
+#include <cstdint>
+#include <cwchar>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+
+namespace
+{
+    using Registry = DX::TextureRegistry<int>;
+
+    // Two paths with the same 64-bit FNV-1a hash, found by cycle finding over names of five CJK characters. Every
+    // character is below 0x8000, so they collide whether wchar_t is 16 or 32 bits wide.
+    constexpr const wchar_t* c_collidingPath = L"textures/\x6505\x4E48\x60A3\x5A88\x5CC0";
+    constexpr const wchar_t* c_collidedPath = L"textures/\x64FB\x597E\x5C55\x612E\x5924";
+
+    std::wstring MakePath(size_t i)
+    {
+        return L"textures/props/" + std::to_wstring(i) + L".dds";
+    }
+}
+
+DX_TEST(TextureRegistry, EqualStringsAtDifferentAddressesAreOneTexture)
+{
+    static_assert(DX::TextureId(L"textures/cat.dds") == DX::TextureId(std::wstring_view(L"textures/cat.dds")));
+
+    // The same path held in three different places
+    const wchar_t* literal = L"textures/cat.dds";
+    wchar_t buffer[32];
+    std::wcscpy(buffer, literal);
+    const std::wstring owned = std::wstring(L"textures/") + L"cat.dds";
+    DX_CHECK(static_cast<const void*>(buffer) != static_cast<const void*>(literal));
+    DX_CHECK(static_cast<const void*>(owned.c_str()) != static_cast<const void*>(literal));
+
+    DX_CHECK(DX::TextureId(literal) == DX::TextureId(buffer));
+    DX_CHECK(DX::TextureId(literal) == DX::TextureId(owned));
+
+    Registry registry;
+    const auto handle = registry.Register(buffer, 1);
+    DX_CHECK_EQUAL(registry.Find(literal), handle);
+    DX_CHECK_EQUAL(registry.Find(owned), handle);
+    DX_CHECK_EQUAL(registry.Find(DX::TextureId(literal)), handle);
+    DX_CHECK_EQUAL(registry.at(owned), 1);
+
+    // Registering it again from elsewhere keeps the first value
+    DX_CHECK_EQUAL(registry.Register(owned, 2), handle);
+    DX_CHECK_EQUAL(registry.size(), size_t(1));
+    DX_CHECK_EQUAL(registry.at(literal), 1);
+
+    // A path that differs is another texture, and one never registered is not found
+    DX_CHECK_EQUAL(registry.Register(L"textures/Cat.dds", 3), Registry::Handle(1));
+    DX_CHECK_EQUAL(registry.at(DX::TextureId(L"textures/Cat.dds")), 3);
+    DX_CHECK_EQUAL(registry.Find(L"textures/dog.dds"), Registry::InvalidHandle);
+    DX_CHECK(!registry.Contains(L"textures/cat.dd"));
+    DX_CHECK_THROWS(registry.at(L"textures/dog.dds"), std::out_of_range);
+    DX_CHECK_THROWS(registry.at(DX::TextureId(L"textures/dog.dds")), std::out_of_range);
+}
+
+DX_TEST(TextureRegistry, CollisionsAreRejectedAtRegister)
+{
+    static_assert(DX::HashTexturePath(c_collidingPath) == DX::HashTexturePath(c_collidedPath));
+    DX_CHECK(std::wstring_view(c_collidingPath) != std::wstring_view(c_collidedPath));
+
+    Registry registry;
+    registry.Register(L"textures/cat.dds", 0);
+    const auto handle = registry.Register(c_collidingPath, 1);
+    DX_CHECK_THROWS(registry.Register(c_collidedPath, 2), std::runtime_error);
+
+    // Nothing was added, and the path that lost is not mistaken for the one that won
+    DX_CHECK_EQUAL(registry.size(), size_t(2));
+    DX_CHECK_EQUAL(registry.Find(c_collidingPath), handle);
+    DX_CHECK_EQUAL(registry.Find(c_collidedPath), Registry::InvalidHandle);
+    DX_CHECK_THROWS(registry.at(c_collidedPath), std::out_of_range);
+    DX_CHECK_EQUAL(registry.at(c_collidingPath), 1);
+
+    // In the other order the other path is the one rejected
+    Registry reversed;
+    reversed.Register(c_collidedPath, 2);
+    DX_CHECK_THROWS(reversed.Register(c_collidingPath, 1), std::runtime_error);
+    DX_CHECK_EQUAL(reversed.at(c_collidedPath), 2);
+}
+
+DX_TEST(TextureRegistry, TableGrowsKeepingHandles)
+{
+    // Expecting a single texture and given thousands, the table rehashes many times over
+    Registry registry(1);
+    const size_t count = 5000;
+    for (size_t i = 0; i < count; ++i)
+    {
+        DX_CHECK_EQUAL(registry.Register(MakePath(i), static_cast<int>(i)), Registry::Handle(i));
+    }
+    DX_CHECK_EQUAL(registry.size(), count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto const path = MakePath(i);
+        DX_CHECK_EQUAL(registry.Find(path), Registry::Handle(i));
+        DX_CHECK_EQUAL(registry.Find(DX::TextureId(path)), Registry::Handle(i));
+        DX_CHECK_EQUAL(registry.Get(Registry::Handle(i)), static_cast<int>(i));
+        DX_CHECK(registry.GetPath(Registry::Handle(i)) == path);
+    }
+    DX_CHECK_EQUAL(registry.Find(MakePath(count)), Registry::InvalidHandle);
+
+    // Values iterate in handle order
+    int expected = 0;
+    for (auto const value : registry)
+    {
+        DX_CHECK_EQUAL(value, expected++);
+    }
+
+    // Cleared, it is empty but takes the same paths again from handle 0
+    registry.clear();
+    DX_CHECK(registry.empty());
+    DX_CHECK_EQUAL(registry.Find(MakePath(7)), Registry::InvalidHandle);
+    DX_CHECK_EQUAL(registry.Register(MakePath(7), 70), Registry::Handle(0));
+    DX_CHECK_EQUAL(registry.at(MakePath(7)), 70);
+    DX_CHECK_THROWS(registry.Get(Registry::Handle(1)), std::out_of_range);
+}
@@ -0,0 +1,472 @@
+//
+// TraceCaptureTests.cpp - Round-trips captures through the Chrome trace writer and a JSON reader
+//
+
+#include "TestHarness.h"
+
+#include "TraceCapture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace
+{
+    constexpr DX::ProfileZoneInfo c_outer{ "Outer", L"Outer", __FILE__, __LINE__ };
+    constexpr DX::ProfileZoneInfo c_inner{ "Inner", L"Inner", __FILE__, __LINE__ };
+    constexpr DX::ProfileZoneInfo c_quoted{ "Say \"hi\"\\\tthen\nleave", L"Quoted", __FILE__, __LINE__ };
+
+    // A queue whose work has always just finished by the time anyone waits on it.
+    class ImmediateQueue final : public DX::IFenceBackend
+    {
+    public:
+        bool Signal(uint64_t) noexcept override { return true; }
+
+        uint64_t GetCompletedValue() noexcept override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_completed;
+        }
+
+        bool Wait(uint64_t value, uint32_t) noexcept override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_completed = std::max(m_completed, value);
+            return true;
+        }
+
+    private:
+        std::mutex  m_mutex;
+        uint64_t    m_completed = 0;
+    };
+
+    struct JsonValue
+    {
+        enum class Type { Null, Boolean, Number, String, Array, Object };
+
+        Type                                            type = Type::Null;
+        double                                          number = 0.0;
+        std::string                                     string;
+        std::vector<JsonValue>                          array;
+        std::vector<std::pair<std::string, JsonValue>>  members;
+
+        bool Has(std::string_view key) const
+        {
+            for (auto const& [name, value] : members)
+            {
+                if (name == key)
+                    return true;
+            }
+            return false;
+        }
+
+        JsonValue const& operator[](std::string_view key) const
+        {
+            for (auto const& [name, value] : members)
+            {
+                if (name == key)
+                    return value;
+            }
+            throw std::runtime_error("No member " + std::string(key));
+        }
+    };
+
+    // Reads the JSON the trace writer produces: strict enough that malformed output fails, not a general parser
+    // (escapes outside ASCII are rejected, as the writer never emits them).
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(std::string_view text) : m_text(text), m_position(0) {}
+
+        JsonValue ReadDocument()
+        {
+            auto value = ReadValue();
+            SkipSpace();
+            if (m_position != m_text.size())
+                throw std::runtime_error("Trailing characters after the JSON document");
+            return value;
+        }
+
+    private:
+        void SkipSpace()
+        {
+            while (m_position < m_text.size() && (m_text[m_position] == ' ' || m_text[m_position] == '\n'
+                || m_text[m_position] == '\r' || m_text[m_position] == '\t'))
+            {
+                m_position++;
+            }
+        }
+
+        char Next()
+        {
+            if (m_position == m_text.size())
+                throw std::runtime_error("Unexpected end of JSON");
+            return m_text[m_position++];
+        }
+
+        void Expect(char c)
+        {
+            SkipSpace();
+            if (Next() != c)
+                throw std::runtime_error(std::string("Expected '") + c + "' at " + std::to_string(m_position - 1));
+        }
+
+        bool Accept(char c)
+        {
+            SkipSpace();
+            if (m_position < m_text.size() && m_text[m_position] == c)
+            {
+                m_position++;
+                return true;
+            }
+            return false;
+        }
+
+        std::string ReadString()
+        {
+            Expect('"');
+            std::string text;
+            for (;;)
+            {
+                const char c = Next();
+                if (c == '"')
+                    return text;
+                if (static_cast<unsigned char>(c) < 0x20)
+                    throw std::runtime_error("Unescaped control character in a string");
+                if (c != '\\')
+                {
+                    text.push_back(c);
+                    continue;
+                }
+
+                const char escape = Next();
+                switch (escape)
+                {
+                case '"': case '\\': case '/': text.push_back(escape); break;
+                case 'n': text.push_back('\n'); break;
+                case 't': text.push_back('\t'); break;
+                case 'r': text.push_back('\r'); break;
+                case 'b': text.push_back('\b'); break;
+                case 'f': text.push_back('\f'); break;
+                case 'u':
+                {
+                    if (m_position + 4 > m_text.size())
+                        throw std::runtime_error("Truncated \\u escape");
+                    const auto code = std::strtoul(std::string(m_text.substr(m_position, 4)).c_str(), nullptr, 16);
+                    if (code >= 0x80)
+                        throw std::runtime_error("Non-ASCII \\u escape");
+                    text.push_back(static_cast<char>(code));
+                    m_position += 4;
+                    break;
+                }
+                default:
+                    throw std::runtime_error("Bad escape in a string");
+                }
+            }
+        }
+
+        JsonValue ReadValue()
+        {
+            SkipSpace();
+            if (m_position == m_text.size())
+                throw std::runtime_error("Unexpected end of JSON");
+
+            JsonValue value;
+            const char c = m_text[m_position];
+            if (c == '{')
+            {
+                value.type = JsonValue::Type::Object;
+                Expect('{');
+                if (Accept('}'))
+                    return value;
+                do
+                {
+                    auto key = ReadString();
+                    Expect(':');
+                    value.members.emplace_back(std::move(key), ReadValue());
+                } while (Accept(','));
+                Expect('}');
+            }
+            else if (c == '[')
+            {
+                value.type = JsonValue::Type::Array;
+                Expect('[');
+                if (Accept(']'))
+                    return value;
+                do
+                {
+                    value.array.push_back(ReadValue());
+                } while (Accept(','));
+                Expect(']');
+            }
+            else if (c == '"')
+            {
+                value.type = JsonValue::Type::String;
+                value.string = ReadString();
+            }
+            else if (m_text.substr(m_position, 4) == "true" || m_text.substr(m_position, 5) == "false")
+            {
+                value.type = JsonValue::Type::Boolean;
+                value.number = (c == 't') ? 1.0 : 0.0;
+                m_position += (c == 't') ? 4 : 5;
+            }
+            else if (m_text.substr(m_position, 4) == "null")
+            {
+                m_position += 4;
+            }
+            else
+            {
+                const std::string rest(m_text.substr(m_position, 64));
+                char* end = nullptr;
+                value.type = JsonValue::Type::Number;
+                value.number = std::strtod(rest.c_str(), &end);
+                if (end == rest.c_str())
+                    throw std::runtime_error("Bad value at " + std::to_string(m_position));
+                m_position += static_cast<size_t>(end - rest.c_str());
+            }
+            return value;
+        }
+
+        std::string_view    m_text;
+        size_t              m_position;
+    };
+
+    struct ParsedTrace
+    {
+        DX::TraceWriteResult    result;
+        JsonValue               document;
+
+        // The trace events, metadata included.
+        std::vector<JsonValue> const& Events() const { return document["traceEvents"].array; }
+
+        std::vector<JsonValue const*> Phase(std::string_view phase) const
+        {
+            std::vector<JsonValue const*> events;
+            for (auto const& event : Events())
+            {
+                if (event["ph"].string == phase)
+                {
+                    events.push_back(&event);
+                }
+            }
+            return events;
+        }
+    };
+
+    ParsedTrace WriteAndRead(DX::TraceSnapshot const& snapshot)
+    {
+        std::ostringstream stream;
+        ParsedTrace trace;
+        trace.result = DX::WriteChromeTrace(snapshot, stream);
+        trace.document = JsonReader(stream.str()).ReadDocument();
+        return trace;
+    }
+
+    DX::ProfileEvent Begin(DX::ProfileZoneInfo const& zone, uint64_t ticks)
+    {
+        return DX::ProfileEvent{ ticks, reinterpret_cast<uintptr_t>(&zone) };
+    }
+
+    DX::ProfileEvent End(DX::ProfileZoneInfo const& zone, uint64_t ticks)
+    {
+        return DX::ProfileEvent{ ticks, reinterpret_cast<uintptr_t>(&zone) | DX::ProfileEvent::EndBit };
+    }
+}
+
+DX_TEST(TraceCapture, RoundTripsZonesFencesAndFrames)
+{
+    // A profiler that has not ended a frame counts a tick as a nanosecond, so zone times here are exact
+    DX::Profiler profiler;
+    ImmediateQueue queue;
+    DX::FenceTimeline timeline(&queue);
+    DX::TraceCapture capture(1 << 20);
+    capture.AddFenceTrack(timeline, "Direct \"queue\"");
+
+    // Nothing is kept before the capture starts
+    capture.OnProfileEvents(0, std::vector<DX::ProfileEvent>{ Begin(c_outer, 10), End(c_outer, 20) });
+    capture.RecordFrame(1);
+    timeline.Signal();
+    DX_CHECK_EQUAL(capture.GetRecordCount(), size_t(0));
+
+    capture.Start();
+    capture.RecordFrame(2);
+    capture.OnProfileEvents(0, std::vector<DX::ProfileEvent>{ Begin(c_outer, 1000), Begin(c_inner, 2000),
+        End(c_inner, 3500), Begin(c_inner, 4000), End(c_inner, 4500), End(c_outer, 5000) });
+    capture.OnProfileEvents(3, std::vector<DX::ProfileEvent>{ Begin(c_quoted, 1500), End(c_quoted, 1750) });
+    const uint64_t signaled = timeline.Signal();
+    timeline.Signal();
+    DX_CHECK(timeline.Wait(signaled));
+    capture.RecordFrame(3);
+    capture.Stop();
+    capture.RecordFrame(4);
+    capture.DetachFenceTracks();
+
+    // 2 frames, 8 zone events, 2 signals and a wait's begin and end
+    DX_CHECK_EQUAL(capture.GetRecordCount(), size_t(14));
+    auto const snapshot = capture.TakeSnapshot(profiler);
+    DX_CHECK_EQUAL(capture.GetRecordCount(), size_t(0));
+    DX_CHECK_EQUAL(snapshot.droppedRecords, uint64_t(0));
+
+    auto const trace = WriteAndRead(snapshot);
+    DX_CHECK_EQUAL(trace.result.events, size_t(2 + 4 + 2 + 1));
+    DX_CHECK_EQUAL(trace.result.unmatched, size_t(0));
+    DX_CHECK_EQUAL(trace.Events().size(), trace.result.events + 2);
+    DX_CHECK_EQUAL(trace.document["displayTimeUnit"].string, std::string("ms"));
+
+    // Metadata names the process and the fence's track, escaping and all
+    auto const metadata = trace.Phase("M");
+    DX_CHECK_EQUAL(metadata.size(), size_t(2));
+    DX_CHECK_EQUAL((*metadata[0])["args"]["name"].string, std::string("EMTE"));
+    DX_CHECK_EQUAL((*metadata[1])["name"].string, std::string("thread_name"));
+    DX_CHECK_EQUAL((*metadata[1])["tid"].number, double(DX::TraceCapture::FenceTrackBase));
+    DX_CHECK_EQUAL((*metadata[1])["args"]["name"].string, std::string("Direct \"queue\""));
+
+    // Zones complete in the order they end, in microseconds, all on their thread's track. The fence's records use
+    // the real clock, so the zones' ticks are the earliest and Outer begins the trace.
+    auto const complete = trace.Phase("X");
+    DX_CHECK_EQUAL(complete.size(), size_t(5));
+    struct Expected
+    {
+        const char* name;
+        double      tid;
+        double      ts;
+        double      dur;
+    };
+    const Expected zones[] = {
+        { "Inner", 0, 1.0, 1.5 },
+        { "Inner", 0, 3.0, 0.5 },
+        { "Outer", 0, 0.0, 4.0 },
+        { c_quoted.name, 3, 0.5, 0.25 },
+    };
+    for (size_t i = 0; i < 4; ++i)
+    {
+        auto const& event = *complete[i];
+        DX_CHECK_EQUAL(event["name"].string, std::string(zones[i].name));
+        DX_CHECK_EQUAL(event["tid"].number, zones[i].tid);
+        DX_CHECK_EQUAL(event["ts"].number, zones[i].ts);
+        DX_CHECK_EQUAL(event["dur"].number, zones[i].dur);
+        DX_CHECK(!event.Has("args"));
+    }
+
+    // The wait is a complete event on the fence's track, carrying the value waited for
+    auto const& wait = *complete[4];
+    DX_CHECK_EQUAL(wait["name"].string, std::string("Wait"));
+    DX_CHECK_EQUAL(wait["tid"].number, double(DX::TraceCapture::FenceTrackBase));
+    DX_CHECK_EQUAL(wait["args"]["value"].number, double(signaled));
+    DX_CHECK(wait["dur"].number >= 0.0);
+
+    // Signals are instants on the fence's track, frames global instants; both in the order they happened
+    auto const instants = trace.Phase("i");
+    DX_CHECK_EQUAL(instants.size(), size_t(4));
+    DX_CHECK_EQUAL((*instants[0])["name"].string, std::string("Frame"));
+    DX_CHECK_EQUAL((*instants[0])["s"].string, std::string("g"));
+    DX_CHECK_EQUAL((*instants[0])["args"]["frame"].number, 2.0);
+    for (size_t i = 1; i < 3; ++i)
+    {
+        DX_CHECK_EQUAL((*instants[i])["name"].string, std::string("Signal"));
+        DX_CHECK_EQUAL((*instants[i])["s"].string, std::string("t"));
+        DX_CHECK_EQUAL((*instants[i])["tid"].number, double(DX::TraceCapture::FenceTrackBase));
+        DX_CHECK_EQUAL((*instants[i])["args"]["value"].number, double(signaled + i - 1));
+    }
+    DX_CHECK_EQUAL((*instants[3])["args"]["frame"].number, 3.0);
+    DX_CHECK((*instants[0])["ts"].number <= (*instants[1])["ts"].number);
+    DX_CHECK((*instants[2])["ts"].number <= wait["ts"].number);
+    DX_CHECK(wait["ts"].number <= (*instants[3])["ts"].number);
+}
+
+DX_TEST(TraceCapture, RecycledChunksLeaveUnmatchedHalves)
+{
+    // Two chunks at most: the third recycles the first
+    DX::Profiler profiler;
+    DX::TraceCapture capture(2 * sizeof(DX::TraceChunk));
+    DX_CHECK_EQUAL(capture.GetCapacityBytes(), 2 * sizeof(DX::TraceChunk));
+    capture.Start();
+
+    // Outer, around more Inner zones than fit, then a zone that never ends: three chunks' worth less one record
+    constexpr size_t capacity = DX::TraceChunk::Capacity;
+    constexpr size_t innerCount = capacity * 3 / 2 - 2;
+    static_assert(capacity % 2 == 0);
+    std::vector<DX::ProfileEvent> events;
+    events.push_back(Begin(c_outer, 100));
+    for (size_t i = 0; i < innerCount; ++i)
+    {
+        events.push_back(Begin(c_inner, 1000 + 10 * i));
+        events.push_back(End(c_inner, 1000 + 10 * i + 5));
+    }
+    events.push_back(End(c_outer, 1000 + 10 * innerCount));
+    events.push_back(Begin(c_quoted, 1000 + 10 * innerCount + 1));
+    capture.OnProfileEvents(0, events);
+
+    // The first chunk went, taking Outer's begin, the first capacity / 2 - 1 Inner zones and the begin of the
+    // next, whose end is now the oldest record
+    DX_CHECK_EQUAL(capture.GetDroppedCount(), uint64_t(capacity));
+    DX_CHECK_EQUAL(capture.GetRecordCount(), events.size() - capacity);
+    auto const snapshot = capture.TakeSnapshot(profiler);
+    DX_CHECK_EQUAL(snapshot.droppedRecords, uint64_t(capacity));
+    DX_CHECK_EQUAL(capture.GetDroppedCount(), uint64_t(0));
+    DX_CHECK_EQUAL(snapshot.chunks.size(), size_t(2));
+
+    // Microseconds are written to three places
+    auto const near = [](double a, double b) { return std::abs(a - b) < 0.0005; };
+
+    // That orphaned end, Outer's end and the last zone's begin are unmatched; every Inner zone left is whole
+    auto const trace = WriteAndRead(snapshot);
+    const size_t whole = innerCount - capacity / 2;
+    DX_CHECK_EQUAL(trace.result.unmatched, size_t(3));
+    DX_CHECK_EQUAL(trace.result.events, whole);
+
+    auto const complete = trace.Phase("X");
+    DX_CHECK_EQUAL(complete.size(), whole);
+    bool inner = true;
+    bool timed = true;
+    for (size_t i = 0; i < complete.size(); ++i)
+    {
+        inner &= (*complete[i])["name"].string == "Inner";
+        timed &= near((*complete[i])["dur"].number, 0.005) && near((*complete[i])["ts"].number, 0.005 + 0.01 * double(i));
+    }
+    DX_CHECK(inner);
+    DX_CHECK(timed);
+}
+
+DX_TEST(TraceCapture, WritesFilesWhole)
+{
+    DX::Profiler profiler;
+    DX::TraceCapture capture(1 << 16);
+    capture.Start();
+    capture.RecordFrame(7);
+    capture.OnProfileEvents(0, std::vector<DX::ProfileEvent>{ Begin(c_outer, 1), End(c_outer, 2) });
+
+    auto const path = std::filesystem::temp_directory_path() / "EMTETraceCaptureTest.json";
+    auto const result = DX::WriteChromeTrace(capture.TakeSnapshot(profiler), path);
+    DX_CHECK_EQUAL(result.events, size_t(2));
+
+    auto temporary = path;
+    temporary += ".tmp";
+    DX_CHECK(!std::filesystem::exists(temporary));
+
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream text;
+    text << file.rdbuf();
+    file.close();
+    std::filesystem::remove(path);
+
+    auto const document = JsonReader(text.str()).ReadDocument();
+    DX_CHECK_EQUAL(document["traceEvents"].array.size(), size_t(3));
+
+    // An empty capture is still a valid trace
+    auto const empty = WriteAndRead(capture.TakeSnapshot(profiler));
+    DX_CHECK_EQUAL(empty.result.events, size_t(0));
+    DX_CHECK_EQUAL(empty.Events().size(), size_t(1));
+}
@@ -0,0 +1,110 @@
+//
+// TransformSystemBenchmark.cpp - Updating a million entities, serially and a level at a time across workers
+//
+
+#include "TestHarness.h"
+
+#include "JobSystem.h"
+#include "TransformSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+
+namespace
+{
+    // A thousand roots, each with 31 children of 31 children: 993,000 entities in three levels.
+    constexpr uint32_t c_rootCount = 1000;
+    constexpr uint32_t c_fanOut = 31;
+
+    struct Vector
+    {
+        float x, y, z;
+    };
+
+    struct Quaternion
+    {
+        float x, y, z, w;
+    };
+
+    std::vector<DX::Entity> MakeForest(DX::TransformSystem& transforms)
+    {
+        std::vector<DX::Entity> roots;
+        for (uint32_t r = 0; r < c_rootCount; ++r)
+        {
+            roots.push_back(transforms.Create());
+            transforms.SetPosition(roots.back(), Vector{ float(r % 32) * 10.f, 0.f, float(r / 32) * 10.f });
+            for (uint32_t c = 0; c < c_fanOut; ++c)
+            {
+                auto const child = transforms.Create(roots.back());
+                transforms.SetPosition(child, Vector{ 2.f, float(c), 0.f });
+                for (uint32_t g = 0; g < c_fanOut; ++g)
+                {
+                    auto const grandchild = transforms.Create(child);
+                    transforms.SetPosition(grandchild, Vector{ 0.f, 0.f, float(g) * 0.1f });
+                    transforms.SetScale(grandchild, 0.5f);
+                }
+            }
+        }
+        return roots;
+    }
+
+    // Turn every root a little, which dirties every entity below it.
+    void TurnRoots(DX::TransformSystem& transforms, std::vector<DX::Entity> const& roots, float angle)
+    {
+        for (auto const root : roots)
+        {
+            transforms.SetRotation(root, Quaternion{ 0.f, std::sin(angle * 0.5f), 0.f, std::cos(angle * 0.5f) });
+        }
+    }
+}
+
+DX_BENCHMARK(TransformSystem, MillionEntities)
+{
+    DX::JobSystem jobs(std::max(DX::JobSystem::DefaultWorkerCount(), 3u));
+    auto const parallel = [&jobs](size_t count, auto const& body) { jobs.ParallelForRange(count, 4096, body); };
+
+    DX::TransformSystem transforms;
+    auto const roots = MakeForest(transforms);
+
+    // The first update sorts the arrays by depth, then computes everything
+    auto const start = std::chrono::steady_clock::now();
+    transforms.Update();
+    const double first = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    float angle = 0.f;
+    const double serialAll = DX::Test::MeasureNanoseconds(3, [&]()
+        {
+            TurnRoots(transforms, roots, angle += 0.01f);
+            transforms.Update();
+        });
+    const size_t allCount = transforms.GetUpdatedCount();
+
+    const double parallelAll = DX::Test::MeasureNanoseconds(3, [&]()
+        {
+            TurnRoots(transforms, roots, angle += 0.01f);
+            transforms.Update(parallel);
+        });
+
+    // Only a few roots move: the rest of the arrays are skimmed for dirty flags and changed parents
+    const double fewMoved = DX::Test::MeasureNanoseconds(3, [&]()
+        {
+            for (uint32_t r = 0; r < c_rootCount; r += 100)
+            {
+                transforms.SetPosition(roots[r], Vector{ angle += 0.01f, 0.f, 0.f });
+            }
+            transforms.Update(parallel);
+        });
+    const size_t fewCount = transforms.GetUpdatedCount();
+
+    std::printf("  %zu entities in %zu levels, %u workers\n", transforms.GetEntityCount(), transforms.GetDepth(), jobs.GetWorkerCount());
+    std::printf("  first update, sorting: %.2f ms\n", first * 1e-6);
+    std::printf("  %zu updated: serial %.2f ms (%.1f ns each), parallel %.2f ms (%.2fx)\n", allCount, serialAll * 1e-6,
+        serialAll / double(allCount), parallelAll * 1e-6, serialAll / parallelAll);
+    std::printf("  %zu updated: %.2f ms\n", fewCount, fewMoved * 1e-6);
+}
@@ -0,0 +1,374 @@
+//
+// TransformSystemTests.cpp - Depth ordering, dirty propagation, reparenting, and parallel updates matching serial ones
+//
+
+#include "TestHarness.h"
+
+#include "JobSystem.h"
+#include "TransformSystem.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+
+namespace
+{
+    struct Vector
+    {
+        float x, y, z;
+    };
+
+    struct Quaternion
+    {
+        float x, y, z, w;
+    };
+
+    // A rotation of angle radians about a unit axis.
+    Quaternion AxisAngle(Vector axis, float angle)
+    {
+        const float s = std::sin(angle * 0.5f);
+        return Quaternion{ axis.x * s, axis.y * s, axis.z * s, std::cos(angle * 0.5f) };
+    }
+
+    constexpr size_t NoParent = ~size_t(0);
+
+    // What the system stores for each entity, kept alongside it to compute world matrices independently.
+    struct Local
+    {
+        size_t      parent = NoParent;
+        Vector      position{ 0.f, 0.f, 0.f };
+        Quaternion  rotation{ 0.f, 0.f, 0.f, 1.f };
+        float       scale = 1.f;
+    };
+
+    // Scale, rotate, translate, then the parent's world matrix: the long way round, by walking up the hierarchy.
+    DX::TransformMatrix ReferenceWorld(std::vector<Local> const& locals, size_t i)
+    {
+        auto const& local = locals[i];
+        const float x = local.rotation.x, y = local.rotation.y, z = local.rotation.z, w = local.rotation.w;
+        const float s = local.scale;
+        DX::TransformMatrix world = { {
+            { (1.f - 2.f * (y * y + z * z)) * s, 2.f * (x * y + z * w) * s, 2.f * (x * z - y * w) * s, 0.f },
+            { 2.f * (x * y - z * w) * s, (1.f - 2.f * (x * x + z * z)) * s, 2.f * (y * z + x * w) * s, 0.f },
+            { 2.f * (x * z + y * w) * s, 2.f * (y * z - x * w) * s, (1.f - 2.f * (x * x + y * y)) * s, 0.f },
+            { local.position.x, local.position.y, local.position.z, 1.f },
+        } };
+        if (local.parent == NoParent)
+            return world;
+
+        auto const p = ReferenceWorld(locals, local.parent);
+        DX::TransformMatrix product = {};
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int column = 0; column < 4; ++column)
+            {
+                for (int k = 0; k < 4; ++k)
+                {
+                    product.m[row][column] += world.m[row][k] * p.m[k][column];
+                }
+            }
+        }
+        return product;
+    }
+
+    bool IsNear(DX::TransformMatrix const& a, DX::TransformMatrix const& b)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int column = 0; column < 4; ++column)
+            {
+                if (std::fabs(a.m[row][column] - b.m[row][column]) > 1e-4f * (1.f + std::fabs(b.m[row][column])))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // Every entity's world matrix agrees with walking its ancestors.
+    bool MatchesReference(DX::TransformSystem const& transforms, std::vector<Local> const& locals, std::vector<DX::Entity> const& entities)
+    {
+        for (size_t i = 0; i < entities.size(); ++i)
+        {
+            if (!IsNear(transforms.GetWorld(entities[i]), ReferenceWorld(locals, i)))
+                return false;
+        }
+        return true;
+    }
+
+    Vector Translation(DX::TransformMatrix const& world)
+    {
+        return Vector{ world.m[3][0], world.m[3][1], world.m[3][2] };
+    }
+}
+
+DX_TEST(TransformSystem, LocalTransformOrder)
+{
+    // Scale 2, a quarter turn about +Y, then a move: +X goes to -Z, as XMMatrixRotationY turns it
+    DX::TransformSystem transforms;
+    auto const entity = transforms.Create();
+    transforms.SetScale(entity, 2.f);
+    transforms.SetRotation(entity, AxisAngle(Vector{ 0.f, 1.f, 0.f }, 1.5707964f));
+    transforms.SetPosition(entity, Vector{ 1.f, 2.f, 3.f });
+    transforms.Update();
+
+    auto const& world = transforms.GetWorld(entity).m;
+    DX_CHECK(std::fabs(world[0][0]) < 1e-6f && std::fabs(world[0][2] + 2.f) < 1e-6f);
+    DX_CHECK(std::fabs(world[2][0] - 2.f) < 1e-6f && std::fabs(world[2][2]) < 1e-6f);
+    DX_CHECK_EQUAL(world[1][1], 2.f);
+    DX_CHECK_EQUAL(world[3][0], 1.f);
+    DX_CHECK_EQUAL(world[3][1], 2.f);
+    DX_CHECK_EQUAL(world[3][2], 3.f);
+    DX_CHECK_EQUAL(world[3][3], 1.f);
+    DX_CHECK_EQUAL(world[0][3] + world[1][3] + world[2][3], 0.f);
+
+    // A child a unit along its parent's +X lands at the parent's position, one unit and twice scaled along -Z
+    auto const child = transforms.Create(entity);
+    transforms.SetPosition(child, Vector{ 1.f, 0.f, 0.f });
+    transforms.Update();
+    auto const at = Translation(transforms.GetWorld(child));
+    DX_CHECK(std::fabs(at.x - 1.f) < 1e-6f && at.y == 2.f && std::fabs(at.z - 1.f) < 1e-6f);
+}
+
+DX_TEST(TransformSystem, ParentsAreUpdatedBeforeChildren)
+{
+    // Entities created first become the deepest, so parents come after their children until the arrays are sorted
+    DX::TransformSystem transforms;
+    std::vector<DX::Entity> chain;
+    for (int i = 0; i < 6; ++i)
+    {
+        chain.push_back(transforms.Create());
+        transforms.SetPosition(chain.back(), Vector{ 1.f, float(i), 0.f });
+    }
+    for (size_t i = 0; i + 1 < chain.size(); ++i)
+    {
+        transforms.SetParent(chain[i], chain[i + 1]);
+    }
+
+    transforms.Update();
+    DX_CHECK_EQUAL(transforms.GetDepth(), size_t(6));
+    DX_CHECK_EQUAL(transforms.GetUpdatedCount(), size_t(6));
+
+    // Each entity sits at the sum of its own and its ancestors' offsets
+    for (size_t i = 0; i < chain.size(); ++i)
+    {
+        auto const at = Translation(transforms.GetWorld(chain[i]));
+        float y = 0.f;
+        for (size_t ancestor = i; ancestor < chain.size(); ++ancestor)
+        {
+            y += float(ancestor);
+        }
+        DX_CHECK_EQUAL(at.x, float(chain.size() - i));
+        DX_CHECK_EQUAL(at.y, y);
+    }
+
+    // A flat set is a single level
+    DX::TransformSystem flat;
+    flat.Update();
+    DX_CHECK_EQUAL(flat.GetDepth(), size_t(0));
+    flat.Create();
+    flat.Create();
+    flat.Update();
+    DX_CHECK_EQUAL(flat.GetDepth(), size_t(1));
+}
+
+DX_TEST(TransformSystem, OnlyChangedSubtreesAreUpdated)
+{
+    // root has children a and c, and a has a child b; other stands alone
+    DX::TransformSystem transforms;
+    auto const root = transforms.Create();
+    auto const a = transforms.Create(root);
+    auto const b = transforms.Create(a);
+    auto const c = transforms.Create(root);
+    auto const other = transforms.Create();
+
+    transforms.Update();
+    DX_CHECK_EQUAL(transforms.GetUpdatedCount(), size_t(5));
+
+    transforms.Update();
+    DX_CHECK_EQUAL(transforms.GetUpdatedCount(), size_t(0));
+
+    transforms.SetPosition(a, Vector{ 0.f, 1.f, 0.f });
+    transforms.Update();
+    DX_CHECK_EQUAL(transforms.GetUpdatedCount(), size_t(2));
+    DX_CHECK_EQUAL(Translation(transforms.GetWorld(b)).y, 1.f);
+    DX_CHECK_EQUAL(Translation(transforms.GetWorld(c)).y, 0.f);
+
+    transforms.SetPosition(root, Vector{ 0.f, 10.f, 0.f });
+    transforms.Update();
+    DX_CHECK_EQUAL(transforms.GetUpdatedCount(), size_t(4));
+    DX_CHECK_EQUAL(Translation(transforms.GetWorld(b)).y, 11.f);
+    DX_CHECK_EQUAL(Translation(transforms.GetWorld(c)).y, 10.f);
+
+    // A leaf, and several setters on one entity, recompute it once
+    transforms.SetScale(b, 3.f);
+    transforms.SetRotation(b, AxisAngle(Vector{ 1.f, 0.f, 0.f }, 0.5f));
+    transforms.Update();
+    DX_CHECK_EQUAL(transforms.GetUpdatedCount(), size_t(1));
+
+    // A sibling and its parent both dirty: the sibling is recomputed once, after the parent
+    transforms.SetPosition(c, Vector{ 1.f, 0.f, 0.f });
+    transforms.SetPosition(root, Vector{ 0.f, 20.f, 0.f });
+    transforms.SetPosition(other, Vector{ 5.f, 0.f, 0.f });
+    transforms.Update();
+    DX_CHECK_EQUAL(transforms.GetUpdatedCount(), size_t(5));
+    DX_CHECK_EQUAL(Translation(transforms.GetWorld(c)).x, 1.f);
+    DX_CHECK_EQUAL(Translation(transforms.GetWorld(c)).y, 20.f);
+}
+
+DX_TEST(TransformSystem, Reparenting)
+{
+    DX::TransformSystem transforms;
+    auto const left = transforms.Create();
+    auto const right = transforms.Create();
+    auto const arm = transforms.Create(left);
+    auto const hand = transforms.Create(arm);
+    transforms.SetPosition(left, Vector{ -10.f, 0.f, 0.f });
+    transforms.SetPosition(right, Vector{ 10.f, 0.f, 0.f });
+    transforms.SetPosition(arm, Vector{ 0.f, 1.f, 0.f });
+    transforms.SetPosition(hand, Vector{ 0.f, 0.f, 1.f });
+    transforms.Update();
+    DX_CHECK_EQUAL(Translation(transforms.GetWorld(hand)).x, -10.f);
+
+    // The subtree moves with its new parent, and only it is recomputed
+    transforms.SetParent(arm, right);
+    transforms.Update();
+    DX_CHECK_EQUAL(transforms.GetUpdatedCount(), size_t(2));
+    DX_CHECK_EQUAL(Translation(transforms.GetWorld(hand)).x, 10.f);
+    DX_CHECK_EQUAL(Translation(transforms.GetWorld(hand)).z, 1.f);
+    DX_CHECK_EQUAL(transforms.GetDepth(), size_t(3));
+
+    transforms.SetPosition(left, Vector{ -20.f, 0.f, 0.f });
+    transforms.Update();
+    DX_CHECK_EQUAL(transforms.GetUpdatedCount(), size_t(1));
+    DX_CHECK_EQUAL(Translation(transforms.GetWorld(hand)).x, 10.f);
+
+    // To the root, where the local offset is all there is
+    transforms.SetParent(hand, DX::Entity{});
+    transforms.Update();
+    DX_CHECK_EQUAL(transforms.GetDepth(), size_t(2));
+    DX_CHECK_EQUAL(Translation(transforms.GetWorld(hand)).x, 0.f);
+
+    // A cycle is refused, and leaves the hierarchy as it was
+    transforms.SetParent(hand, arm);
+    DX_CHECK_THROWS(transforms.SetParent(right, hand), std::invalid_argument);
+    DX_CHECK_THROWS(transforms.SetParent(arm, arm), std::invalid_argument);
+    transforms.Update();
+    DX_CHECK_EQUAL(transforms.GetDepth(), size_t(3));
+    DX_CHECK_EQUAL(Translation(transforms.GetWorld(hand)).x, 10.f);
+}
+
+DX_TEST(TransformSystem, DestroyTakesDescendants)
+{
+    DX::TransformSystem transforms;
+    auto const root = transforms.Create();
+    auto const child = transforms.Create(root);
+    auto const grandchild = transforms.Create(child);
+    auto const kept = transforms.Create(child);
+    auto const other = transforms.Create();
+    transforms.Update();
+
+    // A child moved out before the update survives; the rest of the subtree goes with its root
+    transforms.Destroy(root);
+    DX_CHECK(!transforms.IsAlive(root));
+    DX_CHECK(transforms.IsAlive(grandchild));
+    transforms.SetParent(kept, other);
+    transforms.Update();
+
+    DX_CHECK(!transforms.IsAlive(child));
+    DX_CHECK(!transforms.IsAlive(grandchild));
+    DX_CHECK(transforms.IsAlive(kept));
+    DX_CHECK_EQUAL(transforms.GetEntityCount(), size_t(2));
+    DX_CHECK_THROWS(transforms.GetWorld(child), std::invalid_argument);
+    DX_CHECK_THROWS(transforms.SetPosition(grandchild, Vector{}), std::invalid_argument);
+
+    // Freed slots are reused under a new generation, so the old handles stay dead
+    auto const reused = transforms.Create();
+    DX_CHECK(reused.index == root.index || reused.index == child.index || reused.index == grandchild.index);
+    DX_CHECK(transforms.IsAlive(reused));
+    DX_CHECK(!transforms.IsAlive(root) && !transforms.IsAlive(child) && !transforms.IsAlive(grandchild));
+    DX_CHECK(!transforms.IsAlive(DX::Entity{}));
+}
+
+DX_TEST(TransformSystem, ParallelUpdateMatchesSerial)
+{
+    // Two systems given the same random forest and the same edits each frame, one updated on the calling thread
+    // and one in small chunks across workers, must agree bit for bit, and with walking each entity's ancestors
+    DX::JobSystem jobs(4);
+    DX::TransformSystem serial;
+    DX::TransformSystem parallel;
+    std::vector<DX::Entity> entities;
+    std::vector<Local> locals;
+    std::mt19937 random(13);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+    auto const create = [&]()
+        {
+            Local local;
+            DX::Entity parent;
+            if (!entities.empty() && random() % 8)
+            {
+                local.parent = random() % entities.size();
+                parent = entities[local.parent];
+            }
+            auto const entity = serial.Create(parent);
+            DX_CHECK(parallel.Create(parent).index == entity.index);
+            entities.push_back(entity);
+            locals.push_back(local);
+        };
+
+    auto const edit = [&](size_t i)
+        {
+            auto& local = locals[i];
+            local.position = Vector{ unit(random) * 4.f, unit(random) * 4.f, unit(random) * 4.f };
+            local.rotation = AxisAngle(Vector{ 0.f, 0.f, 1.f }, unit(random) * 3.f);
+            local.scale = 0.9f + 0.1f * unit(random);
+            for (auto* transforms : { &serial, &parallel })
+            {
+                transforms->SetPosition(entities[i], local.position);
+                transforms->SetRotation(entities[i], local.rotation);
+                transforms->SetScale(entities[i], local.scale);
+            }
+        };
+
+    for (int i = 0; i < 3000; ++i)
+    {
+        create();
+        edit(entities.size() - 1);
+    }
+
+    for (int frame = 0; frame < 12; ++frame)
+    {
+        // Edit a few, and move a few under earlier entities, which keeps the hierarchy acyclic
+        for (int i = 0; i < 200; ++i)
+        {
+            edit(random() % entities.size());
+        }
+        for (int i = 0; i < 20; ++i)
+        {
+            const size_t child = 1 + random() % (entities.size() - 1);
+            locals[child].parent = random() % child;
+            serial.SetParent(entities[child], entities[locals[child].parent]);
+            parallel.SetParent(entities[child], entities[locals[child].parent]);
+        }
+        create();
+
+        serial.Update();
+        parallel.Update([&jobs](size_t count, auto const& body) { jobs.ParallelForRange(count, 16, body); });
+
+        DX_CHECK_EQUAL(parallel.GetUpdatedCount(), serial.GetUpdatedCount());
+        DX_CHECK_EQUAL(parallel.GetDepth(), serial.GetDepth());
+        bool identical = true;
+        for (auto const entity : entities)
+        {
+            identical &= std::memcmp(&serial.GetWorld(entity), &parallel.GetWorld(entity), sizeof(DX::TransformMatrix)) == 0;
+        }
+        DX_CHECK(identical);
+        DX_CHECK(MatchesReference(parallel, locals, entities));
+    }
+    DX_CHECK(serial.GetDepth() > 4);
+}
@@ -0,0 +1,81 @@
+//
+// UploadAllocatorBenchmark.cpp - A frame's dynamic allocations from the ring against the general-purpose heap
+//
+
+#include "TestHarness.h"
+
+#include "UploadAllocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    constexpr size_t AllocationsPerFrame = 2000;
+
+    struct Request
+    {
+        size_t  size;
+        size_t  alignment;
+    };
+
+    // Constants, vertices and instance data: 16 to 4096 bytes, a quarter of them constant buffers.
+    std::vector<Request> MakeFrame()
+    {
+        std::mt19937 random(9);
+        std::vector<Request> requests(AllocationsPerFrame);
+        for (auto& request : requests)
+        {
+            request.size = 16 + random() % (4096 - 16 + 1);
+            request.alignment = (random() % 4 == 0) ? DX::UploadAllocator::ConstantBufferAlignment : 16;
+        }
+        return requests;
+    }
+}
+
+DX_BENCHMARK(UploadAllocator, FrameOfAllocations)
+{
+    auto const requests = MakeFrame();
+
+    // Three frames' worth, so the ring wraps while two frames are in flight
+    DX::UploadAllocator ring(3 * 8 * 1024 * 1024);
+    uint64_t fence = 0;
+    const double ringFrame = DX::Test::MeasureNanoseconds(200, [&]()
+        {
+            for (auto const& request : requests)
+            {
+                ring.Allocate(request.size, request.alignment);
+            }
+            ring.EndFrame(++fence);
+            if (fence > 2)
+            {
+                ring.Retire(fence - 2);
+            }
+        });
+
+    // The general-purpose heap, with every allocation freed once its frame is done
+    std::vector<void*> blocks(AllocationsPerFrame);
+    const double heapFrame = DX::Test::MeasureNanoseconds(200, [&]()
+        {
+            for (size_t i = 0; i < requests.size(); ++i)
+            {
+                blocks[i] = ::operator new(requests[i].size, std::align_val_t(requests[i].alignment));
+            }
+            for (size_t i = 0; i < requests.size(); ++i)
+            {
+                ::operator delete(blocks[i], std::align_val_t(requests[i].alignment));
+            }
+        });
+
+    std::printf("  %zu allocations a frame: ring %.1f ns each (%.1f us a frame), heap %.1f ns each (%.1f us a frame)\n",
+        AllocationsPerFrame, ringFrame / AllocationsPerFrame, ringFrame / 1000.0,
+        heapFrame / AllocationsPerFrame, heapFrame / 1000.0);
+    std::printf("  ring padding: %llu bytes over %llu allocated\n",
+        static_cast<unsigned long long>(ring.GetLastFrameStatistics().paddingBytes),
+        static_cast<unsigned long long>(ring.GetLastFrameStatistics().allocatedBytes));
+}
@@ -0,0 +1,231 @@
+//
+// UploadAllocatorTests.cpp - Ring wrap, alignment padding, statistics, and falling back when the ring is full
+//
+
+#include "TestHarness.h"
+
+#include "UploadAllocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+
+namespace
+{
+    // Ring memory is identified by its offset; fallbacks are numbered, and counted until released.
+    struct Backend
+    {
+        struct Allocation
+        {
+            bool        isFallback;
+            uint64_t    offset;
+            size_t      size;
+        };
+
+        size_t  held = 0;
+        size_t  released = 0;
+
+        Allocation Ring(uint64_t offset, size_t size) { return Allocation{ false, offset, size }; }
+        Allocation Fallback(size_t size, size_t) { return Allocation{ true, held++, size }; }
+        void ReleaseFallbacks() { released += held; held = 0; }
+    };
+}
+
+DX_TEST(UploadAllocator, RejectsBadRequests)
+{
+    DX_CHECK_THROWS(DX::UploadAllocator(0), std::invalid_argument);
+
+    DX::UploadAllocator ring(1024);
+    DX_CHECK_THROWS(ring.TryAllocate(0, 16), std::out_of_range);
+    DX_CHECK_THROWS(ring.TryAllocate(1025, 16), std::out_of_range);
+    DX_CHECK_THROWS(ring.TryAllocate(16, 0), std::invalid_argument);
+    DX_CHECK_THROWS(ring.TryAllocate(16, 24), std::invalid_argument);
+    DX_CHECK_EQUAL(ring.GetInUse(), uint64_t(0));
+}
+
+DX_TEST(UploadAllocator, AlignmentPadding)
+{
+    DX::UploadAllocator ring(1024);
+    DX_CHECK_EQUAL(ring.Allocate(10, 1), uint64_t(0));
+    DX_CHECK_EQUAL(ring.Allocate(16, DX::UploadAllocator::ConstantBufferAlignment), uint64_t(256));
+    DX_CHECK_EQUAL(ring.Allocate(1, 4), uint64_t(272));
+    DX_CHECK_EQUAL(ring.Allocate(8, 8), uint64_t(280));
+
+    auto const& stats = ring.GetFrameStatistics();
+    DX_CHECK_EQUAL(stats.allocatedBytes, uint64_t(35));
+    DX_CHECK_EQUAL(stats.paddingBytes, uint64_t(246 + 7));
+    DX_CHECK_EQUAL(stats.allocationCount, uint64_t(4));
+    DX_CHECK_EQUAL(stats.highWaterMark, uint64_t(288));
+    DX_CHECK_EQUAL(ring.GetInUse(), uint64_t(288));
+}
+
+DX_TEST(UploadAllocator, WrapsAndRetires)
+{
+    DX::UploadAllocator ring(1000);
+    DX_CHECK_EQUAL(ring.Allocate(400, 1), uint64_t(0));
+    DX_CHECK_EQUAL(ring.Allocate(400, 1), uint64_t(400));
+    ring.EndFrame(1);
+
+    // 300 bytes do not fit in the 200 left at the end, and the start is still in flight
+    DX_CHECK(!ring.TryAllocate(300, 1).has_value());
+    DX_CHECK_THROWS(ring.Allocate(300, 1), std::runtime_error);
+    DX_CHECK_EQUAL(ring.GetFrameStatistics().allocationCount, uint64_t(0));
+    DX_CHECK_EQUAL(ring.GetInUse(), uint64_t(800));
+
+    // Once frame 1 completes the allocation wraps to the start, and the skipped end counts as padding
+    ring.Retire(0);
+    DX_CHECK(!ring.TryAllocate(300, 1).has_value());
+    ring.Retire(1);
+    DX_CHECK_EQUAL(ring.GetInUse(), uint64_t(0));
+    DX_CHECK_EQUAL(ring.Allocate(300, 1), uint64_t(0));
+    DX_CHECK_EQUAL(ring.GetFrameStatistics().paddingBytes, uint64_t(200));
+    DX_CHECK_EQUAL(ring.GetInUse(), uint64_t(500));
+
+    ring.EndFrame(2);
+    ring.Retire(2);
+    DX_CHECK_EQUAL(ring.Allocate(650, 1), uint64_t(300));
+
+    // Aligned to 128, the next allocation would end past the ring, so it wraps; the 50 bytes skipped are padding
+    DX_CHECK_EQUAL(ring.Allocate(50, 128), uint64_t(0));
+    DX_CHECK_EQUAL(ring.GetFrameStatistics().paddingBytes, uint64_t(50));
+}
+
+DX_TEST(UploadAllocator, FrameStatistics)
+{
+    DX::UploadAllocator ring(4096);
+    ring.Allocate(1000, 256);
+    ring.Allocate(1000, 256);
+    ring.EndFrame(1);
+
+    // The closed frame's figures are kept; the new frame's high water mark starts from what is still in flight
+    auto const& last = ring.GetLastFrameStatistics();
+    DX_CHECK_EQUAL(last.allocatedBytes, uint64_t(2000));
+    DX_CHECK_EQUAL(last.paddingBytes, uint64_t(24));
+    DX_CHECK_EQUAL(last.allocationCount, uint64_t(2));
+    DX_CHECK_EQUAL(last.highWaterMark, uint64_t(2024));
+    DX_CHECK_EQUAL(ring.GetFrameStatistics().highWaterMark, uint64_t(2024));
+    DX_CHECK_EQUAL(ring.GetFrameStatistics().allocationCount, uint64_t(0));
+
+    ring.Allocate(1000, 1);
+    ring.Retire(1);
+    ring.Allocate(500, 1);
+    ring.EndFrame(2);
+
+    // Frame 2's peak was while frame 1 was still in flight
+    DX_CHECK_EQUAL(ring.GetLastFrameStatistics().highWaterMark, uint64_t(3024));
+    DX_CHECK_EQUAL(ring.GetInUse(), uint64_t(1500));
+
+    // A frame without allocations is closed without adding anything to retire
+    ring.EndFrame(3);
+    DX_CHECK_EQUAL(ring.GetLastFrameStatistics().allocationCount, uint64_t(0));
+    ring.Retire(2);
+    DX_CHECK_EQUAL(ring.GetInUse(), uint64_t(0));
+}
+
+DX_TEST(UploadAllocator, RangesInFlightNeverOverlap)
+{
+    // Random frames, two in flight: every range must be aligned, inside the ring, and clear of every range the GPU
+    // may still be reading
+    constexpr uint64_t Capacity = 64 * 1024;
+    DX::UploadAllocator ring(Capacity);
+
+    struct Range
+    {
+        uint64_t    begin;
+        uint64_t    end;
+    };
+
+    std::mt19937 random(3);
+    std::deque<std::vector<Range>> inFlight;
+    size_t allocations = 0;
+    size_t full = 0;
+    for (uint64_t frame = 1; frame <= 3000; ++frame)
+    {
+        if (inFlight.size() == 2)
+        {
+            ring.Retire(frame - 2);
+            inFlight.pop_front();
+        }
+
+        std::vector<Range> ranges;
+        const uint32_t count = random() % 24;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const uint64_t size = 1 + random() % 4096;
+            const uint64_t alignment = uint64_t(1) << (random() % 9);
+            auto const offset = ring.TryAllocate(size, alignment);
+            if (!offset)
+            {
+                full++;
+                continue;
+            }
+
+            DX_CHECK_EQUAL(*offset % alignment, uint64_t(0));
+            DX_CHECK(*offset + size <= Capacity);
+
+            const Range range{ *offset, *offset + size };
+            for (auto const& frameRanges : inFlight)
+            {
+                for (auto const& other : frameRanges)
+                {
+                    DX_CHECK(range.end <= other.begin || other.end <= range.begin);
+                }
+            }
+            for (auto const& other : ranges)
+            {
+                DX_CHECK(range.end <= other.begin || other.end <= range.begin);
+            }
+            ranges.push_back(range);
+            allocations++;
+        }
+
+        ring.EndFrame(frame);
+        inFlight.push_back(std::move(ranges));
+    }
+
+    DX_CHECK(allocations > 20000);
+    DX_CHECK(full > 0);
+}
+
+DX_TEST(UploadAllocator, FallsBackWhenTheRingIsFull)
+{
+    DX::FallbackUploadAllocator<Backend> allocator(Backend{}, 1024);
+
+    auto const first = allocator.Allocate(600, 16);
+    DX_CHECK(!first.isFallback);
+    DX_CHECK_EQUAL(first.offset, uint64_t(0));
+
+    // No room left in the ring, and more than the whole ring: both come from the fallback, without throwing
+    auto const spill = allocator.Allocate(600, 16);
+    auto const huge = allocator.Allocate(4096, 256);
+    DX_CHECK(spill.isFallback);
+    DX_CHECK(huge.isFallback);
+    DX_CHECK_EQUAL(huge.size, size_t(4096));
+    DX_CHECK_EQUAL(allocator.GetBackend().held, size_t(2));
+
+    // Small requests still fit in the ring's remainder
+    DX_CHECK(!allocator.Allocate(400, 16).isFallback);
+
+    // Closing the frame releases the fallbacks and reports how many there were
+    allocator.EndFrame(1);
+    DX_CHECK_EQUAL(allocator.GetBackend().held, size_t(0));
+    DX_CHECK_EQUAL(allocator.GetBackend().released, size_t(2));
+    DX_CHECK_EQUAL(allocator.GetLastFrameFallbackCount(), size_t(2));
+
+    // Until frame 1 completes the ring stays full
+    DX_CHECK(allocator.Allocate(32, 16).isFallback);
+    allocator.Retire(1);
+    auto const reused = allocator.Allocate(32, 16);
+    DX_CHECK(!reused.isFallback);
+    allocator.EndFrame(2);
+    DX_CHECK_EQUAL(allocator.GetLastFrameFallbackCount(), size_t(1));
+
+    allocator.EndFrame(3);
+    DX_CHECK_EQUAL(allocator.GetLastFrameFallbackCount(), size_t(0));
+    DX_CHECK_EQUAL(allocator.GetRing().GetLastFrameStatistics().allocationCount, uint64_t(0));
+}
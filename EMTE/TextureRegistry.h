@@ -0,0 +1,182 @@
+//
+// TextureRegistry.h - Textures looked up by interned path
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // 64-bit FNV-1a over the path's characters. constexpr, so IDs for known paths are computed at compile time.
+    constexpr uint64_t HashTexturePath(std::wstring_view path) noexcept
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (auto const c : path)
+        {
+            hash ^= static_cast<uint64_t>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // A texture path reduced to its hash. Equal strings always give equal IDs, wherever they are stored.
+    class TextureId
+    {
+    public:
+        constexpr explicit TextureId(std::wstring_view path) noexcept : m_hash(HashTexturePath(path)) {}
+
+        constexpr uint64_t GetHash() const noexcept { return m_hash; }
+
+        constexpr bool operator== (TextureId const&) const noexcept = default;
+
+    private:
+        uint64_t m_hash;
+    };
+
+    // Maps texture paths to values of T. Each path is interned once, when it is registered, and given a dense handle;
+    // after that a handle indexes straight into the values, and an ID is found with a single probe of an open
+    // addressed table of hashes. Two different paths that hash the same are rejected at registration, so an ID never
+    // needs its string to be compared.
+    template<typename T>
+    class TextureRegistry
+    {
+    public:
+        using Handle = uint32_t;
+        static constexpr Handle InvalidHandle = 0xFFFFFFFF;
+
+        explicit TextureRegistry(size_t expectedCount = 64)
+        {
+            Rehash(expectedCount * 2);
+        }
+
+        TextureRegistry(TextureRegistry const&) = delete;
+        TextureRegistry& operator= (TextureRegistry const&) = delete;
+
+        // Add a texture. If the path is already registered its existing handle is returned and value is discarded.
+        Handle Register(std::wstring_view path, T value)
+        {
+            const uint64_t hash = HashTexturePath(path);
+
+            size_t slot = Probe(hash);
+            if (m_slots[slot].handle != InvalidHandle)
+            {
+                if (m_paths[m_slots[slot].handle] != path)
+                {
+                    throw std::runtime_error("Texture path hash collision");
+                }
+                return m_slots[slot].handle;
+            }
+
+            // Keep the table at most half full, so probe sequences stay short
+            if ((m_values.size() + 1) * 2 > m_slots.size())
+            {
+                Rehash(m_slots.size() * 2);
+                slot = Probe(hash);
+            }
+
+            const Handle handle = static_cast<Handle>(m_values.size());
+            m_paths.emplace_back(path);
+            m_values.emplace_back(std::move(value));
+            m_slots[slot] = Slot{ hash, handle };
+            return handle;
+        }
+
+        Handle Find(TextureId id) const noexcept
+        {
+            return m_slots[Probe(id.GetHash())].handle;
+        }
+
+        // Look up by string; the contents are hashed, so the string's address does not matter.
+        Handle Find(std::wstring_view path) const noexcept
+        {
+            const Handle handle = Find(TextureId(path));
+            return (handle != InvalidHandle && m_paths[handle] == path) ? handle : InvalidHandle;
+        }
+
+        bool Contains(std::wstring_view path) const noexcept { return Find(path) != InvalidHandle; }
+
+        T& Get(Handle handle) { return m_values.at(handle); }
+        T const& Get(Handle handle) const { return m_values.at(handle); }
+
+        // As Find, but throwing std::out_of_range if the texture is not registered.
+        T& at(TextureId id) { return m_values[Resolve(Find(id))]; }
+        T const& at(TextureId id) const { return m_values[Resolve(Find(id))]; }
+        T& at(std::wstring_view path) { return m_values[Resolve(Find(path))]; }
+        T const& at(std::wstring_view path) const { return m_values[Resolve(Find(path))]; }
+
+        std::wstring const& GetPath(Handle handle) const { return m_paths.at(handle); }
+
+        size_t size() const noexcept { return m_values.size(); }
+        bool empty() const noexcept { return m_values.empty(); }
+
+        void clear() noexcept
+        {
+            m_paths.clear();
+            m_values.clear();
+            for (auto& slot : m_slots)
+            {
+                slot = Slot{};
+            }
+        }
+
+        // Values in registration order, which is also handle order.
+        auto begin() noexcept { return m_values.begin(); }
+        auto end() noexcept { return m_values.end(); }
+
+    private:
+        struct Slot
+        {
+            uint64_t    hash = 0;
+            Handle      handle = InvalidHandle;
+        };
+
+        static Handle Resolve(Handle handle)
+        {
+            if (handle == InvalidHandle)
+            {
+                throw std::out_of_range("Texture is not registered");
+            }
+            return handle;
+        }
+
+        // Index of the slot holding hash, or of the empty slot where it would go. Linear probing.
+        size_t Probe(uint64_t hash) const noexcept
+        {
+            const size_t mask = m_slots.size() - 1;
+            size_t index = static_cast<size_t>(hash) & mask;
+            while (m_slots[index].handle != InvalidHandle && m_slots[index].hash != hash)
+            {
+                index = (index + 1) & mask;
+            }
+            return index;
+        }
+
+        void Rehash(size_t capacity)
+        {
+            size_t size = 16;
+            while (size < capacity)
+            {
+                size *= 2;
+            }
+
+            m_slots.assign(size, Slot{});
+            for (Handle handle = 0; handle < m_values.size(); ++handle)
+            {
+                const uint64_t hash = HashTexturePath(m_paths[handle]);
+                m_slots[Probe(hash)] = Slot{ hash, handle };
+            }
+        }
+
+        std::vector<Slot>           m_slots;
+        std::vector<std::wstring>   m_paths;
+        std::vector<T>              m_values;
+    };
+}
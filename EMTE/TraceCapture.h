@@ -0,0 +1,430 @@
+//
+// TraceCapture.h - Records profiler zones, fence activity and frame markers in bounded memory, for Chrome tracing
+//
+
+#pragma once
+
+#include "FenceTimeline.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    enum class TraceRecordType : uint32_t
+    {
+        ZoneBegin,
+        ZoneEnd,
+        Frame,
+        FenceSignal,
+        FenceWaitBegin,
+        FenceWaitEnd,
+    };
+
+    // Timestamps are ProfileClock ticks. Names point at storage that outlives the capture: zone names are string
+    // literals, and fence tracks are named by the capture.
+    struct TraceRecord
+    {
+        uint64_t            ticks;
+        uint64_t            value;      // the frame number, or the fence value
+        const char*         name;
+        uint32_t            track;      // the profiler's thread index, or a fence track
+        TraceRecordType     type;
+    };
+
+    struct TraceChunk
+    {
+        static constexpr size_t Capacity = 2048;
+
+        size_t                              count = 0;
+        std::array<TraceRecord, Capacity>   records;
+    };
+
+    // A capture taken out of a TraceCapture, ready to be written on any thread.
+    struct TraceSnapshot
+    {
+        std::vector<std::unique_ptr<TraceChunk>>        chunks;
+        std::vector<std::pair<uint32_t, std::string>>   trackNames;
+        double                                          nanosecondsPerTick = 1.0;
+        uint64_t                                        droppedRecords = 0;
+    };
+
+    // Records into a chain of fixed-size chunks. Once maxBytes of chunks are full, the oldest is recycled, so a
+    // capture always holds the most recent stretch of time that fits. Recording takes a lock, once per batch of
+    // profiler events and once per fence event, and does nothing at all unless a capture is running.
+    //
+    // Install it as the profiler's event sink, and as the observer of the fence timelines to trace. Detach it from
+    // both before it is destroyed.
+    class TraceCapture final : public IProfileEventSink, public IFenceObserver
+    {
+    public:
+        static constexpr uint32_t FenceTrackBase = 0x10000;
+
+        explicit TraceCapture(size_t maxBytes) :
+            m_maxChunks(std::max<size_t>(maxBytes / sizeof(TraceChunk), 1)),
+            m_capturing(false),
+            m_droppedRecords(0)
+        {
+        }
+
+        TraceCapture(TraceCapture const&) = delete;
+        TraceCapture& operator= (TraceCapture const&) = delete;
+
+        void Start() noexcept { m_capturing.store(true, std::memory_order_relaxed); }
+        void Stop() noexcept { m_capturing.store(false, std::memory_order_relaxed); }
+        bool IsCapturing() const noexcept { return m_capturing.load(std::memory_order_relaxed); }
+
+        // Trace timeline's signals and blocking waits on a track of their own.
+        void AddFenceTrack(FenceTimeline& timeline, std::string name)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_fenceTracks.emplace_back(FenceTrack{ &timeline, std::move(name) });
+            timeline.SetObserver(this);
+        }
+
+        void DetachFenceTracks() noexcept
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto const& track : m_fenceTracks)
+            {
+                track.timeline->SetObserver(nullptr);
+            }
+        }
+
+        void RecordFrame(uint64_t frame)
+        {
+            if (IsCapturing())
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                Append(TraceRecord{ ProfileClock::Now(), frame, "Frame", 0, TraceRecordType::Frame });
+            }
+        }
+
+        void OnProfileEvents(uint32_t thread, std::span<const ProfileEvent> events) override
+        {
+            if (!IsCapturing())
+                return;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto const& event : events)
+            {
+                Append(TraceRecord{ event.ticks, 0, event.GetZone()->name, thread,
+                    event.IsEnd() ? TraceRecordType::ZoneEnd : TraceRecordType::ZoneBegin });
+            }
+        }
+
+        void OnSignal(FenceTimeline const& timeline, uint64_t value) noexcept override
+        {
+            RecordFence(timeline, value, TraceRecordType::FenceSignal);
+        }
+
+        void OnWaitBegin(FenceTimeline const& timeline, uint64_t value) noexcept override
+        {
+            RecordFence(timeline, value, TraceRecordType::FenceWaitBegin);
+        }
+
+        void OnWaitEnd(FenceTimeline const& timeline, uint64_t value) noexcept override
+        {
+            RecordFence(timeline, value, TraceRecordType::FenceWaitEnd);
+        }
+
+        // Take everything recorded so far, leaving the capture empty but still running if it was. Cheap enough for
+        // the render thread: the chunks are moved, not copied.
+        TraceSnapshot TakeSnapshot(Profiler const& profiler)
+        {
+            TraceSnapshot snapshot;
+            snapshot.nanosecondsPerTick = profiler.GetNanosecondsPerTick();
+            for (uint32_t thread = 0; thread < profiler.GetThreadCount(); ++thread)
+            {
+                snapshot.trackNames.emplace_back(thread, profiler.GetThreadName(thread));
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (uint32_t track = 0; track < m_fenceTracks.size(); ++track)
+            {
+                snapshot.trackNames.emplace_back(FenceTrackBase + track, m_fenceTracks[track].name);
+            }
+
+            snapshot.chunks.reserve(m_chunks.size());
+            for (auto& chunk : m_chunks)
+            {
+                snapshot.chunks.emplace_back(std::move(chunk));
+            }
+            m_chunks.clear();
+            snapshot.droppedRecords = std::exchange(m_droppedRecords, 0);
+            return snapshot;
+        }
+
+        // Records held, and records lost to recycling since the last snapshot.
+        size_t GetRecordCount() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_chunks.empty() ? 0 : (m_chunks.size() - 1) * TraceChunk::Capacity + m_chunks.back()->count;
+        }
+        uint64_t GetDroppedCount() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_droppedRecords;
+        }
+        size_t GetCapacityBytes() const noexcept { return m_maxChunks * sizeof(TraceChunk); }
+
+    private:
+        struct FenceTrack
+        {
+            FenceTimeline*  timeline;
+            std::string     name;
+        };
+
+        void RecordFence(FenceTimeline const& timeline, uint64_t value, TraceRecordType type) noexcept
+        {
+            if (!IsCapturing())
+                return;
+
+            const uint64_t ticks = ProfileClock::Now();
+            try
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (uint32_t track = 0; track < m_fenceTracks.size(); ++track)
+                {
+                    if (m_fenceTracks[track].timeline == &timeline)
+                    {
+                        Append(TraceRecord{ ticks, value, m_fenceTracks[track].name.c_str(), FenceTrackBase + track, type });
+                        break;
+                    }
+                }
+            }
+            catch (...)
+            {
+                // The record is lost, and tracing must not take the frame down with it
+            }
+        }
+
+        // Call with the lock held.
+        void Append(TraceRecord const& record)
+        {
+            if (m_chunks.empty() || m_chunks.back()->count == TraceChunk::Capacity)
+            {
+                std::unique_ptr<TraceChunk> chunk;
+                if (m_chunks.size() == m_maxChunks)
+                {
+                    chunk = std::move(m_chunks.front());
+                    m_chunks.pop_front();
+                    m_droppedRecords += chunk->count;
+                    chunk->count = 0;
+                }
+                else
+                {
+                    chunk = std::make_unique<TraceChunk>();
+                }
+                m_chunks.emplace_back(std::move(chunk));
+            }
+
+            auto& chunk = *m_chunks.back();
+            chunk.records[chunk.count++] = record;
+        }
+
+        size_t                                      m_maxChunks;
+        std::atomic<bool>                           m_capturing;
+
+        mutable std::mutex                          m_mutex;
+        std::deque<std::unique_ptr<TraceChunk>>     m_chunks;
+        uint64_t                                    m_droppedRecords;
+        std::deque<FenceTrack>                      m_fenceTracks;
+    };
+
+    struct TraceWriteResult
+    {
+        size_t  events;         // trace events written, not counting metadata
+        size_t  unmatched;      // zone and wait ends or beginnings whose other half was not in the capture
+    };
+
+    namespace Detail
+    {
+        inline void WriteJsonString(std::ostream& stream, std::string_view text)
+        {
+            stream.put('"');
+            for (const char c : text)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    stream.put('\\');
+                    stream.put(c);
+                }
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(c));
+                    stream << escaped;
+                }
+                else
+                {
+                    stream.put(c);
+                }
+            }
+            stream.put('"');
+        }
+    }
+
+    // Write a snapshot as Chrome Trace Event Format JSON, which chrome://tracing and Perfetto open. Zones and fence
+    // waits become complete ("X") events, fence signals instant events on their fence's track, and frames global
+    // instant events. Timestamps are microseconds from the earliest record. Streams as it goes, so memory does not
+    // grow with the capture.
+    inline TraceWriteResult WriteChromeTrace(TraceSnapshot const& snapshot, std::ostream& stream)
+    {
+        TraceWriteResult result = {};
+
+        uint64_t baseTicks = UINT64_MAX;
+        for (auto const& chunk : snapshot.chunks)
+        {
+            for (size_t i = 0; i < chunk->count; ++i)
+            {
+                baseTicks = std::min(baseTicks, chunk->records[i].ticks);
+            }
+        }
+
+        char number[64];
+        auto const writeMicroseconds = [&](uint64_t ticks)
+            {
+                const double microseconds = static_cast<double>(ticks) * snapshot.nanosecondsPerTick / 1000.0;
+                std::snprintf(number, sizeof(number), "%.3f", microseconds);
+                stream << number;
+            };
+
+        bool first = true;
+        auto const beginEvent = [&]()
+            {
+                stream << (first ? "\n" : ",\n");
+                first = false;
+            };
+
+        stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        beginEvent();
+        stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"EMTE\"}}";
+        for (auto const& [track, name] : snapshot.trackNames)
+        {
+            beginEvent();
+            stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track << ",\"args\":{\"name\":";
+            Detail::WriteJsonString(stream, name);
+            stream << "}}";
+        }
+
+        auto const writeComplete = [&](TraceRecord const& begin, TraceRecord const& end)
+            {
+                beginEvent();
+                stream << "{\"name\":";
+                Detail::WriteJsonString(stream, begin.type == TraceRecordType::ZoneBegin ? begin.name : "Wait");
+                stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << begin.track << ",\"ts\":";
+                writeMicroseconds(begin.ticks - baseTicks);
+                stream << ",\"dur\":";
+                writeMicroseconds(end.ticks > begin.ticks ? end.ticks - begin.ticks : 0);
+                if (begin.type == TraceRecordType::FenceWaitBegin)
+                {
+                    stream << ",\"args\":{\"value\":" << begin.value << "}";
+                }
+                stream << "}";
+                result.events++;
+            };
+
+        // Open zones and waits, per track
+        std::unordered_map<uint32_t, std::vector<TraceRecord>> open;
+        for (auto const& chunk : snapshot.chunks)
+        {
+            for (size_t i = 0; i < chunk->count; ++i)
+            {
+                auto const& record = chunk->records[i];
+                switch (record.type)
+                {
+                case TraceRecordType::ZoneBegin:
+                case TraceRecordType::FenceWaitBegin:
+                    open[record.track].push_back(record);
+                    break;
+
+                case TraceRecordType::ZoneEnd:
+                case TraceRecordType::FenceWaitEnd:
+                {
+                    // A zone ends the innermost open zone of its name; a wait the latest wait for its value
+                    auto& stack = open[record.track];
+                    const bool isZone = record.type == TraceRecordType::ZoneEnd;
+                    auto const match = std::find_if(stack.rbegin(), stack.rend(), [&](TraceRecord const& begin)
+                        {
+                            return isZone ? (begin.type == TraceRecordType::ZoneBegin && begin.name == record.name)
+                                : (begin.type == TraceRecordType::FenceWaitBegin && begin.value == record.value);
+                        });
+                    if (match == stack.rend())
+                    {
+                        result.unmatched++;
+                        break;
+                    }
+
+                    writeComplete(*match, record);
+                    const auto index = static_cast<size_t>(stack.rend() - match) - 1;
+                    result.unmatched += stack.size() - index - 1;
+                    stack.resize(index);
+                    break;
+                }
+
+                case TraceRecordType::Frame:
+                    beginEvent();
+                    stream << "{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":";
+                    writeMicroseconds(record.ticks - baseTicks);
+                    stream << ",\"args\":{\"frame\":" << record.value << "}}";
+                    result.events++;
+                    break;
+
+                case TraceRecordType::FenceSignal:
+                    beginEvent();
+                    stream << "{\"name\":\"Signal\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" << record.track << ",\"ts\":";
+                    writeMicroseconds(record.ticks - baseTicks);
+                    stream << ",\"args\":{\"value\":" << record.value << "}}";
+                    result.events++;
+                    break;
+                }
+            }
+        }
+
+        for (auto const& [track, stack] : open)
+        {
+            result.unmatched += stack.size();
+        }
+
+        stream << "\n]}\n";
+        return result;
+    }
+
+    // Write the trace to a temporary file and move it over path, so a failed export leaves no half-written trace.
+    inline TraceWriteResult WriteChromeTrace(TraceSnapshot const& snapshot, std::filesystem::path const& path)
+    {
+        auto temporary = path;
+        temporary += ".tmp";
+        TraceWriteResult result;
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            result = WriteChromeTrace(snapshot, file);
+            if (!file.flush())
+            {
+                throw std::runtime_error("Failed to write the trace");
+            }
+        }
+        std::filesystem::rename(temporary, path);
+        return result;
+    }
+}
@@ -0,0 +1,411 @@
+//
+// TransformSystem.h - Entities with a position, rotation and scale in a parent/child hierarchy
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // A world matrix, laid out as an XMFLOAT4X4 and used with row vectors as DirectXMath does.
+    struct TransformMatrix
+    {
+        float m[4][4];
+    };
+
+    // A handle to an entity. Each slot carries a generation that is bumped when its entity is destroyed, so stale
+    // handles are caught rather than silently naming a new entity.
+    struct Entity
+    {
+        static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+        uint32_t index = InvalidIndex;
+        uint32_t generation = 0;
+
+        bool IsValid() const noexcept { return index != InvalidIndex; }
+    };
+
+    // Owns the transforms of every entity. Each component is an array of its own, indexed alike, so an update
+    // streams through exactly the data it uses.
+    //
+    // The arrays are kept sorted by depth in the hierarchy, every parent before its children, so that Update can
+    // compute world matrices a level at a time, and each level in parallel. Setting a transform marks it dirty;
+    // Update recomputes only dirty entities and the descendants of those whose world matrix changed.
+    //
+    // Creating, destroying and reparenting entities is cheap, but the next Update re-sorts the arrays.
+    class TransformSystem
+    {
+    public:
+        static constexpr uint32_t InvalidIndex = Entity::InvalidIndex;
+
+        TransformSystem() noexcept :
+            m_liveCount(0),
+            m_orderDirty(false),
+            m_updateStamp(0),
+            m_updatedCount(0)
+        {
+        }
+
+        TransformSystem(TransformSystem const&) = delete;
+        TransformSystem& operator= (TransformSystem const&) = delete;
+
+        // Create an entity at the origin with no rotation and unit scale, as a child of parent if it is valid.
+        Entity Create(Entity parent = {})
+        {
+            const uint32_t parentDense = parent.IsValid() ? GetDense(parent) : InvalidIndex;
+
+            uint32_t slot;
+            if (!m_freeSlots.empty())
+            {
+                slot = m_freeSlots.back();
+                m_freeSlots.pop_back();
+            }
+            else
+            {
+                slot = static_cast<uint32_t>(m_slots.size());
+                m_slots.push_back(Slot{});
+            }
+
+            const auto dense = static_cast<uint32_t>(m_parent.size());
+            m_slots[slot].dense = dense;
+
+            m_positionX.push_back(0.f); m_positionY.push_back(0.f); m_positionZ.push_back(0.f);
+            m_rotationX.push_back(0.f); m_rotationY.push_back(0.f); m_rotationZ.push_back(0.f); m_rotationW.push_back(1.f);
+            m_scaleX.push_back(1.f); m_scaleY.push_back(1.f); m_scaleZ.push_back(1.f);
+            m_parent.push_back(parentDense);
+            m_slotOf.push_back(slot);
+            m_dirty.push_back(1);
+            m_alive.push_back(1);
+            m_changed.push_back(0);
+            m_world.push_back(TransformMatrix{});
+
+            m_liveCount++;
+            m_orderDirty = true;
+            return Entity{ slot, m_slots[slot].generation };
+        }
+
+        // Destroy an entity. Its handle is invalid from now on; its descendants are destroyed by the next Update.
+        void Destroy(Entity entity)
+        {
+            const uint32_t dense = GetDense(entity);
+            m_alive[dense] = 0;
+            m_slots[entity.index].generation++;
+            m_slots[entity.index].dense = InvalidIndex;
+            m_freeSlots.push_back(entity.index);
+
+            m_liveCount--;
+            m_orderDirty = true;
+        }
+
+        bool IsAlive(Entity entity) const noexcept
+        {
+            return entity.index < m_slots.size() && m_slots[entity.index].generation == entity.generation
+                && m_slots[entity.index].dense != InvalidIndex && m_alive[m_slots[entity.index].dense];
+        }
+
+        // Move an entity, with its descendants, under another parent, or to the root if parent is invalid.
+        void SetParent(Entity entity, Entity parent)
+        {
+            const uint32_t dense = GetDense(entity);
+            const uint32_t parentDense = parent.IsValid() ? GetDense(parent) : InvalidIndex;
+
+            for (uint32_t ancestor = parentDense; ancestor != InvalidIndex; ancestor = m_parent[ancestor])
+            {
+                if (ancestor == dense)
+                {
+                    throw std::invalid_argument("TransformSystem parent is a descendant of the entity");
+                }
+            }
+
+            m_parent[dense] = parentDense;
+            m_dirty[dense] = 1;
+            m_orderDirty = true;
+        }
+
+        // TVector is any type with x, y and z members; TQuaternion with x, y, z and w.
+        template<typename TVector>
+        void SetPosition(Entity entity, TVector const& position)
+        {
+            const uint32_t dense = GetDense(entity);
+            m_positionX[dense] = position.x;
+            m_positionY[dense] = position.y;
+            m_positionZ[dense] = position.z;
+            m_dirty[dense] = 1;
+        }
+
+        template<typename TQuaternion>
+        void SetRotation(Entity entity, TQuaternion const& rotation)
+        {
+            const uint32_t dense = GetDense(entity);
+            m_rotationX[dense] = rotation.x;
+            m_rotationY[dense] = rotation.y;
+            m_rotationZ[dense] = rotation.z;
+            m_rotationW[dense] = rotation.w;
+            m_dirty[dense] = 1;
+        }
+
+        void SetScale(Entity entity, float x, float y, float z)
+        {
+            const uint32_t dense = GetDense(entity);
+            m_scaleX[dense] = x;
+            m_scaleY[dense] = y;
+            m_scaleZ[dense] = z;
+            m_dirty[dense] = 1;
+        }
+
+        void SetScale(Entity entity, float scale) { SetScale(entity, scale, scale, scale); }
+
+        // The world matrix as of the last Update.
+        TransformMatrix const& GetWorld(Entity entity) const { return m_world[GetDense(entity)]; }
+
+        // Recompute the world matrices that have changed. forRange(count, body) must call body(begin, end) over
+        // disjoint ranges covering [0, count), possibly in parallel, and return once all of them have; it is
+        // called once per level of the hierarchy.
+        template<typename TForRange>
+        void Update(TForRange&& forRange)
+        {
+            if (m_orderDirty)
+            {
+                Sort();
+            }
+
+            const uint32_t stamp = ++m_updateStamp;
+            std::atomic<size_t> updated = 0;
+            for (size_t level = 0; level + 1 < m_levels.size(); ++level)
+            {
+                const uint32_t levelStart = m_levels[level];
+                forRange(size_t(m_levels[level + 1] - levelStart), [&, levelStart, stamp](size_t begin, size_t end)
+                    {
+                        const size_t count = UpdateRange(levelStart + begin, levelStart + end, stamp);
+                        updated.fetch_add(count, std::memory_order_relaxed);
+                    });
+            }
+            m_updatedCount = updated.load(std::memory_order_relaxed);
+        }
+
+        // Update on the calling thread alone.
+        void Update()
+        {
+            Update([](size_t count, auto const& body)
+                {
+                    if (count)
+                    {
+                        body(size_t(0), count);
+                    }
+                });
+        }
+
+        size_t GetEntityCount() const noexcept { return m_liveCount; }
+
+        // Levels in the hierarchy, as of the last Update; one if no entity has a parent.
+        size_t GetDepth() const noexcept { return m_levels.empty() ? 0 : m_levels.size() - 1; }
+
+        // World matrices recomputed by the last Update.
+        size_t GetUpdatedCount() const noexcept { return m_updatedCount; }
+
+    private:
+        struct Slot
+        {
+            uint32_t dense = InvalidIndex;
+            uint32_t generation = 0;
+        };
+
+        uint32_t GetDense(Entity entity) const
+        {
+            if (!IsAlive(entity))
+            {
+                throw std::invalid_argument("TransformSystem entity is not alive");
+            }
+            return m_slots[entity.index].dense;
+        }
+
+        // Compute the world matrices of [begin, end), whose parents are all up to date.
+        size_t UpdateRange(size_t begin, size_t end, uint32_t stamp) noexcept
+        {
+            size_t updated = 0;
+            for (size_t i = begin; i < end; ++i)
+            {
+                const uint32_t parent = m_parent[i];
+                if (!m_dirty[i] && (parent == InvalidIndex || m_changed[parent] != stamp))
+                    continue;
+
+                // Scale, then rotate, then translate, as XMMatrixAffineTransformation
+                const float x = m_rotationX[i], y = m_rotationY[i], z = m_rotationZ[i], w = m_rotationW[i];
+                const float sx = m_scaleX[i], sy = m_scaleY[i], sz = m_scaleZ[i];
+                const float local[4][3] =
+                {
+                    { (1.f - 2.f * (y * y + z * z)) * sx, 2.f * (x * y + z * w) * sx, 2.f * (x * z - y * w) * sx },
+                    { 2.f * (x * y - z * w) * sy, (1.f - 2.f * (x * x + z * z)) * sy, 2.f * (y * z + x * w) * sy },
+                    { 2.f * (x * z + y * w) * sz, 2.f * (y * z - x * w) * sz, (1.f - 2.f * (x * x + y * y)) * sz },
+                    { m_positionX[i], m_positionY[i], m_positionZ[i] },
+                };
+
+                auto& world = m_world[i].m;
+                if (parent == InvalidIndex)
+                {
+                    for (int row = 0; row < 4; ++row)
+                    {
+                        world[row][0] = local[row][0];
+                        world[row][1] = local[row][1];
+                        world[row][2] = local[row][2];
+                        world[row][3] = row == 3 ? 1.f : 0.f;
+                    }
+                }
+                else
+                {
+                    auto const& p = m_world[parent].m;
+                    for (int row = 0; row < 4; ++row)
+                    {
+                        const float translate = row == 3 ? 1.f : 0.f;
+                        for (int column = 0; column < 3; ++column)
+                        {
+                            world[row][column] = local[row][0] * p[0][column] + local[row][1] * p[1][column]
+                                + local[row][2] * p[2][column] + translate * p[3][column];
+                        }
+                        world[row][3] = translate;
+                    }
+                }
+
+                m_dirty[i] = 0;
+                m_changed[i] = stamp;
+                updated++;
+            }
+            return updated;
+        }
+
+        // Drop destroyed entities and their descendants, and order the rest by depth.
+        void Sort()
+        {
+            const size_t count = m_parent.size();
+
+            // Depth of each entity, or InvalidIndex if it or an ancestor was destroyed. Parents may still follow
+            // their children here, so each entity walks up to the nearest ancestor whose depth is known.
+            std::vector<uint32_t> depth(count, InvalidIndex - 1);
+            std::vector<uint32_t> chain;
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto current = static_cast<uint32_t>(i);
+                while (current != InvalidIndex && depth[current] == InvalidIndex - 1)
+                {
+                    chain.push_back(current);
+                    current = m_parent[current];
+                }
+
+                uint32_t known = current == InvalidIndex ? InvalidIndex - 1 : depth[current];
+                for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+                {
+                    const bool dead = !m_alive[*it] || known == InvalidIndex;
+                    known = dead ? InvalidIndex : (known == InvalidIndex - 1 ? 0 : known + 1);
+                    depth[*it] = known;
+                }
+                chain.clear();
+            }
+
+            // Counting sort by depth; the order within a level is kept
+            uint32_t levelCount = 0;
+            for (auto const d : depth)
+            {
+                if (d != InvalidIndex)
+                    levelCount = std::max(levelCount, d + 1);
+            }
+            m_levels.assign(size_t(levelCount) + 1, 0);
+            for (auto const d : depth)
+            {
+                if (d != InvalidIndex)
+                    m_levels[d + 1]++;
+            }
+            for (size_t level = 1; level < m_levels.size(); ++level)
+            {
+                m_levels[level] += m_levels[level - 1];
+            }
+
+            std::vector<uint32_t> order(m_levels.back());
+            std::vector<uint32_t> remap(count, InvalidIndex);
+            {
+                std::vector<uint32_t> next(m_levels.begin(), m_levels.end() - 1);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    if (depth[i] == InvalidIndex)
+                        continue;
+                    remap[i] = next[depth[i]]++;
+                    order[remap[i]] = static_cast<uint32_t>(i);
+                }
+            }
+
+            // Descendants of destroyed entities still hold their slots
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (depth[i] == InvalidIndex && m_alive[i])
+                {
+                    auto& slot = m_slots[m_slotOf[i]];
+                    slot.generation++;
+                    slot.dense = InvalidIndex;
+                    m_freeSlots.push_back(m_slotOf[i]);
+                    m_liveCount--;
+                }
+            }
+
+            Permute(m_positionX, order); Permute(m_positionY, order); Permute(m_positionZ, order);
+            Permute(m_rotationX, order); Permute(m_rotationY, order); Permute(m_rotationZ, order); Permute(m_rotationW, order);
+            Permute(m_scaleX, order); Permute(m_scaleY, order); Permute(m_scaleZ, order);
+            Permute(m_slotOf, order);
+            Permute(m_dirty, order);
+            Permute(m_alive, order);
+            Permute(m_changed, order);
+            Permute(m_world, order);
+            Permute(m_parent, order);
+            for (auto& parent : m_parent)
+            {
+                parent = parent == InvalidIndex ? InvalidIndex : remap[parent];
+            }
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                m_slots[m_slotOf[i]].dense = static_cast<uint32_t>(i);
+            }
+
+            m_orderDirty = false;
+        }
+
+        template<typename T>
+        static void Permute(std::vector<T>& values, std::vector<uint32_t> const& order)
+        {
+            std::vector<T> sorted(order.size());
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                sorted[i] = values[order[i]];
+            }
+            values.swap(sorted);
+        }
+
+        // Indexed by entity slot
+        std::vector<Slot>               m_slots;
+        std::vector<uint32_t>           m_freeSlots;
+
+        // Indexed by position in depth order
+        std::vector<float>              m_positionX, m_positionY, m_positionZ;
+        std::vector<float>              m_rotationX, m_rotationY, m_rotationZ, m_rotationW;
+        std::vector<float>              m_scaleX, m_scaleY, m_scaleZ;
+        std::vector<uint32_t>           m_parent;
+        std::vector<uint32_t>           m_slotOf;
+        std::vector<uint8_t>            m_dirty;
+        std::vector<uint8_t>            m_alive;
+        std::vector<uint32_t>           m_changed;
+        std::vector<TransformMatrix>    m_world;
+
+        // m_levels[d] is where depth d starts; the last entry is the entity count
+        std::vector<uint32_t>           m_levels;
+
+        size_t                          m_liveCount;
+        bool                            m_orderDirty;
+        uint32_t                        m_updateStamp;
+        size_t                          m_updatedCount;
+    };
+}
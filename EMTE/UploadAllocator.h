@@ -0,0 +1,209 @@
+//
+// UploadAllocator.h - Per-frame sub-allocation from a ring of upload memory, reclaimed by fence value
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+
+namespace DX
+{
+    // Hands out aligned ranges of a ring buffer for one frame's dynamic data. Allocation only bumps the head; a
+    // frame's ranges are all reclaimed at once, when the GPU reaches the fence value passed to EndFrame. Ranges
+    // never straddle the end of the ring, and the skipped remainder counts as padding.
+    //
+    // Offsets are relative to the start of the ring, so the memory behind it must be aligned to the largest
+    // alignment requested. This only tracks offsets; it never touches the memory itself.
+    class UploadAllocator
+    {
+    public:
+        // Constant buffer views must start on a 256 byte boundary
+        static constexpr uint64_t ConstantBufferAlignment = 256;
+
+        struct Statistics
+        {
+            uint64_t    allocatedBytes;     // bytes requested
+            uint64_t    paddingBytes;       // bytes lost to alignment, and to skipping the end of the ring
+            uint64_t    allocationCount;
+            uint64_t    highWaterMark;      // most bytes in use at once, including frames still in flight
+        };
+
+        explicit UploadAllocator(uint64_t capacity) :
+            m_capacity(capacity),
+            m_head(0),
+            m_tail(0),
+            m_frameStart(0),
+            m_frame{},
+            m_lastFrame{}
+        {
+            if (capacity == 0)
+            {
+                throw std::invalid_argument("UploadAllocator needs a capacity");
+            }
+        }
+
+        UploadAllocator(UploadAllocator const&) = delete;
+        UploadAllocator& operator= (UploadAllocator const&) = delete;
+
+        // Allocate size bytes for the current frame, returning their offset in the ring, or nothing if the frames
+        // still in flight leave no room. alignment must be a power of two.
+        std::optional<uint64_t> TryAllocate(uint64_t size, uint64_t alignment)
+        {
+            if (size == 0 || size > m_capacity)
+            {
+                throw std::out_of_range("UploadAllocator allocation size");
+            }
+            if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+            {
+                throw std::invalid_argument("UploadAllocator alignment must be a power of two");
+            }
+
+            uint64_t start = m_head;
+            const uint64_t offset = start % m_capacity;
+            const uint64_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+            if (aligned + size > m_capacity)
+            {
+                start += m_capacity - offset;
+            }
+            else
+            {
+                start += aligned - offset;
+            }
+
+            if (start + size - m_tail > m_capacity)
+                return std::nullopt;
+
+            m_frame.allocatedBytes += size;
+            m_frame.paddingBytes += start - m_head;
+            m_frame.allocationCount++;
+            m_head = start + size;
+            m_frame.highWaterMark = std::max(m_frame.highWaterMark, m_head - m_tail);
+            return start % m_capacity;
+        }
+
+        uint64_t Allocate(uint64_t size, uint64_t alignment)
+        {
+            auto const offset = TryAllocate(size, alignment);
+            if (!offset)
+            {
+                throw std::runtime_error("UploadAllocator ring is full");
+            }
+            return *offset;
+        }
+
+        // Close the current frame's allocations; they are reclaimed once fenceValue completes.
+        void EndFrame(uint64_t fenceValue)
+        {
+            if (m_head != m_frameStart)
+            {
+                m_frames.emplace_back(fenceValue, m_head);
+                m_frameStart = m_head;
+            }
+
+            m_lastFrame = m_frame;
+            m_frame = {};
+            m_frame.highWaterMark = m_head - m_tail;
+        }
+
+        // Reclaim every frame whose fence value has been reached.
+        void Retire(uint64_t completedValue) noexcept
+        {
+            while (!m_frames.empty() && m_frames.front().first <= completedValue)
+            {
+                m_tail = m_frames.front().second;
+                m_frames.pop_front();
+            }
+        }
+
+        uint64_t GetCapacity() const noexcept { return m_capacity; }
+        uint64_t GetInUse() const noexcept { return m_head - m_tail; }
+
+        // The frame being allocated, and the last one closed by EndFrame.
+        Statistics const& GetFrameStatistics() const noexcept { return m_frame; }
+        Statistics const& GetLastFrameStatistics() const noexcept { return m_lastFrame; }
+
+    private:
+        uint64_t                                    m_capacity;
+
+        // Tracked with monotonic offsets, so that full and empty are distinguishable.
+        uint64_t                                    m_head;
+        uint64_t                                    m_tail;
+        uint64_t                                    m_frameStart;
+        std::deque<std::pair<uint64_t, uint64_t>>   m_frames;
+
+        Statistics                                  m_frame;
+        Statistics                                  m_lastFrame;
+    };
+
+    // Sub-allocates a ring of upload memory with an UploadAllocator, and takes whatever does not fit from a fallback
+    // allocator instead, so that a spike costs an allocation rather than a stall. Fallback allocations are held until
+    // the frame ends.
+    //
+    // TBackend must provide:
+    //     using Allocation = ...;
+    //     Allocation Ring(uint64_t offset, size_t size);           // the ring's memory at offset
+    //     Allocation Fallback(size_t size, size_t alignment);      // memory from elsewhere, held until released
+    //     void ReleaseFallbacks();                                 // the frame holding them has been closed
+    template<typename TBackend>
+    class FallbackUploadAllocator
+    {
+    public:
+        using Allocation = typename TBackend::Allocation;
+
+        FallbackUploadAllocator(TBackend backend, uint64_t capacity) :
+            m_backend(std::move(backend)),
+            m_ring(capacity),
+            m_frameFallbackCount(0),
+            m_lastFrameFallbackCount(0)
+        {
+        }
+
+        FallbackUploadAllocator(FallbackUploadAllocator const&) = delete;
+        FallbackUploadAllocator& operator= (FallbackUploadAllocator const&) = delete;
+
+        Allocation Allocate(size_t size, size_t alignment)
+        {
+            if (size <= m_ring.GetCapacity())
+            {
+                if (auto const offset = m_ring.TryAllocate(size, alignment))
+                {
+                    return m_backend.Ring(*offset, size);
+                }
+            }
+
+            m_frameFallbackCount++;
+            return m_backend.Fallback(size, alignment);
+        }
+
+        // Close the frame; its ring memory is reused once the GPU reaches fenceValue.
+        void EndFrame(uint64_t fenceValue)
+        {
+            m_ring.EndFrame(fenceValue);
+            m_backend.ReleaseFallbacks();
+
+            m_lastFrameFallbackCount = m_frameFallbackCount;
+            m_frameFallbackCount = 0;
+        }
+
+        void Retire(uint64_t completedValue) noexcept { m_ring.Retire(completedValue); }
+
+        UploadAllocator const& GetRing() const noexcept { return m_ring; }
+        TBackend& GetBackend() noexcept { return m_backend; }
+
+        // Allocations of the last frame that did not fit in the ring.
+        size_t GetLastFrameFallbackCount() const noexcept { return m_lastFrameFallbackCount; }
+
+    private:
+        TBackend            m_backend;
+        UploadAllocator     m_ring;
+        size_t              m_frameFallbackCount;
+        size_t              m_lastFrameFallbackCount;
+    };
+}